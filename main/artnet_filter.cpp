@@ -0,0 +1,156 @@
+#include "artnet_filter.h"
+#include <string>
+#include <algorithm>
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+
+static constexpr int64_t g_s64TokenCredit = 1000000; // one packet, credit is refilled per microsecond
+static constexpr int64_t g_s64MaximumCredit = PROJECT_ARTNET_FILTER_BURST * g_s64TokenCredit;
+
+ArtNetFilter::ArtNetFilter()
+{
+    for (SourceBucket &stBucket : m_aBuckets)
+    {
+        stBucket.u32Ip = 0;
+        stBucket.s64Credit = 0;
+        stBucket.s64LastUs = 0;
+    }
+    m_aAllowed.fill(0);
+    m_s32AllowedCount = 0;
+    m_aStartUniv.fill(0);
+    m_aEndUniv.fill(0);
+    m_u32Revision = 0;
+    m_bConfigured = false;
+    m_u32PassedCount = 0;
+    m_aDropCount.fill(0);
+}
+
+void ArtNetFilter::Configure()
+{
+    const Settings &oSettings = Settings::GetInstance();
+    m_u32Revision = oSettings.GetRevision();
+    m_bConfigured = true;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        m_aStartUniv[i] = oSettings.GetStartUniverse(i);
+        m_aEndUniv[i] = m_aStartUniv[i] + oSettings.GetNoUniverses(i);
+    }
+
+    // Settings only stores lists that passed SettingsValidator::IsValidAllowedSources().
+    const std::string &sSources = oSettings.GetAllowedSources();
+    m_s32AllowedCount = 0;
+    size_t u32Start = 0;
+    while (!sSources.empty() && u32Start <= sSources.length() && m_s32AllowedCount < PROJECT_MAXIMUM_ALLOWED_SOURCES)
+    {
+        size_t u32End = std::min(sSources.find(',', u32Start), sSources.length());
+        ip4_addr_t stAddr;
+        if (ip4addr_aton(sSources.substr(u32Start, u32End - u32Start).c_str(), &stAddr))
+        {
+            m_aAllowed[m_s32AllowedCount++] = ip4_addr_get_u32(&stAddr);
+        }
+        u32Start = u32End + 1;
+    }
+}
+
+bool ArtNetFilter::IsOwned(int32_t s32Univ) const
+{
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (m_aStartUniv[i] <= s32Univ && s32Univ < m_aEndUniv[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ArtNetFilter::IsAllowed(uint32_t u32Ip) const
+{
+    if (m_s32AllowedCount == 0)
+    {
+        return true;
+    }
+    return std::find(m_aAllowed.begin(), m_aAllowed.begin() + m_s32AllowedCount, u32Ip) != m_aAllowed.begin() + m_s32AllowedCount;
+}
+
+bool ArtNetFilter::TakeToken(uint32_t u32Ip)
+{
+    int64_t s64NowUs = esp_timer_get_time();
+    SourceBucket *pBucket = &m_aBuckets[0];
+    for (SourceBucket &stBucket : m_aBuckets)
+    {
+        if (stBucket.u32Ip == u32Ip)
+        {
+            pBucket = &stBucket;
+            break;
+        }
+        if (stBucket.s64LastUs < pBucket->s64LastUs)
+        {
+            pBucket = &stBucket;
+        }
+    }
+    if (pBucket->u32Ip != u32Ip)
+    {
+        // New source, or one that was quiet long enough to be evicted: starts with a full bucket.
+        pBucket->u32Ip = u32Ip;
+        pBucket->s64Credit = g_s64MaximumCredit;
+    }
+    else
+    {
+        int64_t s64Refill = (s64NowUs - pBucket->s64LastUs) * PROJECT_ARTNET_FILTER_RATE;
+        pBucket->s64Credit = std::min(pBucket->s64Credit + s64Refill, g_s64MaximumCredit);
+    }
+    pBucket->s64LastUs = s64NowUs;
+    if (pBucket->s64Credit < g_s64TokenCredit)
+    {
+        return false;
+    }
+    pBucket->s64Credit -= g_s64TokenCredit;
+    return true;
+}
+
+bool ArtNetFilter::Accept(const ArtNet::Packet &oPacket, uint32_t u32SourceIp)
+{
+    uint16_t u16OpCode = oPacket.GetOpCode();
+    if (u16OpCode == ArtNet::OP_POLL || u16OpCode == ArtNet::OP_CONFIG)
+    {
+        return true;
+    }
+    if (!m_bConfigured || Settings::GetInstance().GetRevision() != m_u32Revision)
+    {
+        Configure();
+    }
+
+    DropReason eReason;
+    if (u16OpCode == ArtNet::OP_DMX && !IsOwned(oPacket.GetPortAddress()))
+    {
+        // Broadcast ArtDmx of the other nodes, by far the most common drop.
+        eReason = DROP_NOT_OWNED;
+    }
+    else if (!IsAllowed(u32SourceIp))
+    {
+        eReason = DROP_SOURCE_NOT_ALLOWED;
+    }
+    else if (!TakeToken(u32SourceIp))
+    {
+        eReason = DROP_RATE_LIMITED;
+    }
+    else
+    {
+        m_u32PassedCount++;
+        return true;
+    }
+    m_aDropCount[eReason]++;
+    return false;
+}
+
+cJSON *ArtNetFilter::ToJson() const
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "Passed", m_u32PassedCount);
+    cJSON_AddNumberToObject(json, "NotOwned", m_aDropCount[DROP_NOT_OWNED]);
+    cJSON_AddNumberToObject(json, "SourceNotAllowed", m_aDropCount[DROP_SOURCE_NOT_ALLOWED]);
+    cJSON_AddNumberToObject(json, "RateLimited", m_aDropCount[DROP_RATE_LIMITED]);
+    return json;
+}
@@ -0,0 +1,75 @@
+#ifndef __ARTNET_NODE_ARTNET_FILTER_H__
+#define __ARTNET_NODE_ARTNET_FILTER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <array>
+#include "artnet_packet.h"
+#include "models/settings.h"
+
+struct cJSON;
+
+// Sustained Art-Net packets per second a single source may send, ArtDmx for 40 universes at 44 Hz fits.
+#ifndef PROJECT_ARTNET_FILTER_RATE
+#define PROJECT_ARTNET_FILTER_RATE 2500
+#endif
+
+// Packets a source may send back to back, e.g. all universes of a frame plus ArtSync.
+#ifndef PROJECT_ARTNET_FILTER_BURST
+#define PROJECT_ARTNET_FILTER_BURST 128
+#endif
+
+// Sources tracked with their own token bucket, the least recently seen one makes room for a new source.
+#ifndef PROJECT_ARTNET_FILTER_SOURCES
+#define PROJECT_ARTNET_FILTER_SOURCES 8
+#endif
+
+// Rejects Art-Net traffic the node would only throw away later, before it costs a handler: ArtDmx for
+// Port-Addresses no port owns, sources outside Settings::GetAllowedSources() and sources exceeding their
+// packet rate. On the raw pcb path it also saves the copy out of the pbuf, the socket path has already
+// copied the datagram into a pool slot and only gets the slot back. ArtPoll and ArtConfig always pass so
+// the node stays discoverable. Not thread safe, every receive path owns its filter.
+class ArtNetFilter
+{
+public:
+    enum DropReason
+    {
+        DROP_NOT_OWNED,
+        DROP_SOURCE_NOT_ALLOWED,
+        DROP_RATE_LIMITED,
+        DROP_REASON_COUNT,
+    };
+
+private:
+    typedef struct
+    {
+        uint32_t u32Ip; // 0: unused
+        int64_t s64Credit; // tokens scaled by 1000000, refilled at PROJECT_ARTNET_FILTER_RATE per second
+        int64_t s64LastUs;
+    } SourceBucket;
+
+    std::array<SourceBucket, PROJECT_ARTNET_FILTER_SOURCES> m_aBuckets;
+    std::array<uint32_t, PROJECT_MAXIMUM_ALLOWED_SOURCES> m_aAllowed;
+    int32_t m_s32AllowedCount;
+    std::array<int32_t, PROJECT_NUMBER_OF_PORTS> m_aStartUniv; // universes of each port, as Ports maps them
+    std::array<int32_t, PROJECT_NUMBER_OF_PORTS> m_aEndUniv;
+    uint32_t m_u32Revision;
+    bool m_bConfigured;
+
+    uint32_t m_u32PassedCount;
+    std::array<uint32_t, DROP_REASON_COUNT> m_aDropCount;
+
+    void Configure();
+    bool IsOwned(int32_t s32Univ) const;
+    bool IsAllowed(uint32_t u32Ip) const;
+    bool TakeToken(uint32_t u32Ip);
+
+public:
+    ArtNetFilter();
+    // oPacket parsed successfully, u32SourceIp in network byte order.
+    bool Accept(const ArtNet::Packet &oPacket, uint32_t u32SourceIp);
+    uint32_t GetDropCount(DropReason eReason) const { return m_aDropCount[eReason]; }
+    cJSON *ToJson() const;
+};
+
+#endif /* __ARTNET_NODE_ARTNET_FILTER_H__ */
@@ -0,0 +1,52 @@
+#include "artnet_packet.h"
+#include "cJSON.h"
+#include <algorithm>
+
+namespace ArtNet
+{
+    cJSON *ParseStats::ToJson() const
+    {
+        static const char *apNames[PARSE_RESULT_COUNT] = {"Ok", "TooShort", "BadId", "BadVersion", "BadLength", "UnsupportedOpCode"};
+        cJSON *json = cJSON_CreateObject();
+        for (int32_t i = 0; i < PARSE_RESULT_COUNT; ++i)
+        {
+            cJSON_AddNumberToObject(json, apNames[i], m_aCount[i]);
+        }
+        return json;
+    }
+
+    size_t WriteFec(int32_t s32PortAddress, const FecMember *pMembers, uint8_t u8Count, uint8_t *pOut)
+    {
+        size_t u32Parity = 0;
+        for (uint8_t i = 0; i < u8Count; ++i)
+        {
+            u32Parity = std::max(u32Parity, std::min<size_t>(pMembers[i].u16Length, MAXIMUM_FEC_PARITY));
+        }
+        memset(pOut, 0, OFFSET_FEC_ENTRIES);
+        memcpy(pOut + OFFSET_ID, ID, sizeof(ID));
+        pOut[OFFSET_OPCODE] = OP_FEC & 0xFF;
+        pOut[OFFSET_OPCODE + 1] = OP_FEC >> 8;
+        pOut[OFFSET_PROT_VER_LO] = PROTOCOL_VERSION;
+        pOut[OFFSET_FEC_COUNT] = u8Count;
+        pOut[OFFSET_FEC_SUBUNI] = s32PortAddress & 0xFF;
+        pOut[OFFSET_FEC_NET] = (s32PortAddress >> 8) & 0x7F;
+        pOut[OFFSET_FEC_LENGTH_HI] = u32Parity >> 8;
+        pOut[OFFSET_FEC_LENGTH_LO] = u32Parity & 0xFF;
+        uint8_t *pParity = pOut + OFFSET_FEC_ENTRIES + u8Count * FEC_ENTRY_LENGTH;
+        memset(pParity, 0, u32Parity);
+        for (uint8_t i = 0; i < u8Count; ++i)
+        {
+            uint8_t *pEntry = pOut + OFFSET_FEC_ENTRIES + i * FEC_ENTRY_LENGTH;
+            pEntry[0] = pMembers[i].u8Sequence;
+            pEntry[1] = pMembers[i].u16Length >> 8;
+            pEntry[2] = pMembers[i].u16Length & 0xFF;
+            // Every payload byte: 16-bit and RGBW universes use all 512, a lost one is rebuilt to its end.
+            size_t u32Bytes = std::min<size_t>(pMembers[i].u16Length, MAXIMUM_FEC_PARITY);
+            for (size_t j = 0; j < u32Bytes; ++j)
+            {
+                pParity[j] ^= pMembers[i].pData[j];
+            }
+        }
+        return pParity + u32Parity - pOut;
+    }
+}
@@ -0,0 +1,305 @@
+#ifndef __ARTNET_NODE_ARTNET_PACKET_H__
+#define __ARTNET_NODE_ARTNET_PACKET_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <array>
+
+struct cJSON;
+
+namespace ArtNet
+{
+    enum OpCode : uint16_t
+    {
+        OP_POLL = 0x2000,
+        OP_POLL_REPLY = 0x2100,
+        OP_CONFIG = 0x2009, // vendor ArtConfig, see Existing::TArtConfig
+        OP_DMX = 0x5000,
+        OP_SYNC = 0x5200,
+        OP_FEC = 0x8A00,    // vendor ArtFec parity, other nodes ignore the unknown opcode
+        OP_DMX_BATCH = 0x8B00, // vendor ArtDmxBatch, several universes in one datagram
+    };
+
+    static constexpr uint16_t PROTOCOL_VERSION = 14;
+    static constexpr uint16_t MAXIMUM_DMX_LENGTH = 512;
+
+    // Byte offsets, shared by every opcode up to OFFSET_PROT_VER_LO.
+    static constexpr size_t OFFSET_ID = 0;
+    static constexpr size_t OFFSET_OPCODE = 8; // little endian
+    static constexpr size_t OFFSET_PROT_VER_HI = 10;
+    static constexpr size_t OFFSET_PROT_VER_LO = 11;
+    static constexpr size_t HEADER_LENGTH = 12;
+    // ArtDmx
+    static constexpr size_t OFFSET_DMX_SEQUENCE = 12;
+    static constexpr size_t OFFSET_DMX_PHYSICAL = 13;
+    static constexpr size_t OFFSET_DMX_SUBUNI = 14;
+    static constexpr size_t OFFSET_DMX_NET = 15;
+    static constexpr size_t OFFSET_DMX_LENGTH_HI = 16;
+    static constexpr size_t OFFSET_DMX_LENGTH_LO = 17;
+    static constexpr size_t OFFSET_DMX_DATA = 18;
+    // ArtSync
+    static constexpr size_t SYNC_LENGTH = 14;
+    // ArtPoll
+    static constexpr size_t OFFSET_POLL_FLAGS = 12;
+    static constexpr size_t OFFSET_POLL_DIAG_PRIORITY = 13;
+    static constexpr size_t POLL_LENGTH = 14;
+    // ArtFec: XOR parity over the whole payload of up to MAXIMUM_FEC_GROUP consecutive universes of one
+    // frame, as long as the longest of them. The node uses the bytes its pixel format takes.
+    static constexpr size_t OFFSET_FEC_COUNT = 12;
+    static constexpr size_t OFFSET_FEC_SUBUNI = 14;
+    static constexpr size_t OFFSET_FEC_NET = 15;
+    static constexpr size_t OFFSET_FEC_LENGTH_HI = 16;
+    static constexpr size_t OFFSET_FEC_LENGTH_LO = 17;
+    static constexpr size_t OFFSET_FEC_ENTRIES = 18; // per universe: ArtDmx sequence, payload length hi, lo
+    static constexpr size_t FEC_ENTRY_LENGTH = 3;
+    static constexpr uint8_t MAXIMUM_FEC_GROUP = 8;
+    static constexpr size_t MAXIMUM_FEC_PARITY = MAXIMUM_DMX_LENGTH;
+    static constexpr size_t MAXIMUM_FEC_LENGTH = OFFSET_FEC_ENTRIES + MAXIMUM_FEC_GROUP * FEC_ENTRY_LENGTH + MAXIMUM_FEC_PARITY;
+    // ArtDmxBatch: universe count, then per universe an entry header followed by its payload.
+    static constexpr size_t OFFSET_BATCH_COUNT = 12;
+    static constexpr size_t OFFSET_BATCH_ENTRIES = 14;
+    static constexpr size_t BATCH_ENTRY_HEADER_LENGTH = 5; // ArtDmx sequence, subuni, net, length hi, lo
+    static constexpr uint8_t MAXIMUM_BATCH_UNIVERSES = 32;
+
+    typedef struct
+    {
+        uint8_t u8Sequence;
+        int32_t s32PortAddress;
+        uint16_t u16Length;
+    } BatchEntry;
+
+    // Reads the entry header at pEntry, u32Left counts the bytes from pEntry to the end of the datagram.
+    // False when the entry does not fit, the rest of the datagram is then unusable.
+    static inline bool ReadBatchEntry(const uint8_t *pEntry, size_t u32Left, BatchEntry &stEntry)
+    {
+        if (u32Left < BATCH_ENTRY_HEADER_LENGTH)
+        {
+            return false;
+        }
+        stEntry.u8Sequence = pEntry[0];
+        stEntry.s32PortAddress = ((pEntry[2] & 0x7F) << 8) | pEntry[1];
+        stEntry.u16Length = (pEntry[3] << 8) | pEntry[4];
+        return stEntry.u16Length <= MAXIMUM_DMX_LENGTH && BATCH_ENTRY_HEADER_LENGTH + stEntry.u16Length <= u32Left;
+    }
+
+    static constexpr char ID[8] = {'A', 'r', 't', '-', 'N', 'e', 't', '\0'};
+
+    enum ParseResult
+    {
+        PARSE_OK,
+        PARSE_TOO_SHORT,
+        PARSE_BAD_ID,
+        PARSE_BAD_VERSION,
+        PARSE_BAD_LENGTH,
+        PARSE_UNSUPPORTED_OPCODE,
+        PARSE_RESULT_COUNT,
+    };
+
+    // Validated, zero-copy view over a received datagram. Only the first u32HeaderLength bytes need to be
+    // contiguous, which lets the raw lwIP path parse a header copied out of a pbuf chain.
+    class Packet
+    {
+        const uint8_t *m_pHeader;
+        size_t m_u32HeaderLength;
+        size_t m_u32PacketLength;
+        uint16_t m_u16OpCode;
+
+    public:
+        Packet() : m_pHeader(nullptr), m_u32HeaderLength(0), m_u32PacketLength(0), m_u16OpCode(0) {}
+
+        // Single pass over the header: length, opcode, ID, version, then the opcode specific fields.
+        ParseResult Parse(const void *pHeader, size_t u32HeaderLength, size_t u32PacketLength)
+        {
+            m_pHeader = (const uint8_t *)pHeader;
+            m_u32HeaderLength = u32HeaderLength;
+            m_u32PacketLength = u32PacketLength;
+            if (u32HeaderLength < OFFSET_OPCODE + 2)
+            {
+                return PARSE_TOO_SHORT;
+            }
+            m_u16OpCode = m_pHeader[OFFSET_OPCODE] | (m_pHeader[OFFSET_OPCODE + 1] << 8);
+            if (m_u16OpCode == OP_CONFIG)
+            {
+                // The vendor tool's own framing: it may not send the Art-Net ID or a version, the opcode is
+                // all it has always been matched on. Its handler checks the size.
+                return PARSE_OK;
+            }
+            if (u32HeaderLength < HEADER_LENGTH)
+            {
+                return PARSE_TOO_SHORT;
+            }
+            if (memcmp(m_pHeader + OFFSET_ID, ID, sizeof(ID)) != 0)
+            {
+                return PARSE_BAD_ID;
+            }
+            if (GetProtocolVersion() < PROTOCOL_VERSION)
+            {
+                return PARSE_BAD_VERSION;
+            }
+            switch (m_u16OpCode)
+            {
+            case OP_DMX:
+            {
+                if (u32HeaderLength < OFFSET_DMX_DATA)
+                {
+                    return PARSE_TOO_SHORT;
+                }
+                uint16_t u16Length = GetDmxLength();
+                if (u16Length == 0 || u16Length > MAXIMUM_DMX_LENGTH || OFFSET_DMX_DATA + u16Length > u32PacketLength)
+                {
+                    return PARSE_BAD_LENGTH;
+                }
+                return PARSE_OK;
+            }
+            case OP_SYNC:
+                return u32HeaderLength < SYNC_LENGTH ? PARSE_TOO_SHORT : PARSE_OK;
+            case OP_POLL:
+                return u32HeaderLength < POLL_LENGTH ? PARSE_TOO_SHORT : PARSE_OK;
+            case OP_DMX_BATCH:
+            {
+                if (u32HeaderLength < OFFSET_BATCH_ENTRIES)
+                {
+                    return PARSE_TOO_SHORT;
+                }
+                // Entries are checked while they are walked, see ReadBatchEntry().
+                uint8_t u8Count = GetBatchCount();
+                if (u8Count == 0 || u8Count > MAXIMUM_BATCH_UNIVERSES || OFFSET_BATCH_ENTRIES + u8Count * BATCH_ENTRY_HEADER_LENGTH > u32PacketLength)
+                {
+                    return PARSE_BAD_LENGTH;
+                }
+                return PARSE_OK;
+            }
+            case OP_FEC:
+            {
+                if (u32HeaderLength < OFFSET_FEC_ENTRIES)
+                {
+                    return PARSE_TOO_SHORT;
+                }
+                uint8_t u8Count = GetFecCount();
+                uint16_t u16Length = GetFecLength();
+                if (u8Count == 0 || u8Count > MAXIMUM_FEC_GROUP || u16Length > MAXIMUM_DMX_LENGTH ||
+                    OFFSET_FEC_ENTRIES + u8Count * FEC_ENTRY_LENGTH + u16Length > u32PacketLength)
+                {
+                    return PARSE_BAD_LENGTH;
+                }
+                return PARSE_OK;
+            }
+            default:
+                return PARSE_UNSUPPORTED_OPCODE;
+            }
+        }
+
+        uint16_t GetOpCode() const { return m_u16OpCode; }
+        uint16_t GetProtocolVersion() const { return (m_pHeader[OFFSET_PROT_VER_HI] << 8) | m_pHeader[OFFSET_PROT_VER_LO]; }
+        size_t GetPacketLength() const { return m_u32PacketLength; }
+
+        // ArtDmx, only valid after Parse() returned PARSE_OK for OP_DMX.
+        uint8_t GetSequence() const { return m_pHeader[OFFSET_DMX_SEQUENCE]; }
+        uint8_t GetPhysical() const { return m_pHeader[OFFSET_DMX_PHYSICAL]; }
+        // 15-bit Net:SubNet:Universe
+        int32_t GetPortAddress() const { return ((m_pHeader[OFFSET_DMX_NET] & 0x7F) << 8) | m_pHeader[OFFSET_DMX_SUBUNI]; }
+        uint16_t GetDmxLength() const { return (m_pHeader[OFFSET_DMX_LENGTH_HI] << 8) | m_pHeader[OFFSET_DMX_LENGTH_LO]; }
+        // nullptr when only the header is contiguous.
+        const uint8_t *GetDmxData() const { return m_u32HeaderLength == m_u32PacketLength ? m_pHeader + OFFSET_DMX_DATA : nullptr; }
+
+        // ArtPoll
+        uint8_t GetPollFlags() const { return m_pHeader[OFFSET_POLL_FLAGS]; }
+        uint8_t GetPollDiagPriority() const { return m_pHeader[OFFSET_POLL_DIAG_PRIORITY]; }
+
+        // ArtDmxBatch
+        uint8_t GetBatchCount() const { return m_pHeader[OFFSET_BATCH_COUNT]; }
+
+        // ArtFec. The entries and the parity need the whole datagram contiguous.
+        uint8_t GetFecCount() const { return m_pHeader[OFFSET_FEC_COUNT]; }
+        int32_t GetFecPortAddress() const { return ((m_pHeader[OFFSET_FEC_NET] & 0x7F) << 8) | m_pHeader[OFFSET_FEC_SUBUNI]; }
+        uint16_t GetFecLength() const { return (m_pHeader[OFFSET_FEC_LENGTH_HI] << 8) | m_pHeader[OFFSET_FEC_LENGTH_LO]; }
+        uint8_t GetFecSequence(int32_t i) const { return m_pHeader[OFFSET_FEC_ENTRIES + i * FEC_ENTRY_LENGTH]; }
+        uint16_t GetFecUniverseLength(int32_t i) const
+        {
+            const uint8_t *pEntry = m_pHeader + OFFSET_FEC_ENTRIES + i * FEC_ENTRY_LENGTH;
+            return (pEntry[1] << 8) | pEntry[2];
+        }
+        const uint8_t *GetFecData() const
+        {
+            return m_u32HeaderLength == m_u32PacketLength ? m_pHeader + OFFSET_FEC_ENTRIES + GetFecCount() * FEC_ENTRY_LENGTH : nullptr;
+        }
+    };
+
+#pragma pack(push)
+#pragma pack(1)
+    typedef struct
+    {
+        uint8_t Id[8];
+        uint16_t OpCode;           // OP_POLL_REPLY, little endian
+        uint8_t IpAddress[4];
+        uint16_t Port;             // 0x1936, little endian
+        uint8_t VersInfoH;
+        uint8_t VersInfoL;
+        uint8_t NetSwitch;         // bits 14-8 of the Port-Address
+        uint8_t SubSwitch;         // bits 7-4 of the Port-Address
+        uint8_t OemHi;
+        uint8_t Oem;
+        uint8_t UbeaVersion;
+        uint8_t Status1;
+        uint8_t EstaManLo;
+        uint8_t EstaManHi;
+        char ShortName[18];
+        char LongName[64];
+        char NodeReport[64];
+        uint8_t NumPortsHi;
+        uint8_t NumPortsLo;
+        uint8_t PortTypes[4];
+        uint8_t GoodInput[4];
+        uint8_t GoodOutputA[4];
+        uint8_t SwIn[4];
+        uint8_t SwOut[4];          // bits 3-0 of the Port-Address
+        uint8_t AcnPriority;
+        uint8_t SwMacro;
+        uint8_t SwRemote;
+        uint8_t Spare[3];
+        uint8_t Style;
+        uint8_t Mac[6];
+        uint8_t BindIp[4];
+        uint8_t BindIndex;         // 1-based page of a node answering with several replies
+        uint8_t Status2;
+        uint8_t GoodOutputB[4];
+        uint8_t Status3;
+        uint8_t DefaultRespUID[6];
+        uint8_t UserHi;
+        uint8_t UserLo;
+        uint8_t RefreshRateHi;
+        uint8_t RefreshRateLo;
+        uint8_t Filler[11];
+    } TArtPollReply;
+#pragma pack(pop)
+
+    static_assert(sizeof(TArtPollReply) == 239, "ArtPollReply is 239 bytes");
+
+    // One universe of an ArtFec group, as its ArtDmx carried it.
+    typedef struct
+    {
+        uint8_t u8Sequence;
+        uint16_t u16Length;
+        const uint8_t *pData;
+    } FecMember;
+
+    // Sender side of ArtFec, for host encoders: the parity of u8Count (1..MAXIMUM_FEC_GROUP) consecutive universes
+    // from s32PortAddress on, written to pOut of MAXIMUM_FEC_LENGTH bytes. Returns the datagram length.
+    size_t WriteFec(int32_t s32PortAddress, const FecMember *pMembers, uint8_t u8Count, uint8_t *pOut);
+
+    // Parse outcome counters of one receive path.
+    class ParseStats
+    {
+        std::array<uint32_t, PARSE_RESULT_COUNT> m_aCount;
+
+    public:
+        ParseStats() { m_aCount.fill(0); }
+        void Add(ParseResult eResult) { m_aCount[eResult]++; }
+        uint32_t Get(ParseResult eResult) const { return m_aCount[eResult]; }
+        cJSON *ToJson() const;
+    };
+}
+
+#endif /* __ARTNET_NODE_ARTNET_PACKET_H__ */
@@ -0,0 +1,175 @@
+#include "artnet_poll.h"
+#include <string.h>
+#include <algorithm>
+#include "esp_log.h"
+#include "cJSON.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+#include "lwip/tcpip.h"
+#include "config.h"
+#include "version.h"
+#include "wifi.h"
+#include "miscellaneous.h"
+#include "models/settings.h"
+
+static const char *TAG = "ArtPoll";
+
+ArtPollResponder::ArtPollResponder()
+{
+    m_u32BuiltRevision = 0;
+    m_u32BuiltIp = 0;
+    m_bBuilt = false;
+    m_bSendInTcpipThread = false;
+    m_u32TargetIp = 0;
+    m_s64LastReplyUs = INT64_MIN / 2;
+    m_u32PollCount = 0;
+    m_u32RateLimitedCount = 0;
+    m_u32ReplyCount = 0;
+    m_u32RebuildCount = 0;
+    m_hReplyTimer = xTimerCreate("artpoll_reply_timer", 1, pdFALSE, this, &ArtPollResponder::ReplyTimerCallback);
+}
+
+void ArtPollResponder::Rebuild(uint32_t u32Ip)
+{
+    using namespace ArtNet;
+    const Settings &oSettings = Settings::GetInstance();
+    Existing::NQN_MANAGER_VERSION stVersion(FWVersion::version, FWVersion::buildTime);
+    uint8_t au8Mac[6] = {0};
+    esp_read_mac(au8Mac, ESP_MAC_WIFI_STA);
+
+    TArtPollReply stTemplate = {};
+    memcpy(stTemplate.Id, ID, sizeof(ID));
+    stTemplate.OpCode = OP_POLL_REPLY;
+    memcpy(stTemplate.IpAddress, &u32Ip, sizeof(stTemplate.IpAddress));
+    stTemplate.Port = PROJECT_UDP_ARTNET_PORT;
+    stTemplate.VersInfoH = stVersion.MainVersionHigh;
+    stTemplate.VersInfoL = stVersion.MainVersionLow;
+    stTemplate.OemHi = 0x00;
+    stTemplate.Oem = 0xFF;      // unregistered OEM
+    stTemplate.Status1 = 0xD0;  // indicators normal, Port-Address set from the config tool
+    stTemplate.EstaManLo = 0xF0;
+    stTemplate.EstaManHi = 0x7F; // ESTA prototyping id
+    strncpy(stTemplate.ShortName, oSettings.GetIdentity().c_str(), sizeof(stTemplate.ShortName) - 1);
+    snprintf(stTemplate.LongName, sizeof(stTemplate.LongName), "%s %s", oSettings.GetIdentity().c_str(), oSettings.GetModel().c_str());
+    memcpy(stTemplate.Mac, au8Mac, sizeof(stTemplate.Mac));
+    memcpy(stTemplate.BindIp, &u32Ip, sizeof(stTemplate.BindIp));
+    stTemplate.Status2 = 0x08 | 0x04 | (WifiSTA::IsUseStaticIp() ? 0x00 : 0x02); // 15-bit Port-Address, DHCP capable, DHCP in use
+    std::fill(std::begin(stTemplate.GoodInput), std::end(stTemplate.GoodInput), 0x08); // inputs disabled
+
+    m_vReplies.clear();
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        int32_t s32Start = oSettings.GetStartUniverse(i);
+        int32_t s32Count = oSettings.GetNoUniverses(i);
+        if (s32Start < 0 || s32Count <= 0)
+        {
+            continue;
+        }
+        // A reply carries four universes sharing Net and SubNet, split the port where that breaks.
+        for (int32_t j = 0; j < s32Count;)
+        {
+            int32_t s32Addr = s32Start + j;
+            TArtPollReply stReply = stTemplate;
+            stReply.NetSwitch = (s32Addr >> 8) & 0x7F;
+            stReply.SubSwitch = (s32Addr >> 4) & 0x0F;
+            snprintf(stReply.NodeReport, sizeof(stReply.NodeReport), "#0001 [0000] Port %ld OK", i);
+            uint8_t u8Ports = 0;
+            while (u8Ports < 4 && j < s32Count && ((s32Start + j) >> 4) == (s32Addr >> 4))
+            {
+                stReply.PortTypes[u8Ports] = 0x80;   // output, DMX512
+                stReply.GoodOutputA[u8Ports] = 0x80; // data transmitted
+                stReply.SwOut[u8Ports] = (s32Start + j) & 0x0F;
+                u8Ports++;
+                j++;
+            }
+            stReply.NumPortsLo = u8Ports;
+            stReply.BindIndex = m_vReplies.size() + 1;
+            m_vReplies.push_back(stReply);
+        }
+    }
+
+    m_u32BuiltRevision = oSettings.GetRevision();
+    m_u32BuiltIp = u32Ip;
+    m_bBuilt = true;
+    m_u32RebuildCount++;
+    ESP_LOGI(TAG, "Built %d ArtPollReply", (int)m_vReplies.size());
+}
+
+void ArtPollResponder::HandlePoll(const char *senderIP)
+{
+    m_u32PollCount.fetch_add(1, std::memory_order_relaxed);
+    if (esp_timer_get_time() - m_s64LastReplyUs.load(std::memory_order_relaxed) < PROJECT_ARTPOLL_MIN_INTERVAL_MS * 1000LL)
+    {
+        m_u32RateLimitedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t u32Ip = inet_addr(senderIP);
+    uint32_t u32Pending = 0;
+    if (!m_u32TargetIp.compare_exchange_strong(u32Pending, u32Ip))
+    {
+        // A reply is already scheduled. A second controller polling meanwhile gets it by broadcast.
+        if (u32Pending != u32Ip)
+        {
+            m_u32TargetIp.store(IPADDR_BROADCAST);
+        }
+        return;
+    }
+
+    TickType_t u32Delay = std::max<TickType_t>(pdMS_TO_TICKS(1 + esp_random() % PROJECT_ARTPOLL_REPLY_JITTER_MS), 1);
+    if (xTimerChangePeriod(m_hReplyTimer, u32Delay, 0) != pdPASS)
+    {
+        m_u32TargetIp.store(0);
+    }
+}
+
+void ArtPollResponder::ReplyTimerCallback(TimerHandle_t xTimer)
+{
+    ArtPollResponder *pResponder = (ArtPollResponder *)pvTimerGetTimerID(xTimer);
+    if (!pResponder->m_bSendInTcpipThread)
+    {
+        pResponder->SendReplies();
+    }
+    else if (tcpip_callback(&ArtPollResponder::SendRepliesCallback, pResponder) != ERR_OK)
+    {
+        pResponder->m_u32TargetIp.store(0);
+    }
+}
+
+void ArtPollResponder::SendRepliesCallback(void *pvContext)
+{
+    ((ArtPollResponder *)pvContext)->SendReplies();
+}
+
+void ArtPollResponder::SendReplies()
+{
+    uint32_t u32Ip = WifiSTA::GetIPAddress();
+    if (!m_bBuilt || m_u32BuiltRevision != Settings::GetInstance().GetRevision() || m_u32BuiltIp != u32Ip)
+    {
+        Rebuild(u32Ip);
+    }
+
+    uint32_t u32Target = m_u32TargetIp.exchange(0);
+    if (u32Target == 0 || !m_fnSender)
+    {
+        return;
+    }
+    for (const ArtNet::TArtPollReply &stReply : m_vReplies)
+    {
+        m_fnSender((const uint8_t *)&stReply, sizeof(stReply), u32Target);
+    }
+    m_u32ReplyCount.fetch_add(m_vReplies.size(), std::memory_order_relaxed);
+    m_s64LastReplyUs.store(esp_timer_get_time(), std::memory_order_relaxed);
+}
+
+cJSON *ArtPollResponder::ToJson()
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "Polls", m_u32PollCount.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "RateLimited", m_u32RateLimitedCount.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "Replies", m_u32ReplyCount.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "Rebuilds", m_u32RebuildCount);
+    return json;
+}
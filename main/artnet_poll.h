@@ -0,0 +1,62 @@
+#ifndef __ARTNET_NODE_ARTNET_POLL_H__
+#define __ARTNET_NODE_ARTNET_POLL_H__
+
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "artnet_packet.h"
+
+// Polls closer together than this share one reply burst.
+#ifndef PROJECT_ARTPOLL_MIN_INTERVAL_MS
+#define PROJECT_ARTPOLL_MIN_INTERVAL_MS 1000
+#endif
+
+// Replies are delayed by a random 1..N ms so a network of nodes does not answer in one burst.
+#ifndef PROJECT_ARTPOLL_REPLY_JITTER_MS
+#define PROJECT_ARTPOLL_REPLY_JITTER_MS 500
+#endif
+
+typedef std::function<void(const uint8_t *, size_t, uint32_t)> ReplySender_t; // packet, length, destination IPv4 (network order)
+
+// Answers ArtPoll with one ArtPollReply per group of up to four universes of each configured port.
+// The replies are built once and only rebuilt after Settings or the node IP changed.
+class ArtPollResponder
+{
+    std::vector<ArtNet::TArtPollReply> m_vReplies; // only touched from the sending context
+    uint32_t m_u32BuiltRevision;
+    uint32_t m_u32BuiltIp;
+    bool m_bBuilt;
+
+    TimerHandle_t m_hReplyTimer;
+    ReplySender_t m_fnSender;
+    bool m_bSendInTcpipThread;
+    std::atomic<uint32_t> m_u32TargetIp; // 0: no reply pending
+    std::atomic<int64_t> m_s64LastReplyUs;
+
+    std::atomic<uint32_t> m_u32PollCount;
+    std::atomic<uint32_t> m_u32RateLimitedCount;
+    std::atomic<uint32_t> m_u32ReplyCount;
+    uint32_t m_u32RebuildCount;
+
+    void Rebuild(uint32_t u32Ip);
+    void SendReplies();
+    static void ReplyTimerCallback(TimerHandle_t xTimer);
+    static void SendRepliesCallback(void *pvContext);
+
+public:
+    static ArtPollResponder &GetInstance()
+    {
+        static ArtPollResponder oIns;
+        return oIns;
+    }
+    ArtPollResponder();
+    // bInTcpipThread: the sender uses the raw lwIP API and must run in the tcpip thread.
+    void RegisterReplySender(ReplySender_t fnSender, bool bInTcpipThread) { m_fnSender = fnSender; m_bSendInTcpipThread = bInTcpipThread; }
+    void HandlePoll(const char *senderIP);
+    cJSON *ToJson();
+};
+
+#endif /* __ARTNET_NODE_ARTNET_POLL_H__ */
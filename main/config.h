@@ -4,6 +4,11 @@
 #define PROJECT_WIFI_AP_MAX_CONN 5
 #define PROJECT_UDP_ARTNET_PORT 6454
 #define PROJECT_UDP_COMMON_PORT 9494
+#define PROJECT_UDP_DELTA_STREAM_PORT 6460 // keyframe + delta compressed pixel stream, see delta_stream.h
+#define PROJECT_ARTNET_RAW_UDP_RECEIVE 0 // 1: lwIP raw pcb copies ArtDmx payload into port buffers, 0: socket task
+#define PROJECT_UDP_REACTOR_STACK_SIZE 6144 // one task serves every UDP socket, handlers included
+#define PROJECT_NETWORK_CORE 0 // receive, parse and assembly, next to the WiFi and lwIP tasks
+#define PROJECT_OUTPUT_CORE 1  // led output only
 #define PROJECT_NUMBER_OF_PORTS 4
 #define PROJECT_MAXIMUM_NUMBER_OF_LEDS_PER_PORT 1020
 #define PROJECT_PORT_0_DATA_PIN 4
@@ -0,0 +1,16 @@
+#include "ddp_packet.h"
+#include "cJSON.h"
+
+namespace DDP
+{
+    cJSON *ParseStats::ToJson() const
+    {
+        static const char *apNames[PARSE_RESULT_COUNT] = {"Ok", "TooShort", "BadVersion", "BadLength", "Unsupported"};
+        cJSON *json = cJSON_CreateObject();
+        for (int32_t i = 0; i < PARSE_RESULT_COUNT; ++i)
+        {
+            cJSON_AddNumberToObject(json, apNames[i], m_aCount[i]);
+        }
+        return json;
+    }
+}
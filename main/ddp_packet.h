@@ -0,0 +1,116 @@
+#ifndef __ARTNET_NODE_DDP_PACKET_H__
+#define __ARTNET_NODE_DDP_PACKET_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+struct cJSON;
+
+// Distributed Display Protocol, pixel data addressed by byte offset into the node's whole pixel space.
+namespace DDP
+{
+    static constexpr uint16_t UDP_PORT = 4048;
+    static constexpr size_t MAXIMUM_DATA_LENGTH = 1440; // largest payload that still fits one 1500 byte frame
+
+    static constexpr uint8_t FLAG_VERSION_MASK = 0xC0;
+    static constexpr uint8_t FLAG_VERSION_1 = 0x40;
+    static constexpr uint8_t FLAG_TIMECODE = 0x10;
+    static constexpr uint8_t FLAG_STORAGE = 0x08;
+    static constexpr uint8_t FLAG_REPLY = 0x04;
+    static constexpr uint8_t FLAG_QUERY = 0x02;
+    static constexpr uint8_t FLAG_PUSH = 0x01;
+
+    static constexpr uint8_t TYPE_UNDEFINED = 0x00;
+    static constexpr uint8_t TYPE_RGB = 0x01;       // legacy senders
+    static constexpr uint8_t TYPE_RGB_8BIT = 0x0B;  // C=0 R=0 TTT=RGB SSS=8 bit
+
+    static constexpr uint8_t ID_DISPLAY = 1;
+    static constexpr uint8_t ID_ALL = 255;
+
+    // Byte offsets, every field is big endian.
+    static constexpr size_t OFFSET_FLAGS = 0;
+    static constexpr size_t OFFSET_SEQUENCE = 1; // low nibble, 0: not sequenced
+    static constexpr size_t OFFSET_TYPE = 2;
+    static constexpr size_t OFFSET_ID = 3;
+    static constexpr size_t OFFSET_DATA_OFFSET = 4;
+    static constexpr size_t OFFSET_DATA_LENGTH = 8;
+    static constexpr size_t HEADER_LENGTH = 10;
+    static constexpr size_t TIMECODE_LENGTH = 4;
+
+    enum ParseResult
+    {
+        PARSE_OK,
+        PARSE_TOO_SHORT,
+        PARSE_BAD_VERSION,
+        PARSE_BAD_LENGTH,
+        PARSE_UNSUPPORTED, // queries, replies, storage, other destinations and data types
+        PARSE_RESULT_COUNT,
+    };
+
+    // Validated, zero-copy view over a received datagram, the counterpart of ArtNet::Packet.
+    class Packet
+    {
+        const uint8_t *m_pData;
+        size_t m_u32Length;
+
+    public:
+        Packet() : m_pData(nullptr), m_u32Length(0) {}
+
+        ParseResult Parse(const void *pData, size_t u32Length)
+        {
+            m_pData = (const uint8_t *)pData;
+            m_u32Length = u32Length;
+            if (u32Length < HEADER_LENGTH)
+            {
+                return PARSE_TOO_SHORT;
+            }
+            if ((GetFlags() & FLAG_VERSION_MASK) != FLAG_VERSION_1)
+            {
+                return PARSE_BAD_VERSION;
+            }
+            if (GetFlags() & (FLAG_STORAGE | FLAG_REPLY | FLAG_QUERY))
+            {
+                return PARSE_UNSUPPORTED;
+            }
+            if (GetDataLength() > MAXIMUM_DATA_LENGTH || GetHeaderLength() + GetDataLength() > u32Length)
+            {
+                return PARSE_BAD_LENGTH;
+            }
+            uint8_t u8Type = m_pData[OFFSET_TYPE];
+            uint8_t u8Id = m_pData[OFFSET_ID];
+            if ((u8Id != ID_DISPLAY && u8Id != ID_ALL) || (u8Type != TYPE_UNDEFINED && u8Type != TYPE_RGB && u8Type != TYPE_RGB_8BIT))
+            {
+                return PARSE_UNSUPPORTED;
+            }
+            return PARSE_OK;
+        }
+
+        uint8_t GetFlags() const { return m_pData[OFFSET_FLAGS]; }
+        bool IsPush() const { return GetFlags() & FLAG_PUSH; }
+        uint8_t GetSequence() const { return m_pData[OFFSET_SEQUENCE] & 0x0F; }
+        uint32_t GetDataOffset() const
+        {
+            return ((uint32_t)m_pData[OFFSET_DATA_OFFSET] << 24) | (m_pData[OFFSET_DATA_OFFSET + 1] << 16) |
+                   (m_pData[OFFSET_DATA_OFFSET + 2] << 8) | m_pData[OFFSET_DATA_OFFSET + 3];
+        }
+        uint16_t GetDataLength() const { return (m_pData[OFFSET_DATA_LENGTH] << 8) | m_pData[OFFSET_DATA_LENGTH + 1]; }
+        size_t GetHeaderLength() const { return HEADER_LENGTH + ((GetFlags() & FLAG_TIMECODE) ? TIMECODE_LENGTH : 0); }
+        const uint8_t *GetData() const { return m_pData + GetHeaderLength(); }
+    };
+
+    // Parse outcome counters, see ArtNet::ParseStats.
+    class ParseStats
+    {
+        std::array<uint32_t, PARSE_RESULT_COUNT> m_aCount;
+
+    public:
+        ParseStats() { m_aCount.fill(0); }
+        void Add(ParseResult eResult) { m_aCount[eResult]++; }
+        uint32_t Get(ParseResult eResult) const { return m_aCount[eResult]; }
+        cJSON *ToJson() const;
+    };
+}
+
+#endif /* __ARTNET_NODE_DDP_PACKET_H__ */
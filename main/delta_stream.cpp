@@ -0,0 +1,222 @@
+#include "delta_stream.h"
+
+namespace DeltaStream
+{
+    static constexpr uint8_t MAGIC[3] = {'L', 'D', 'S'};
+
+    static inline bool SamePixel(const uint8_t *a, const uint8_t *b)
+    {
+        return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+    }
+
+    bool ReadHeader(const uint8_t *pData, size_t u32Length, Header &stHeader)
+    {
+        if (u32Length < HEADER_LENGTH || memcmp(pData, MAGIC, sizeof(MAGIC)) != 0 || pData[3] != VERSION)
+        {
+            return false;
+        }
+        stHeader.u8Type = pData[4];
+        stHeader.u8Port = pData[5];
+        stHeader.u16Sequence = (pData[6] << 8) | pData[7];
+        stHeader.u16BaseSequence = (pData[8] << 8) | pData[9];
+        stHeader.u8Index = pData[10];
+        stHeader.u8Count = pData[11];
+        stHeader.u16FirstPixel = (pData[12] << 8) | pData[13];
+        stHeader.u16OpsLength = (pData[14] << 8) | pData[15];
+        return stHeader.u8Type <= TYPE_KEY_REQUEST && stHeader.u8Count >= 1 && stHeader.u8Count <= MAXIMUM_PACKETS_PER_FRAME &&
+               stHeader.u8Index < stHeader.u8Count && stHeader.u16OpsLength <= MAXIMUM_OPS_LENGTH && HEADER_LENGTH + stHeader.u16OpsLength == u32Length;
+    }
+
+    void WriteHeader(const Header &stHeader, uint8_t *pData)
+    {
+        memcpy(pData, MAGIC, sizeof(MAGIC));
+        pData[3] = VERSION;
+        pData[4] = stHeader.u8Type;
+        pData[5] = stHeader.u8Port;
+        pData[6] = stHeader.u16Sequence >> 8;
+        pData[7] = stHeader.u16Sequence;
+        pData[8] = stHeader.u16BaseSequence >> 8;
+        pData[9] = stHeader.u16BaseSequence;
+        pData[10] = stHeader.u8Index;
+        pData[11] = stHeader.u8Count;
+        pData[12] = stHeader.u16FirstPixel >> 8;
+        pData[13] = stHeader.u16FirstPixel;
+        pData[14] = stHeader.u16OpsLength >> 8;
+        pData[15] = stHeader.u16OpsLength;
+    }
+
+    bool ApplyOps(uint8_t *pFrame, size_t u32FramePixels, size_t u32FirstPixel, const uint8_t *pOps, size_t u32OpsLength, bool bKey)
+    {
+        size_t u32Pixel = u32FirstPixel;
+        size_t i = 0;
+        while (i < u32OpsLength)
+        {
+            uint8_t u8Op = pOps[i++];
+            size_t u32Count;
+            if (u8Op & OP_LITERAL)
+            {
+                u32Count = (u8Op & 0x7F) + 1;
+                if (u32Pixel + u32Count > u32FramePixels || i + u32Count * 3 > u32OpsLength)
+                {
+                    return false;
+                }
+                memcpy(pFrame + u32Pixel * 3, pOps + i, u32Count * 3);
+                i += u32Count * 3;
+            }
+            else if (u8Op & OP_RUN)
+            {
+                u32Count = (u8Op & 0x3F) + 1;
+                if (u32Pixel + u32Count > u32FramePixels || i + 3 > u32OpsLength)
+                {
+                    return false;
+                }
+                for (size_t j = 0; j < u32Count; ++j)
+                {
+                    memcpy(pFrame + (u32Pixel + j) * 3, pOps + i, 3);
+                }
+                i += 3;
+            }
+            else
+            {
+                // A keyframe has no base to keep pixels from.
+                u32Count = u8Op + 1;
+                if (bKey || u32Pixel + u32Count > u32FramePixels)
+                {
+                    return false;
+                }
+            }
+            u32Pixel += u32Count;
+        }
+        return true;
+    }
+
+    size_t EncodeOps(const uint8_t *pFrame, const uint8_t *pBase, size_t u32FramePixels, size_t u32FirstPixel,
+                     uint8_t *pOps, size_t u32OpsMaximum, size_t &u32Pixels)
+    {
+        size_t u32Out = 0;
+        size_t u32Used = 0; // ops length up to the last op that is not a skip
+        size_t p = u32FirstPixel;
+        while (p < u32FramePixels)
+        {
+            const uint8_t *pPixel = pFrame + p * 3;
+            size_t u32Left = u32FramePixels - p;
+            if (pBase && SamePixel(pPixel, pBase + p * 3))
+            {
+                if (u32Out + 1 > u32OpsMaximum)
+                {
+                    break;
+                }
+                size_t n = 1;
+                while (n < MAXIMUM_SKIP && n < u32Left && SamePixel(pPixel + n * 3, pBase + (p + n) * 3))
+                {
+                    n++;
+                }
+                pOps[u32Out++] = OP_SKIP | (n - 1);
+                p += n;
+                continue;
+            }
+
+            size_t r = 1;
+            while (r < MAXIMUM_RUN && r < u32Left && SamePixel(pPixel + r * 3, pPixel))
+            {
+                r++;
+            }
+            if (u32Out + 4 > u32OpsMaximum)
+            {
+                break;
+            }
+            if (r >= 2)
+            {
+                pOps[u32Out++] = OP_RUN | (r - 1);
+                memcpy(pOps + u32Out, pPixel, 3);
+                u32Out += 3;
+                p += r;
+                u32Used = u32Out;
+                continue;
+            }
+
+            // Literal until a pixel that a skip or a run encodes cheaper.
+            size_t u32Room = (u32OpsMaximum - u32Out - 1) / 3;
+            size_t n = 1;
+            while (n < MAXIMUM_LITERAL && n < u32Left && n < u32Room)
+            {
+                const uint8_t *pNext = pPixel + n * 3;
+                if ((pBase && SamePixel(pNext, pBase + (p + n) * 3)) || (n + 1 < u32Left && SamePixel(pNext, pNext + 3)))
+                {
+                    break;
+                }
+                n++;
+            }
+            pOps[u32Out++] = OP_LITERAL | (n - 1);
+            memcpy(pOps + u32Out, pPixel, n * 3);
+            u32Out += n * 3;
+            p += n;
+            u32Used = u32Out;
+        }
+        u32Pixels = p - u32FirstPixel;
+        // Skips that run to the end of the frame change nothing.
+        return p == u32FramePixels ? u32Used : u32Out;
+    }
+
+    Encoder::Encoder(uint8_t u8Port, size_t u32Pixels, uint32_t u32KeyInterval)
+        : m_u8Port(u8Port), m_vBase(u32Pixels * 3, 0), m_vPackets(MAXIMUM_PACKETS_PER_FRAME * (HEADER_LENGTH + MAXIMUM_OPS_LENGTH)),
+          m_u16Sequence(0), m_bKeyPending(true), m_u32KeyInterval(u32KeyInterval), m_u32SinceKey(0)
+    {
+    }
+
+    bool Encoder::EncodeFrame(const uint8_t *pRgb, const Sender_t &fnSend)
+    {
+        bool bKey = m_bKeyPending || (m_u32KeyInterval != 0 && m_u32SinceKey + 1 >= m_u32KeyInterval);
+        size_t u32Pixels = GetPixels();
+        uint16_t au16FirstPixel[MAXIMUM_PACKETS_PER_FRAME];
+        uint16_t au16OpsLength[MAXIMUM_PACKETS_PER_FRAME];
+        size_t u32Count = 0;
+        size_t u32Pixel = 0;
+        // One packet even when nothing changed: the frame still moves the sequence on.
+        do
+        {
+            if (u32Count == MAXIMUM_PACKETS_PER_FRAME)
+            {
+                return false;
+            }
+            size_t u32Covered;
+            uint8_t *pOps = &m_vPackets[u32Count * (HEADER_LENGTH + MAXIMUM_OPS_LENGTH) + HEADER_LENGTH];
+            au16OpsLength[u32Count] = EncodeOps(pRgb, bKey ? nullptr : m_vBase.data(), u32Pixels, u32Pixel, pOps, MAXIMUM_OPS_LENGTH, u32Covered);
+            au16FirstPixel[u32Count] = u32Pixel;
+            u32Pixel += u32Covered;
+            u32Count++;
+        } while (u32Pixel < u32Pixels);
+
+        Header stHeader = {};
+        stHeader.u8Type = bKey ? TYPE_KEY : TYPE_DELTA;
+        stHeader.u8Port = m_u8Port;
+        stHeader.u16Sequence = m_u16Sequence + 1;
+        stHeader.u16BaseSequence = m_u16Sequence;
+        stHeader.u8Count = u32Count;
+        for (size_t i = 0; i < u32Count; ++i)
+        {
+            uint8_t *pPacket = &m_vPackets[i * (HEADER_LENGTH + MAXIMUM_OPS_LENGTH)];
+            stHeader.u8Index = i;
+            stHeader.u16FirstPixel = au16FirstPixel[i];
+            stHeader.u16OpsLength = au16OpsLength[i];
+            WriteHeader(stHeader, pPacket);
+            fnSend(pPacket, HEADER_LENGTH + au16OpsLength[i]);
+        }
+        memcpy(m_vBase.data(), pRgb, m_vBase.size());
+        m_u16Sequence++;
+        m_bKeyPending = false;
+        m_u32SinceKey = bKey ? 0 : m_u32SinceKey + 1;
+        return true;
+    }
+
+    bool Encoder::HandleKeyRequest(const uint8_t *pData, size_t u32Length)
+    {
+        Header stHeader;
+        if (!ReadHeader(pData, u32Length, stHeader) || stHeader.u8Type != TYPE_KEY_REQUEST || stHeader.u8Port != m_u8Port)
+        {
+            return false;
+        }
+        m_bKeyPending = true;
+        return true;
+    }
+}
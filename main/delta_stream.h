@@ -0,0 +1,112 @@
+#ifndef __ARTNET_NODE_DELTA_STREAM_H__
+#define __ARTNET_NODE_DELTA_STREAM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+#include <vector>
+
+// Compressed per-port pixel stream: keyframes carry every pixel, delta frames only what changed since
+// a named base frame. Plain C++ without ESP-IDF so a host side relay can share the codec.
+//
+// Datagram, big endian:
+//   0  'L' 'D' 'S' version
+//   4  type (TYPE_*)
+//   5  port
+//   6  frame sequence
+//   8  base sequence, the frame a delta applies to
+//   10 packet index, packet count of the frame (count <= MAXIMUM_PACKETS_PER_FRAME)
+//   12 first pixel of this packet
+//   14 ops length
+//   16 ops
+//
+// Ops run over RGB pixels from the first pixel on:
+//   0x00..0x3F  skip n + 1 pixels, unchanged from the base (delta only)
+//   0x40..0x7F  run of n + 1 pixels of the one RGB that follows
+//   0x80..0xFF  n + 1 literal RGB pixels follow
+namespace DeltaStream
+{
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_LENGTH = 16;
+    static constexpr size_t MAXIMUM_PACKETS_PER_FRAME = 32;
+    static constexpr size_t MAXIMUM_OPS_LENGTH = 1400;
+
+    enum Type : uint8_t
+    {
+        TYPE_KEY = 0,
+        TYPE_DELTA = 1,
+        TYPE_KEY_REQUEST = 2, // node to sender, header only, port and the newest frame sequence seen
+    };
+
+    static constexpr uint8_t OP_SKIP = 0x00;
+    static constexpr uint8_t OP_RUN = 0x40;
+    static constexpr uint8_t OP_LITERAL = 0x80;
+    static constexpr size_t MAXIMUM_SKIP = 0x40;
+    static constexpr size_t MAXIMUM_RUN = 0x40;
+    static constexpr size_t MAXIMUM_LITERAL = 0x80;
+
+    typedef struct
+    {
+        uint8_t u8Type;
+        uint8_t u8Port;
+        uint16_t u16Sequence;
+        uint16_t u16BaseSequence;
+        uint8_t u8Index;
+        uint8_t u8Count;
+        uint16_t u16FirstPixel;
+        uint16_t u16OpsLength;
+    } Header;
+
+    // Returns false unless pData holds a complete, consistent datagram of this version.
+    bool ReadHeader(const uint8_t *pData, size_t u32Length, Header &stHeader);
+    void WriteHeader(const Header &stHeader, uint8_t *pData);
+
+    // Applies one packet's ops to the RGB frame. False when the ops are malformed or run past the frame,
+    // the frame is then partly updated.
+    bool ApplyOps(uint8_t *pFrame, size_t u32FramePixels, size_t u32FirstPixel, const uint8_t *pOps, size_t u32OpsLength, bool bKey);
+
+    // Encodes pixels from u32FirstPixel on until the frame ends or u32OpsMaximum would be exceeded.
+    // pBase nullptr encodes a keyframe. Returns the ops length and the pixels covered in u32Pixels.
+    size_t EncodeOps(const uint8_t *pFrame, const uint8_t *pBase, size_t u32FramePixels, size_t u32FirstPixel,
+                     uint8_t *pOps, size_t u32OpsMaximum, size_t &u32Pixels);
+
+    // Sender side of one port's stream: a keyframe first, then deltas against the frame sent before it. The next
+    // frame is a keyframe again once the node asks for one, and every u32KeyInterval frames unless that is 0.
+    class Encoder
+    {
+        uint8_t m_u8Port;
+        std::vector<uint8_t> m_vBase; // RGB of the last frame sent
+        std::vector<uint8_t> m_vPackets; // datagrams of the frame being sent, one HEADER_LENGTH + MAXIMUM_OPS_LENGTH slot each
+        uint16_t m_u16Sequence; // of the last frame sent
+        bool m_bKeyPending;
+        uint32_t m_u32KeyInterval;
+        uint32_t m_u32SinceKey;
+
+    public:
+        typedef std::function<void(const uint8_t *pData, size_t u32Length)> Sender_t;
+
+        Encoder(uint8_t u8Port, size_t u32Pixels, uint32_t u32KeyInterval = 0);
+        // Encodes GetPixels() RGB pixels and hands each datagram to fnSend. False when the frame would take more
+        // than MAXIMUM_PACKETS_PER_FRAME datagrams, nothing is sent then.
+        bool EncodeFrame(const uint8_t *pRgb, const Sender_t &fnSend);
+        // A key request for this port makes the next frame a keyframe. False for any other datagram.
+        bool HandleKeyRequest(const uint8_t *pData, size_t u32Length);
+        uint8_t GetPort() const { return m_u8Port; }
+        size_t GetPixels() const { return m_vBase.size() / 3; }
+        uint16_t GetSequence() const { return m_u16Sequence; }
+    };
+
+    // Frames up to this many sequence numbers behind are stale, further back means the sender restarted.
+    static constexpr int16_t REORDER_WINDOW = 32;
+
+    // Signed distance a - b between 16-bit sequence numbers.
+    static inline int16_t SequenceDistance(uint16_t a, uint16_t b) { return (int16_t)(uint16_t)(a - b); }
+    static inline bool IsStale(uint16_t u16Sequence, uint16_t u16Newest)
+    {
+        int16_t s16Distance = SequenceDistance(u16Sequence, u16Newest);
+        return s16Distance <= 0 && s16Distance > -REORDER_WINDOW;
+    }
+}
+
+#endif /* __ARTNET_NODE_DELTA_STREAM_H__ */
@@ -0,0 +1,123 @@
+#include "dmx_message.h"
+#include "esp_log.h"
+
+static const char *TAG = "DMX-Pool";
+
+static inline uint32_t MakeHead(uint32_t u32Tag, uint16_t u16Slot)
+{
+    return (u32Tag << 16) | u16Slot;
+}
+
+DMX512Message::DMX512Message(const DMX512Message &oOther) : m_pPool(oOther.m_pPool), m_u16Slot(oOther.m_u16Slot)
+{
+    if (m_pPool)
+    {
+        m_pPool->Retain(m_u16Slot);
+    }
+}
+
+DMX512Message::DMX512Message(DMX512Message &&oOther) noexcept : m_pPool(oOther.m_pPool), m_u16Slot(oOther.m_u16Slot)
+{
+    oOther.m_pPool = nullptr;
+}
+
+DMX512Message &DMX512Message::operator=(const DMX512Message &oOther)
+{
+    if (this != &oOther)
+    {
+        if (oOther.m_pPool)
+        {
+            oOther.m_pPool->Retain(oOther.m_u16Slot);
+        }
+        Release();
+        m_pPool = oOther.m_pPool;
+        m_u16Slot = oOther.m_u16Slot;
+    }
+    return *this;
+}
+
+DMX512Message &DMX512Message::operator=(DMX512Message &&oOther) noexcept
+{
+    if (this != &oOther)
+    {
+        Release();
+        m_pPool = oOther.m_pPool;
+        m_u16Slot = oOther.m_u16Slot;
+        oOther.m_pPool = nullptr;
+    }
+    return *this;
+}
+
+void DMX512Message::Release()
+{
+    if (m_pPool)
+    {
+        m_pPool->Release(m_u16Slot);
+        m_pPool = nullptr;
+    }
+}
+
+char *DMX512Message::GetBuffer() const
+{
+    return m_pPool ? m_pPool->GetBuffer(m_u16Slot) : nullptr;
+}
+
+int32_t DMX512Message::GetUniverse() const
+{
+    const uint8_t *pData = (const uint8_t *)GetBuffer();
+    return ((pData[15] & 0x7F) << 8) | pData[14]; // 15-bit Port-Address
+}
+
+DMX512MessagePool::DMX512MessagePool()
+{
+    for (uint16_t i = 0; i < m_aSlots.size(); ++i)
+    {
+        m_aSlots[i].m_u32RefCount.store(0, std::memory_order_relaxed);
+        m_aSlots[i].m_u16Next.store(i + 1u < m_aSlots.size() ? i + 1 : m_u16NoSlot, std::memory_order_relaxed);
+    }
+    m_u32Head.store(MakeHead(0, 0), std::memory_order_release);
+    m_s32FreeCount.store(m_aSlots.size(), std::memory_order_relaxed);
+    m_u32ExhaustedCount.store(0, std::memory_order_relaxed);
+    ESP_LOGI(TAG, "Pool of %d slots (%d bytes each) ready", (int)m_aSlots.size(), PROJECT_DMX_MESSAGE_BUFFER_SIZE);
+}
+
+DMX512Message DMX512MessagePool::Acquire()
+{
+    uint32_t u32Head = m_u32Head.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint16_t u16Slot = u32Head & 0xFFFF;
+        if (u16Slot == m_u16NoSlot)
+        {
+            m_u32ExhaustedCount.fetch_add(1, std::memory_order_relaxed);
+            return DMX512Message();
+        }
+        uint16_t u16Next = m_aSlots[u16Slot].m_u16Next.load(std::memory_order_relaxed);
+        if (m_u32Head.compare_exchange_weak(u32Head, MakeHead((u32Head >> 16) + 1, u16Next), std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            m_aSlots[u16Slot].m_u32RefCount.store(1, std::memory_order_relaxed);
+            m_s32FreeCount.fetch_sub(1, std::memory_order_relaxed);
+            return DMX512Message(this, u16Slot);
+        }
+    }
+}
+
+void DMX512MessagePool::Retain(uint16_t u16Slot)
+{
+    m_aSlots[u16Slot].m_u32RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DMX512MessagePool::Release(uint16_t u16Slot)
+{
+    if (m_aSlots[u16Slot].m_u32RefCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    uint32_t u32Head = m_u32Head.load(std::memory_order_relaxed);
+    do
+    {
+        m_aSlots[u16Slot].m_u16Next.store(u32Head & 0xFFFF, std::memory_order_relaxed);
+    } while (!m_u32Head.compare_exchange_weak(u32Head, MakeHead((u32Head >> 16) + 1, u16Slot), std::memory_order_release, std::memory_order_relaxed));
+    m_s32FreeCount.fetch_add(1, std::memory_order_relaxed);
+}
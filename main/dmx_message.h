@@ -0,0 +1,92 @@
+#ifndef __ARTNET_NODE_DMX_MESSAGE_H__
+#define __ARTNET_NODE_DMX_MESSAGE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <array>
+
+// Largest Art-Net datagram handled: ArtDmx is 18 + 512, ArtFec 18 + 3 * 8 + 512, ArtDmxBatch fills
+// an unfragmented datagram, 1500 byte MTU less IP and UDP headers.
+#ifndef PROJECT_DMX_MESSAGE_BUFFER_SIZE
+#define PROJECT_DMX_MESSAGE_BUFFER_SIZE 1472
+#endif
+
+// Ports copy the payload on arrival, so only the slots in flight in the receive path are needed.
+#ifndef PROJECT_DMX_MESSAGE_POOL_SIZE
+#define PROJECT_DMX_MESSAGE_POOL_SIZE 8
+#endif
+
+class DMX512MessagePool;
+
+// Copies up to u32Length payload bytes into pDest and returns the number of bytes written.
+typedef size_t (*PayloadCopier_t)(void *pDest, size_t u32Length, void *pvContext);
+
+// Handle to a pooled receive buffer. Copies share the slot, the last one returns it to the pool.
+class DMX512Message
+{
+    DMX512MessagePool *m_pPool;
+    uint16_t m_u16Slot;
+
+    friend class DMX512MessagePool;
+
+    DMX512Message(DMX512MessagePool *pPool, uint16_t u16Slot) : m_pPool(pPool), m_u16Slot(u16Slot) {}
+    void Release();
+
+public:
+    DMX512Message() : m_pPool(nullptr), m_u16Slot(0) {}
+    DMX512Message(const DMX512Message &oOther);
+    DMX512Message(DMX512Message &&oOther) noexcept;
+    DMX512Message &operator=(const DMX512Message &oOther);
+    DMX512Message &operator=(DMX512Message &&oOther) noexcept;
+    ~DMX512Message() { Release(); }
+
+    bool IsValid() const { return m_pPool != nullptr; }
+    void Reset() { Release(); }
+    int32_t GetUniverse() const;
+    char *GetBuffer() const;
+    static constexpr size_t GetBufferLength() { return PROJECT_DMX_MESSAGE_BUFFER_SIZE; }
+};
+
+// Fixed-capacity, lock-free pool of receive buffers. The free list is a Treiber stack of
+// slot indices whose head carries a 16-bit tag in the upper half to defeat ABA.
+class DMX512MessagePool
+{
+    static constexpr uint16_t m_u16NoSlot = 0xFFFF;
+
+    struct Slot
+    {
+        alignas(4) char m_aData[PROJECT_DMX_MESSAGE_BUFFER_SIZE];
+        std::atomic<uint32_t> m_u32RefCount;
+        std::atomic<uint16_t> m_u16Next;
+    };
+
+    std::array<Slot, PROJECT_DMX_MESSAGE_POOL_SIZE> m_aSlots;
+    std::atomic<uint32_t> m_u32Head;
+    std::atomic<int32_t> m_s32FreeCount;
+    std::atomic<uint32_t> m_u32ExhaustedCount;
+
+    friend class DMX512Message;
+    void Retain(uint16_t u16Slot);
+    void Release(uint16_t u16Slot);
+    char *GetBuffer(uint16_t u16Slot) { return m_aSlots[u16Slot].m_aData; }
+
+public:
+    static DMX512MessagePool &GetInstance()
+    {
+        static DMX512MessagePool oIns;
+        return oIns;
+    }
+    DMX512MessagePool();
+
+    // Returns an invalid handle when every slot is in use.
+    DMX512Message Acquire();
+    int32_t GetFreeCount() const { return m_s32FreeCount.load(std::memory_order_relaxed); }
+    uint32_t GetExhaustedCount() const { return m_u32ExhaustedCount.load(std::memory_order_relaxed); }
+    static constexpr int32_t GetCapacity() { return PROJECT_DMX_MESSAGE_POOL_SIZE; }
+};
+
+static_assert(PROJECT_DMX_MESSAGE_POOL_SIZE < 0xFFFF, "DMX512 message pool slot index must fit in 16 bits");
+
+#endif /* __ARTNET_NODE_DMX_MESSAGE_H__ */
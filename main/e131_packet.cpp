@@ -0,0 +1,16 @@
+#include "e131_packet.h"
+#include "cJSON.h"
+
+namespace E131
+{
+    cJSON *ParseStats::ToJson() const
+    {
+        static const char *apNames[PARSE_RESULT_COUNT] = {"Ok", "TooShort", "BadId", "BadVector", "BadLength", "Unsupported"};
+        cJSON *json = cJSON_CreateObject();
+        for (int32_t i = 0; i < PARSE_RESULT_COUNT; ++i)
+        {
+            cJSON_AddNumberToObject(json, apNames[i], m_aCount[i]);
+        }
+        return json;
+    }
+}
@@ -0,0 +1,206 @@
+#ifndef __ARTNET_NODE_E131_PACKET_H__
+#define __ARTNET_NODE_E131_PACKET_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <array>
+
+struct cJSON;
+
+// ANSI E1.31 (sACN), data and universe synchronization packets.
+namespace E131
+{
+    enum RootVector : uint32_t
+    {
+        VECTOR_ROOT_DATA = 0x00000004,
+        VECTOR_ROOT_EXTENDED = 0x00000008,
+    };
+
+    enum FramingVector : uint32_t
+    {
+        VECTOR_EXTENDED_SYNCHRONIZATION = 0x00000001,
+        VECTOR_EXTENDED_DISCOVERY = 0x00000002,
+        VECTOR_DATA_PACKET = 0x00000002,
+    };
+
+    enum PacketType
+    {
+        PACKET_NONE,
+        PACKET_DATA,
+        PACKET_SYNC,
+    };
+
+    static constexpr uint16_t UDP_PORT = 5568;
+    static constexpr uint16_t MAXIMUM_DMX_LENGTH = 512;
+    static constexpr uint16_t MINIMUM_UNIVERSE = 1;
+    static constexpr uint16_t MAXIMUM_UNIVERSE = 63999;
+    static constexpr uint8_t DEFAULT_PRIORITY = 100;
+    static constexpr uint8_t OPTION_PREVIEW_DATA = 0x80;
+    static constexpr uint8_t OPTION_STREAM_TERMINATED = 0x40;
+
+    // Byte offsets, every field is big endian.
+    static constexpr size_t OFFSET_PREAMBLE_SIZE = 0;
+    static constexpr size_t OFFSET_POSTAMBLE_SIZE = 2;
+    static constexpr size_t OFFSET_ACN_ID = 4;
+    static constexpr size_t OFFSET_ROOT_VECTOR = 18;
+    static constexpr size_t OFFSET_CID = 22;
+    static constexpr size_t OFFSET_FRAMING_VECTOR = 40;
+    static constexpr size_t ROOT_LENGTH = 38;
+    // Data packet
+    static constexpr size_t OFFSET_DATA_PRIORITY = 108;
+    static constexpr size_t OFFSET_DATA_SYNC_ADDRESS = 109;
+    static constexpr size_t OFFSET_DATA_SEQUENCE = 111;
+    static constexpr size_t OFFSET_DATA_OPTIONS = 112;
+    static constexpr size_t OFFSET_DATA_UNIVERSE = 113;
+    static constexpr size_t OFFSET_DMP_VECTOR = 117;
+    static constexpr size_t OFFSET_DMP_ADDRESS_TYPE = 118;
+    static constexpr size_t OFFSET_DMP_PROPERTY_COUNT = 123;
+    static constexpr size_t OFFSET_DMP_START_CODE = 125;
+    static constexpr size_t OFFSET_DMX_DATA = 126;
+    // Synchronization packet
+    static constexpr size_t OFFSET_SYNC_SEQUENCE = 44;
+    static constexpr size_t OFFSET_SYNC_ADDRESS = 45;
+    static constexpr size_t SYNC_LENGTH = 49;
+
+    static constexpr char ACN_ID[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', '\0', '\0', '\0'};
+    static constexpr size_t CID_LENGTH = 16;
+
+    // Multicast group of a universe, 239.255.<hi>.<lo>, in network byte order.
+    static inline uint32_t MulticastAddress(uint16_t u16Universe)
+    {
+        const uint8_t au8Address[4] = {239, 255, (uint8_t)(u16Universe >> 8), (uint8_t)u16Universe};
+        uint32_t u32Address;
+        memcpy(&u32Address, au8Address, sizeof(u32Address));
+        return u32Address;
+    }
+
+    enum ParseResult
+    {
+        PARSE_OK,
+        PARSE_TOO_SHORT,
+        PARSE_BAD_ID,
+        PARSE_BAD_VECTOR,
+        PARSE_BAD_LENGTH,
+        PARSE_UNSUPPORTED, // universe discovery, alternate START codes
+        PARSE_RESULT_COUNT,
+    };
+
+    // Validated, zero-copy view over a received datagram, the counterpart of ArtNet::Packet.
+    class Packet
+    {
+        const uint8_t *m_pData;
+        size_t m_u32Length;
+        PacketType m_eType;
+
+        uint16_t Read16(size_t u32Offset) const { return (m_pData[u32Offset] << 8) | m_pData[u32Offset + 1]; }
+        uint32_t Read32(size_t u32Offset) const { return ((uint32_t)Read16(u32Offset) << 16) | Read16(u32Offset + 2); }
+        // Each PDU starts with 4 bits of flags (0x7) and a 12-bit length up to the end of the packet.
+        bool CheckPduLength(size_t u32Offset) const { return Read16(u32Offset) == (0x7000 | (m_u32Length - u32Offset)); }
+
+    public:
+        Packet() : m_pData(nullptr), m_u32Length(0), m_eType(PACKET_NONE) {}
+
+        ParseResult Parse(const void *pData, size_t u32Length)
+        {
+            m_pData = (const uint8_t *)pData;
+            m_u32Length = u32Length;
+            m_eType = PACKET_NONE;
+            if (u32Length < ROOT_LENGTH + 6)
+            {
+                return PARSE_TOO_SHORT;
+            }
+            if (Read16(OFFSET_PREAMBLE_SIZE) != 0x0010 || Read16(OFFSET_POSTAMBLE_SIZE) != 0 ||
+                memcmp(m_pData + OFFSET_ACN_ID, ACN_ID, sizeof(ACN_ID)) != 0)
+            {
+                return PARSE_BAD_ID;
+            }
+            if (!CheckPduLength(OFFSET_ROOT_VECTOR - 2) || !CheckPduLength(OFFSET_FRAMING_VECTOR - 2))
+            {
+                return PARSE_BAD_LENGTH;
+            }
+
+            uint32_t u32RootVector = Read32(OFFSET_ROOT_VECTOR);
+            uint32_t u32FramingVector = Read32(OFFSET_FRAMING_VECTOR);
+            if (u32RootVector == VECTOR_ROOT_EXTENDED)
+            {
+                if (u32FramingVector == VECTOR_EXTENDED_DISCOVERY)
+                {
+                    return PARSE_UNSUPPORTED;
+                }
+                if (u32FramingVector != VECTOR_EXTENDED_SYNCHRONIZATION)
+                {
+                    return PARSE_BAD_VECTOR;
+                }
+                if (u32Length < SYNC_LENGTH)
+                {
+                    return PARSE_TOO_SHORT;
+                }
+                m_eType = PACKET_SYNC;
+                return PARSE_OK;
+            }
+            if (u32RootVector != VECTOR_ROOT_DATA || u32FramingVector != VECTOR_DATA_PACKET)
+            {
+                return PARSE_BAD_VECTOR;
+            }
+
+            if (u32Length < OFFSET_DMX_DATA + 1)
+            {
+                return PARSE_TOO_SHORT;
+            }
+            if (m_pData[OFFSET_DMP_VECTOR] != 0x02 || m_pData[OFFSET_DMP_ADDRESS_TYPE] != 0xA1)
+            {
+                return PARSE_BAD_VECTOR;
+            }
+            // The property count includes the START code.
+            uint16_t u16Count = Read16(OFFSET_DMP_PROPERTY_COUNT);
+            if (!CheckPduLength(OFFSET_DMP_VECTOR - 2) || u16Count < 2 || u16Count > MAXIMUM_DMX_LENGTH + 1 ||
+                OFFSET_DMP_START_CODE + u16Count > u32Length)
+            {
+                return PARSE_BAD_LENGTH;
+            }
+            uint16_t u16Universe = GetUniverse();
+            if (u16Universe < MINIMUM_UNIVERSE || u16Universe > MAXIMUM_UNIVERSE)
+            {
+                return PARSE_BAD_LENGTH;
+            }
+            if (m_pData[OFFSET_DMP_START_CODE] != 0x00)
+            {
+                return PARSE_UNSUPPORTED;
+            }
+            m_eType = PACKET_DATA;
+            return PARSE_OK;
+        }
+
+        PacketType GetType() const { return m_eType; }
+        const uint8_t *GetCid() const { return m_pData + OFFSET_CID; }
+
+        // Data packet, only valid after Parse() returned PARSE_OK for PACKET_DATA.
+        uint8_t GetPriority() const { return m_pData[OFFSET_DATA_PRIORITY]; }
+        uint16_t GetSyncAddress() const { return Read16(OFFSET_DATA_SYNC_ADDRESS); }
+        uint8_t GetSequence() const { return m_pData[OFFSET_DATA_SEQUENCE]; }
+        uint8_t GetOptions() const { return m_pData[OFFSET_DATA_OPTIONS]; }
+        uint16_t GetUniverse() const { return Read16(OFFSET_DATA_UNIVERSE); }
+        uint16_t GetDmxLength() const { return Read16(OFFSET_DMP_PROPERTY_COUNT) - 1; }
+        const uint8_t *GetDmxData() const { return m_pData + OFFSET_DMX_DATA; }
+
+        // Synchronization packet
+        uint8_t GetSyncSequence() const { return m_pData[OFFSET_SYNC_SEQUENCE]; }
+        uint16_t GetSyncUniverse() const { return Read16(OFFSET_SYNC_ADDRESS); }
+    };
+
+    // Parse outcome counters, see ArtNet::ParseStats.
+    class ParseStats
+    {
+        std::array<uint32_t, PARSE_RESULT_COUNT> m_aCount;
+
+    public:
+        ParseStats() { m_aCount.fill(0); }
+        void Add(ParseResult eResult) { m_aCount[eResult]++; }
+        uint32_t Get(ParseResult eResult) const { return m_aCount[eResult]; }
+        cJSON *ToJson() const;
+    };
+}
+
+#endif /* __ARTNET_NODE_E131_PACKET_H__ */
@@ -0,0 +1,317 @@
+#include "led_output.h"
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include "esp_check.h"
+#include "esp_log.h"
+
+static const char *TAG = "Led-Output";
+
+// Bit timings of the clockless LedTypeOnline types. Clocked (LED6803, LED8806, LED9813) and DMX512 types have no row.
+// LED1903 / LED16703 keep the SM16703 waveform FastLED generated (300/600/300, RBG).
+static const LedChipset g_aChipsets[] =
+{
+    {"LED1903", 1200, 300, 900, 300, 3, {0, 2, 1}},
+    {"LED1904", 1250, 400, 850, 300, 4, {0, 1, 2, LED_WIRE_WHITE}}, // UCS1904, RGBW
+    {"LED1905", 1250, 400, 850, 300, 3, {0, 1, 2}},
+    {"LED2811", 1250, 320, 640, 300, 3, {0, 1, 2}},
+    {"LED2812", 1250, 400, 800, 300, 3, {1, 0, 2}},                // GRB
+    {"LED8206", 1250, 300, 900, 300, 3, {0, 1, 2}},
+    {"LED1916", 1250, 400, 850, 300, 3, {0, 1, 2}},
+    {"LED16703", 1200, 300, 900, 300, 3, {0, 2, 1}},
+    {"LED9883", 1250, 400, 850, 300, 3, {0, 1, 2}},
+    {"LED1914", 1250, 360, 720, 300, 3, {0, 1, 2}},
+    {"LED8903", 1250, 400, 850, 300, 6, {0, 0, 1, 1, 2, 2}},       // UCS8903, 16-bit RGB, c -> c * 257
+    {"UCS1903", 2500, 500, 2000, 300, 3, {0, 1, 2}},
+};
+
+static uint16_t NsToTicks(uint32_t u32Ns)
+{
+    return (uint64_t)u32Ns * PROJECT_LED_RMT_RESOLUTION_HZ / 1000000000ULL;
+}
+
+// One RMT symbol per bit value: high for u32HighNs, then low for the rest of the bit period.
+static esp_err_t MakeBitSymbol(uint32_t u32HighNs, uint32_t u32PeriodNs, rmt_symbol_word_t &stSymbol)
+{
+    ESP_RETURN_ON_FALSE(u32HighNs < u32PeriodNs, ESP_ERR_INVALID_ARG, TAG, "High time %" PRIu32 "ns does not fit a %" PRIu32 "ns bit", u32HighNs, u32PeriodNs);
+    uint16_t u16HighTicks = NsToTicks(u32HighNs);
+    uint16_t u16LowTicks = NsToTicks(u32PeriodNs - u32HighNs);
+    // Durations are 15-bit fields, a zero duration would end the transmission.
+    ESP_RETURN_ON_FALSE(0 < u16HighTicks && u16HighTicks < 0x8000 && 0 < u16LowTicks && u16LowTicks < 0x8000, ESP_ERR_INVALID_ARG, TAG,
+                        "%" PRIu32 "/%" PRIu32 "ns is out of the RMT resolution", u32HighNs, u32PeriodNs);
+    stSymbol.level0 = 1;
+    stSymbol.duration0 = u16HighTicks;
+    stSymbol.level1 = 0;
+    stSymbol.duration1 = u16LowTicks;
+    return ESP_OK;
+}
+
+// Pixel bytes through the bytes encoder, then the latch low time through the copy encoder.
+typedef struct
+{
+    rmt_encoder_t base;
+    rmt_encoder_t *pBytesEncoder;
+    rmt_encoder_t *pCopyEncoder;
+    int32_t s32State;
+    rmt_symbol_word_t stResetCode;
+} LedRmtEncoder;
+
+static size_t LedEncoderEncode(rmt_encoder_t *pEncoder, rmt_channel_handle_t hChannel, const void *pData, size_t u32Size, rmt_encode_state_t *pRetState)
+{
+    LedRmtEncoder *pLedEncoder = __containerof(pEncoder, LedRmtEncoder, base);
+    rmt_encode_state_t eSessionState = RMT_ENCODING_RESET;
+    int32_t s32State = RMT_ENCODING_RESET;
+    size_t u32Encoded = 0;
+    switch (pLedEncoder->s32State)
+    {
+    case 0:
+        u32Encoded += pLedEncoder->pBytesEncoder->encode(pLedEncoder->pBytesEncoder, hChannel, pData, u32Size, &eSessionState);
+        if (eSessionState & RMT_ENCODING_COMPLETE)
+        {
+            pLedEncoder->s32State = 1;
+        }
+        if (eSessionState & RMT_ENCODING_MEM_FULL)
+        {
+            s32State |= RMT_ENCODING_MEM_FULL;
+            break;
+        }
+        // fall-through
+    case 1:
+        u32Encoded += pLedEncoder->pCopyEncoder->encode(pLedEncoder->pCopyEncoder, hChannel, &pLedEncoder->stResetCode, sizeof(pLedEncoder->stResetCode), &eSessionState);
+        if (eSessionState & RMT_ENCODING_COMPLETE)
+        {
+            pLedEncoder->s32State = RMT_ENCODING_RESET;
+            s32State |= RMT_ENCODING_COMPLETE;
+        }
+        if (eSessionState & RMT_ENCODING_MEM_FULL)
+        {
+            s32State |= RMT_ENCODING_MEM_FULL;
+        }
+        break;
+    }
+    *pRetState = (rmt_encode_state_t)s32State;
+    return u32Encoded;
+}
+
+static esp_err_t LedEncoderDelete(rmt_encoder_t *pEncoder)
+{
+    LedRmtEncoder *pLedEncoder = __containerof(pEncoder, LedRmtEncoder, base);
+    rmt_del_encoder(pLedEncoder->pBytesEncoder);
+    rmt_del_encoder(pLedEncoder->pCopyEncoder);
+    delete pLedEncoder;
+    return ESP_OK;
+}
+
+static esp_err_t LedEncoderReset(rmt_encoder_t *pEncoder)
+{
+    LedRmtEncoder *pLedEncoder = __containerof(pEncoder, LedRmtEncoder, base);
+    rmt_encoder_reset(pLedEncoder->pBytesEncoder);
+    rmt_encoder_reset(pLedEncoder->pCopyEncoder);
+    pLedEncoder->s32State = RMT_ENCODING_RESET;
+    return ESP_OK;
+}
+
+static esp_err_t NewLedEncoder(const rmt_symbol_word_t &stBit0, const rmt_symbol_word_t &stBit1, uint16_t u16ResetUs, rmt_encoder_handle_t *pRetEncoder)
+{
+    LedRmtEncoder *pLedEncoder = new LedRmtEncoder();
+    ESP_RETURN_ON_FALSE(pLedEncoder, ESP_ERR_NO_MEM, TAG, "No memory for led encoder");
+    pLedEncoder->base.encode = LedEncoderEncode;
+    pLedEncoder->base.del = LedEncoderDelete;
+    pLedEncoder->base.reset = LedEncoderReset;
+
+    rmt_bytes_encoder_config_t stBytesConfig = {};
+    stBytesConfig.bit0 = stBit0;
+    stBytesConfig.bit1 = stBit1;
+    stBytesConfig.flags.msb_first = 1;
+    esp_err_t err = rmt_new_bytes_encoder(&stBytesConfig, &pLedEncoder->pBytesEncoder);
+    if (err != ESP_OK)
+    {
+        delete pLedEncoder;
+        return err;
+    }
+
+    rmt_copy_encoder_config_t stCopyConfig = {};
+    err = rmt_new_copy_encoder(&stCopyConfig, &pLedEncoder->pCopyEncoder);
+    if (err != ESP_OK)
+    {
+        rmt_del_encoder(pLedEncoder->pBytesEncoder);
+        delete pLedEncoder;
+        return err;
+    }
+
+    uint16_t u16ResetTicks = NsToTicks(u16ResetUs * 1000) / 2;
+    pLedEncoder->stResetCode.level0 = 0;
+    pLedEncoder->stResetCode.duration0 = u16ResetTicks;
+    pLedEncoder->stResetCode.level1 = 0;
+    pLedEncoder->stResetCode.duration1 = u16ResetTicks;
+
+    *pRetEncoder = &pLedEncoder->base;
+    return ESP_OK;
+}
+
+PixelTransform::PixelTransform()
+{
+    m_u8BytesPerPixel = 0;
+    m_aSource.fill(0);
+    m_bIdentity = true;
+}
+
+void PixelTransform::Build(const LedChipset &stChipset, float fGamma, float fBrightness, const std::array<uint8_t, 3> &aWhiteBalance)
+{
+    m_u8BytesPerPixel = stChipset.u8BytesPerPixel;
+    m_bIdentity = m_u8BytesPerPixel == 3;
+    for (uint8_t j = 0; j < m_u8BytesPerPixel; ++j)
+    {
+        uint8_t u8Channel = stChipset.aWire[j];
+        std::array<uint8_t, 256> &aLut = m_aLut[j];
+        m_aSource[j] = u8Channel;
+        if (u8Channel == LED_WIRE_WHITE)
+        {
+            // White balance is a matter of R, G and B, W only follows gamma and brightness.
+            for (int32_t x = 0; x < 256; ++x)
+            {
+                aLut[x] = (uint8_t)(powf(x / 255.0f, fGamma) * fBrightness * 255.0f + 0.5f);
+            }
+            m_bIdentity = false;
+            continue;
+        }
+        // A 16-bit channel is two neighbouring wire bytes of the same input, high byte first.
+        bool bLowByte = j > 0 && stChipset.aWire[j - 1] == u8Channel;
+        bool bWide = bLowByte || (j + 1 < m_u8BytesPerPixel && stChipset.aWire[j + 1] == u8Channel);
+        float fScale = fBrightness * aWhiteBalance[u8Channel] / 255.0f;
+        for (int32_t x = 0; x < 256; ++x)
+        {
+            float fLevel = powf(x / 255.0f, fGamma) * fScale;
+            uint32_t u32Level16 = (uint32_t)(fLevel * 65535.0f + 0.5f);
+            aLut[x] = bWide ? (bLowByte ? u32Level16 & 0xFF : u32Level16 >> 8) : (uint8_t)(fLevel * 255.0f + 0.5f);
+            m_bIdentity &= aLut[x] == x;
+        }
+        m_bIdentity &= u8Channel == j;
+    }
+}
+
+void PixelTransform::Apply(uint8_t *pWire, const uint8_t *pPixels, size_t u32Length, uint8_t u8Channels) const
+{
+    size_t i = 0;
+    if (m_u8BytesPerPixel == 3 && u8Channels == 3)
+    {
+        // Wire and RGB have the same size: four pixels per step as three words in, twelve lookups, three words out.
+        const uint8_t *pLut0 = m_aLut[0].data(), *pLut1 = m_aLut[1].data(), *pLut2 = m_aLut[2].data();
+        const uint8_t u8Source0 = m_aSource[0], u8Source1 = m_aSource[1], u8Source2 = m_aSource[2];
+        for (; i + 12 <= u32Length; i += 12)
+        {
+            uint8_t aIn[12], aOut[12];
+            memcpy(aIn, pPixels + i, sizeof(aIn));
+            for (size_t k = 0; k < 12; k += 3)
+            {
+                aOut[k] = pLut0[aIn[k + u8Source0]];
+                aOut[k + 1] = pLut1[aIn[k + u8Source1]];
+                aOut[k + 2] = pLut2[aIn[k + u8Source2]];
+            }
+            memcpy(pWire + i, aOut, sizeof(aOut));
+        }
+        pWire += i;
+    }
+    for (; i + u8Channels <= u32Length; i += u8Channels, pWire += m_u8BytesPerPixel)
+    {
+        // Read the whole pixel first, the wire bytes may overwrite it. RGB input has no white.
+        uint8_t aPixel[4] = {pPixels[i], pPixels[i + 1], pPixels[i + 2], u8Channels == 4 ? pPixels[i + 3] : (uint8_t)0};
+        for (uint8_t j = 0; j < m_u8BytesPerPixel; ++j)
+        {
+            pWire[j] = m_aLut[j][aPixel[m_aSource[j]]];
+        }
+    }
+}
+
+RmtLedStrip::RmtLedStrip()
+{
+    m_hChannel = nullptr;
+    m_hEncoder = nullptr;
+    m_pChipset = nullptr;
+    m_stBit0 = {};
+    m_stBit1 = {};
+    m_bBusy = false;
+}
+
+const LedChipset *RmtLedStrip::FindChipset(const std::string &sLedType)
+{
+    for (const LedChipset &stChipset : g_aChipsets)
+    {
+        if (sLedType == stChipset.pName)
+        {
+            return &stChipset;
+        }
+    }
+    return nullptr;
+}
+
+bool RmtLedStrip::HasWhite() const
+{
+    for (uint8_t j = 0; j < m_pChipset->u8BytesPerPixel; ++j)
+    {
+        if (m_pChipset->aWire[j] == LED_WIRE_WHITE)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t RmtLedStrip::Init(int32_t s32Pin, const LedChipset *pChipset, int32_t s32TimeHighNs, int32_t s32TimeLowNs)
+{
+    ESP_RETURN_ON_FALSE(pChipset, ESP_ERR_NOT_SUPPORTED, TAG, "Unsupported chipset on pin %" PRId32, s32Pin);
+    m_pChipset = pChipset;
+    m_oTransform.Build(*pChipset, 1.0f, 1.0f, {255, 255, 255});
+
+    uint32_t u32T1HighNs = s32TimeHighNs > 0 ? s32TimeHighNs : pChipset->u16T1HighNs;
+    uint32_t u32T0HighNs = s32TimeLowNs > 0 ? s32TimeLowNs : pChipset->u16T0HighNs;
+    ESP_RETURN_ON_ERROR(MakeBitSymbol(u32T0HighNs, pChipset->u16BitPeriodNs, m_stBit0), TAG, "%s: Invalid 0 bit", pChipset->pName);
+    ESP_RETURN_ON_ERROR(MakeBitSymbol(u32T1HighNs, pChipset->u16BitPeriodNs, m_stBit1), TAG, "%s: Invalid 1 bit", pChipset->pName);
+
+    rmt_tx_channel_config_t stChannelConfig = {};
+    stChannelConfig.gpio_num = static_cast<gpio_num_t>(s32Pin);
+    stChannelConfig.clk_src = RMT_CLK_SRC_DEFAULT;
+    stChannelConfig.resolution_hz = PROJECT_LED_RMT_RESOLUTION_HZ;
+    stChannelConfig.mem_block_symbols = PROJECT_LED_RMT_MEM_BLOCK_SYMBOLS;
+    stChannelConfig.trans_queue_depth = 2;
+    ESP_RETURN_ON_ERROR(rmt_new_tx_channel(&stChannelConfig, &m_hChannel), TAG, "Failed to create RMT channel on pin %" PRId32, s32Pin);
+    ESP_RETURN_ON_ERROR(NewLedEncoder(m_stBit0, m_stBit1, pChipset->u16ResetUs, &m_hEncoder), TAG, "Failed to create led encoder");
+    ESP_RETURN_ON_ERROR(rmt_enable(m_hChannel), TAG, "Failed to enable RMT channel on pin %" PRId32, s32Pin);
+    ESP_LOGI(TAG, "%s strip on pin %" PRId32 " ready, bit 0 %d/%d ticks, bit 1 %d/%d ticks", pChipset->pName, s32Pin,
+             m_stBit0.duration0, m_stBit0.duration1, m_stBit1.duration0, m_stBit1.duration1);
+    return ESP_OK;
+}
+
+void RmtLedStrip::Encode(uint8_t *pWire, const uint8_t *pPixels, size_t u32Length, uint8_t u8Channels) const
+{
+    if (u8Channels == 3 && m_oTransform.IsIdentity() && pWire == pPixels)
+    {
+        return;
+    }
+    m_oTransform.Apply(pWire, pPixels, u32Length, u8Channels);
+}
+
+esp_err_t RmtLedStrip::Transmit(const uint8_t *pData, size_t u32Length)
+{
+    ESP_RETURN_ON_ERROR(WaitDone(), TAG, "Previous frame still transmitting");
+
+    rmt_transmit_config_t stTransmitConfig = {};
+    stTransmitConfig.loop_count = 0;
+    esp_err_t err = rmt_transmit(m_hChannel, m_hEncoder, pData, u32Length, &stTransmitConfig);
+    m_bBusy = (err == ESP_OK);
+    return err;
+}
+
+esp_err_t RmtLedStrip::WaitDone()
+{
+    if (!m_bBusy)
+    {
+        return ESP_OK;
+    }
+    esp_err_t err = rmt_tx_wait_all_done(m_hChannel, PROJECT_LED_SHOW_TIMEOUT_MS);
+    if (err == ESP_OK)
+    {
+        m_bBusy = false;
+    }
+    return err;
+}
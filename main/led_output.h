@@ -0,0 +1,90 @@
+#ifndef __ARTNET_NODE_LED_OUTPUT_H__
+#define __ARTNET_NODE_LED_OUTPUT_H__
+
+#include <stdio.h>
+#include <string>
+#include <array>
+#include <esp_err.h>
+#include "driver/rmt_tx.h"
+
+#ifndef PROJECT_LED_RMT_RESOLUTION_HZ
+#define PROJECT_LED_RMT_RESOLUTION_HZ 10000000 // 0.1us per tick
+#endif
+
+#ifndef PROJECT_LED_RMT_MEM_BLOCK_SYMBOLS
+#define PROJECT_LED_RMT_MEM_BLOCK_SYMBOLS 64 // ESP32 has 8 x 64 symbols, one block per port
+#endif
+
+#ifndef PROJECT_LED_SHOW_TIMEOUT_MS
+#define PROJECT_LED_SHOW_TIMEOUT_MS 100
+#endif
+
+#ifndef PROJECT_LED_MAXIMUM_BYTES_PER_PIXEL
+#define PROJECT_LED_MAXIMUM_BYTES_PER_PIXEL 6 // 16-bit RGB
+#endif
+
+#define LED_WIRE_WHITE 3 // aWire entry of the W channel, fed from RGBW input, 0 for RGB input
+
+// One row per clockless LedTypeOnline chipset, read at runtime instead of a driver template per type.
+typedef struct
+{
+    const char *pName;
+    uint16_t u16BitPeriodNs;
+    uint16_t u16T0HighNs;
+    uint16_t u16T1HighNs;
+    uint16_t u16ResetUs;
+    uint8_t u8BytesPerPixel;
+    std::array<uint8_t, PROJECT_LED_MAXIMUM_BYTES_PER_PIXEL> aWire; // wire byte n of a pixel is the incoming (RGB or RGBW) byte aWire[n]
+} LedChipset;
+
+// Per-port pixel transform fused into the wire encoding: each wire byte is one table lookup of an input
+// channel, the tables fold in gamma, brightness, white balance and the 16-bit expansion. Built off the
+// hot path whenever the settings change, applied per universe as it lands.
+class PixelTransform
+{
+    uint8_t m_u8BytesPerPixel;
+    std::array<uint8_t, PROJECT_LED_MAXIMUM_BYTES_PER_PIXEL> m_aSource; // input channel of each wire byte
+    std::array<std::array<uint8_t, 256>, PROJECT_LED_MAXIMUM_BYTES_PER_PIXEL> m_aLut; // one per wire byte
+    bool m_bIdentity; // RGB in order and uncorrected, nothing to do in place
+
+public:
+    PixelTransform();
+    // fGamma 1..3, fBrightness 0..1, aWhiteBalance scales the RGB channels by n / 255.
+    void Build(const LedChipset &stChipset, float fGamma, float fBrightness, const std::array<uint8_t, 3> &aWhiteBalance);
+    bool IsIdentity() const { return m_bIdentity; }
+    // u8Channels 3 (RGB) or 4 (RGBW) per input pixel. pPixels may be the tail of the pWire region,
+    // pixels are expanded front to back.
+    void Apply(uint8_t *pWire, const uint8_t *pPixels, size_t u32Length, uint8_t u8Channels) const;
+};
+
+// One clockless strip driven by its own RMT TX channel. Transmit() only queues the frame,
+// so starting every port before waiting on any of them shifts all ports out in parallel.
+class RmtLedStrip
+{
+    rmt_channel_handle_t m_hChannel;
+    rmt_encoder_handle_t m_hEncoder;
+    const LedChipset *m_pChipset;
+    rmt_symbol_word_t m_stBit0;
+    rmt_symbol_word_t m_stBit1;
+    PixelTransform m_oTransform;
+    bool m_bBusy;
+
+public:
+    RmtLedStrip();
+    static const LedChipset *FindChipset(const std::string &sLedType);
+    // s32TimeHighNs / s32TimeLowNs replace the chipset high time of a 1 / 0 bit (T1H / T0H), keeping its bit period.
+    // 0, the Settings default, keeps the chipset value.
+    esp_err_t Init(int32_t s32Pin, const LedChipset *pChipset, int32_t s32TimeHighNs, int32_t s32TimeLowNs);
+    uint8_t GetBytesPerPixel() const { return m_pChipset->u8BytesPerPixel; }
+    bool HasWhite() const;
+    // Applies to the pixels encoded from now on.
+    void SetTransform(float fGamma, float fBrightness, const std::array<uint8_t, 3> &aWhiteBalance) { m_oTransform.Build(*m_pChipset, fGamma, fBrightness, aWhiteBalance); }
+    // Expands u32Length bytes of RGB, or RGBW with u8Channels 4, into the chipset wire format at pWire through the pixel
+    // transform. Called per universe as it lands. pPixels may be the tail of the pWire region, pixels are expanded front to back.
+    void Encode(uint8_t *pWire, const uint8_t *pPixels, size_t u32Length, uint8_t u8Channels = 3) const;
+    // Starts shifting out already encoded bytes. pData must stay untouched until WaitDone().
+    esp_err_t Transmit(const uint8_t *pData, size_t u32Length);
+    esp_err_t WaitDone();
+};
+
+#endif /* __ARTNET_NODE_LED_OUTPUT_H__ */
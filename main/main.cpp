@@ -9,6 +9,7 @@
 #include "models/info.h"
 #include "models/status.h"
 #include "port.h"
+#include "artnet_poll.h"
 #include "driver/gpio.h"
 
 static const char *TAG = "Main";
@@ -33,19 +34,52 @@ static void hello_task(void *pvParameters)
     }
 }
 
-static void dmx_message_handler(const char * msg, size_t len, const char * sender)
+#if !PROJECT_ARTNET_RAW_UDP_RECEIVE
+static void dmx_message_handler(DMX512Message & oMessage, const ArtNet::Packet & oPacket, const char * sender)
 {
-    // ESP_LOGI(TAG, "dmx_message_handler with size of %d - from %s", (int)len, sender);
-    std::shared_ptr<DMX512Message> spMessage = std::make_shared<DMX512Message>();
-    memcpy(spMessage->GetBuffer(), msg, len);
-    int32_t s32StartUniv = Settings::GetInstance().GetStartUniverse();
-    int32_t s32EndUniv = s32StartUniv + Settings::GetInstance().GetNoUniverses();
-    if (s32StartUniv <= spMessage->GetUniverse() && spMessage->GetUniverse() < s32EndUniv)
+    // ESP_LOGI(TAG, "dmx_message_handler with size of %d - from %s", (int)oPacket.GetDmxLength(), sender);
+    // The universe map of the ports decides ownership, the filter already dropped what no port owns.
+    if (Ports::GetInstance().HandleDMXMessage(oMessage, oPacket) > 0)
     {
-        Ports::GetInstance().HandleDMXMessage(spMessage);
-        Status::GetInstance().UpdateForNewDMXMessage(spMessage->GetUniverse());
+        Status::GetInstance().UpdateForNewDMXMessage();
     }
 }
+#endif
+
+static size_t dmx_payload_handler(int32_t s32Univ, uint8_t u8Sequence, size_t len, PayloadCopier_t fnCopy, void * pvContext)
+{
+    size_t u32Copied = Ports::GetInstance().WriteUniverse(s32Univ, u8Sequence, len, fnCopy, pvContext);
+    if (u32Copied > 0)
+    {
+        Status::GetInstance().UpdateForNewDMXMessage();
+    }
+    return u32Copied;
+}
+
+static size_t ddp_payload_handler(size_t u32Offset, size_t len, PayloadCopier_t fnCopy, void * pvContext)
+{
+    Status::GetInstance().UpdateForNewDMXMessage();
+    return Ports::GetInstance().WriteLinear(u32Offset, len, fnCopy, pvContext);
+}
+
+static void ddp_push_handler(const char * msg, size_t len, const char * sender)
+{
+    Ports::GetInstance().Push();
+}
+
+static void port_frame_handler(int32_t s32Port, const uint8_t * pRgb, size_t len)
+{
+    Ports::GetInstance().WritePortFrame(s32Port, pRgb, len);
+}
+
+static void artnet_response(const char * pBuffer, size_t u32BufferSize)
+{
+#if PROJECT_ARTNET_RAW_UDP_RECEIVE
+    ArtNetRawServer::GetInstance().Response(pBuffer, u32BufferSize);
+#else
+    ArtNetServer::GetInstance().Response(pBuffer, u32BufferSize);
+#endif
+}
 
 static void artsync_message_handler(const char * msg, size_t len, const char * sender)
 {
@@ -72,7 +106,7 @@ static void discovery_message_handler(const char * msg, size_t len, const char *
         TArtConfig stArtConfig;
         size_t u32Size;
         GetConfig(stArtConfig, u32Size);
-        ArtNetServer::GetInstance().Response((const char *)&stArtConfig, u32Size);
+        artnet_response((const char *)&stArtConfig, u32Size);
     }
     break;
     case ConfigSetConfig:
@@ -80,7 +114,7 @@ static void discovery_message_handler(const char * msg, size_t len, const char *
         TArtConfig stArtConfig;
         size_t u32Size;
         SetConfig(*(TArtConfig *)msg, stArtConfig, u32Size);
-        ArtNetServer::GetInstance().Response((const char *)&stArtConfig, u32Size);
+        artnet_response((const char *)&stArtConfig, u32Size);
     }
     break;
     default:
@@ -89,6 +123,20 @@ static void discovery_message_handler(const char * msg, size_t len, const char *
     }
 }
 
+static void artpoll_message_handler(const char * msg, size_t len, const char * sender)
+{
+    ArtPollResponder::GetInstance().HandlePoll(sender);
+}
+
+static void fec_message_handler(const char * msg, size_t len, const char * sender)
+{
+    ArtNet::Packet oPacket;
+    if (oPacket.Parse(msg, len, len) == ArtNet::PARSE_OK && oPacket.GetOpCode() == ArtNet::OP_FEC)
+    {
+        Ports::GetInstance().HandleParity(oPacket);
+    }
+}
+
 static void common_message_handler(const char * msg, size_t len, const char * sender)
 {
     ESP_LOGI(TAG, "common_message_handler");
@@ -217,7 +265,8 @@ extern "C" void app_main(void)
         std::string sPass = Settings::GetInstance().GetBroadcastPassword();
         WifiAP::Start();
         CommonServer::GetInstance().RegisterMessageHandler(common_message_handler);
-        xTaskCreate(CommonServer::FreeRTOSTask, "CommonServer::FreeRTOSTask", 4096, NULL, configMAX_PRIORITIES - 2, NULL);
+        CommonServer::GetInstance().Attach(UdpReactor::GetInstance(), PROJECT_UDP_COMMON_PORT);
+        xTaskCreatePinnedToCore(UdpReactor::FreeRTOSTask, "UdpReactor::FreeRTOSTask", PROJECT_UDP_REACTOR_STACK_SIZE, NULL, configMAX_PRIORITIES - 2, NULL, PROJECT_NETWORK_CORE);
     }
     else if (mode == HWStatus::Mode::WIFI_AUTO_CONNECT)
     {
@@ -227,16 +276,48 @@ extern "C" void app_main(void)
 
         WifiAutoConnect::Start();
 
+#if PROJECT_ARTNET_RAW_UDP_RECEIVE
+        ArtNetRawServer::GetInstance().RegisterDMXPayloadHandler(dmx_payload_handler);
+        ArtNetRawServer::GetInstance().RegisterArtSyncMessageHandler(artsync_message_handler);
+        ArtNetRawServer::GetInstance().RegisterDiscoveryMessageHandler(discovery_message_handler);
+        ArtNetRawServer::GetInstance().RegisterPollMessageHandler(artpoll_message_handler);
+        ArtNetRawServer::GetInstance().RegisterFecMessageHandler(fec_message_handler);
+        ArtPollResponder::GetInstance().RegisterReplySender([](const uint8_t * pData, size_t len, uint32_t ip)
+                                                            { ArtNetRawServer::GetInstance().SendTo(pData, len, ip); }, true);
+#else
         ArtNetServer::GetInstance().RegisterDMXMessageHandler(dmx_message_handler);
+        ArtNetServer::GetInstance().RegisterDMXPayloadHandler(dmx_payload_handler);
         ArtNetServer::GetInstance().RegisterArtSyncMessageHandler(artsync_message_handler);
         ArtNetServer::GetInstance().RegisterDiscoveryMessageHandler(discovery_message_handler);
+        ArtNetServer::GetInstance().RegisterPollMessageHandler(artpoll_message_handler);
+        ArtNetServer::GetInstance().RegisterFecMessageHandler(fec_message_handler);
+        ArtPollResponder::GetInstance().RegisterReplySender([](const uint8_t * pData, size_t len, uint32_t ip)
+                                                            { ArtNetServer::GetInstance().SendTo(pData, len, ip); }, false);
+#endif
+        SacnServer::GetInstance().RegisterDMXPayloadHandler(dmx_payload_handler);
+        SacnServer::GetInstance().RegisterSyncMessageHandler(artsync_message_handler);
+        DdpServer::GetInstance().RegisterPayloadHandler(ddp_payload_handler);
+        DdpServer::GetInstance().RegisterPushMessageHandler(ddp_push_handler);
+        DeltaStreamServer::GetInstance().RegisterPortFrameHandler(port_frame_handler);
         CommonServer::GetInstance().RegisterMessageHandler(common_message_handler);
 
-        Ports::GetInstance().Init();
+        // Ports::Init runs in the output task: the RMT channels it creates get their refill interrupts on the
+        // core they are created on, which has to be PROJECT_OUTPUT_CORE. Receive starts once it is done.
+        xTaskCreatePinnedToCore(Ports::FreeRTOSTask, "Ports::FreeRTOSTask", 4096, xTaskGetCurrentTaskHandle(), configMAX_PRIORITIES - 1, NULL, PROJECT_OUTPUT_CORE);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-        xTaskCreate(ArtNetServer::FreeRTOSTask, "ArtNetServer::FreeRTOSTask", 4096, NULL, configMAX_PRIORITIES - 2, NULL);
-        xTaskCreate(CommonServer::FreeRTOSTask, "CommonServer::FreeRTOSTask", 4096, NULL, configMAX_PRIORITIES - 3, NULL);
-        xTaskCreate(Ports::FreeRTOSTask, "Ports::FreeRTOSTask", 4096, NULL, configMAX_PRIORITIES - 1, NULL);
+        UdpReactor &oReactor = UdpReactor::GetInstance();
+#if PROJECT_ARTNET_RAW_UDP_RECEIVE
+        ESP_ERROR_CHECK(ArtNetRawServer::GetInstance().Start());
+#else
+        ArtNetServer::GetInstance().Attach(oReactor, PROJECT_UDP_ARTNET_PORT);
+#endif
+        SacnServer::GetInstance().Attach(oReactor, E131::UDP_PORT);
+        DdpServer::GetInstance().Attach(oReactor, DDP::UDP_PORT);
+        DeltaStreamServer::GetInstance().Attach(oReactor, PROJECT_UDP_DELTA_STREAM_PORT);
+        CommonServer::GetInstance().Attach(oReactor, PROJECT_UDP_COMMON_PORT);
+        // Receive and assembly share the core with WiFi and lwIP (see sdkconfig), output gets the other one to itself.
+        xTaskCreatePinnedToCore(UdpReactor::FreeRTOSTask, "UdpReactor::FreeRTOSTask", PROJECT_UDP_REACTOR_STACK_SIZE, NULL, configMAX_PRIORITIES - 2, NULL, PROJECT_NETWORK_CORE);
     }
 
     // static const char * pSettings = "{\"BroadcastSSID\":\"ESP_D0FC29\",\"BroadcastPassword\":\"\",\"SiteSSID\":\"Bo home-Ext\",\"SitePassword\":\"namnamnam\",\"StaticIP\":\"\",\"LedType\":\"\",\"TimeHigh\":-1,\"TimeLow\":-1,\"StartUniverse\":0,\"NoUniverses\":24,\"Identity\":\"\",\"Model\":\"\",\"ProductID\":\"\",\"ArtNetSync\":false,\"Ports\":[{\"StartUniverse\":0,\"NoUniverses\":6,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":6,\"NoUniverses\":6,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":-1,\"NoUniverses\":-1,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":-1,\"NoUniverses\":-1,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":-1,\"NoUniverses\":-1,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":-1,\"NoUniverses\":-1,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":-1,\"NoUniverses\":-1,\"LedCount\":1020,\"LedType\":\"SM16703\"},{\"StartUniverse\":-1,\"NoUniverses\":-1,\"LedCount\":1020,\"LedType\":\"SM16703\"}]}";
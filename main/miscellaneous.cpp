@@ -35,11 +35,6 @@ float HWStatus::GetSpeedValue()
     return -1.0;
 }
 
-int32_t DMX512Message::GetUniverse()
-{
-    return pData[15] << 8 | pData[14];
-}
-
 namespace Existing
 {
     using TypeLedOnline = LedTypeOnline::TypeLedOnline;
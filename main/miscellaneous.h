@@ -5,10 +5,6 @@
 #include <memory>
 #include <map>
 
-#ifndef PROJECT_DMX_MESSAGE_BUFFER_SIZE
-#define PROJECT_DMX_MESSAGE_BUFFER_SIZE 530
-#endif
-
 struct cJSON;
 
 class HWStatus
@@ -24,27 +20,6 @@ public:
     static float GetSpeedValue();
 };
 
-class DMX512Message
-{
-    char *pData;
-
-public:
-    DMX512Message()
-    {
-        pData = new char[PROJECT_DMX_MESSAGE_BUFFER_SIZE];
-    }
-    DMX512Message(char * pBuffer)
-    {
-        pData = pBuffer;
-    }
-    ~DMX512Message()
-    {
-        delete[] pData;
-    }
-    int32_t GetUniverse();
-    char * GetBuffer() { return pData; }
-};
-
 namespace Existing
 {
     class LedTypeOnline
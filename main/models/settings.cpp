@@ -1,7 +1,8 @@
 #include "settings.h"
 #include "esp_log.h"
-#include "wifi.h"
 #include "string.h"
+#include <algorithm>
+#include "lwip/inet.h"
 #include "miscellaneous.h"
 
 #define BUFFER_LENGTH 1024
@@ -10,23 +11,39 @@ static const char *TAG = "Settings-Model";
 
 #define DEFAULT_SETTING_BROADCAST_SSID "Solantech_0001"
 #define DEFAULT_SETTING_SITE_SSID "BlankSSID"
-#define DEFAULT_SETTING_TIME_HIGH 1000
-#define DEFAULT_SETTING_TIME_LOW 200
+// 0: the chipset's own bit timing, see RmtLedStrip::FindChipset.
+#define DEFAULT_SETTING_TIME_HIGH 0
+#define DEFAULT_SETTING_TIME_LOW 0
+// Stored by earlier firmware as its default whatever the chipset, turned into 0 once, see Settings().
+#define LEGACY_SETTING_TIME_HIGH 1000
+#define LEGACY_SETTING_TIME_LOW 200
 #define DEFAULT_SETTING_START_UNIVERSE 0
 #define DEFAULT_SETTING_NO_UNIVERSES 1
 #define DEFAULT_SETTING_IDENTITY "ARTNET_NODE"
 #define DEFAULT_SETTING_MODEL "ARTNET_ESP32_WIFI2.4GHZ"
 #define DEFAULT_LED_TYPE "LED1903"
 #define DEFAULT_LED_COUNT 1020
-
+#define DEFAULT_FRAME_OUTPUT_MODE "AllPorts"
+#define DEFAULT_OUTPUT_DEADLINE_MS 25
+#define DEFAULT_PARTIAL_FRAME_DEADLINE_MS 30
+#define DEFAULT_INTERPOLATION_RATE_HZ 40
+#define DEFAULT_BRIGHTNESS 255
+#define DEFAULT_GAMMA_X100 100
+#define DEFAULT_WHITE_BALANCE 0xFFFFFF
+#define DEFAULT_PIXEL_FORMAT "RGB"
+#define DEFAULT_BIT_DEPTH 8
+#define DEFAULT_CHANNELS_PER_UNIVERSE 510
+
+// 0 keeps the chipset's timing. A set high time may reach into the longest bit period of the chipset table
+// (UCS1903, 2500 ns), RmtLedStrip::Init() checks it against the period of the chipset actually used.
 bool SettingsValidator::IsValidTimeHigh(int32_t s32TimeHigh)
 {
-    return (200 <= s32TimeHigh) && (s32TimeHigh <= 1000);
+    return (s32TimeHigh == 0) || ((200 <= s32TimeHigh) && (s32TimeHigh < 2500));
 }
 
 bool SettingsValidator::IsValidTimeLow(int32_t s32TimeLow)
 {
-    return (200 <= s32TimeLow) && (s32TimeLow <= 1000);
+    return (s32TimeLow == 0) || ((200 <= s32TimeLow) && (s32TimeLow < 2500));
 }
 
 bool SettingsValidator::IsValidIdentity(const std::string& sIdentity)
@@ -49,9 +66,76 @@ bool SettingsValidator::IsValidSiteSSID(const std::string& sSsid)
     return sSsid.length() > 0;
 }
 
+bool SettingsValidator::IsValidFrameOutputMode(const std::string& sMode)
+{
+    return sMode == "PerPort" || sMode == "AllPorts" || sMode == "Interpolated";
+}
+
+bool SettingsValidator::IsValidOutputDeadline(int32_t s32DeadlineMs)
+{
+    return (1 <= s32DeadlineMs) && (s32DeadlineMs <= 1000);
+}
+
+bool SettingsValidator::IsValidPartialFrameDeadline(int32_t s32DeadlineMs)
+{
+    return (0 <= s32DeadlineMs) && (s32DeadlineMs <= 1000);
+}
+
+bool SettingsValidator::IsValidInterpolationRate(int32_t s32RateHz)
+{
+    return (1 <= s32RateHz) && (s32RateHz <= 100);
+}
+
+bool SettingsValidator::IsValidBrightness(int32_t s32Brightness)
+{
+    return (0 <= s32Brightness) && (s32Brightness <= 255);
+}
+
+bool SettingsValidator::IsValidGamma(double dGamma)
+{
+    return (1.0 <= dGamma) && (dGamma <= 3.0);
+}
+
+bool SettingsValidator::IsValidPixelFormat(const std::string& sFormat)
+{
+    return PixelFormat::FindChannels(sFormat) != 0;
+}
+
+bool SettingsValidator::IsValidBitDepth(int32_t s32BitDepth)
+{
+    return s32BitDepth == 8 || s32BitDepth == 16;
+}
+
+bool SettingsValidator::IsValidChannelsPerUniverse(int32_t s32Channels)
+{
+    return s32Channels == 510 || s32Channels == 512;
+}
+
+bool SettingsValidator::IsValidAllowedSources(const std::string& sSources)
+{
+    if (sSources.empty())
+    {
+        return true;
+    }
+    int32_t s32Count = 0;
+    size_t u32Start = 0;
+    while (u32Start <= sSources.length())
+    {
+        size_t u32End = std::min(sSources.find(',', u32Start), sSources.length());
+        ip4_addr_t stAddr;
+        if (++s32Count > PROJECT_MAXIMUM_ALLOWED_SOURCES || !ip4addr_aton(sSources.substr(u32Start, u32End - u32Start).c_str(), &stAddr))
+        {
+            return false;
+        }
+        u32Start = u32End + 1;
+    }
+    return true;
+}
+
 Settings::Settings()
 {
     esp_err_t err;
+    m_u32Revision = 0;
     ESP_ERROR_CHECK(nvs_open("settings", NVS_READWRITE, &m_s32NVSHandle));
     char buffer[BUFFER_LENGTH];
     size_t len = BUFFER_LENGTH;
@@ -203,7 +287,31 @@ Settings::Settings()
     {
         ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
     }
-    
+    // On the first start after earlier firmware, its default pair becomes the chipset's timing, in NVS as well.
+    // The flag keeps the same pair set on purpose later on.
+    uint8_t u8TimeMigrated = 0;
+    err = nvs_get_u8(m_s32NVSHandle, "time_migrated", &u8TimeMigrated);
+    if (err == ESP_ERR_NVS_NOT_FOUND || (err == ESP_OK && u8TimeMigrated == 0))
+    {
+        if (m_s32TimeHigh == LEGACY_SETTING_TIME_HIGH && m_s32TimeLow == LEGACY_SETTING_TIME_LOW)
+        {
+            ESP_LOGI(TAG, "Legacy TimeHigh/TimeLow %d/%d ns, using the chipset timing", LEGACY_SETTING_TIME_HIGH, LEGACY_SETTING_TIME_LOW);
+            m_s32TimeHigh = DEFAULT_SETTING_TIME_HIGH;
+            m_s32TimeLow = DEFAULT_SETTING_TIME_LOW;
+            ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "time_high", m_s32TimeHigh));
+            ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "time_low", m_s32TimeLow));
+        }
+        ESP_ERROR_CHECK(nvs_set_u8(m_s32NVSHandle, "time_migrated", 1));
+        err = nvs_commit(m_s32NVSHandle);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+        }
+    }
+    else if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
 
     err = nvs_get_i32(m_s32NVSHandle, "start_universe", &m_s32StartUniverse);
     if (err == ESP_ERR_NVS_NOT_FOUND)
@@ -294,14 +402,145 @@ Settings::Settings()
     }
 
     len = BUFFER_LENGTH;
-    err = nvs_get_str(m_s32NVSHandle, "ports", buffer, &len);
+    err = nvs_get_str(m_s32NVSHandle, "frame_mode", buffer, &len);
+    if (err == ESP_OK)
+    {
+        m_sFrameOutputMode.assign(buffer, len - 1); // exclude null character.
+        if (!SettingsValidator::IsValidFrameOutputMode(m_sFrameOutputMode))
+        {
+            m_sFrameOutputMode = DEFAULT_FRAME_OUTPUT_MODE;
+        }
+    }
+    else if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        m_sFrameOutputMode = DEFAULT_FRAME_OUTPUT_MODE;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    err = nvs_get_i32(m_s32NVSHandle, "out_deadline", &m_s32OutputDeadlineMs);
+    if (err == ESP_ERR_NVS_NOT_FOUND || !SettingsValidator::IsValidOutputDeadline(m_s32OutputDeadlineMs))
+    {
+        m_s32OutputDeadlineMs = DEFAULT_OUTPUT_DEADLINE_MS;
+    }
+    else if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    err = nvs_get_i32(m_s32NVSHandle, "partial_dl", &m_s32PartialFrameDeadlineMs);
+    if (err == ESP_ERR_NVS_NOT_FOUND || !SettingsValidator::IsValidPartialFrameDeadline(m_s32PartialFrameDeadlineMs))
+    {
+        m_s32PartialFrameDeadlineMs = DEFAULT_PARTIAL_FRAME_DEADLINE_MS;
+    }
+    else if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    err = nvs_get_i32(m_s32NVSHandle, "interp_rate", &m_s32InterpolationRateHz);
+    if (err == ESP_ERR_NVS_NOT_FOUND || !SettingsValidator::IsValidInterpolationRate(m_s32InterpolationRateHz))
+    {
+        m_s32InterpolationRateHz = DEFAULT_INTERPOLATION_RATE_HZ;
+    }
+    else if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    err = nvs_get_i32(m_s32NVSHandle, "brightness", &m_s32Brightness);
+    if (err == ESP_ERR_NVS_NOT_FOUND || !SettingsValidator::IsValidBrightness(m_s32Brightness))
+    {
+        m_s32Brightness = DEFAULT_BRIGHTNESS;
+    }
+    else if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    err = nvs_get_i32(m_s32NVSHandle, "gamma", &m_s32GammaX100);
+    if (err == ESP_ERR_NVS_NOT_FOUND || !SettingsValidator::IsValidGamma(m_s32GammaX100 / 100.0))
+    {
+        m_s32GammaX100 = DEFAULT_GAMMA_X100;
+    }
+    else if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    int32_t s32WhiteBalance = DEFAULT_WHITE_BALANCE; // 0x00RRGGBB
+    err = nvs_get_i32(m_s32NVSHandle, "white_bal", &s32WhiteBalance);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+        s32WhiteBalance = DEFAULT_WHITE_BALANCE;
+    }
+    m_aWhiteBalance = {(uint8_t)(s32WhiteBalance >> 16), (uint8_t)(s32WhiteBalance >> 8), (uint8_t)s32WhiteBalance};
+
+    err = nvs_get_u8(m_s32NVSHandle, "fec", &bEnabled);
+    if (err == ESP_OK)
+    {
+        m_bFecEnabled = (bool)bEnabled;
+    }
+    else if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        m_bFecEnabled = false;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    err = nvs_get_u8(m_s32NVSHandle, "pacing", &bEnabled);
+    if (err == ESP_OK)
+    {
+        m_bFramePacingEnabled = (bool)bEnabled;
+    }
+    else if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        m_bFramePacingEnabled = false;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    len = BUFFER_LENGTH;
+    err = nvs_get_str(m_s32NVSHandle, "allowed_src", buffer, &len);
+    if (err == ESP_OK)
+    {
+        m_sAllowedSources.assign(buffer, len - 1); // exclude null character.
+        if (!SettingsValidator::IsValidAllowedSources(m_sAllowedSources))
+        {
+            m_sAllowedSources = "";
+        }
+    }
+    else if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        m_sAllowedSources = "";
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Access NVS Error %s", esp_err_to_name(err));
+    }
+
+    // Eight ports with their pixel formats outgrow the stack buffer.
+    len = 0;
+    err = nvs_get_str(m_s32NVSHandle, "ports", NULL, &len);
+    std::string sPorts(len, '\0');
+    if (err == ESP_OK)
+    {
+        err = nvs_get_str(m_s32NVSHandle, "ports", &sPorts[0], &len);
+    }
     if (err == ESP_ERR_NVS_NOT_FOUND)
     {
         m_aPorts.fill(PortSettings());
     }
     else if (err == ESP_OK)
     {
-        cJSON * json = cJSON_Parse(buffer);
+        cJSON * json = cJSON_Parse(sPorts.c_str());
         if (!cJSON_IsArray(json) || cJSON_GetArraySize(json) != PROJECT_NUMBER_OF_PORTS)
         {
             m_aPorts.fill(PortSettings());
@@ -356,6 +595,7 @@ Settings::Settings()
                         m_aPorts[i].m_sLedType = DEFAULT_LED_TYPE;
                     }
                 }
+                PixelFormatFromJson(pPort, m_aPorts[i]);
             }
         }
         cJSON_Delete(json);
@@ -462,6 +702,77 @@ void Settings::FromJson(const cJSON *json)
         SetArtNetSyncEnabled(cJSON_IsTrue(pItem));
     }
 
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "FrameOutputMode");
+    if (cJSON_IsString(pItem) && SettingsValidator::IsValidFrameOutputMode(pItem->valuestring))
+    {
+        SetFrameOutputMode(pItem->valuestring);
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "OutputDeadlineMs");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidOutputDeadline(pItem->valueint))
+    {
+        SetOutputDeadlineMs(pItem->valueint);
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "PartialFrameDeadlineMs");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidPartialFrameDeadline(pItem->valueint))
+    {
+        SetPartialFrameDeadlineMs(pItem->valueint);
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "InterpolationRateHz");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidInterpolationRate(pItem->valueint))
+    {
+        SetInterpolationRateHz(pItem->valueint);
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "Brightness");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidBrightness(pItem->valueint))
+    {
+        SetBrightness(pItem->valueint);
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "Gamma");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidGamma(pItem->valuedouble))
+    {
+        SetGamma(pItem->valuedouble);
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "WhiteBalance");
+    if (cJSON_IsArray(pItem) && cJSON_GetArraySize(pItem) == 3)
+    {
+        std::array<uint8_t, 3> aWhiteBalance;
+        bool bValid = true;
+        for (int32_t i = 0; i < 3; ++i)
+        {
+            cJSON *pChannel = cJSON_GetArrayItem(pItem, i);
+            bValid &= cJSON_IsNumber(pChannel) && SettingsValidator::IsValidBrightness(pChannel->valueint);
+            aWhiteBalance[i] = bValid ? pChannel->valueint : 0;
+        }
+        if (bValid)
+        {
+            SetWhiteBalance(aWhiteBalance);
+        }
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "FecEnabled");
+    if (cJSON_IsBool(pItem))
+    {
+        SetFecEnabled(cJSON_IsTrue(pItem));
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "FramePacing");
+    if (cJSON_IsBool(pItem))
+    {
+        SetFramePacingEnabled(cJSON_IsTrue(pItem));
+    }
+
+    pItem = cJSON_GetObjectItemCaseSensitive(json, "AllowedSources");
+    if (cJSON_IsString(pItem) && SettingsValidator::IsValidAllowedSources(pItem->valuestring))
+    {
+        SetAllowedSources(pItem->valuestring);
+    }
+
     pItem = cJSON_GetObjectItemCaseSensitive(json, "Ports");
     if (cJSON_IsArray(pItem))
     {
@@ -497,6 +808,7 @@ void Settings::FromJson(const cJSON *json)
                     m_aPorts[i].m_sLedType = cJSON_GetStringValue(pPortItem);
                 }
             }
+            PixelFormatFromJson(pPort, m_aPorts[i]);
         }
 
         SavePorts();
@@ -539,6 +851,7 @@ void Settings::FromJson(const cJSON *json)
                         m_aPorts[s32PortNumber].m_sLedType = cJSON_GetStringValue(pPortItem);
                     }
                 }
+                PixelFormatFromJson(pItem, m_aPorts[s32PortNumber]);
 
                 SavePorts();
             }
@@ -566,6 +879,21 @@ cJSON *Settings::ToJson()
     cJSON_AddStringToObject(pJson, "Model", m_sModel.c_str());
     cJSON_AddStringToObject(pJson, "ProductID", m_sProductID.c_str());
     cJSON_AddBoolToObject(pJson, "ArtNetSync", m_bArtNetSyncEnabled);
+    cJSON_AddStringToObject(pJson, "FrameOutputMode", m_sFrameOutputMode.c_str());
+    cJSON_AddNumberToObject(pJson, "OutputDeadlineMs", m_s32OutputDeadlineMs);
+    cJSON_AddNumberToObject(pJson, "PartialFrameDeadlineMs", m_s32PartialFrameDeadlineMs);
+    cJSON_AddNumberToObject(pJson, "InterpolationRateHz", m_s32InterpolationRateHz);
+    cJSON_AddNumberToObject(pJson, "Brightness", m_s32Brightness);
+    cJSON_AddNumberToObject(pJson, "Gamma", GetGamma());
+    cJSON * pWhiteBalance = cJSON_CreateArray();
+    for (uint8_t u8Scale : m_aWhiteBalance)
+    {
+        cJSON_AddItemToArray(pWhiteBalance, cJSON_CreateNumber(u8Scale));
+    }
+    cJSON_AddItemToObject(pJson, "WhiteBalance", pWhiteBalance);
+    cJSON_AddBoolToObject(pJson, "FecEnabled", m_bFecEnabled);
+    cJSON_AddBoolToObject(pJson, "FramePacing", m_bFramePacingEnabled);
+    cJSON_AddStringToObject(pJson, "AllowedSources", m_sAllowedSources.c_str());
 
     cJSON * pPorts = cJSON_CreateArray();
     for (int32_t i=0; i<PROJECT_NUMBER_OF_PORTS; ++i)
@@ -575,6 +903,7 @@ cJSON *Settings::ToJson()
         cJSON_AddNumberToObject(pPort, "NoUniverses", m_aPorts[i].m_s32NoUniverses);
         cJSON_AddNumberToObject(pPort, "LedCount", m_aPorts[i].m_s32LedCount);
         cJSON_AddStringToObject(pPort, "LedType", m_aPorts[i].m_sLedType.c_str());
+        PixelFormatToJson(m_aPorts[i], pPort);
         cJSON_AddItemToArray(pPorts, pPort);
     }
     cJSON_AddItemToObject(pJson, "Ports", pPorts);
@@ -598,6 +927,7 @@ esp_err_t Settings::SetBroadcastSSID(const std::string &sSsid)
     if (err == ESP_OK)
     {
         m_sBroadcastSSID = sSsid;
+        m_u32Revision++;
     }
     return err;
 }
@@ -609,6 +939,7 @@ esp_err_t Settings::SetBroadcastPassword(const std::string &sPassword)
     if (err == ESP_OK)
     {
         m_sBroadcastPassword = sPassword;
+        m_u32Revision++;
     }
     return err;
 }
@@ -620,6 +951,7 @@ esp_err_t Settings::SetSiteSSID(const std::string &sSsid)
     if (err == ESP_OK)
     {
         m_sSiteSSID = sSsid;
+        m_u32Revision++;
     }
     return err;
 }
@@ -631,6 +963,7 @@ esp_err_t Settings::SetSitePassword(const std::string &sPassword)
     if (err == ESP_OK)
     {
         m_sSitePassword = sPassword;
+        m_u32Revision++;
     }
     return err;
 }
@@ -642,6 +975,7 @@ esp_err_t Settings::SetStaticIP(const std::string &sIP)
     if (err == ESP_OK)
     {
         m_sStaticIP = sIP;
+        m_u32Revision++;
     }
     return err;
 }
@@ -653,6 +987,7 @@ esp_err_t Settings::SetNetmask(const std::string &sNetmask)
     if (err == ESP_OK)
     {
         m_sNetmask = sNetmask;
+        m_u32Revision++;
     }
     return err;
 }
@@ -664,6 +999,7 @@ esp_err_t Settings::SetGatewayAddress(const std::string &sGatewayAddress)
     if (err == ESP_OK)
     {
         m_sGatewayAddress = sGatewayAddress;
+        m_u32Revision++;
     }
     return err;
 }
@@ -675,6 +1011,7 @@ esp_err_t Settings::SetLedType(const std::string &sType)
     if (err == ESP_OK)
     {
         m_sLedType = sType;
+        m_u32Revision++;
     }
     return err;
 }
@@ -686,6 +1023,7 @@ esp_err_t Settings::SetTimeHigh(int32_t s32Time)
     if (err == ESP_OK)
     {
         m_s32TimeHigh = s32Time;
+        m_u32Revision++;
     }
     return err;
 }
@@ -697,6 +1035,7 @@ esp_err_t Settings::SetTimeLow(int32_t s32Time)
     if (err == ESP_OK)
     {
         m_s32TimeLow = s32Time;
+        m_u32Revision++;
     }
     return err;
 }
@@ -708,6 +1047,7 @@ esp_err_t Settings::SetStartUniverse(int32_t s32Univ)
     if (err == ESP_OK)
     {
         m_s32StartUniverse = s32Univ;
+        m_u32Revision++;
     }
     return err;
 }
@@ -719,6 +1059,7 @@ esp_err_t Settings::SetNoUniverses(int32_t s32Count)
     if (err == ESP_OK)
     {
         m_s32NoUniverses = s32Count;
+        m_u32Revision++;
     }
     return err;
 }
@@ -730,6 +1071,7 @@ esp_err_t Settings::SetIdentity(const std::string &sIdentity)
     if (err == ESP_OK)
     {
         m_sIdentity = sIdentity;
+        m_u32Revision++;
     }
     return err;
 }
@@ -741,6 +1083,7 @@ esp_err_t Settings::SetModel(const std::string &sModel)
     if (err == ESP_OK)
     {
         m_sModel = sModel;
+        m_u32Revision++;
     }
     return err;
 }
@@ -752,6 +1095,7 @@ esp_err_t Settings::SetProductID(const std::string &sProductID)
     if (err == ESP_OK)
     {
         m_sProductID = sProductID;
+        m_u32Revision++;
     }
     return err;
 }
@@ -763,6 +1107,129 @@ esp_err_t Settings::SetArtNetSyncEnabled(bool bEnabled)
     if (err == ESP_OK)
     {
         m_bArtNetSyncEnabled = bEnabled;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetFrameOutputMode(const std::string &sMode)
+{
+    ESP_ERROR_CHECK(nvs_set_str(m_s32NVSHandle, "frame_mode", sMode.c_str()));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_sFrameOutputMode = sMode;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetOutputDeadlineMs(int32_t s32DeadlineMs)
+{
+    ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "out_deadline", s32DeadlineMs));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_s32OutputDeadlineMs = s32DeadlineMs;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetPartialFrameDeadlineMs(int32_t s32DeadlineMs)
+{
+    ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "partial_dl", s32DeadlineMs));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_s32PartialFrameDeadlineMs = s32DeadlineMs;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetInterpolationRateHz(int32_t s32RateHz)
+{
+    ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "interp_rate", s32RateHz));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_s32InterpolationRateHz = s32RateHz;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetBrightness(int32_t s32Brightness)
+{
+    ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "brightness", s32Brightness));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_s32Brightness = s32Brightness;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetGamma(double dGamma)
+{
+    int32_t s32GammaX100 = (int32_t)(dGamma * 100 + 0.5);
+    ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "gamma", s32GammaX100));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_s32GammaX100 = s32GammaX100;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetWhiteBalance(const std::array<uint8_t, 3> &aWhiteBalance)
+{
+    int32_t s32WhiteBalance = (aWhiteBalance[0] << 16) | (aWhiteBalance[1] << 8) | aWhiteBalance[2];
+    ESP_ERROR_CHECK(nvs_set_i32(m_s32NVSHandle, "white_bal", s32WhiteBalance));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_aWhiteBalance = aWhiteBalance;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetFecEnabled(bool bEnabled)
+{
+    ESP_ERROR_CHECK(nvs_set_u8(m_s32NVSHandle, "fec", (uint8_t)bEnabled));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_bFecEnabled = bEnabled;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetFramePacingEnabled(bool bEnabled)
+{
+    ESP_ERROR_CHECK(nvs_set_u8(m_s32NVSHandle, "pacing", (uint8_t)bEnabled));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_bFramePacingEnabled = bEnabled;
+        m_u32Revision++;
+    }
+    return err;
+}
+
+esp_err_t Settings::SetAllowedSources(const std::string &sSources)
+{
+    ESP_ERROR_CHECK(nvs_set_str(m_s32NVSHandle, "allowed_src", sSources.c_str()));
+    esp_err_t err = nvs_commit(m_s32NVSHandle);
+    if (err == ESP_OK)
+    {
+        m_sAllowedSources = sSources;
+        m_u32Revision++;
     }
     return err;
 }
@@ -778,21 +1245,70 @@ esp_err_t Settings::SavePorts()
         cJSON_AddNumberToObject(pPort, "NoUniverses", m_aPorts[i].m_s32NoUniverses);
         cJSON_AddNumberToObject(pPort, "LedCount", m_aPorts[i].m_s32LedCount);
         cJSON_AddStringToObject(pPort, "LedType", m_aPorts[i].m_sLedType.c_str());
+        PixelFormatToJson(m_aPorts[i], pPort);
         cJSON_AddItemToArray(json, pPort);
     }
 
     char * pData = cJSON_PrintUnformatted(json);
     ESP_ERROR_CHECK(nvs_set_str(m_s32NVSHandle, "ports", pData));
     esp_err_t err = nvs_commit(m_s32NVSHandle);
+    m_u32Revision++;
     cJSON_Delete(json);
     free(pData);
     return err;
 }
 
+void Settings::PixelFormatFromJson(const cJSON *pPort, PortSettings &stPort)
+{
+    cJSON *pItem = cJSON_GetObjectItemCaseSensitive(pPort, "PixelFormat");
+    if (cJSON_IsString(pItem) && SettingsValidator::IsValidPixelFormat(pItem->valuestring))
+    {
+        stPort.m_sPixelFormat = pItem->valuestring;
+    }
+    pItem = cJSON_GetObjectItemCaseSensitive(pPort, "BitDepth");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidBitDepth(pItem->valueint))
+    {
+        stPort.m_s32BitDepth = pItem->valueint;
+    }
+    pItem = cJSON_GetObjectItemCaseSensitive(pPort, "ChannelsPerUniverse");
+    if (cJSON_IsNumber(pItem) && SettingsValidator::IsValidChannelsPerUniverse(pItem->valueint))
+    {
+        stPort.m_s32ChannelsPerUniverse = pItem->valueint;
+    }
+    pItem = cJSON_GetObjectItemCaseSensitive(pPort, "SplitPixels");
+    if (cJSON_IsBool(pItem))
+    {
+        stPort.m_bSplitPixels = cJSON_IsTrue(pItem);
+    }
+}
+
+void Settings::PixelFormatToJson(const PortSettings &stPort, cJSON *pPort)
+{
+    cJSON_AddStringToObject(pPort, "PixelFormat", stPort.m_sPixelFormat.c_str());
+    cJSON_AddNumberToObject(pPort, "BitDepth", stPort.m_s32BitDepth);
+    cJSON_AddNumberToObject(pPort, "ChannelsPerUniverse", stPort.m_s32ChannelsPerUniverse);
+    cJSON_AddBoolToObject(pPort, "SplitPixels", stPort.m_bSplitPixels);
+}
+
+PixelFormat Settings::GetPixelFormat(int32_t s32PortNumber) const
+{
+    const PortSettings &stPort = m_aPorts[s32PortNumber];
+    PixelFormat stFormat;
+    stFormat.u8Channels = PixelFormat::FindChannels(stPort.m_sPixelFormat);
+    stFormat.u8BytesPerChannel = stPort.m_s32BitDepth / 8;
+    stFormat.u16UniverseBytes = stPort.m_s32ChannelsPerUniverse;
+    stFormat.bSplitPixels = stPort.m_bSplitPixels;
+    return stFormat;
+}
+
 Settings::PortSettings::PortSettings()
 {
     m_s32StartUniverse = DEFAULT_SETTING_START_UNIVERSE;
     m_s32NoUniverses = DEFAULT_SETTING_NO_UNIVERSES;
     m_s32LedCount = DEFAULT_LED_COUNT;
     m_sLedType = DEFAULT_LED_TYPE;
+    m_sPixelFormat = DEFAULT_PIXEL_FORMAT;
+    m_s32BitDepth = DEFAULT_BIT_DEPTH;
+    m_s32ChannelsPerUniverse = DEFAULT_CHANNELS_PER_UNIVERSE;
+    m_bSplitPixels = false;
 }
\ No newline at end of file
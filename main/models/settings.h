@@ -8,6 +8,7 @@
 #include "nvs.h"
 #include <list>
 #include <array>
+#include "pixel_format.h"
 
 #ifndef PROJECT_NUMBER_OF_PORTS
 #define PROJECT_NUMBER_OF_PORTS 4
@@ -17,6 +18,11 @@
 #define PROJECT_MAXIMUM_NUMBER_OF_UNIVERSES 40
 #endif
 
+// Art-Net sources the node accepts DMX from, empty allowlist: every source.
+#ifndef PROJECT_MAXIMUM_ALLOWED_SOURCES
+#define PROJECT_MAXIMUM_ALLOWED_SOURCES 4
+#endif
+
 class SettingsValidator
 {
 public:
@@ -26,6 +32,16 @@ public:
     static bool IsValidModel(const std::string &sModel);
     static bool IsValidLedType(const std::string &sLedType);
     static bool IsValidSiteSSID(const std::string &sSsid);
+    static bool IsValidFrameOutputMode(const std::string &sMode);
+    static bool IsValidOutputDeadline(int32_t s32DeadlineMs);
+    static bool IsValidPartialFrameDeadline(int32_t s32DeadlineMs);
+    static bool IsValidInterpolationRate(int32_t s32RateHz);
+    static bool IsValidBrightness(int32_t s32Brightness);
+    static bool IsValidGamma(double dGamma);
+    static bool IsValidPixelFormat(const std::string &sFormat);
+    static bool IsValidBitDepth(int32_t s32BitDepth);
+    static bool IsValidChannelsPerUniverse(int32_t s32Channels);
+    static bool IsValidAllowedSources(const std::string &sSources);
 };
 
 class Settings
@@ -36,6 +52,11 @@ class Settings
         int32_t m_s32NoUniverses;
         int32_t m_s32LedCount;
         std::string m_sLedType;
+        // How the pixels arrive in the port's universes, read when the ports start.
+        std::string m_sPixelFormat; // "RGB", "RGBW" or "Mono"
+        int32_t m_s32BitDepth; // 8 or 16
+        int32_t m_s32ChannelsPerUniverse; // 510 or 512
+        bool m_bSplitPixels; // a pixel may continue in the next universe
         PortSettings();
     } PortSettings;
 
@@ -55,11 +76,26 @@ class Settings
     std::string m_sModel;
     std::string m_sProductID;
     bool m_bArtNetSyncEnabled;
+    std::string m_sFrameOutputMode; // used while ArtNet sync is disabled
+    int32_t m_s32OutputDeadlineMs;
+    int32_t m_s32PartialFrameDeadlineMs; // 0: a port only shows complete frames
+    int32_t m_s32InterpolationRateHz; // output rate of the "Interpolated" frame output mode
+    // Pixel transform of every port, applied while the pixels are encoded for the wire.
+    int32_t m_s32Brightness; // 0..255
+    int32_t m_s32GammaX100;
+    std::array<uint8_t, 3> m_aWhiteBalance; // RGB channel scale, n / 255
+    bool m_bFecEnabled; // reconstruct a lost universe from ArtFec parity, read when the ports start
+    bool m_bFramePacingEnabled; // show frames through the playout buffer on a steady clock, read when the ports start
+    std::string m_sAllowedSources; // comma separated IPv4 addresses
     std::array<PortSettings, PROJECT_NUMBER_OF_PORTS> m_aPorts; // 0-based index
 
     nvs_handle_t m_s32NVSHandle;
+    uint32_t m_u32Revision; // bumped on every successful change, lets caches built from settings detect staleness
 
     esp_err_t SavePorts();
+    // Pixel format members of a port object, invalid or missing ones are left as they are.
+    static void PixelFormatFromJson(const cJSON *pPort, PortSettings &stPort);
+    static void PixelFormatToJson(const PortSettings &stPort, cJSON *pPort);
 
 public:
     static Settings &GetInstance()
@@ -72,6 +108,7 @@ public:
     void FromJson(const cJSON *json);
     cJSON *ToJson();
     void Log();
+    uint32_t GetRevision() const { return m_u32Revision; }
 
     const std::string &GetBroadcastSSID() const { return m_sBroadcastSSID; }
     esp_err_t SetBroadcastSSID(const std::string &sSsid);
@@ -121,10 +158,41 @@ public:
     bool GetArtNetSyncEnabled() const { return m_bArtNetSyncEnabled; }
     esp_err_t SetArtNetSyncEnabled(bool bEnabled);
 
+    const std::string &GetFrameOutputMode() const { return m_sFrameOutputMode; }
+    esp_err_t SetFrameOutputMode(const std::string &sMode);
+
+    int32_t GetOutputDeadlineMs() const { return m_s32OutputDeadlineMs; }
+    esp_err_t SetOutputDeadlineMs(int32_t s32DeadlineMs);
+
+    int32_t GetPartialFrameDeadlineMs() const { return m_s32PartialFrameDeadlineMs; }
+    esp_err_t SetPartialFrameDeadlineMs(int32_t s32DeadlineMs);
+
+    int32_t GetInterpolationRateHz() const { return m_s32InterpolationRateHz; }
+    esp_err_t SetInterpolationRateHz(int32_t s32RateHz);
+
+    int32_t GetBrightness() const { return m_s32Brightness; }
+    esp_err_t SetBrightness(int32_t s32Brightness);
+
+    float GetGamma() const { return m_s32GammaX100 / 100.0f; }
+    esp_err_t SetGamma(double dGamma);
+
+    const std::array<uint8_t, 3> &GetWhiteBalance() const { return m_aWhiteBalance; }
+    esp_err_t SetWhiteBalance(const std::array<uint8_t, 3> &aWhiteBalance);
+
+    bool GetFecEnabled() const { return m_bFecEnabled; }
+    esp_err_t SetFecEnabled(bool bEnabled);
+
+    bool GetFramePacingEnabled() const { return m_bFramePacingEnabled; }
+    esp_err_t SetFramePacingEnabled(bool bEnabled);
+
+    const std::string &GetAllowedSources() const { return m_sAllowedSources; }
+    esp_err_t SetAllowedSources(const std::string &sSources);
+
     int32_t GetStartUniverse(int32_t s32PortNumber) const { return m_aPorts[s32PortNumber].m_s32StartUniverse; }
     int32_t GetNoUniverses(int32_t s32PortNumber) const { return m_aPorts[s32PortNumber].m_s32NoUniverses; }
     int32_t GetLedCount(int32_t s32PortNumber) const { return m_aPorts[s32PortNumber].m_s32LedCount; }
     std::string GetLedType(int32_t s32PortNumber) const { return m_aPorts[s32PortNumber].m_sLedType; }
+    PixelFormat GetPixelFormat(int32_t s32PortNumber) const;
 };
 
 #endif /* __ARTNET_NODE_SETTINGS_MODEL_H__ */
\ No newline at end of file
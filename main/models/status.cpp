@@ -1,6 +1,12 @@
 #include "status.h"
+#include <algorithm>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
 #include "settings.h"
+#include "port.h"
+#include "udp_server.h"
+#include "artnet_poll.h"
 
 #ifndef PROJECT_WINDOW_MESSAGE_COUNT
 #define PROJECT_WINDOW_MESSAGE_COUNT 1000
@@ -12,43 +18,81 @@ Status::Status()
 {
     m_s64DMXCount = 0;
     m_f32ReceptionRate = 0;
-    m_s32LastUniv = -1;
-    m_s32WindowLostCount = 0;
+    m_u32WindowStartLost = 0;
     m_s32WindowCount = 0;
+    m_aIdleRunTime.fill(0);
+    m_u32LastSampleTime = 0;
 }
 
-void Status::UpdateForNewDMXMessage(int32_t s32Univ)
+void Status::UpdateForNewDMXMessage()
 {
     m_s64DMXCount++;
 
-    s32Univ -= Settings::GetInstance().GetStartUniverse(); // offset to 0.
-    if (m_s32LastUniv != -1)
+    // Losses come from the per-universe ArtDmx sequence numbers tracked by Ports. Exactly one caller sees the
+    // count reach the window size and closes the window, messages counted meanwhile go to the next one.
+    if (++m_s32WindowCount == PROJECT_WINDOW_MESSAGE_COUNT)
     {
-        if (m_s32LastUniv < s32Univ)
-        {
-            m_s32WindowLostCount += (s32Univ - m_s32LastUniv - 1);
-        }
-        else
-        {
-            m_s32WindowLostCount += (Settings::GetInstance().GetNoUniverses() - 1 + s32Univ - m_s32LastUniv);
-        }
-    }
-    m_s32LastUniv = s32Univ;
-
-    m_s32WindowCount++;
-    if (m_s32WindowCount >= PROJECT_WINDOW_MESSAGE_COUNT)
-    {
-        m_f32ReceptionRate = (float)m_s32WindowCount / (m_s32WindowCount + m_s32WindowLostCount);
-        m_s32WindowCount = 0;
-        m_s32WindowLostCount = 0;
+        uint32_t u32Lost = Ports::GetInstance().GetLostCount();
+        // Late packets take back losses, possibly ones counted in the previous window.
+        int32_t s32WindowLost = std::max<int32_t>((int32_t)(u32Lost - m_u32WindowStartLost), 0);
+        m_f32ReceptionRate = (float)PROJECT_WINDOW_MESSAGE_COUNT / (PROJECT_WINDOW_MESSAGE_COUNT + s32WindowLost);
+        m_u32WindowStartLost = u32Lost;
+        m_s32WindowCount -= PROJECT_WINDOW_MESSAGE_COUNT;
     }
 }
 
 cJSON * Status::ToJson()
 {
     cJSON * json = cJSON_CreateObject();
-    cJSON_AddNumberToObject(json, "DMXCount", m_s64DMXCount);
-    cJSON_AddNumberToObject(json, "ReceptionRate", m_f32ReceptionRate);
+    cJSON_AddNumberToObject(json, "DMXCount", m_s64DMXCount.load());
+    cJSON_AddNumberToObject(json, "ReceptionRate", m_f32ReceptionRate.load());
+#if PROJECT_ARTNET_RAW_UDP_RECEIVE
+    cJSON_AddItemToObject(json, "ArtNetParse", ArtNetRawServer::GetInstance().GetParseStats().ToJson());
+    cJSON_AddItemToObject(json, "ArtNetFilter", ArtNetRawServer::GetInstance().GetFilter().ToJson());
+    cJSON_AddNumberToObject(json, "ArtDmxBroadcast", ArtNetRawServer::GetInstance().GetBroadcastDmxCount());
+    cJSON_AddNumberToObject(json, "ArtDmxUnicast", ArtNetRawServer::GetInstance().GetUnicastDmxCount());
+    cJSON_AddNumberToObject(json, "ArtDmxBatch", ArtNetRawServer::GetInstance().GetBatchCount());
+    cJSON_AddNumberToObject(json, "ArtDmxBatchUniverses", ArtNetRawServer::GetInstance().GetBatchUniverseCount());
+    cJSON_AddNumberToObject(json, "ArtDmxBatchMalformed", ArtNetRawServer::GetInstance().GetBatchMalformedCount());
+#else
+    cJSON_AddItemToObject(json, "ArtNetParse", ArtNetServer::GetInstance().GetParseStats().ToJson());
+    cJSON_AddItemToObject(json, "ArtNetFilter", ArtNetServer::GetInstance().GetFilter().ToJson());
+    cJSON_AddNumberToObject(json, "ArtDmxBroadcast", ArtNetServer::GetInstance().GetBroadcastDmxCount());
+    cJSON_AddNumberToObject(json, "ArtDmxUnicast", ArtNetServer::GetInstance().GetUnicastDmxCount());
+    cJSON_AddNumberToObject(json, "ArtDmxBatch", ArtNetServer::GetInstance().GetBatchCount());
+    cJSON_AddNumberToObject(json, "ArtDmxBatchUniverses", ArtNetServer::GetInstance().GetBatchUniverseCount());
+    cJSON_AddNumberToObject(json, "ArtDmxBatchMalformed", ArtNetServer::GetInstance().GetBatchMalformedCount());
+#endif
+    // Datagrams per wake up: how much select() batching saves over one blocking receive per datagram.
+    cJSON_AddNumberToObject(json, "UdpWakes", UdpReactor::GetInstance().GetWakeCount());
+    cJSON_AddNumberToObject(json, "UdpDatagrams", UdpReactor::GetInstance().GetDatagramCount());
+    cJSON_AddNumberToObject(json, "UdpSelectErrors", UdpReactor::GetInstance().GetSelectErrorCount());
+    cJSON_AddItemToObject(json, "ArtPoll", ArtPollResponder::GetInstance().ToJson());
+    cJSON_AddItemToObject(json, "sACN", SacnServer::GetInstance().ToJson());
+    cJSON_AddItemToObject(json, "DDP", DdpServer::GetInstance().ToJson());
+    cJSON_AddItemToObject(json, "DeltaStream", DeltaStreamServer::GetInstance().ToJson());
+    cJSON_AddItemToObject(json, "Output", Ports::GetInstance().ToJson());
+    cJSON_AddItemToObject(json, "CoreLoad", CoreLoadToJson());
+    return json;
+}
+
+cJSON * Status::CoreLoadToJson()
+{
+    // Percent of the time since the previous call each core spent outside its idle task.
+    // The run time counter is 32-bit microseconds, differences stay valid across the wrap.
+    uint32_t u32Now = (uint32_t)esp_timer_get_time();
+    uint32_t u32Elapsed = u32Now - m_u32LastSampleTime;
+    m_u32LastSampleTime = u32Now;
+
+    cJSON * json = cJSON_CreateArray();
+    for (int32_t i = 0; i < portNUM_PROCESSORS; ++i)
+    {
+        uint32_t u32Idle = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(i));
+        uint32_t u32IdleElapsed = u32Idle - m_aIdleRunTime[i];
+        m_aIdleRunTime[i] = u32Idle;
+        float f32Load = u32Elapsed ? 100.0f * (1.0f - (float)std::min(u32IdleElapsed, u32Elapsed) / u32Elapsed) : 0;
+        cJSON_AddItemToArray(json, cJSON_CreateNumber(f32Load));
+    }
     return json;
 }
 
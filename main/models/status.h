@@ -3,17 +3,25 @@
 
 #include <stdio.h>
 #include <string>
+#include <array>
+#include <atomic>
 #include <esp_err.h>
 #include "cJSON.h"
+#include "freertos/FreeRTOS.h"
 
 class Status
 {
-    int64_t m_s64DMXCount;
-    float m_f32ReceptionRate;
+    // Updated from every receive task (reactor, tcpip thread with the raw pcb), read by the web server.
+    std::atomic<int64_t> m_s64DMXCount;
+    std::atomic<float> m_f32ReceptionRate;
 
-    int32_t m_s32LastUniv;
-    int32_t m_s32WindowLostCount;
-    int32_t m_s32WindowCount;
+    uint32_t m_u32WindowStartLost; // Ports lost count when the window started, only the task closing a window touches it
+    std::atomic<int32_t> m_s32WindowCount;
+
+    // Idle task run time per core at the previous ToJson(), in run time stats (esp_timer) ticks.
+    std::array<uint32_t, portNUM_PROCESSORS> m_aIdleRunTime;
+    uint32_t m_u32LastSampleTime;
+    cJSON * CoreLoadToJson();
 public:
     static Status& GetInstance()
     {
@@ -21,7 +29,7 @@ public:
         return oIns;
     }
     Status();
-    void UpdateForNewDMXMessage(int32_t s32Univ);
+    void UpdateForNewDMXMessage();
     cJSON * ToJson();
     void Log();
 };
@@ -0,0 +1,152 @@
+#include "pixel_format.h"
+#include <algorithm>
+#include <string.h>
+
+uint8_t PixelFormat::FindChannels(const std::string &sName)
+{
+    if (sName == "RGB")
+    {
+        return 3;
+    }
+    if (sName == "RGBW")
+    {
+        return 4;
+    }
+    return sName == "Mono" ? 1 : 0;
+}
+
+// N input channels per pixel, 16-bit ones reduced to 8 bits by error diffusion along the strip: the
+// rounding error of a channel is carried into the same channel of the next pixel. The error starts at
+// 0 on every call, so the result does not depend on the order universes arrive in.
+template <size_t N, bool bWide, bool bKeepWhite>
+static void ConvertPixels(uint8_t *pOut, const uint8_t *pIn, size_t u32Pixels)
+{
+    int32_t aError[N] = {};
+    for (size_t i = 0; i < u32Pixels; ++i, pIn += bWide ? 2 * N : N)
+    {
+        int32_t aValue[N];
+        for (size_t c = 0; c < N; ++c)
+        {
+            if constexpr (bWide)
+            {
+                // 8-bit n stands for n * 257 in 16 bits, (v * 255 + 32768) >> 16 rounds v / 257.
+                int32_t s32Level = ((pIn[2 * c] << 8) | pIn[2 * c + 1]) + aError[c];
+                aValue[c] = std::min<int32_t>(std::max<int32_t>((s32Level * 255 + 32768) >> 16, 0), 255);
+                aError[c] = s32Level - aValue[c] * 257;
+            }
+            else
+            {
+                aValue[c] = pIn[c];
+            }
+        }
+        if constexpr (N == 1)
+        {
+            pOut[0] = pOut[1] = pOut[2] = aValue[0];
+            pOut += 3;
+        }
+        else if constexpr (N == 4 && !bKeepWhite)
+        {
+            // No white channel on the strip, white is mixed into R, G and B.
+            for (size_t c = 0; c < 3; ++c)
+            {
+                pOut[c] = std::min<int32_t>(aValue[c] + aValue[3], 255);
+            }
+            pOut += 3;
+        }
+        else
+        {
+            for (size_t c = 0; c < N; ++c)
+            {
+                pOut[c] = aValue[c];
+            }
+            pOut += N;
+        }
+    }
+}
+
+static PixelConverter FindConverter(uint8_t u8Channels, bool bWide, bool bWhite)
+{
+    switch (u8Channels)
+    {
+    case 1:
+        return bWide ? ConvertPixels<1, true, false> : ConvertPixels<1, false, false>;
+    case 4:
+        if (bWhite)
+        {
+            return bWide ? ConvertPixels<4, true, true> : ConvertPixels<4, false, true>;
+        }
+        return bWide ? ConvertPixels<4, true, false> : ConvertPixels<4, false, false>;
+    default:
+        return bWide ? ConvertPixels<3, true, false> : ConvertPixels<3, false, false>;
+    }
+}
+
+CopyPlan::CopyPlan()
+{
+    m_stFormat = {3, 1, 510, false};
+    m_fnConvert = nullptr;
+    m_u8OutputChannels = 3;
+}
+
+void CopyPlan::Build(const PixelFormat &stFormat, size_t u32Universes, size_t u32LedCount, bool bWhite)
+{
+    m_stFormat = stFormat;
+    const size_t u32UniverseBytes = stFormat.u16UniverseBytes;
+    const size_t u32BytesPerPixel = stFormat.GetBytesPerPixel();
+    const bool bWide = stFormat.u8BytesPerChannel == 2;
+    // Splitting only changes something when the pixels do not fill the universe exactly.
+    const bool bSplit = stFormat.bSplitPixels && u32UniverseBytes % u32BytesPerPixel != 0;
+    m_fnConvert = stFormat.u8Channels == 3 && !bWide && !bSplit ? nullptr : FindConverter(stFormat.u8Channels, bWide, bWhite);
+    m_u8OutputChannels = stFormat.u8Channels == 4 && bWhite ? 4 : 3;
+
+    m_vUniverses.assign(u32Universes, UniverseCopy{});
+    for (size_t i = 0; i < u32Universes; ++i)
+    {
+        UniverseCopy &stCopy = m_vUniverses[i];
+        size_t u32First, u32End; // first pixel starting inside the universe, first one not whole inside
+        if (bSplit)
+        {
+            // The port's channels are one stream, the universe covers [u32Start, u32Start + u32UniverseBytes).
+            size_t u32Start = i * u32UniverseBytes;
+            u32First = (u32Start + u32BytesPerPixel - 1) / u32BytesPerPixel;
+            u32End = (u32Start + u32UniverseBytes) / u32BytesPerPixel;
+            stCopy.u16Offset = u32First * u32BytesPerPixel - u32Start;
+            size_t u32TailBytes = u32Start + u32UniverseBytes - u32End * u32BytesPerPixel;
+            if (u32TailBytes != 0 && u32End < u32LedCount)
+            {
+                stCopy.u32TailPixel = u32End;
+                stCopy.u16TailOffset = u32UniverseBytes - u32TailBytes;
+                stCopy.u8TailBytes = u32TailBytes;
+            }
+        }
+        else
+        {
+            u32First = i * (u32UniverseBytes / u32BytesPerPixel);
+            u32End = u32First + u32UniverseBytes / u32BytesPerPixel;
+        }
+        stCopy.u32FirstPixel = u32First;
+        stCopy.u16Pixels = u32First < u32LedCount ? std::min(u32End, u32LedCount) - u32First : 0;
+    }
+}
+
+// A word at a time: its even and odd bytes are blended as two 16-bit lanes each, and a lane's sum never
+// exceeds 255 * 256.
+void BlendFrames(uint8_t *pOut, const uint8_t *pFrom, const uint8_t *pTo, size_t u32Length, uint32_t u32Weight)
+{
+    uint32_t u32Keep = 256 - u32Weight;
+    size_t u32Words = u32Length / 4;
+    for (size_t i = 0; i < u32Words; ++i)
+    {
+        uint32_t u32From, u32To;
+        memcpy(&u32From, pFrom + i * 4, 4);
+        memcpy(&u32To, pTo + i * 4, 4);
+        uint32_t u32Even = (((u32From & 0x00FF00FF) * u32Keep + (u32To & 0x00FF00FF) * u32Weight) >> 8) & 0x00FF00FF;
+        uint32_t u32Odd = (((u32From >> 8) & 0x00FF00FF) * u32Keep + ((u32To >> 8) & 0x00FF00FF) * u32Weight) & 0xFF00FF00;
+        uint32_t u32Out = u32Even | u32Odd;
+        memcpy(pOut + i * 4, &u32Out, 4);
+    }
+    for (size_t i = u32Words * 4; i < u32Length; ++i)
+    {
+        pOut[i] = (pFrom[i] * u32Keep + pTo[i] * u32Weight) >> 8;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef __ARTNET_NODE_PIXEL_FORMAT_H__
+#define __ARTNET_NODE_PIXEL_FORMAT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Largest universe payload, all 512 DMX channels.
+#ifndef PROJECT_MAXIMUM_BYTES_PER_UNIVERSE
+#define PROJECT_MAXIMUM_BYTES_PER_UNIVERSE 512
+#endif
+
+// How a port's pixels arrive in its universes. Plain C++ without ESP-IDF so the copy plans can be
+// checked on a host.
+typedef struct PixelFormat
+{
+    static constexpr size_t MAXIMUM_BYTES_PER_PIXEL = 8; // 16-bit RGBW
+
+    uint8_t u8Channels;        // 1: one channel driving R, G and B, 3: RGB, 4: RGBW
+    uint8_t u8BytesPerChannel; // 2: 16-bit, most significant byte first
+    uint16_t u16UniverseBytes; // channels used per universe, 510 or 512
+    bool bSplitPixels;         // a pixel may continue in the next universe, else the channels left over stay unused
+
+    size_t GetBytesPerPixel() const { return u8Channels * u8BytesPerChannel; }
+    // Channels of a Settings pixel format name ("RGB", "RGBW", "Mono"), 0 if unknown.
+    static uint8_t FindChannels(const std::string &sName);
+} PixelFormat;
+
+// Pixels converted from the universe payload, ready for the strip's pixel transform: 8-bit RGB, or
+// RGBW when the input has white and the strip a white channel.
+typedef void (*PixelConverter)(uint8_t *pOut, const uint8_t *pIn, size_t u32Pixels);
+
+// Where the channels of one universe go.
+typedef struct
+{
+    uint32_t u32FirstPixel; // first pixel starting inside the universe
+    uint16_t u16Offset;     // of that pixel in the payload, bytes before it end the previous universe's tail pixel
+    uint16_t u16Pixels;     // whole pixels from u16Offset on, clipped to the port
+    uint32_t u32TailPixel;  // pixel starting inside the universe and ending in the next one
+    uint16_t u16TailOffset;
+    uint8_t u8TailBytes;    // 0: no tail pixel, or it is beyond the port
+} UniverseCopy;
+
+// A port's pixel format compiled into one UniverseCopy per universe and a converter picked for the
+// format, so the assembler only copies ranges and never decides anything per pixel.
+class CopyPlan
+{
+    PixelFormat m_stFormat;
+    PixelConverter m_fnConvert; // nullptr: the payload is 8-bit RGB in whole pixels, copied as it is
+    uint8_t m_u8OutputChannels;
+    std::vector<UniverseCopy> m_vUniverses;
+
+public:
+    CopyPlan();
+    // bWhite: the strip has a white channel, RGBW input keeps it instead of mixing it into RGB.
+    void Build(const PixelFormat &stFormat, size_t u32Universes, size_t u32LedCount, bool bWhite);
+    const PixelFormat &GetFormat() const { return m_stFormat; }
+    bool IsDirect() const { return m_fnConvert == nullptr; }
+    PixelConverter GetConverter() const { return m_fnConvert; }
+    uint8_t GetOutputChannels() const { return m_u8OutputChannels; }
+    const UniverseCopy &GetUniverse(size_t u32Index) const { return m_vUniverses[u32Index]; }
+};
+
+// Crossfade of two frames in the strip's wire format, pOut = pFrom + (pTo - pFrom) * u32Weight / 256 for
+// every byte, u32Weight 0..256.
+void BlendFrames(uint8_t *pOut, const uint8_t *pFrom, const uint8_t *pTo, size_t u32Length, uint32_t u32Weight);
+
+#endif /* __ARTNET_NODE_PIXEL_FORMAT_H__ */
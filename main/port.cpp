@@ -1,69 +1,28 @@
 #include "port.h"
 #include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <cstdlib>
 #include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "miscellaneous.h"
 
 static const char *TAG = "Port";
 
-static std::array<std::array<CRGB, PROJECT_MAXIMUM_NUMBER_OF_LEDS_PER_PORT>, PROJECT_NUMBER_OF_PORTS> g_buffers; // 0-based index
-
-static CLEDController *CLEDControllerFactory(const std::string &sChipset, int32_t s32Port, CRGB *pData, int32_t s32LedCount)
-{
-    if (sChipset == "LED1903" || sChipset == "LED16703")
-    {
-        switch (s32Port)
-        {
-        case 0:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_0_DATA_PIN, RBG>(pData, s32LedCount);
-        case 1:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_1_DATA_PIN, RBG>(pData, s32LedCount);
-        case 2:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_2_DATA_PIN, RBG>(pData, s32LedCount);
-        case 3:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_3_DATA_PIN, RBG>(pData, s32LedCount);
-        case 4:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_4_DATA_PIN, RBG>(pData, s32LedCount);
-        case 5:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_5_DATA_PIN, RBG>(pData, s32LedCount);
-        case 6:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_6_DATA_PIN, RBG>(pData, s32LedCount);
-        case 7:
-            return &FastLED.addLeds<SM16703, PROJECT_PORT_7_DATA_PIN, RBG>(pData, s32LedCount);
-        default:
-            ESP_ERROR_CHECK(ESP_ERR_INVALID_ARG);
-        }
-    }
-    else if (sChipset == "UCS1903")
-    {
-        switch (s32Port)
-        {
-        case 0:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_0_DATA_PIN>(pData, s32LedCount);
-        case 1:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_1_DATA_PIN>(pData, s32LedCount);
-        case 2:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_2_DATA_PIN>(pData, s32LedCount);
-        case 3:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_3_DATA_PIN>(pData, s32LedCount);
-        case 4:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_4_DATA_PIN>(pData, s32LedCount);
-        case 5:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_5_DATA_PIN>(pData, s32LedCount);
-        case 6:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_6_DATA_PIN>(pData, s32LedCount);
-        case 7:
-            return &FastLED.addLeds<UCS1903B, PROJECT_PORT_7_DATA_PIN>(pData, s32LedCount);
-        default:
-            ESP_ERROR_CHECK(ESP_ERR_INVALID_ARG);
-        }
-    }
-    else
-    {
-        ESP_ERROR_CHECK(ESP_ERR_NOT_SUPPORTED);
-    }
-    // Unreachable return!
-    return NULL;
+// Raw payload of a universe that has to be converted, only used with the receive mutex held.
+static std::array<uint8_t, PROJECT_MAXIMUM_BYTES_PER_UNIVERSE> g_aPayload;
+// Retry of a deadline that fired while a receive path held the mutex.
+static constexpr uint64_t g_u64DeadlineRetryUs = 1000;
+
+static const std::array<int32_t, 8> g_aDataPins = {PROJECT_PORT_0_DATA_PIN, PROJECT_PORT_1_DATA_PIN, PROJECT_PORT_2_DATA_PIN, PROJECT_PORT_3_DATA_PIN,
+                                                   PROJECT_PORT_4_DATA_PIN, PROJECT_PORT_5_DATA_PIN, PROJECT_PORT_6_DATA_PIN, PROJECT_PORT_7_DATA_PIN};
+
+static size_t CopyFromMessage(void * pDest, size_t u32Length, void * pvContext)
+{
+    memcpy(pDest, pvContext, u32Length);
+    return u32Length;
 }
 
 static bool CheckPortNumber(int32_t s32Port)
@@ -84,123 +43,1255 @@ static bool CheckLedType(const std::string& sLedType)
 Port::Port(int32_t s32PortNumber) : m_s32PortNumber(s32PortNumber)
 {
     ESP_ERROR_CHECK(Init());
-    ESP_LOGI(TAG, "Init port %ld successfully!", m_s32PortNumber);
+    ESP_LOGI(TAG, "Init port %" PRId32 " successfully!", m_s32PortNumber);
 }
 
 esp_err_t Port::Init()
 {
-    ESP_RETURN_ON_FALSE(CheckPortNumber(m_s32PortNumber), ESP_ERR_NOT_SUPPORTED, TAG, "Invalid Port Number %ld", m_s32PortNumber);
-    m_pBuffer = &g_buffers[m_s32PortNumber];
+    ESP_RETURN_ON_FALSE(CheckPortNumber(m_s32PortNumber), ESP_ERR_NOT_SUPPORTED, TAG, "Invalid Port Number %" PRId32, m_s32PortNumber);
+    m_aFrames.fill(nullptr);
+    m_u8WriteIndex = 0;
+    m_u8ReadyIndex = 1;
+    m_u8DisplayIndex = 2;
+    m_u32CommittedFrames = 0;
+    m_u32OverwrittenFrames = 0;
+    m_u32DisplayedFrames = 0;
+    m_aCommitTimeUs.fill(0);
+    m_bPaced = Settings::GetInstance().GetFramePacingEnabled();
+    m_pBlendFrom = nullptr;
+    m_pBlendOut = nullptr;
+    m_s64BlendStartUs = 0;
+    m_s64InputIntervalUs = 1000000 / 25;
+    m_bBlendDone = true;
+    m_bBlendSeeded = false;
+    m_u32BlendedFrames = 0;
+    m_pFecGroups = nullptr;
+    m_u32FecRecoveredCount = 0;
+    m_u32FecMismatchCount = 0;
+    m_hDeadlineTimer = nullptr;
+    m_s64DeadlineUs = 0;
+    m_u8PreviousIndex = m_u8DisplayIndex;
+    m_u32PartialCommitCount = 0;
+    m_u32ConcealedUniverseCount = 0;
+    m_pSeams = nullptr;
+    m_u64SeamMask = 0;
+    m_u64SeamTailMask = 0;
+    m_u64SeamHeadMask = 0;
 
     m_s32StartUniv = Settings::GetInstance().GetStartUniverse(m_s32PortNumber);
-    m_s32EndUniv = m_s32StartUniv + Settings::GetInstance().GetNoUniverses(m_s32PortNumber);
-    m_s32NextUniv = m_s32StartUniv;
+    m_s32EndUniv = m_s32StartUniv + std::max<int32_t>(Settings::GetInstance().GetNoUniverses(m_s32PortNumber), 0);
+    ESP_RETURN_ON_FALSE(GetNoUniverses() <= 64, ESP_ERR_NOT_SUPPORTED, TAG, "Port %" PRId32 ": Too many universes", m_s32PortNumber);
+    m_u64ReceivedMask = 0;
+    m_u64CompleteMask = (GetNoUniverses() == 64) ? ~0ULL : ((1ULL << GetNoUniverses()) - 1);
 
     std::string sLedType = Settings::GetInstance().GetLedType(m_s32PortNumber);
     int32_t s32LedCount = Settings::GetInstance().GetLedCount(m_s32PortNumber);
-    ESP_LOGI(TAG, "Initializing Port %ld, Led Type %s, Led Count %ld", m_s32PortNumber, sLedType.c_str(), s32LedCount);
-    ESP_RETURN_ON_FALSE(CheckLedType(sLedType), ESP_ERR_NOT_SUPPORTED, TAG, "Port %ld: Invalid Led Type %s", m_s32PortNumber, sLedType.c_str());
-    ESP_RETURN_ON_FALSE(CheckLedCount(s32LedCount), ESP_ERR_NOT_SUPPORTED, TAG, "Port %ld: Invalid Led Count %ld", m_s32PortNumber, s32LedCount);
+    ESP_LOGI(TAG, "Initializing Port %" PRId32 ", Led Type %s, Led Count %" PRId32, m_s32PortNumber, sLedType.c_str(), s32LedCount);
+    ESP_RETURN_ON_FALSE(CheckLedType(sLedType), ESP_ERR_NOT_SUPPORTED, TAG, "Port %" PRId32 ": Invalid Led Type %s", m_s32PortNumber, sLedType.c_str());
+    ESP_RETURN_ON_FALSE(CheckLedCount(s32LedCount), ESP_ERR_NOT_SUPPORTED, TAG, "Port %" PRId32 ": Invalid Led Count %" PRId32, m_s32PortNumber, s32LedCount);
+    static_assert(PROJECT_NUMBER_OF_PORTS <= 8, "One data pin and RMT channel per port");
+    ESP_RETURN_ON_ERROR(m_oStrip.Init(g_aDataPins[m_s32PortNumber], RmtLedStrip::FindChipset(sLedType), Settings::GetInstance().GetTimeHigh(), Settings::GetInstance().GetTimeLow()),
+                        TAG, "Port %" PRId32 ": Failed to init led output", m_s32PortNumber);
+
+    m_u32FrameBytes = s32LedCount * m_oStrip.GetBytesPerPixel();
+    m_s32LedCount = s32LedCount;
+    // Only the playout buffer needs frames beyond the triple buffer.
+    size_t u32Frames = m_bPaced ? m_aFrames.size() : 3;
+    for (size_t i = 0; i < u32Frames && m_u32FrameBytes != 0; ++i)
+    {
+        m_aFrames[i] = (uint8_t *)heap_caps_calloc(1, m_u32FrameBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ESP_RETURN_ON_FALSE(m_aFrames[i], ESP_ERR_NO_MEM, TAG, "Port %" PRId32 ": No memory for %zu bytes frame", m_s32PortNumber, m_u32FrameBytes);
+    }
+    for (size_t i = 0; m_bPaced && i < u32Frames; ++i)
+    {
+        if (i != m_u8WriteIndex && i != m_u8DisplayIndex)
+        {
+            m_oFreeFrames.Push(i);
+        }
+    }
+
+    PixelFormat stFormat = Settings::GetInstance().GetPixelFormat(m_s32PortNumber);
+    ESP_LOGI(TAG, "Port %" PRId32 ": %d channel pixels, %d bit, %d channels per universe%s", m_s32PortNumber, stFormat.u8Channels, stFormat.u8BytesPerChannel * 8,
+             stFormat.u16UniverseBytes, stFormat.bSplitPixels ? ", split pixels" : "");
+    m_oPlan.Build(stFormat, GetNoUniverses(), s32LedCount, m_oStrip.HasWhite());
+    for (int32_t i = 0; i < GetNoUniverses(); ++i)
+    {
+        if (m_oPlan.GetUniverse(i).u8TailBytes != 0)
+        {
+            m_u64SeamMask |= 1ULL << i;
+        }
+    }
+    if (m_u64SeamMask != 0)
+    {
+        m_pSeams = (uint8_t *)heap_caps_calloc(GetNoUniverses(), PixelFormat::MAXIMUM_BYTES_PER_PIXEL, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ESP_RETURN_ON_FALSE(m_pSeams, ESP_ERR_NO_MEM, TAG, "Port %" PRId32 ": No memory for split pixels", m_s32PortNumber);
+    }
 
-    m_oCLedController = CLEDControllerFactory(sLedType, m_s32PortNumber, m_pBuffer->data(), s32LedCount);
+    if (Settings::GetInstance().GetFecEnabled() && GetNoUniverses() > 0)
+    {
+        int32_t s32Groups = (GetNoUniverses() + PROJECT_FEC_GROUP_SIZE - 1) / PROJECT_FEC_GROUP_SIZE;
+        m_pFecGroups = (FecGroup *)heap_caps_calloc(s32Groups, sizeof(FecGroup), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ESP_RETURN_ON_FALSE(m_pFecGroups, ESP_ERR_NO_MEM, TAG, "Port %" PRId32 ": No memory for %" PRId32 " FEC groups", m_s32PortNumber, s32Groups);
+    }
+
+    if (IsActive())
+    {
+        esp_timer_create_args_t stTimerArgs = {};
+        stTimerArgs.callback = &Ports::DeadlineCallback;
+        stTimerArgs.arg = this;
+        stTimerArgs.dispatch_method = ESP_TIMER_TASK;
+        stTimerArgs.name = "port_deadline";
+        ESP_RETURN_ON_ERROR(esp_timer_create(&stTimerArgs, &m_hDeadlineTimer), TAG, "Port %" PRId32 ": Failed to create deadline timer", m_s32PortNumber);
+    }
 
     return ESP_OK;
 }
 
-bool Port::MatchUniv(int32_t s32Univ)
+void Port::Commit()
 {
-    return m_s32EndUniv != s32Univ && m_s32NextUniv == s32Univ;
+    m_aCommitTimeUs[m_u8WriteIndex] = esp_timer_get_time();
+    m_u32CommittedFrames.fetch_add(1, std::memory_order_relaxed);
+    uint8_t u8Free;
+    if (m_bPaced && !m_oFreeFrames.Pop(u8Free))
+    {
+        // Every spare frame is queued for playout, this one is dropped and its buffer reused.
+        m_u32OverwrittenFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (m_bPaced)
+    {
+        m_oPlayout.Push({m_u8WriteIndex, m_aCommitTimeUs[m_u8WriteIndex]});
+        m_u8PreviousIndex = m_u8WriteIndex;
+        m_u8WriteIndex = u8Free;
+    }
+    else
+    {
+        m_u8PreviousIndex = m_u8WriteIndex;
+        uint8_t u8Previous = m_u8ReadyIndex.exchange(m_u8WriteIndex | m_u8FreshFlag, std::memory_order_acq_rel);
+        if (u8Previous & m_u8FreshFlag)
+        {
+            m_u32OverwrittenFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_u8WriteIndex = u8Previous & ~m_u8FreshFlag;
+    }
+    ResetAssembly();
+    Ports::GetInstance().NotifyFrameComplete(m_s32PortNumber);
 }
 
-bool Port::MatchUnivLoss(int32_t s32Univ)
+bool Port::TakeReadyFrame()
 {
-    return !MatchUniv(s32Univ) && m_s32StartUniv == s32Univ;
+    if (!(m_u8ReadyIndex.load(std::memory_order_acquire) & m_u8FreshFlag))
+    {
+        return false;
+    }
+    // The display frame goes back to the assembler, it must not still be shifting out.
+    m_oStrip.WaitDone();
+    uint8_t u8Ready = m_u8ReadyIndex.exchange(m_u8DisplayIndex, std::memory_order_acq_rel);
+    m_u8DisplayIndex = u8Ready & ~m_u8FreshFlag;
+    m_u32DisplayedFrames.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
-bool Port::IsFull()
+bool Port::PeekPlayout(int64_t &s64CommitUs, uint32_t u32Offset) const
 {
-    return m_s32EndUniv == m_s32NextUniv;
+    PlayoutFrame stFrame;
+    if (!m_oPlayout.Peek(stFrame, u32Offset))
+    {
+        return false;
+    }
+    s64CommitUs = stFrame.s64CommitUs;
+    return true;
 }
 
-void Port::Commit()
+void Port::TakePlayout(bool bShow)
+{
+    PlayoutFrame stFrame;
+    if (!m_oPlayout.Pop(stFrame))
+    {
+        return;
+    }
+    if (!bShow)
+    {
+        m_oFreeFrames.Push(stFrame.u8Index);
+        m_u32OverwrittenFrames.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // The display frame goes back to the assembler, it must not still be shifting out.
+    m_oStrip.WaitDone();
+    m_oFreeFrames.Push(m_u8DisplayIndex);
+    m_u8DisplayIndex = stFrame.u8Index;
+    m_u32DisplayedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Port::TakeBlendFrame(int64_t s64NowUs)
+{
+    int64_t s64PreviousCommitUs = GetDisplayCommitTimeUs();
+    if (!TakeReadyFrame())
+    {
+        return false;
+    }
+    if (m_pBlendOut == nullptr && m_u32FrameBytes != 0)
+    {
+        m_pBlendFrom = (uint8_t *)heap_caps_calloc(1, m_u32FrameBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        m_pBlendOut = (uint8_t *)heap_caps_calloc(1, m_u32FrameBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (m_pBlendFrom == nullptr || m_pBlendOut == nullptr)
+        {
+            ESP_LOGE(TAG, "Port %" PRId32 ": No memory for interpolation, frames are shown as they come", m_s32PortNumber);
+            heap_caps_free(m_pBlendFrom);
+            heap_caps_free(m_pBlendOut);
+            m_pBlendFrom = nullptr;
+            m_pBlendOut = nullptr;
+        }
+    }
+    if (m_pBlendOut != nullptr && !m_bBlendSeeded)
+    {
+        // First frame since start or a mode switch, fading in from black or an old frame would be wrong.
+        memcpy(m_pBlendOut, m_aFrames[m_u8DisplayIndex], m_u32FrameBytes);
+        m_bBlendSeeded = true;
+    }
+    if (m_pBlendOut != nullptr)
+    {
+        // From what the strip shows right now, so a frame arriving mid fade does not jump.
+        memcpy(m_pBlendFrom, m_pBlendOut, m_u32FrameBytes);
+    }
+    int64_t s64IntervalUs = GetDisplayCommitTimeUs() - s64PreviousCommitUs;
+    if (0 < s64IntervalUs && s64IntervalUs <= PROJECT_INTERPOLATION_MAXIMUM_INTERVAL_US)
+    {
+        m_s64InputIntervalUs += (s64IntervalUs - m_s64InputIntervalUs) / 4;
+    }
+    m_s64BlendStartUs = s64NowUs;
+    m_bBlendDone = false;
+    return true;
+}
+
+bool Port::ShowBlend(int64_t s64NowUs)
+{
+    if (m_bBlendDone || m_s32LedCount == 0)
+    {
+        return false;
+    }
+    int64_t s64ElapsedUs = s64NowUs - m_s64BlendStartUs;
+    uint32_t u32Weight = s64ElapsedUs >= m_s64InputIntervalUs ? 256 : s64ElapsedUs * 256 / m_s64InputIntervalUs;
+    // Once the display frame is reached the strip keeps it, a stopped input holds the last frame.
+    m_bBlendDone = u32Weight == 256 || m_pBlendOut == nullptr;
+    const uint8_t *pData = m_aFrames[m_u8DisplayIndex];
+    if (m_pBlendOut != nullptr)
+    {
+        BlendFrames(m_pBlendOut, m_pBlendFrom, m_aFrames[m_u8DisplayIndex], m_u32FrameBytes, u32Weight);
+        pData = m_pBlendOut;
+        m_u32BlendedFrames += !m_bBlendDone;
+    }
+    if (m_oStrip.Transmit(pData, m_u32FrameBytes) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Port %" PRId32 ": Failed to start output", m_s32PortNumber);
+    }
+    return true;
+}
+
+esp_err_t Port::Show()
+{
+    if (m_s32LedCount == 0)
+    {
+        return ESP_OK;
+    }
+    return m_oStrip.Transmit(m_aFrames[m_u8DisplayIndex], m_u32FrameBytes);
+}
+
+cJSON * Port::ToJson()
+{
+    cJSON * json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "CommittedFrames", m_u32CommittedFrames.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "OverwrittenFrames", m_u32OverwrittenFrames.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "DisplayedFrames", m_u32DisplayedFrames.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "FecRecovered", m_u32FecRecoveredCount);
+    cJSON_AddNumberToObject(json, "FecMismatch", m_u32FecMismatchCount);
+    cJSON_AddNumberToObject(json, "PartialCommits", m_u32PartialCommitCount);
+    cJSON_AddNumberToObject(json, "ConcealedUniverses", m_u32ConcealedUniverseCount);
+    cJSON_AddNumberToObject(json, "BlendedFrames", m_u32BlendedFrames);
+    return json;
+}
+
+void Port::ResetAssembly()
+{
+    m_u64ReceivedMask = 0;
+    m_s64DeadlineUs = 0;
+    m_u64SeamTailMask = 0;
+    m_u64SeamHeadMask = 0;
+    if (m_pFecGroups == nullptr)
+    {
+        return;
+    }
+    int32_t s32Groups = (GetNoUniverses() + PROJECT_FEC_GROUP_SIZE - 1) / PROJECT_FEC_GROUP_SIZE;
+    for (int32_t i = 0; i < s32Groups; ++i)
+    {
+        m_pFecGroups[i].aXor.fill(0);
+        m_pFecGroups[i].u8ClippedMask = 0;
+        m_pFecGroups[i].bParity = false;
+    }
+}
+
+void Port::CopyPreviousFrame()
+{
+    // After a swap the write frame holds the one from two commits ago.
+    if (m_u8PreviousIndex != m_u8WriteIndex)
+    {
+        memcpy(m_aFrames[m_u8WriteIndex], m_aFrames[m_u8PreviousIndex], m_u32FrameBytes);
+    }
+}
+
+size_t Port::WritePixels(size_t u32Pixel, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext, uint8_t * pXor)
+{
+    if (u32Pixel >= (size_t)m_s32LedCount)
+    {
+        return 0;
+    }
+    size_t u32Pixels = std::min(u32Length / 3, m_s32LedCount - u32Pixel);
+    u32Length = u32Pixels * 3;
+    // The RGB payload lands at the tail of the range's wire bytes and is expanded forward in place,
+    // a wire pixel never outgrows the RGB pixels not yet read.
+    uint8_t *pWire = m_aFrames[m_u8WriteIndex] + u32Pixel * m_oStrip.GetBytesPerPixel();
+    uint8_t *pRgb = pWire + u32Pixels * m_oStrip.GetBytesPerPixel() - u32Length;
+    size_t u32Copied = fnCopy(pRgb, u32Length, pvContext);
+    if (pXor != nullptr)
+    {
+        for (size_t i = 0; i < u32Copied; ++i)
+        {
+            pXor[i] ^= pRgb[i];
+        }
+    }
+    // Encode while the data is still in cache, showing then only has to start the RMT.
+    m_oStrip.Encode(pWire, pRgb, u32Copied);
+    return u32Copied;
+}
+
+size_t Port::WriteUniverse(int32_t s32Index, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext)
+{
+    uint64_t u64Bit = 1ULL << s32Index;
+    FecGroup *pGroup = m_pFecGroups ? &m_pFecGroups[s32Index / PROJECT_FEC_GROUP_SIZE] : nullptr;
+    int32_t s32Member = s32Index % PROJECT_FEC_GROUP_SIZE;
+    if (pGroup && (pGroup->u8RecoveredMask & (1 << s32Member)))
+    {
+        // The universe parity already rebuilt, arriving late. Taking it would open the next frame with a
+        // universe of the one just committed.
+        pGroup->u8RecoveredMask &= ~(1 << s32Member);
+        if (u8Sequence == pGroup->au8Sequence[s32Member])
+        {
+            return 0;
+        }
+    }
+    if (m_u64ReceivedMask & u64Bit)
+    {
+        // Universe seen twice: the previous frame lost a universe. Show what it got unless partial
+        // frames are disabled, then start over with this one.
+        if (m_s64DeadlineUs != 0)
+        {
+            CommitPartial();
+        }
+        else
+        {
+            ResetAssembly();
+        }
+    }
+    bool bFirst = m_u64ReceivedMask == 0;
+
+    size_t u32Payload = std::min<size_t>(u32Length, m_oPlan.GetFormat().u16UniverseBytes);
+    size_t u32Copied;
+    if (m_oPlan.IsDirect())
+    {
+        // 8-bit RGB lands in the frame as it is. Only whole pixels are used, the parity of the rest is ignored.
+        u32Payload = u32Payload / 3 * 3;
+        u32Copied = WritePixels(m_oPlan.GetUniverse(s32Index).u32FirstPixel, u32Payload, fnCopy, pvContext, pGroup ? pGroup->aXor.data() : nullptr);
+    }
+    else
+    {
+        u32Copied = WriteConverted(s32Index, u32Payload, fnCopy, pvContext, pGroup ? pGroup->aXor.data() : nullptr);
+    }
+    m_u64ReceivedMask |= u64Bit;
+
+    if (pGroup)
+    {
+        pGroup->au8Sequence[s32Member] = u8Sequence;
+        if (u32Copied < u32Payload)
+        {
+            pGroup->u8ClippedMask |= 1 << s32Member;
+        }
+        if (pGroup->bParity && !IsFull())
+        {
+            // May complete and commit the frame.
+            TryRecover(s32Index / PROJECT_FEC_GROUP_SIZE);
+        }
+    }
+
+    if (IsFull())
+    {
+        Commit();
+    }
+    else if (bFirst)
+    {
+        ArmDeadline();
+    }
+    return u32Copied;
+}
+
+size_t Port::WriteConverted(int32_t s32Index, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext, uint8_t * pXor)
 {
-    // ESP_LOGI(TAG, "Commit on port %ld", m_s32PortNumber);
-    if (m_oBufferMutex.try_lock())
+    const UniverseCopy &stCopy = m_oPlan.GetUniverse(s32Index);
+    size_t u32Copied = fnCopy(g_aPayload.data(), u32Length, pvContext);
+    if (pXor != nullptr)
+    {
+        for (size_t i = 0; i < u32Copied; ++i)
+        {
+            pXor[i] ^= g_aPayload[i];
+        }
+    }
+    // A short universe converts the whole pixels it has, a seam only completes with all its bytes.
+    size_t u32Available = u32Copied > stCopy.u16Offset ? (u32Copied - stCopy.u16Offset) / m_oPlan.GetFormat().GetBytesPerPixel() : 0;
+    ConvertPixels(stCopy.u32FirstPixel, std::min<size_t>(stCopy.u16Pixels, u32Available), g_aPayload.data() + stCopy.u16Offset);
+    if (stCopy.u16Offset != 0 && u32Copied >= stCopy.u16Offset)
+    {
+        AddSeamPart(s32Index - 1, false, g_aPayload.data(), stCopy.u16Offset);
+    }
+    if (stCopy.u8TailBytes != 0 && u32Copied >= (size_t)stCopy.u16TailOffset + stCopy.u8TailBytes)
+    {
+        AddSeamPart(s32Index, true, g_aPayload.data() + stCopy.u16TailOffset, stCopy.u8TailBytes);
+    }
+    return u32Copied;
+}
+
+void Port::ConvertPixels(size_t u32Pixel, size_t u32Pixels, const uint8_t * pIn)
+{
+    if (u32Pixels == 0)
+    {
+        return;
+    }
+    // Converted pixels land at the tail of the range's wire bytes and are encoded forward in place,
+    // like WritePixels() does with RGB.
+    size_t u32BytesPerPixel = m_oStrip.GetBytesPerPixel();
+    size_t u32Length = u32Pixels * m_oPlan.GetOutputChannels();
+    uint8_t *pWire = m_aFrames[m_u8WriteIndex] + u32Pixel * u32BytesPerPixel;
+    uint8_t *pPixels = pWire + u32Pixels * u32BytesPerPixel - u32Length;
+    m_oPlan.GetConverter()(pPixels, pIn, u32Pixels);
+    m_oStrip.Encode(pWire, pPixels, u32Length, m_oPlan.GetOutputChannels());
+}
+
+void Port::AddSeamPart(int32_t s32Seam, bool bTail, const uint8_t * pBytes, size_t u32Length)
+{
+    uint64_t u64Bit = 1ULL << s32Seam;
+    if (!(m_u64SeamMask & u64Bit))
+    {
+        // The pixel is beyond the port.
+        return;
+    }
+    const UniverseCopy &stCopy = m_oPlan.GetUniverse(s32Seam);
+    uint8_t *pSeam = m_pSeams + s32Seam * PixelFormat::MAXIMUM_BYTES_PER_PIXEL;
+    memcpy(bTail ? pSeam : pSeam + stCopy.u8TailBytes, pBytes, u32Length);
+    (bTail ? m_u64SeamTailMask : m_u64SeamHeadMask) |= u64Bit;
+    if (m_u64SeamTailMask & m_u64SeamHeadMask & u64Bit)
+    {
+        ConvertPixels(stCopy.u32TailPixel, 1, pSeam);
+    }
+}
+
+void Port::ArmDeadline()
+{
+    int32_t s32DeadlineMs = Settings::GetInstance().GetPartialFrameDeadlineMs();
+    if (s32DeadlineMs == 0 || m_hDeadlineTimer == nullptr || m_u64ReceivedMask == 0)
+    {
+        return;
+    }
+    m_s64DeadlineUs = esp_timer_get_time() + s32DeadlineMs * 1000LL;
+    esp_timer_stop(m_hDeadlineTimer); // not running is fine
+    esp_timer_start_once(m_hDeadlineTimer, s32DeadlineMs * 1000ULL);
+}
+
+void Port::CommitPartial()
+{
+    // The previous frame is never the write frame, the output task only reads it.
+    const uint8_t *pPrevious = m_aFrames[m_u8PreviousIndex];
+    uint8_t *pFrame = m_aFrames[m_u8WriteIndex];
+    size_t u32BytesPerPixel = m_oStrip.GetBytesPerPixel();
+    uint64_t u64Missing = m_u64CompleteMask & ~m_u64ReceivedMask;
+    for (int32_t i = 0; u64Missing != 0; ++i, u64Missing >>= 1)
+    {
+        const UniverseCopy &stCopy = m_oPlan.GetUniverse(i);
+        if (!(u64Missing & 1) || stCopy.u16Pixels == 0)
+        {
+            continue;
+        }
+        size_t u32Offset = stCopy.u32FirstPixel * u32BytesPerPixel;
+        memcpy(pFrame + u32Offset, pPrevious + u32Offset, stCopy.u16Pixels * u32BytesPerPixel);
+        m_u32ConcealedUniverseCount++;
+    }
+    // Pixels split across a missing universe and a received one.
+    uint64_t u64Seams = m_u64SeamMask & ~(m_u64SeamTailMask & m_u64SeamHeadMask);
+    for (int32_t i = 0; u64Seams != 0; ++i, u64Seams >>= 1)
     {
-        void * pDestBuffer = m_pBuffer->data();
-        int32_t s32Offset = 0;
-        for(auto spMsg : m_listMessages)
+        if (u64Seams & 1)
         {
-            void * pSrcBuffer = spMsg->GetBuffer() + 18;
-            size_t s32Size = ((spMsg->GetBuffer()[16] << 8) | spMsg->GetBuffer()[17]) - 2; // 510 bytes, 170 leds
-            memcpy(pDestBuffer + s32Offset, pSrcBuffer, s32Size);
-            s32Offset += s32Size;
+            size_t u32Offset = m_oPlan.GetUniverse(i).u32TailPixel * u32BytesPerPixel;
+            memcpy(pFrame + u32Offset, pPrevious + u32Offset, u32BytesPerPixel);
         }
-        // ESP_LOGI(TAG, "Bytes of led 170 %d, %d, %d", m_pBuffer->at(169).raw[0], m_pBuffer->at(169).raw[1], m_pBuffer->at(169).raw[2]);
-        // ESP_LOGI(TAG, "Bytes of led 170 %d, %d, %d", *(m_listMessages.front()->GetBuffer() + 18 + 507), *(m_listMessages.front()->GetBuffer() + 18 + 508), *(m_listMessages.front()->GetBuffer() + 18 + 509));
-        m_oBufferMutex.unlock();
-        m_s32NextUniv = m_s32StartUniv;
-        m_listMessages.clear();
     }
+    m_u32PartialCommitCount++;
+    Commit();
+}
+
+bool Port::CommitIfExpired(int64_t s64NowUs)
+{
+    if (m_s64DeadlineUs == 0 || s64NowUs < m_s64DeadlineUs)
+    {
+        return false;
+    }
+    CommitPartial();
+    return true;
+}
+
+bool Port::AddParity(int32_t s32Index, const ArtNet::Packet &oPacket)
+{
+    int32_t s32Count = std::min<int32_t>(PROJECT_FEC_GROUP_SIZE, GetNoUniverses() - s32Index);
+    if (m_pFecGroups == nullptr || s32Index % PROJECT_FEC_GROUP_SIZE != 0 || oPacket.GetFecCount() != s32Count || oPacket.GetFecData() == nullptr)
+    {
+        return false;
+    }
+    FecGroup &stGroup = m_pFecGroups[s32Index / PROJECT_FEC_GROUP_SIZE];
+    size_t u32Length = std::min<size_t>(oPacket.GetFecLength(), m_oPlan.GetFormat().u16UniverseBytes);
+    memcpy(stGroup.aParity.data(), oPacket.GetFecData(), u32Length);
+    std::fill(stGroup.aParity.begin() + u32Length, stGroup.aParity.end(), 0);
+    for (int32_t i = 0; i < s32Count; ++i)
+    {
+        stGroup.au8ParitySequence[i] = oPacket.GetFecSequence(i);
+        stGroup.au16ParityLength[i] = std::min<size_t>(oPacket.GetFecUniverseLength(i), u32Length);
+    }
+    stGroup.bParity = true;
+    TryRecover(s32Index / PROJECT_FEC_GROUP_SIZE);
+    return true;
 }
 
-void Port::TryAddMessage(std::shared_ptr<DMX512Message> spMessage)
+void Port::TryRecover(int32_t s32Group)
 {
-    if (!IsFull())
+    FecGroup &stGroup = m_pFecGroups[s32Group];
+    int32_t s32First = s32Group * PROJECT_FEC_GROUP_SIZE;
+    int32_t s32Count = std::min<int32_t>(PROJECT_FEC_GROUP_SIZE, GetNoUniverses() - s32First);
+    int32_t s32Missing = -1;
+    for (int32_t i = 0; i < s32Count; ++i)
     {
-        if (MatchUniv(spMessage->GetUniverse()))
+        if (!(m_u64ReceivedMask & (1ULL << (s32First + i))))
         {
-            // ESP_LOGI(TAG, "Received Matched Universe (%ld) Message for Port %ld", spMessage->GetUniverse(),  m_s32PortNumber);
-            m_listMessages.push_back(spMessage);
-            m_s32NextUniv++;
+            if (s32Missing >= 0)
+            {
+                // Two or more missing so far, wait for more of the frame.
+                return;
+            }
+            s32Missing = i;
         }
-        else if (MatchUnivLoss(spMessage->GetUniverse()))
+    }
+    if (s32Missing < 0)
+    {
+        return;
+    }
+
+    // Unsequenced ArtDmx cannot be matched to the parity's frame.
+    for (int32_t i = 0; i < s32Count; ++i)
+    {
+        bool bReceived = i != s32Missing;
+        if (stGroup.au8ParitySequence[i] == 0 || (bReceived && (stGroup.au8Sequence[i] != stGroup.au8ParitySequence[i] || (stGroup.u8ClippedMask & (1 << i)))))
         {
-            // ESP_LOGI(TAG, "Workaround for message loss on Port %ld", m_s32PortNumber);
-            m_listMessages.clear();
-            m_listMessages.push_back(spMessage);
-            m_s32NextUniv = m_s32StartUniv + 1;
+            stGroup.bParity = false;
+            m_u32FecMismatchCount++;
+            return;
         }
     }
+
+    size_t u32Length = stGroup.au16ParityLength[s32Missing];
+    for (size_t i = 0; i < u32Length; ++i)
+    {
+        stGroup.aParity[i] ^= stGroup.aXor[i];
+    }
+    stGroup.bParity = false;
+    m_u32FecRecoveredCount++;
+    WriteUniverse(s32First + s32Missing, stGroup.au8ParitySequence[s32Missing], u32Length, CopyFromMessage, stGroup.aParity.data());
+    stGroup.u8RecoveredMask |= 1 << s32Missing;
+}
+
+Ports::Ports() : m_s32BaseUniv(0), m_bInitialized(false)
+{
+    static_assert(PROJECT_NUMBER_OF_PORTS + 1 <= 24, "Event group holds at most 24 bits");
+    m_hOutputEvents = xEventGroupCreate();
+    m_hReceiveMutex = xSemaphoreCreateMutex();
+    m_u32ActiveFrameBits = 0;
+    m_u32CoalescedSyncCount = 0;
+    m_u32LostCount = 0;
+    m_u32DuplicateCount = 0;
+    m_u32LateCount = 0;
+    m_u32StaleCount = 0;
+    m_u32ResyncCount = 0;
+    m_u32DeadlineShowCount = 0;
+    m_u32LinearPortMask = 0;
+    m_u32MisalignedLinearCount = 0;
+    m_u32ParityCount = 0;
+    m_u32ParityRejectedCount = 0;
+    m_bPaced = false;
+    m_s64PlayoutPeriodUs = 1000000 / 44; // Art-Net's usual refresh until frames were measured
+    m_s64PlayoutDelayUs = 0;
+    m_s64JitterInUs = 0;
+    m_s64JitterOutUs = 0;
+    m_s64NextTickUs = 0;
+    m_s64LastShowUs = 0;
+    m_aLastArrivalUs.fill(0);
+    m_u32PlayoutLateCount = 0;
+    m_u32TransformRevision = 0;
+    m_bTransformsBuilt = false;
+    m_u32TransformBuildCount = 0;
+    m_u32LockTimeoutCount = 0;
 }
 
 void Ports::Init()
 {
+    m_bPaced = Settings::GetInstance().GetFramePacingEnabled();
     for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
     {
         m_aPortList[i] = new Port(i);
     }
+    BuildUniverseMap();
+    RefreshTransforms();
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (m_aPortList[i]->IsActive())
+        {
+            m_u32ActiveFrameBits |= FrameBit(i);
+        }
+    }
+    m_bInitialized = true;
+}
+
+cJSON * Ports::ToJson()
+{
+    cJSON * json = cJSON_CreateObject();
+
+    static const char * apModeNames[OUTPUT_MODE_COUNT] = {"ArtSync", "PerPort", "AllPorts", "Paced", "Interpolated"};
+    cJSON_AddStringToObject(json, "Mode", apModeNames[GetOutputMode()]);
+    cJSON_AddItemToObject(json, "SyncToShowLatencyUs", m_stSyncLatency.ToJson());
+    cJSON * pFrameLatency = cJSON_CreateObject();
+    for (int32_t i = 0; i < OUTPUT_MODE_COUNT; ++i)
+    {
+        cJSON_AddItemToObject(pFrameLatency, apModeNames[i], m_aFrameLatency[i].ToJson());
+    }
+    cJSON_AddItemToObject(json, "FrameToShowLatencyUs", pFrameLatency);
+    cJSON_AddNumberToObject(json, "DeadlineShowCount", m_u32DeadlineShowCount);
+    cJSON * pPlayout = cJSON_CreateObject();
+    cJSON_AddBoolToObject(pPlayout, "Enabled", m_bPaced);
+    cJSON_AddNumberToObject(pPlayout, "PeriodUs", m_s64PlayoutPeriodUs);
+    cJSON_AddNumberToObject(pPlayout, "DelayUs", m_s64PlayoutDelayUs);
+    cJSON_AddNumberToObject(pPlayout, "JitterInUs", m_s64JitterInUs);
+    cJSON_AddNumberToObject(pPlayout, "JitterOutUs", m_s64JitterOutUs);
+    cJSON_AddNumberToObject(pPlayout, "Late", m_u32PlayoutLateCount);
+    cJSON_AddItemToObject(json, "Playout", pPlayout);
+    cJSON_AddNumberToObject(json, "TransformBuilds", m_u32TransformBuildCount);
+
+    // Queue depth between each pipeline stage, receive -> assembly -> output.
+    cJSON * pPipeline = cJSON_CreateObject();
+    cJSON_AddNumberToObject(pPipeline, "RxSlotsInUse", DMX512MessagePool::GetCapacity() - DMX512MessagePool::GetInstance().GetFreeCount());
+    cJSON_AddNumberToObject(pPipeline, "SyncQueueDepth", m_oSyncRing.GetDepth());
+    cJSON_AddNumberToObject(pPipeline, "SyncQueueMaxDepth", m_oSyncRing.GetMaxDepth());
+    cJSON_AddNumberToObject(pPipeline, "SyncQueueDropped", m_oSyncRing.GetDroppedCount());
+    cJSON_AddNumberToObject(pPipeline, "CoalescedSyncs", m_u32CoalescedSyncCount);
+    int32_t s32ReadyFrames = 0;
+    if (m_bInitialized)
+    {
+        for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+        {
+            s32ReadyFrames += m_aPortList[i]->HasReadyFrame();
+        }
+    }
+    cJSON_AddNumberToObject(pPipeline, "ReadyFrames", s32ReadyFrames);
+    cJSON_AddItemToObject(json, "Pipeline", pPipeline);
+
+    cJSON * pSequence = cJSON_CreateObject();
+    cJSON_AddNumberToObject(pSequence, "Lost", m_u32LostCount);
+    cJSON_AddNumberToObject(pSequence, "Duplicate", m_u32DuplicateCount);
+    cJSON_AddNumberToObject(pSequence, "Late", m_u32LateCount);
+    cJSON_AddNumberToObject(pSequence, "Stale", m_u32StaleCount);
+    cJSON_AddNumberToObject(pSequence, "Resync", m_u32ResyncCount);
+    cJSON_AddItemToObject(json, "Sequence", pSequence);
+    cJSON_AddNumberToObject(json, "MisalignedLinearWrites", m_u32MisalignedLinearCount);
+    cJSON_AddNumberToObject(json, "FecParity", m_u32ParityCount);
+    cJSON_AddNumberToObject(json, "FecParityRejected", m_u32ParityRejectedCount);
+    cJSON_AddNumberToObject(json, "ReceiveLockTimeouts", m_u32LockTimeoutCount);
+
+    cJSON * pPorts = cJSON_CreateArray();
+    if (m_bInitialized)
+    {
+        for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+        {
+            cJSON_AddItemToArray(pPorts, m_aPortList[i]->ToJson());
+        }
+    }
+    cJSON_AddItemToObject(json, "Ports", pPorts);
+    return json;
+}
+
+bool Ports::LockReceive()
+{
+    if (xSemaphoreTake(m_hReceiveMutex, pdMS_TO_TICKS(PROJECT_RECEIVE_LOCK_TIMEOUT_MS)) != pdTRUE)
+    {
+        m_u32LockTimeoutCount++;
+        return false;
+    }
+    return true;
+}
+
+void Ports::Sync()
+{
+    // The receive mutex keeps the receive paths a single producer of the ring. The ring only carries the
+    // sync time for the latency statistics, a busy mutex loses that sample but never the show.
+    if (LockReceive())
+    {
+        m_oSyncRing.Push(esp_timer_get_time());
+        xSemaphoreGive(m_hReceiveMutex);
+    }
+    xEventGroupSetBits(m_hOutputEvents, m_SYNC_BIT);
+}
+
+void Ports::BuildUniverseMap()
+{
+    m_s32BaseUniv = INT32_MAX;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (m_aPortList[i]->GetNoUniverses() > 0)
+        {
+            m_s32BaseUniv = std::min(m_s32BaseUniv, m_aPortList[i]->GetStartUniverse());
+        }
+    }
+
+    for (auto &stSlot : m_aUniverseMap)
+    {
+        stSlot.s8Port = -1;
+        stSlot.u8Index = 0;
+        stSlot.oSequence = SequenceWindow();
+    }
+
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        for (int32_t j = 0; j < m_aPortList[i]->GetNoUniverses(); ++j)
+        {
+            uint32_t u32Slot = m_aPortList[i]->GetStartUniverse() + j - m_s32BaseUniv;
+            if (u32Slot >= m_aUniverseMap.size())
+            {
+                ESP_LOGW(TAG, "Port %" PRId32 ": universe %" PRId32 " is out of the universe map", i, m_aPortList[i]->GetStartUniverse() + j);
+                continue;
+            }
+            if (m_aUniverseMap[u32Slot].s8Port != -1)
+            {
+                ESP_LOGW(TAG, "Port %" PRId32 ": universe %" PRId32 " is already owned by port %d", i, m_aPortList[i]->GetStartUniverse() + j, m_aUniverseMap[u32Slot].s8Port);
+                continue;
+            }
+            m_aUniverseMap[u32Slot].s8Port = i;
+            m_aUniverseMap[u32Slot].u8Index = j;
+        }
+    }
+}
+
+typedef struct
+{
+    PayloadCopier_t fnCopy;
+    void * pvContext;
+    size_t u32Skip; // bytes already taken by the previous ports
+} LinearCopy_t;
+
+// Only contiguous sources can be split across ports, the copier context is a pointer to the payload.
+static size_t CopyLinearChunk(void * pDest, size_t u32Length, void * pvContext)
+{
+    LinearCopy_t * pCopy = (LinearCopy_t *)pvContext;
+    return pCopy->fnCopy(pDest, u32Length, (uint8_t *)pCopy->pvContext + pCopy->u32Skip);
+}
+
+size_t Ports::HandleDMXMessage(const DMX512Message &oMsg, const ArtNet::Packet &oPacket)
+{
+    // The packet is a view over oMsg, its length was checked against the datagram.
+    return WriteUniverse(oPacket.GetPortAddress(), oPacket.GetSequence(), oPacket.GetDmxLength(), CopyFromMessage, (void *)oPacket.GetDmxData());
+}
+
+bool Ports::CheckSequence(UniverseSlot &stSlot, uint8_t u8Sequence, int64_t s64NowUs)
+{
+    int32_t s32Lost;
+    SequenceWindow::Verdict eVerdict = stSlot.oSequence.Check(u8Sequence, s64NowUs, s32Lost);
+    m_u32LostCount += s32Lost;
+    switch (eVerdict)
+    {
+    case SequenceWindow::DUPLICATE:
+        m_u32DuplicateCount++;
+        return false;
+    case SequenceWindow::LATE:
+        // It may have been counted as lost when the newer one arrived; it was only late, but is stale by now.
+        m_u32LateCount++;
+        return false;
+    case SequenceWindow::STALE:
+        m_u32StaleCount++;
+        return false;
+    case SequenceWindow::RESYNC:
+        m_u32ResyncCount++;
+        return true;
+    default:
+        return true;
+    }
+}
+
+size_t Ports::WriteUniverse(int32_t s32Univ, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext)
+{
+    uint32_t u32Slot = s32Univ - m_s32BaseUniv;
+    if (u32Slot >= m_aUniverseMap.size() || m_aUniverseMap[u32Slot].s8Port < 0)
+    {
+        return 0;
+    }
+    UniverseSlot &stSlot = m_aUniverseMap[u32Slot];
+    if (!LockReceive())
+    {
+        return 0;
+    }
+    RefreshTransforms();
+    size_t u32Copied = 0;
+    // Never let an older frame overwrite a fresher one.
+    int64_t s64NowUs = esp_timer_get_time();
+    if (CheckSequence(stSlot, u8Sequence, s64NowUs))
+    {
+        // A deadline that fired while the mutex was held is caught up here.
+        m_aPortList[stSlot.s8Port]->CommitIfExpired(s64NowUs);
+        u32Copied = m_aPortList[stSlot.s8Port]->WriteUniverse(stSlot.u8Index, u8Sequence, u32Length, fnCopy, pvContext);
+    }
+    xSemaphoreGive(m_hReceiveMutex);
+    return u32Copied;
+}
+
+size_t Ports::WriteLinear(size_t u32Offset, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext)
+{
+    // Only whole pixels, the wire encoders work pixel by pixel.
+    if (u32Offset % 3 != 0 || u32Length % 3 != 0)
+    {
+        m_u32MisalignedLinearCount++;
+        return 0;
+    }
+    if (!LockReceive())
+    {
+        return 0;
+    }
+    RefreshTransforms();
+    // The ports' RGB data laid end to end, in port order.
+    size_t u32Copied = 0;
+    size_t u32PortStart = 0;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS && u32Copied < u32Length; ++i)
+    {
+        size_t u32PortBytes = m_aPortList[i]->GetLedCount() * 3;
+        size_t u32Position = u32Offset + u32Copied;
+        if (u32Position < u32PortStart + u32PortBytes)
+        {
+            size_t u32Chunk = std::min(u32Length - u32Copied, u32PortStart + u32PortBytes - u32Position);
+            LinearCopy_t stCopy = {fnCopy, pvContext, u32Copied};
+            if (!(m_u32LinearPortMask & (1UL << i)))
+            {
+                // First write since the last push, what it does not cover keeps the last pushed pixels.
+                m_aPortList[i]->CopyPreviousFrame();
+                m_u32LinearPortMask |= 1UL << i;
+            }
+            u32Copied += m_aPortList[i]->WritePixels((u32Position - u32PortStart) / 3, u32Chunk, CopyLinearChunk, &stCopy);
+        }
+        u32PortStart += u32PortBytes;
+    }
+    xSemaphoreGive(m_hReceiveMutex);
+    return u32Copied;
+}
+
+void Ports::HandleParity(const ArtNet::Packet &oPacket)
+{
+    uint32_t u32Slot = oPacket.GetFecPortAddress() - m_s32BaseUniv;
+    if (u32Slot >= m_aUniverseMap.size() || m_aUniverseMap[u32Slot].s8Port < 0)
+    {
+        m_u32ParityRejectedCount++;
+        return;
+    }
+    const UniverseSlot &stSlot = m_aUniverseMap[u32Slot];
+    if (!LockReceive())
+    {
+        return;
+    }
+    bool bAccepted = m_aPortList[stSlot.s8Port]->AddParity(stSlot.u8Index, oPacket);
+    xSemaphoreGive(m_hReceiveMutex);
+    if (bAccepted)
+    {
+        m_u32ParityCount++;
+    }
+    else
+    {
+        m_u32ParityRejectedCount++;
+    }
+}
+
+void Ports::DeadlineCallback(void * pvPort)
+{
+    Ports &oPorts = Ports::GetInstance();
+    Port *pPort = (Port *)pvPort;
+    // Never block the esp_timer task behind a receive path, try again shortly instead.
+    if (xSemaphoreTake(oPorts.m_hReceiveMutex, 0) != pdTRUE)
+    {
+        esp_timer_start_once(pPort->m_hDeadlineTimer, g_u64DeadlineRetryUs);
+        return;
+    }
+    pPort->CommitIfExpired(esp_timer_get_time());
+    xSemaphoreGive(oPorts.m_hReceiveMutex);
 }
 
-void Ports::HandleDMXMessage(std::shared_ptr<DMX512Message> spMsg)
+size_t Ports::WritePortFrame(int32_t s32Port, const uint8_t * pRgb, size_t u32Length)
 {
+    if (s32Port < 0 || s32Port >= PROJECT_NUMBER_OF_PORTS)
+    {
+        return 0;
+    }
+    if (!LockReceive())
+    {
+        return 0;
+    }
+    RefreshTransforms();
+    size_t u32Copied = m_aPortList[s32Port]->WritePixels(0, u32Length, CopyFromMessage, (void *)pRgb);
+    m_aPortList[s32Port]->Commit();
+    xSemaphoreGive(m_hReceiveMutex);
+    return u32Copied;
+}
+
+void Ports::Push()
+{
+    // A dropped push keeps the written ports marked, the next one commits them.
+    if (!LockReceive())
+    {
+        return;
+    }
     for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
     {
-        m_aPortList[i]->TryAddMessage(spMsg);
-        if (m_aPortList[i]->IsFull())
+        if (m_u32LinearPortMask & (1UL << i))
         {
             m_aPortList[i]->Commit();
         }
     }
+    m_u32LinearPortMask = 0;
+    xSemaphoreGive(m_hReceiveMutex);
+    // Frame driven output shows on the commits, ArtSync output needs the sync as well.
+    if (GetOutputMode() == OUTPUT_ARTSYNC)
+    {
+        Sync();
+    }
+}
+
+void Ports::RefreshTransforms()
+{
+    const Settings &oSettings = Settings::GetInstance();
+    // Called for every packet, one compare unless the settings changed.
+    if (m_bTransformsBuilt && oSettings.GetRevision() == m_u32TransformRevision)
+    {
+        return;
+    }
+    m_u32TransformRevision = oSettings.GetRevision();
+    m_bTransformsBuilt = true;
+    m_u32TransformBuildCount++;
+    float fBrightness = oSettings.GetBrightness() / 255.0f;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        m_aPortList[i]->SetTransform(oSettings.GetGamma(), fBrightness, oSettings.GetWhiteBalance());
+    }
+}
+
+Ports::OutputMode Ports::GetOutputMode() const
+{
+    // The ports were started with a playout buffer, only the paced output takes frames from it.
+    if (m_bPaced)
+    {
+        return OUTPUT_PACED;
+    }
+    if (Settings::GetInstance().GetArtNetSyncEnabled())
+    {
+        return OUTPUT_ARTSYNC;
+    }
+    const std::string &sMode = Settings::GetInstance().GetFrameOutputMode();
+    if (sMode == "Interpolated")
+    {
+        return OUTPUT_INTERPOLATED;
+    }
+    return sMode == "PerPort" ? OUTPUT_PER_PORT : OUTPUT_ALL_PORTS;
+}
+
+void Ports::TakeReadyFrames(OutputMode eMode)
+{
+    // Ports without a new frame keep showing their current one.
+    int64_t s64NowUs = esp_timer_get_time();
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (m_aPortList[i]->TakeReadyFrame())
+        {
+            m_aFrameLatency[eMode].Add(s64NowUs - m_aPortList[i]->GetDisplayCommitTimeUs());
+        }
+    }
+}
+
+void Ports::ShowAll()
+{
+    // Every RMT channel is started before waiting on any, so a frame costs one strip time instead of one per port.
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (m_aPortList[i]->Show() != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Port %" PRId32 ": Failed to start output", i);
+        }
+    }
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        m_aPortList[i]->WaitShown();
+    }
+}
+
+void Ports::RunArtSyncCycle()
+{
+    EventBits_t u32Events = xEventGroupWaitBits(m_hOutputEvents, m_SYNC_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(PROJECT_OUTPUT_MODE_POLL_MS));
+    // Frame bits are only waited for by frame driven output, never let them pile up.
+    xEventGroupClearBits(m_hOutputEvents, m_u32ActiveFrameBits);
+    if (!(u32Events & m_SYNC_BIT))
+    {
+        return;
+    }
+
+    // Syncs that piled up while the previous show was running collapse into this one.
+    int64_t s64SyncTimeUs = 0;
+    uint32_t u32Syncs = 0;
+    while (m_oSyncRing.Pop(s64SyncTimeUs))
+    {
+        u32Syncs++;
+    }
+    if (u32Syncs > 1)
+    {
+        m_u32CoalescedSyncCount += u32Syncs - 1;
+    }
+
+    TakeReadyFrames(OUTPUT_ARTSYNC);
+    if (u32Syncs > 0)
+    {
+        m_stSyncLatency.Add(esp_timer_get_time() - s64SyncTimeUs);
+    }
+    ShowAll();
+}
+
+void Ports::RunPerPortCycle()
+{
+    EventBits_t u32Events = xEventGroupWaitBits(m_hOutputEvents, m_u32ActiveFrameBits, pdTRUE, pdFALSE, pdMS_TO_TICKS(PROJECT_OUTPUT_MODE_POLL_MS));
+    xEventGroupClearBits(m_hOutputEvents, m_SYNC_BIT);
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if ((u32Events & FrameBit(i)) && m_aPortList[i]->TakeReadyFrame())
+        {
+            m_aFrameLatency[OUTPUT_PER_PORT].Add(esp_timer_get_time() - m_aPortList[i]->GetDisplayCommitTimeUs());
+            m_aPortList[i]->Show(); // returns once the port's previous frame is out, others keep shifting
+        }
+    }
+}
+
+void Ports::RunAllPortsCycle()
+{
+    EventBits_t u32Events = xEventGroupWaitBits(m_hOutputEvents, m_u32ActiveFrameBits, pdTRUE, pdFALSE, pdMS_TO_TICKS(PROJECT_OUTPUT_MODE_POLL_MS));
+    xEventGroupClearBits(m_hOutputEvents, m_SYNC_BIT);
+    if (!(u32Events & m_u32ActiveFrameBits))
+    {
+        return;
+    }
+
+    // The deadline runs from the first completed port of this cycle.
+    TickType_t u32Start = xTaskGetTickCount();
+    TickType_t u32Deadline = pdMS_TO_TICKS(Settings::GetInstance().GetOutputDeadlineMs());
+    while ((u32Events & m_u32ActiveFrameBits) != m_u32ActiveFrameBits)
+    {
+        TickType_t u32Elapsed = xTaskGetTickCount() - u32Start;
+        if (u32Elapsed >= u32Deadline)
+        {
+            m_u32DeadlineShowCount++;
+            break;
+        }
+        u32Events |= xEventGroupWaitBits(m_hOutputEvents, m_u32ActiveFrameBits & ~u32Events, pdTRUE, pdFALSE, u32Deadline - u32Elapsed);
+    }
+
+    TakeReadyFrames(OUTPUT_ALL_PORTS);
+    ShowAll();
+}
+
+void Ports::AddArrival(int32_t s32Port, int64_t s64CommitUs)
+{
+    int64_t s64IntervalUs = s64CommitUs - m_aLastArrivalUs[s32Port];
+    m_aLastArrivalUs[s32Port] = s64CommitUs;
+    if (s64IntervalUs <= 0 || s64IntervalUs > PROJECT_PLAYOUT_MAXIMUM_PERIOD_US)
+    {
+        // First frame, or the stream paused.
+        return;
+    }
+    // Running averages with a gain of 1/16, like the RTP interarrival jitter.
+    m_s64PlayoutPeriodUs += (s64IntervalUs - m_s64PlayoutPeriodUs) / 16;
+    m_s64PlayoutPeriodUs = std::clamp<int64_t>(m_s64PlayoutPeriodUs, PROJECT_PLAYOUT_MINIMUM_PERIOD_US, PROJECT_PLAYOUT_MAXIMUM_PERIOD_US);
+    m_s64JitterInUs += (std::abs(s64IntervalUs - m_s64PlayoutPeriodUs) - m_s64JitterInUs) / 16;
+    // Long enough to ride out the usual jitter, short enough for the spare frames to hold the queue.
+    m_s64PlayoutDelayUs = std::min<int64_t>(PROJECT_PLAYOUT_JITTER_FACTOR * m_s64JitterInUs, (PROJECT_PLAYOUT_DEPTH - 1) * m_s64PlayoutPeriodUs);
+}
+
+void Ports::RunPacedCycle()
+{
+    // Frames are taken on the playout clock, the sync event is not needed.
+    xEventGroupClearBits(m_hOutputEvents, m_SYNC_BIT);
+    int64_t s64WaitUs = m_s64NextTickUs - esp_timer_get_time();
+    if (s64WaitUs > 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS((s64WaitUs + 500) / 1000));
+    }
+    xEventGroupClearBits(m_hOutputEvents, m_u32ActiveFrameBits);
+    bool bQueued = false;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        bQueued |= m_aPortList[i]->GetPlayoutDepth() > 0;
+    }
+    if (!bQueued)
+    {
+        // Missed the tick, the first frame to complete is shown at once.
+        xEventGroupWaitBits(m_hOutputEvents, m_u32ActiveFrameBits, pdTRUE, pdFALSE, pdMS_TO_TICKS(PROJECT_OUTPUT_MODE_POLL_MS));
+        return;
+    }
+
+    int64_t s64NowUs = esp_timer_get_time();
+    int64_t s64DueUs = 0; // when the frames shown were due, their commit plus the playout delay
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        Port &oPort = *m_aPortList[i];
+        int64_t s64CommitUs = 0, s64NextCommitUs = 0;
+        if (!oPort.PeekPlayout(s64CommitUs))
+        {
+            continue;
+        }
+        // A newer frame is due as well, showing both would hold every later frame back a tick.
+        while (oPort.PeekPlayout(s64NextCommitUs, 1) && s64NowUs >= s64NextCommitUs + m_s64PlayoutDelayUs)
+        {
+            AddArrival(i, s64CommitUs);
+            oPort.TakePlayout(false);
+            m_u32PlayoutLateCount++;
+            s64CommitUs = s64NextCommitUs;
+        }
+        AddArrival(i, s64CommitUs);
+        oPort.TakePlayout(true);
+        m_aFrameLatency[OUTPUT_PACED].Add(s64NowUs - s64CommitUs);
+        s64DueUs = std::max(s64DueUs, s64CommitUs + m_s64PlayoutDelayUs);
+    }
+
+    int64_t s64IntervalUs = s64NowUs - m_s64LastShowUs;
+    if (m_s64LastShowUs != 0 && s64IntervalUs <= PROJECT_PLAYOUT_MAXIMUM_PERIOD_US)
+    {
+        m_s64JitterOutUs += (std::abs(s64IntervalUs - m_s64PlayoutPeriodUs) - m_s64JitterOutUs) / 16;
+    }
+    m_s64LastShowUs = s64NowUs;
+    ShowAll();
+
+    // The next tick is a period on, pulled 1/16 of the way towards when these frames were due: the clock
+    // follows the average phase of the input, not the jitter of each frame.
+    m_s64NextTickUs = s64NowUs + m_s64PlayoutPeriodUs + (s64DueUs - s64NowUs) / 16;
+}
+
+void Ports::RunInterpolatedCycle()
+{
+    // Rendered on the clock, the completion and sync events are not needed.
+    xEventGroupClearBits(m_hOutputEvents, m_u32ActiveFrameBits | m_SYNC_BIT);
+
+    int64_t s64NowUs = esp_timer_get_time();
+    uint32_t u32Shown = 0;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (m_aPortList[i]->TakeBlendFrame(s64NowUs))
+        {
+            m_aFrameLatency[OUTPUT_INTERPOLATED].Add(s64NowUs - m_aPortList[i]->GetDisplayCommitTimeUs());
+        }
+        if (m_aPortList[i]->ShowBlend(s64NowUs))
+        {
+            u32Shown |= 1UL << i;
+        }
+    }
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (u32Shown & (1UL << i))
+        {
+            m_aPortList[i]->WaitShown();
+        }
+    }
+
+    WaitForNextTick(1000000 / Settings::GetInstance().GetInterpolationRateHz());
+}
+
+void Ports::WaitForNextTick(int64_t s64PeriodUs)
+{
+    // Ticks stay one period apart however long showing took, a clock that fell behind starts over from now.
+    m_s64NextTickUs += s64PeriodUs;
+    int64_t s64WaitUs = m_s64NextTickUs - esp_timer_get_time();
+    if (s64WaitUs < 0)
+    {
+        m_s64NextTickUs -= s64WaitUs;
+        s64WaitUs = 0;
+    }
+    vTaskDelay(pdMS_TO_TICKS((s64WaitUs + 500) / 1000));
 }
 
 void Ports::FreeRTOSTask(void * pvParameters)
 {
+    Ports &oPorts = Ports::GetInstance();
+    // Created from this task so the RMT interrupts are allocated on PROJECT_OUTPUT_CORE, pvParameters is the
+    // task waiting for it.
+    oPorts.Init();
+    xTaskNotifyGive((TaskHandle_t)pvParameters);
+    OutputMode ePreviousMode = OUTPUT_MODE_COUNT;
     while(true)
     {
-        if (Ports::GetInstance().m_bSync)
+        OutputMode eMode = oPorts.GetOutputMode();
+        if (eMode == OUTPUT_INTERPOLATED && ePreviousMode != OUTPUT_INTERPOLATED)
         {
-            Ports::GetInstance().m_bSync = false;
             for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
             {
-                Ports::GetInstance().m_aPortList[i]->m_oBufferMutex.lock();
-            }
-            FastLED.show();
-            for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
-            {
-                Ports::GetInstance().m_aPortList[i]->m_oBufferMutex.unlock();
+                oPorts.m_aPortList[i]->ResetBlend();
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(1));
+        ePreviousMode = eMode;
+        if (eMode != OUTPUT_ARTSYNC && oPorts.m_u32ActiveFrameBits == 0)
+        {
+            // No port to wait for, an empty wait mask is not allowed.
+            vTaskDelay(pdMS_TO_TICKS(PROJECT_OUTPUT_MODE_POLL_MS));
+            continue;
+        }
+        switch (eMode)
+        {
+        case OUTPUT_ARTSYNC:
+            oPorts.RunArtSyncCycle();
+            break;
+        case OUTPUT_PER_PORT:
+            oPorts.RunPerPortCycle();
+            break;
+        case OUTPUT_PACED:
+            oPorts.RunPacedCycle();
+            break;
+        case OUTPUT_INTERPOLATED:
+            oPorts.RunInterpolatedCycle();
+            break;
+        default:
+            oPorts.RunAllPortsCycle();
+            break;
+        }
     }
-}
\ No newline at end of file
+}
+
+void LatencyStats::Add(int64_t s64Us)
+{
+    s64LastUs = s64Us;
+    s64MaxUs = std::max(s64MaxUs, s64Us);
+    s64SumUs += s64Us;
+    u32Count++;
+}
+
+cJSON * LatencyStats::ToJson() const
+{
+    cJSON * json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "Last", s64LastUs);
+    cJSON_AddNumberToObject(json, "Max", s64MaxUs);
+    cJSON_AddNumberToObject(json, "Average", u32Count ? s64SumUs / u32Count : 0);
+    return json;
+}
@@ -2,42 +2,270 @@
 #define __ARTNET_NODE_PORT_H__
 
 #include "config.h"
-#include <mutex>
-#include <memory>
+#include <atomic>
 #include <array>
-#include <list>
 #include "models/settings.h"
 #include "miscellaneous.h"
-#include "FastLED.h"
+#include "dmx_message.h"
+#include "artnet_packet.h"
+#include "led_output.h"
+#include "pixel_format.h"
+#include "sequence_window.h"
+#include "spsc_ring.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+// Longest the output task blocks before re-reading the output mode from Settings.
+#ifndef PROJECT_OUTPUT_MODE_POLL_MS
+#define PROJECT_OUTPUT_MODE_POLL_MS 500
+#endif
+
+// Universes of a port covered by one ArtFec parity, counted from the port's start universe.
+#ifndef PROJECT_FEC_GROUP_SIZE
+#define PROJECT_FEC_GROUP_SIZE 6
+#endif
+static_assert(PROJECT_FEC_GROUP_SIZE <= ArtNet::MAXIMUM_FEC_GROUP, "ArtFec covers at most 8 universes");
+
+// Frames the playout buffer adds to each port's triple buffer, only allocated with frame pacing.
+#ifndef PROJECT_PLAYOUT_DEPTH
+#define PROJECT_PLAYOUT_DEPTH 3
+#endif
+static_assert(3 + PROJECT_PLAYOUT_DEPTH <= 8, "Playout rings hold 8 frame indices");
+
+// Longest a receive path waits for the receive mutex before it drops the packet. The raw lwIP receive runs in
+// the tcpip thread, which must never stall behind assembly in another task.
+#ifndef PROJECT_RECEIVE_LOCK_TIMEOUT_MS
+#define PROJECT_RECEIVE_LOCK_TIMEOUT_MS 2
+#endif
+
+// Playout delay in multiples of the measured arrival jitter.
+#ifndef PROJECT_PLAYOUT_JITTER_FACTOR
+#define PROJECT_PLAYOUT_JITTER_FACTOR 3
+#endif
+
+// Range of the paced output period, which follows the measured input frame interval.
+#ifndef PROJECT_PLAYOUT_MINIMUM_PERIOD_US
+#define PROJECT_PLAYOUT_MINIMUM_PERIOD_US 10000
+#endif
+#ifndef PROJECT_PLAYOUT_MAXIMUM_PERIOD_US
+#define PROJECT_PLAYOUT_MAXIMUM_PERIOD_US 100000
+#endif
+
+// Input frame intervals longer than this are a paused stream, not a frame rate to interpolate over.
+#ifndef PROJECT_INTERPOLATION_MAXIMUM_INTERVAL_US
+#define PROJECT_INTERPOLATION_MAXIMUM_INTERVAL_US 200000
+#endif
+
+typedef struct LatencyStats
+{
+    int64_t s64LastUs = 0;
+    int64_t s64MaxUs = 0;
+    int64_t s64SumUs = 0;
+    uint32_t u32Count = 0;
+    void Add(int64_t s64Us);
+    cJSON * ToJson() const;
+} LatencyStats;
 
 class Port
 {
+    // Single loss recovery: the XOR of the group's universes received so far, together with the
+    // parity, is the one universe still missing.
+    typedef struct
+    {
+        std::array<uint8_t, PROJECT_MAXIMUM_BYTES_PER_UNIVERSE> aXor;    // payloads of the frame in assembly
+        std::array<uint8_t, PROJECT_MAXIMUM_BYTES_PER_UNIVERSE> aParity; // newest ArtFec of the group
+        std::array<uint8_t, PROJECT_FEC_GROUP_SIZE> au8Sequence; // ArtDmx sequence of each received universe
+        std::array<uint8_t, PROJECT_FEC_GROUP_SIZE> au8ParitySequence;
+        std::array<uint16_t, PROJECT_FEC_GROUP_SIZE> au16ParityLength;
+        uint8_t u8ClippedMask; // universes that did not fit the port entirely, aXor lacks part of them
+        uint8_t u8RecoveredMask; // rebuilt before their own ArtDmx arrived, au8Sequence holds the frame's sequence
+        bool bParity;
+    } FecGroup;
+
+    typedef struct
+    {
+        uint8_t u8Index;
+        int64_t s64CommitUs;
+    } PlayoutFrame;
+
 public:
     const int32_t m_s32PortNumber;
 
-    std::mutex m_oBufferMutex;
-    std::array<CRGB, PROJECT_MAXIMUM_NUMBER_OF_LEDS_PER_PORT> * m_pBuffer;
-    std::list<std::shared_ptr<DMX512Message>> m_listMessages;
+    // Triple buffer: the assembler owns m_u8WriteIndex, the output task owns m_u8DisplayIndex
+    // and completed frames are handed over by exchanging m_u8ReadyIndex.
+    static constexpr uint8_t m_u8FreshFlag = 0x80;
+    std::array<uint8_t *, 3 + PROJECT_PLAYOUT_DEPTH> m_aFrames; // LedCount * bytes per pixel each, already in the chipset wire format
+    std::array<int64_t, 3 + PROJECT_PLAYOUT_DEPTH> m_aCommitTimeUs; // esp_timer time each frame was completed
+    uint8_t m_u8WriteIndex;
+    std::atomic<uint8_t> m_u8ReadyIndex; // m_u8FreshFlag set until the output task takes it
+    uint8_t m_u8DisplayIndex;
+    std::atomic<uint32_t> m_u32CommittedFrames;
+    std::atomic<uint32_t> m_u32OverwrittenFrames; // committed but replaced before being displayed
+    std::atomic<uint32_t> m_u32DisplayedFrames;
+    // Frame pacing replaces the ready frame with a playout buffer: committed frames queue up for the
+    // output task's clock and come back through m_oFreeFrames once shown or dropped.
+    bool m_bPaced;
+    SpscRing<PlayoutFrame, 8> m_oPlayout; // assembler -> output task
+    SpscRing<uint8_t, 8> m_oFreeFrames;   // output task -> assembler
+    // Frame interpolation, output task only: crossfades from what the strip showed when the display frame
+    // arrived to the display frame over one input frame interval. Buffers are allocated on first use.
+    uint8_t *m_pBlendFrom;
+    uint8_t *m_pBlendOut;
+    int64_t m_s64BlendStartUs;
+    int64_t m_s64InputIntervalUs; // smoothed interval between displayed input frames
+    bool m_bBlendDone; // the display frame itself was shown, the strip holds it until the next one
+    bool m_bBlendSeeded; // m_pBlendOut holds a received frame, not zeros or one from before a mode switch
+    uint32_t m_u32BlendedFrames; // intermediate frames shown
     int32_t m_s32StartUniv;
     int32_t m_s32EndUniv;
-    int32_t m_s32NextUniv;
-    CLEDController *m_oCLedController;
+    uint64_t m_u64ReceivedMask; // bit n: universe m_s32StartUniv + n has landed in the assembly buffer
+    uint64_t m_u64CompleteMask;
+    size_t m_u32FrameBytes;
+    int32_t m_s32LedCount;
+    RmtLedStrip m_oStrip;
+    // Universes are copied by the port's pixel format plan. A pixel split across two universes is put
+    // together at its seam, one PixelFormat::MAXIMUM_BYTES_PER_PIXEL slot per universe boundary.
+    CopyPlan m_oPlan;
+    uint8_t *m_pSeams; // nullptr unless pixels are split
+    uint64_t m_u64SeamMask; // bit n: a pixel continues from universe n into n + 1
+    uint64_t m_u64SeamTailMask; // bit n: universe n delivered the start of its seam pixel
+    uint64_t m_u64SeamHeadMask; // bit n: universe n + 1 delivered the end
+    FecGroup *m_pFecGroups; // one per PROJECT_FEC_GROUP_SIZE universes, nullptr while FEC is disabled
+    uint32_t m_u32FecRecoveredCount;
+    uint32_t m_u32FecMismatchCount; // parity of another frame than the one in assembly
+    // Partial frames: committed at Settings::GetPartialFrameDeadlineMs() after their first universe,
+    // the universes still missing keep the pixels of the previous frame.
+    esp_timer_handle_t m_hDeadlineTimer;
+    int64_t m_s64DeadlineUs; // esp_timer time the frame in assembly is due, 0: no deadline
+    uint8_t m_u8PreviousIndex; // frame committed last, ready or on display, never written
+    uint32_t m_u32PartialCommitCount;
+    uint32_t m_u32ConcealedUniverseCount;
 
     esp_err_t Init();
-    inline bool MatchUniv(int32_t s32Univ);
-    inline bool MatchUnivLoss(int32_t s32Univ);
+    void ResetAssembly();
+    void TryRecover(int32_t s32Group);
+    void ArmDeadline();
+    void CommitPartial();
+    size_t WriteConverted(int32_t s32Index, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext, uint8_t * pXor);
+    void ConvertPixels(size_t u32Pixel, size_t u32Pixels, const uint8_t * pIn);
+    void AddSeamPart(int32_t s32Seam, bool bTail, const uint8_t * pBytes, size_t u32Length);
 
 public:
     Port(int32_t s32PortNumber);
-    inline bool IsFull();
+    int32_t GetStartUniverse() const { return m_s32StartUniv; }
+    int32_t GetNoUniverses() const { return m_s32EndUniv - m_s32StartUniv; }
+    inline bool IsFull() const { return m_u64CompleteMask != 0 && m_u64ReceivedMask == m_u64CompleteMask; }
+    bool IsActive() const { return m_u64CompleteMask != 0; }
     void Commit();
-    void TryAddMessage(std::shared_ptr<DMX512Message> spMessage);
+    bool HasReadyFrame() const { return m_bPaced ? m_oPlayout.GetDepth() > 0 : m_u8ReadyIndex.load(std::memory_order_relaxed) & m_u8FreshFlag; }
+    bool TakeReadyFrame();
+    // Output task side of the playout buffer, frame pacing only.
+    bool PeekPlayout(int64_t &s64CommitUs, uint32_t u32Offset = 0) const;
+    uint32_t GetPlayoutDepth() const { return m_oPlayout.GetDepth(); }
+    // The oldest queued frame goes onto the display, or back to the assembler unseen.
+    void TakePlayout(bool bShow);
+    // Output task, frame interpolation: TakeReadyFrame() that starts a crossfade to the new frame.
+    bool TakeBlendFrame(int64_t s64NowUs);
+    // The next frame taken is shown as it is, the crossfades start from it.
+    void ResetBlend() { m_bBlendSeeded = false; }
+    // Starts shifting out the crossfade at s64NowUs, false once there is nothing new to show.
+    bool ShowBlend(int64_t s64NowUs);
+    int64_t GetDisplayCommitTimeUs() const { return m_aCommitTimeUs[m_u8DisplayIndex]; }
+    esp_err_t Show();
+    esp_err_t WaitShown() { return m_oStrip.WaitDone(); }
+    int32_t GetLedCount() const { return m_s32LedCount; }
+    // Receive mutex held, applies to the universes written from now on.
+    void SetTransform(float fGamma, float fBrightness, const std::array<uint8_t, 3> &aWhiteBalance) { m_oStrip.SetTransform(fGamma, fBrightness, aWhiteBalance); }
+    // The write frame starts as a copy of the frame committed last, for updates that do not cover the port.
+    void CopyPreviousFrame();
+    // u32Length bytes of 8-bit RGB from pixel u32Pixel on whatever the port's pixel format, clipped to the port.
+    // Returns the bytes copied.
+    // The copied RGB is XORed into pXor unless it is nullptr.
+    size_t WritePixels(size_t u32Pixel, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext, uint8_t * pXor = nullptr);
+    size_t WriteUniverse(int32_t s32Index, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext);
+    // oPacket is a contiguous ArtFec whose first universe is s32Index of this port.
+    bool AddParity(int32_t s32Index, const ArtNet::Packet &oPacket);
+    // Commits the frame in assembly if its deadline has passed, receive mutex held.
+    bool CommitIfExpired(int64_t s64NowUs);
+    cJSON * ToJson();
 };
 
 class Ports
 {
+    typedef struct
+    {
+        int8_t s8Port;  // -1: universe not owned by any port
+        uint8_t u8Index; // universe index inside the port
+        SequenceWindow oSequence;
+    } UniverseSlot;
+
     std::array<Port *, PROJECT_NUMBER_OF_PORTS> m_aPortList;
-    bool m_bSync;
+    std::array<UniverseSlot, PROJECT_MAXIMUM_NUMBER_OF_UNIVERSES> m_aUniverseMap; // indexed by universe - m_s32BaseUniv
+    int32_t m_s32BaseUniv;
+    bool m_bInitialized;
+
+    enum OutputMode
+    {
+        OUTPUT_ARTSYNC,      // show every port on ArtSync
+        OUTPUT_PER_PORT,     // show each port as soon as its frame completes
+        OUTPUT_ALL_PORTS,    // show all ports once every active port completed or the deadline expired
+        OUTPUT_PACED,        // show one queued frame per port on every tick of a clock following the input rate
+        OUTPUT_INTERPOLATED, // show crossfades between the last two frames at Settings::GetInterpolationRateHz()
+        OUTPUT_MODE_COUNT,
+    };
+
+    static const EventBits_t m_SYNC_BIT = BIT0;
+    static constexpr EventBits_t FrameBit(int32_t s32Port) { return BIT1 << s32Port; }
+    EventGroupHandle_t m_hOutputEvents;
+    SemaphoreHandle_t m_hReceiveMutex; // Art-Net and sACN receive in different tasks, one of them assembles at a time
+    EventBits_t m_u32ActiveFrameBits;
+    SpscRing<int64_t, 8> m_oSyncRing; // esp_timer time of each ArtSync, network core to output core
+    uint32_t m_u32CoalescedSyncCount; // ArtSyncs that arrived while an earlier one was still pending
+    LatencyStats m_stSyncLatency;
+    std::array<LatencyStats, OUTPUT_MODE_COUNT> m_aFrameLatency; // frame completion to show, per output mode
+    uint32_t m_u32DeadlineShowCount; // OUTPUT_ALL_PORTS shows with at least one port still incomplete
+    // Sequence accounting, written by the receive path only.
+    uint32_t m_u32LostCount; // sequence gaps, taken back when the missing packet shows up late
+    uint32_t m_u32DuplicateCount;
+    uint32_t m_u32LateCount;
+    uint32_t m_u32StaleCount; // behind the reorder window while the sender is still sending, dropped
+    uint32_t m_u32ResyncCount; // sender restarted after a pause
+    uint32_t m_u32LinearPortMask; // ports written by offset since the last Push()
+    uint32_t m_u32MisalignedLinearCount;
+    uint32_t m_u32ParityCount;
+    uint32_t m_u32ParityRejectedCount; // not for a universe group of this node, or FEC disabled
+    // Frame pacing, fixed when the ports start and then owned by the output task.
+    bool m_bPaced;
+    int64_t m_s64PlayoutPeriodUs; // smoothed frame arrival interval, the period of the output clock
+    int64_t m_s64PlayoutDelayUs;  // a frame is due this long after its commit
+    int64_t m_s64JitterInUs;      // smoothed deviation of the arrival intervals from the period
+    int64_t m_s64JitterOutUs;     // same for the intervals between shows
+    int64_t m_s64NextTickUs; // paced and interpolated output
+    int64_t m_s64LastShowUs;
+    std::array<int64_t, PROJECT_NUMBER_OF_PORTS> m_aLastArrivalUs;
+    uint32_t m_u32PlayoutLateCount; // due frames dropped because a newer one was due as well
+    // Pixel transforms, rebuilt by the receive path when the settings revision changes.
+    uint32_t m_u32TransformRevision;
+    bool m_bTransformsBuilt;
+    uint32_t m_u32TransformBuildCount;
+    uint32_t m_u32LockTimeoutCount; // packets dropped because the receive mutex was held too long
+
+    // Bounded take of the receive mutex, counts a timeout.
+    bool LockReceive();
+    void BuildUniverseMap();
+    bool CheckSequence(UniverseSlot &stSlot, uint8_t u8Sequence, int64_t s64NowUs);
+    OutputMode GetOutputMode() const;
+    void RunArtSyncCycle();
+    void RunPerPortCycle();
+    void RunAllPortsCycle();
+    void RunPacedCycle();
+    void RunInterpolatedCycle();
+    void WaitForNextTick(int64_t s64PeriodUs);
+    void AddArrival(int32_t s32Port, int64_t s64CommitUs);
+    void TakeReadyFrames(OutputMode eMode);
+    void ShowAll();
+    void RefreshTransforms();
 
 public:
     static Ports &GetInstance()
@@ -45,10 +273,31 @@ public:
         static Ports oIns;
         return oIns;
     }
+    Ports();
     void Init();
+    cJSON * ToJson();
     static void FreeRTOSTask(void * pvParameters);
-    void Sync() { m_bSync = true; }
-    void HandleDMXMessage(std::shared_ptr<DMX512Message> spMsg);
+    void Sync();
+    void NotifyFrameComplete(int32_t s32Port) { xEventGroupSetBits(m_hOutputEvents, FrameBit(s32Port)); }
+    size_t HandleDMXMessage(const DMX512Message &oMsg, const ArtNet::Packet &oPacket);
+    // u8Sequence is the ArtDmx sequence, 0 when the sender does not sequence. Returns 0 when the packet was
+    // dropped, as stale or because the receive mutex stayed busy.
+    size_t WriteUniverse(int32_t s32Univ, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext);
+    // RGB addressed by byte offset over all ports laid end to end (DDP). pvContext must point at contiguous
+    // payload that fnCopy reads from, so a write can be split across ports. Returns 0 when the receive mutex
+    // stayed busy.
+    size_t WriteLinear(size_t u32Offset, size_t u32Length, PayloadCopier_t fnCopy, void * pvContext);
+    // oPacket is a parsed, contiguous ArtFec.
+    void HandleParity(const ArtNet::Packet &oPacket);
+    // Writes and commits a whole frame of the port, RGB from the first pixel on. Returns 0 when the receive
+    // mutex stayed busy.
+    size_t WritePortFrame(int32_t s32Port, const uint8_t * pRgb, size_t u32Length);
+    // Commits every port written by WriteLinear() since the last push. Dropped while the receive mutex stays
+    // busy, the ports stay written for the next push.
+    void Push();
+    // esp_timer callback of a port's partial frame deadline, pvPort is the Port.
+    static void DeadlineCallback(void * pvPort);
+    uint32_t GetLostCount() const { return m_u32LostCount; }
 };
 
 #endif /* __ARTNET_NODE_PORT_H__ */
@@ -0,0 +1,105 @@
+#ifndef __ARTNET_NODE_SEQUENCE_WINDOW_H__
+#define __ARTNET_NODE_SEQUENCE_WINDOW_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+
+// ArtDmx arriving at most this many sequence numbers behind the newest one counts as reordered, not as a restart.
+#ifndef PROJECT_SEQUENCE_REORDER_WINDOW
+#define PROJECT_SEQUENCE_REORDER_WINDOW 8
+#endif
+
+// ArtDmx further behind than the reorder window is taken as a sender restart only once nothing newer
+// arrived for this long, before that it is stale and dropped.
+#ifndef PROJECT_SEQUENCE_RESTART_MS
+#define PROJECT_SEQUENCE_RESTART_MS 500
+#endif
+
+// ArtDmx sequence tracking of one universe. Sequences run 1..255 then wrap to 1, 0 disables the check.
+// Remembers which of the numbers just before the newest one were counted as lost, so a late packet
+// takes back exactly the loss it caused and a late duplicate takes back nothing. Plain C++, so it can be
+// checked on a host.
+class SequenceWindow
+{
+    static_assert(PROJECT_SEQUENCE_REORDER_WINDOW <= 32, "Lost sequences are tracked in 32 bits");
+
+    uint8_t m_u8Last;       // newest accepted sequence, 0: none yet
+    uint32_t m_u32LostMask; // bit n: m_u8Last - 1 - n was counted as lost and has not shown up since
+    int64_t m_s64LastUs;    // when m_u8Last arrived
+
+    void Advance(uint8_t u8Sequence, int64_t s64NowUs, int32_t s32Distance)
+    {
+        // The numbers skipped are the s32Distance - 1 right below the new newest one.
+        uint64_t u64Mask = s32Distance >= 32 ? 0 : (uint64_t)m_u32LostMask << s32Distance;
+        u64Mask |= s32Distance > 1 ? (1ULL << std::min<int32_t>(s32Distance - 1, 32)) - 1 : 0;
+        m_u32LostMask = (uint32_t)u64Mask;
+        m_u8Last = u8Sequence;
+        m_s64LastUs = s64NowUs;
+    }
+
+public:
+    enum Verdict
+    {
+        ACCEPT,
+        DUPLICATE, // same sequence as the newest accepted one
+        LATE,      // older than the newest accepted one, within the reorder window
+        STALE,     // further behind, while the sender is still sending newer ones
+        RESYNC,    // further behind after a pause, the sender restarted; accepted
+    };
+
+    SequenceWindow() : m_u8Last(0), m_u32LostMask(0), m_s64LastUs(0) {}
+
+    // s32Lost is set to the change of the lost count: the gap skipped by an accepted packet, or -1 for a
+    // late one that was counted as lost.
+    Verdict Check(uint8_t u8Sequence, int64_t s64NowUs, int32_t &s32Lost)
+    {
+        s32Lost = 0;
+        if (u8Sequence == 0)
+        {
+            return ACCEPT;
+        }
+        if (m_u8Last == 0)
+        {
+            Advance(u8Sequence, s64NowUs, 0);
+            return ACCEPT;
+        }
+
+        // Fold the distance into -127..127.
+        int32_t s32Distance = (u8Sequence - m_u8Last + 255) % 255;
+        if (s32Distance > 127)
+        {
+            s32Distance -= 255;
+        }
+
+        if (s32Distance == 0)
+        {
+            return DUPLICATE;
+        }
+        if (-PROJECT_SEQUENCE_REORDER_WINDOW <= s32Distance && s32Distance < 0)
+        {
+            uint32_t u32Bit = 1UL << (-s32Distance - 1);
+            if (m_u32LostMask & u32Bit)
+            {
+                m_u32LostMask &= ~u32Bit;
+                s32Lost = -1;
+            }
+            return LATE;
+        }
+        if (s32Distance < 0)
+        {
+            if (s64NowUs - m_s64LastUs < PROJECT_SEQUENCE_RESTART_MS * 1000LL)
+            {
+                return STALE;
+            }
+            m_u32LostMask = 0;
+            Advance(u8Sequence, s64NowUs, 0);
+            return RESYNC;
+        }
+        s32Lost = s32Distance - 1;
+        Advance(u8Sequence, s64NowUs, s32Distance);
+        return ACCEPT;
+    }
+};
+
+#endif /* __ARTNET_NODE_SEQUENCE_WINDOW_H__ */
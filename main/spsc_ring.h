@@ -0,0 +1,76 @@
+#ifndef __ARTNET_NODE_SPSC_RING_H__
+#define __ARTNET_NODE_SPSC_RING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <array>
+
+// Lock-free ring for exactly one producer and one consumer, typically on different cores.
+// Head and tail sit on their own cache lines so the two sides never write the same line.
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+
+    std::array<T, N> m_aItems;
+    alignas(32) std::atomic<uint32_t> m_u32Head; // next slot to write, owned by the producer
+    alignas(32) std::atomic<uint32_t> m_u32Tail; // next slot to read, owned by the consumer
+    std::atomic<uint32_t> m_u32MaxDepth;
+    std::atomic<uint32_t> m_u32DroppedCount;
+
+public:
+    SpscRing() : m_u32Head(0), m_u32Tail(0), m_u32MaxDepth(0), m_u32DroppedCount(0) {}
+
+    // Producer side. Returns false and counts a drop when the ring is full.
+    bool Push(const T &item)
+    {
+        uint32_t u32Head = m_u32Head.load(std::memory_order_relaxed);
+        uint32_t u32Depth = u32Head - m_u32Tail.load(std::memory_order_acquire);
+        if (u32Depth >= N)
+        {
+            m_u32DroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_aItems[u32Head & (N - 1)] = item;
+        m_u32Head.store(u32Head + 1, std::memory_order_release);
+        if (u32Depth + 1 > m_u32MaxDepth.load(std::memory_order_relaxed))
+        {
+            m_u32MaxDepth.store(u32Depth + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side.
+    bool Pop(T &item)
+    {
+        uint32_t u32Tail = m_u32Tail.load(std::memory_order_relaxed);
+        if (u32Tail == m_u32Head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = m_aItems[u32Tail & (N - 1)];
+        m_u32Tail.store(u32Tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, the oldest item, or the one u32Offset places behind it, without taking it.
+    bool Peek(T &item, uint32_t u32Offset = 0) const
+    {
+        uint32_t u32Tail = m_u32Tail.load(std::memory_order_relaxed);
+        if (m_u32Head.load(std::memory_order_acquire) - u32Tail <= u32Offset)
+        {
+            return false;
+        }
+        item = m_aItems[(u32Tail + u32Offset) & (N - 1)];
+        return true;
+    }
+
+    // Either side, a snapshot that may be stale by the time it is used.
+    uint32_t GetDepth() const { return m_u32Head.load(std::memory_order_acquire) - m_u32Tail.load(std::memory_order_acquire); }
+    uint32_t GetMaxDepth() const { return m_u32MaxDepth.load(std::memory_order_relaxed); }
+    uint32_t GetDroppedCount() const { return m_u32DroppedCount.load(std::memory_order_relaxed); }
+    static constexpr size_t GetCapacity() { return N; }
+};
+
+#endif /* __ARTNET_NODE_SPSC_RING_H__ */
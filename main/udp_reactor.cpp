@@ -0,0 +1,232 @@
+#include "udp_reactor.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#else
+#include <time.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <fcntl.h>
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fprintf(stderr, "I %s: " format "\n", tag, ##__VA_ARGS__)
+#endif
+
+static const char *TAG = "UDP-Reactor";
+
+static int64_t GetTimeUs()
+{
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec stNow;
+    clock_gettime(CLOCK_MONOTONIC, &stNow);
+    return stNow.tv_sec * 1000000LL + stNow.tv_nsec / 1000;
+#endif
+}
+
+static void SleepMs(uint32_t u32Ms)
+{
+#ifdef ESP_PLATFORM
+    vTaskDelay(pdMS_TO_TICKS(u32Ms));
+#else
+    usleep(u32Ms * 1000);
+#endif
+}
+
+bool UdpReactor::Open(Entry &stEntry, bool bLog)
+{
+    uint16_t u16Port = stEntry.stEndpoint.u16Port;
+    int32_t s32Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (s32Socket < 0)
+    {
+        if (bLog)
+        {
+            ESP_LOGE(TAG, "Port %d: unable to create socket: errno %d", u16Port, errno);
+        }
+        return false;
+    }
+    // Destination address of each datagram, tells broadcast from unicast.
+    int32_t s32Enable = 1;
+    setsockopt(s32Socket, IPPROTO_IP, IP_PKTINFO, &s32Enable, sizeof(s32Enable));
+    // Only select() blocks, a burst is read until the socket runs dry.
+    fcntl(s32Socket, F_SETFL, fcntl(s32Socket, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in stAddress = {};
+    stAddress.sin_family = AF_INET;
+    stAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    stAddress.sin_port = htons(u16Port);
+    if (bind(s32Socket, (struct sockaddr *)&stAddress, sizeof(stAddress)) < 0)
+    {
+        if (bLog)
+        {
+            ESP_LOGE(TAG, "Port %d: socket unable to bind: errno %d", u16Port, errno);
+        }
+        close(s32Socket);
+        return false;
+    }
+    ESP_LOGI(TAG, "Socket bound, port %d", u16Port);
+    stEntry.s32Socket = s32Socket;
+    stEntry.stEndpoint.fnOpen(s32Socket);
+    return true;
+}
+
+// Opens a closed socket once its retry time has come. Failures back off exponentially and only the
+// 1st, 2nd, 4th, 8th... one in a row is logged.
+bool UdpReactor::Reopen(Entry &stEntry)
+{
+    int64_t s64NowUs = GetTimeUs();
+    if (s64NowUs < stEntry.s64RetryAtUs)
+    {
+        return false;
+    }
+    bool bLog = (stEntry.u32Failures & (stEntry.u32Failures + 1)) == 0;
+    if (Open(stEntry, bLog))
+    {
+        if (stEntry.u32Failures != 0)
+        {
+            ESP_LOGI(TAG, "Port %d: opened after %d failures", stEntry.stEndpoint.u16Port, (int)stEntry.u32Failures);
+        }
+        stEntry.u32Failures = 0;
+        return true;
+    }
+    int64_t s64BackoffMs = std::min<int64_t>((int64_t)PROJECT_UDP_REACTOR_WAKE_MS << std::min<uint32_t>(stEntry.u32Failures, 16),
+                                             PROJECT_UDP_REACTOR_RETRY_MAX_MS);
+    stEntry.u32Failures++;
+    stEntry.s64RetryAtUs = s64NowUs + s64BackoffMs * 1000;
+    if (bLog)
+    {
+        ESP_LOGE(TAG, "Port %d: open failed %d times, next try in %d ms", stEntry.stEndpoint.u16Port, (int)stEntry.u32Failures, (int)s64BackoffMs);
+    }
+    return false;
+}
+
+void UdpReactor::Close(Entry &stEntry)
+{
+    ESP_LOGE(TAG, "Port %d: shutting down socket, reopened on the next wake up", stEntry.stEndpoint.u16Port);
+    shutdown(stEntry.s32Socket, 0);
+    close(stEntry.s32Socket);
+    stEntry.s32Socket = -1;
+    stEntry.stEndpoint.fnOpen(-1);
+}
+
+void UdpReactor::Drain(Entry &stEntry)
+{
+    char aControl[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    for (int32_t i = 0; i < PROJECT_UDP_REACTOR_BURST; ++i)
+    {
+        size_t u32Length = 0;
+        UdpDatagram_t stDatagram = {};
+        struct iovec stIov = {};
+        stIov.iov_base = stEntry.stEndpoint.fnBuffer(u32Length);
+        stIov.iov_len = u32Length;
+        struct msghdr stMsg = {};
+        stMsg.msg_name = &stDatagram.stSource;
+        stMsg.msg_namelen = sizeof(stDatagram.stSource);
+        stMsg.msg_iov = &stIov;
+        stMsg.msg_iovlen = 1;
+        stMsg.msg_control = aControl;
+        stMsg.msg_controllen = sizeof(aControl);
+        int len = recvmsg(stEntry.s32Socket, &stMsg, 0);
+        if (len < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                ESP_LOGE(TAG, "Port %d: recvmsg failed: errno %d", stEntry.stEndpoint.u16Port, errno);
+                Close(stEntry);
+            }
+            return;
+        }
+        if (stDatagram.stSource.sin_family != AF_INET)
+        {
+            continue;
+        }
+        for (struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&stMsg); pCmsg != nullptr; pCmsg = CMSG_NXTHDR(&stMsg, pCmsg))
+        {
+            if (pCmsg->cmsg_level == IPPROTO_IP && pCmsg->cmsg_type == IP_PKTINFO)
+            {
+                stDatagram.u32Destination = ((struct in_pktinfo *)CMSG_DATA(pCmsg))->ipi_addr.s_addr;
+            }
+        }
+        m_u32DatagramCount++;
+        stEntry.stEndpoint.fnHandle(len, stDatagram);
+    }
+}
+
+void UdpReactor::Run()
+{
+    ESP_LOGI(TAG, "UDP Reactor serves %d ports", (int)m_vEntries.size());
+    while (true)
+    {
+        fd_set stReadable;
+        FD_ZERO(&stReadable);
+        int32_t s32MaxSocket = -1;
+        for (Entry &stEntry : m_vEntries)
+        {
+            if (stEntry.s32Socket < 0 && !Reopen(stEntry))
+            {
+                continue;
+            }
+            FD_SET(stEntry.s32Socket, &stReadable);
+            s32MaxSocket = std::max(s32MaxSocket, stEntry.s32Socket);
+        }
+
+        struct timeval stTimeout;
+        stTimeout.tv_sec = PROJECT_UDP_REACTOR_WAKE_MS / 1000;
+        stTimeout.tv_usec = (PROJECT_UDP_REACTOR_WAKE_MS % 1000) * 1000;
+        int32_t s32Ready = select(s32MaxSocket + 1, &stReadable, nullptr, nullptr, &stTimeout);
+        if (s32Ready < 0 && errno != EINTR)
+        {
+            // A select() that keeps failing returns at once, sleep a wake up period instead of spinning on
+            // the network core. Only the 1st, 2nd, 4th, 8th... failure in a row is logged.
+            int32_t s32Errno = errno;
+            m_u32SelectErrorCount++;
+            if ((m_u32SelectFailures & (m_u32SelectFailures + 1)) == 0)
+            {
+                ESP_LOGE(TAG, "select failed %d times: errno %d", (int)m_u32SelectFailures + 1, (int)s32Errno);
+            }
+            m_u32SelectFailures++;
+            SleepMs(PROJECT_UDP_REACTOR_WAKE_MS);
+        }
+        else if (m_u32SelectFailures != 0)
+        {
+            ESP_LOGI(TAG, "select recovered after %d failures", (int)m_u32SelectFailures);
+            m_u32SelectFailures = 0;
+        }
+        m_u32WakeCount++;
+
+        for (Entry &stEntry : m_vEntries)
+        {
+            stEntry.stEndpoint.fnWake();
+            if (s32Ready > 0 && stEntry.s32Socket >= 0 && FD_ISSET(stEntry.s32Socket, &stReadable))
+            {
+                Drain(stEntry);
+            }
+        }
+    }
+}
+
+#ifdef ESP_PLATFORM
+void UdpReactor::FreeRTOSTask(void *pvParameters)
+{
+    UdpReactor::GetInstance().Run();
+    vTaskDelete(NULL);
+}
+#endif
+
+void UdpReactor::SendTo(int32_t s32Socket, const void *pBuffer, size_t u32Length, const struct sockaddr_in &stDestination)
+{
+    if (s32Socket < 0)
+    {
+        return;
+    }
+    int err = sendto(s32Socket, pBuffer, u32Length, 0, (const struct sockaddr *)&stDestination, sizeof(stDestination));
+    if (err < 0)
+    {
+        ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef __ARTNET_NODE_UDP_REACTOR_H__
+#define __ARTNET_NODE_UDP_REACTOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+#include <functional>
+#ifdef ESP_PLATFORM
+#include "lwip/sockets.h"
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+// Longest the reactor sleeps without a datagram, endpoints follow Settings changes on every wake up.
+#ifndef PROJECT_UDP_REACTOR_WAKE_MS
+#define PROJECT_UDP_REACTOR_WAKE_MS 1000
+#endif
+
+// Longest wait between two attempts to open a socket that failed, the wait doubles from
+// PROJECT_UDP_REACTOR_WAKE_MS on every failure.
+#ifndef PROJECT_UDP_REACTOR_RETRY_MAX_MS
+#define PROJECT_UDP_REACTOR_RETRY_MAX_MS 64000
+#endif
+
+// Datagrams read from one socket per wake up before the other sockets get their turn.
+#ifndef PROJECT_UDP_REACTOR_BURST
+#define PROJECT_UDP_REACTOR_BURST 8
+#endif
+
+// Source and destination of one received datagram, only valid while it is handled.
+typedef struct UdpDatagram
+{
+    struct sockaddr_in stSource;
+    uint32_t u32Destination; // network byte order, from IP_PKTINFO, 0 if unknown
+
+    // Dotted source address, acBuffer holds at least 16 bytes.
+    const char *FormatSource(char *acBuffer) const { return inet_ntop(AF_INET, &stSource.sin_addr, acBuffer, 16); }
+} UdpDatagram_t;
+
+typedef struct
+{
+    uint16_t u16Port;
+    std::function<void(int32_t)> fnOpen;                         // socket bound, -1: closed after an error
+    std::function<void()> fnWake;                                // every wake up, before datagrams are handled
+    std::function<char *(size_t &)> fnBuffer;                    // receive buffer and its length
+    std::function<void(size_t, const UdpDatagram_t &)> fnHandle; // datagram of the given length is in the buffer
+} UdpEndpoint_t;
+
+// Serves every UDP port of the node from one task: select() over the sockets, then each readable socket
+// is drained into its endpoint's buffer and handled in place. Plain POSIX sockets, so it builds on a
+// desktop against the same endpoints for testing and benchmarks.
+class UdpReactor
+{
+    typedef struct
+    {
+        UdpEndpoint_t stEndpoint;
+        int32_t s32Socket;
+        uint32_t u32Failures;  // Open() failed in a row
+        int64_t s64RetryAtUs; // no Open() before
+    } Entry;
+
+    std::vector<Entry> m_vEntries;
+    uint32_t m_u32WakeCount;
+    uint32_t m_u32DatagramCount;
+    uint32_t m_u32SelectFailures; // select() failed in a row
+    uint32_t m_u32SelectErrorCount;
+
+    bool Open(Entry &stEntry, bool bLog);
+    bool Reopen(Entry &stEntry);
+    void Close(Entry &stEntry);
+    void Drain(Entry &stEntry);
+
+public:
+    static UdpReactor &GetInstance()
+    {
+        static UdpReactor oIns;
+        return oIns;
+    }
+    UdpReactor() : m_u32WakeCount(0), m_u32DatagramCount(0), m_u32SelectFailures(0), m_u32SelectErrorCount(0) {}
+    // Only before Run() starts.
+    void Register(const UdpEndpoint_t &stEndpoint) { m_vEntries.push_back({stEndpoint, -1, 0, 0}); }
+    // Never returns.
+    void Run();
+#ifdef ESP_PLATFORM
+    static void FreeRTOSTask(void *pvParameters);
+#endif
+    // u32Length bytes to stDestination, errors are logged.
+    static void SendTo(int32_t s32Socket, const void *pBuffer, size_t u32Length, const struct sockaddr_in &stDestination);
+    uint32_t GetWakeCount() const { return m_u32WakeCount; }
+    uint32_t GetDatagramCount() const { return m_u32DatagramCount; }
+    uint32_t GetSelectErrorCount() const { return m_u32SelectErrorCount; }
+};
+
+// Socket, receive buffer and per datagram source of one UDP port served by UdpReactor. TServer implements
+// HandleIncommingMessage(size_t, const UdpDatagram_t &) and CheckHandlers(), and may hide OnOpen(), OnWake()
+// and GetBuffer() with its own. TServer makes this class a friend when those are private.
+template <typename TServer, size_t N>
+class UdpServer
+{
+protected:
+    std::array<char, N> m_aRxBuffer;
+    int32_t m_s32Socket;
+    struct sockaddr_in m_stSource; // of the datagram being handled
+
+    void OnOpen() {}
+    void OnWake() {}
+    char *GetBuffer(size_t &u32Length)
+    {
+        u32Length = m_aRxBuffer.size();
+        return m_aRxBuffer.data();
+    }
+
+public:
+    UdpServer() : m_s32Socket(-1), m_stSource{} {}
+
+    // Handlers must be registered before.
+    void Attach(UdpReactor &oReactor, uint16_t u16Port)
+    {
+        TServer *pServer = static_cast<TServer *>(this);
+        pServer->CheckHandlers();
+        UdpEndpoint_t stEndpoint;
+        stEndpoint.u16Port = u16Port;
+        stEndpoint.fnOpen = [pServer](int32_t s32Socket)
+        {
+            pServer->m_s32Socket = s32Socket;
+            if (s32Socket >= 0)
+            {
+                pServer->OnOpen();
+            }
+        };
+        stEndpoint.fnWake = [pServer]() { pServer->OnWake(); };
+        stEndpoint.fnBuffer = [pServer](size_t &u32Length) { return pServer->GetBuffer(u32Length); };
+        stEndpoint.fnHandle = [pServer](size_t u32Length, const UdpDatagram_t &stDatagram)
+        {
+            pServer->m_stSource = stDatagram.stSource;
+            pServer->HandleIncommingMessage(u32Length, stDatagram);
+        };
+        oReactor.Register(stEndpoint);
+    }
+
+    // To the source of the datagram being handled, i.e. from the handlers inside the reactor task.
+    void Response(const char *pBuffer, size_t u32BufferSize) { UdpReactor::SendTo(m_s32Socket, pBuffer, u32BufferSize, m_stSource); }
+};
+
+#endif /* __ARTNET_NODE_UDP_REACTOR_H__ */
@@ -1,35 +1,109 @@
 #include "udp_server.h"
 #include <esp_log.h>
+#include <algorithm>
+#include <inttypes.h>
+#include "lwip/tcpip.h"
+#include "lwip/netif.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "config.h"
 
 const char * TAG = "UDP-Server";
 
-int32_t ArtNetServer::m_s32Socket = -1;
-sockaddr_storage ArtNetServer::m_stSourceAddress;
-int32_t CommonServer::m_s32Socket = -1;
-sockaddr_storage CommonServer::m_stSourceAddress;
+static size_t CopyFromDatagram(void *pDest, size_t u32Length, void *pvContext)
+{
+    memcpy(pDest, pvContext, u32Length);
+    return u32Length;
+}
+
+char * ArtNetServer::GetBuffer(size_t &u32Length)
+{
+    if (!m_oRxMessage.IsValid())
+    {
+        m_oRxMessage = DMX512MessagePool::GetInstance().Acquire();
+    }
+    u32Length = DMX512Message::GetBufferLength();
+    // Keep draining the socket while every slot is held; those datagrams are dropped.
+    return m_oRxMessage.IsValid() ? m_oRxMessage.GetBuffer() : m_aRxBuffer.data();
+}
 
-void ArtNetServer::HandleIncommingMessage(size_t msgLength, char * senderIP)
+void ArtNetServer::HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram)
 {
-    if (msgLength < 10)
+    if (!m_oRxMessage.IsValid())
+    {
+        ESP_LOGD(TAG, "Drop ArtNet Message, DMX message pool exhausted");
+        return;
+    }
+    char * pBuffer = m_oRxMessage.GetBuffer();
+    ArtNet::Packet oPacket;
+    ArtNet::ParseResult eResult = oPacket.Parse(pBuffer, msgLength, msgLength);
+    m_oParseStats.Add(eResult);
+    if (eResult != ArtNet::PARSE_OK)
     {
-        ESP_LOGD(TAG, "Receive Artnet Message with length less than 10");
+        ESP_LOGD(TAG, "Drop invalid ArtNet Message, reason %d", eResult);
         return;
     }
-    int16_t op_code = m_aRxBuffer.data()[9] << 8 | m_aRxBuffer.data()[8];
-    switch (op_code)
+    // recvmsg() has copied the whole datagram by now. Filtering earlier would mean a hook in the tcpip
+    // thread sharing the token buckets with this task; builds that need the copy saved use the raw pcb,
+    // PROJECT_ARTNET_RAW_UDP_RECEIVE, which filters on the pbuf header.
+    if (!m_oFilter.Accept(oPacket, stDatagram.stSource.sin_addr.s_addr))
     {
-    case 0x5000:
-        m_oDMXHandler(m_aRxBuffer.data(), msgLength, senderIP);
+        // The pool slot is reused for the next datagram.
+        return;
+    }
+    char senderIP[16];
+    stDatagram.FormatSource(senderIP);
+    switch (oPacket.GetOpCode())
+    {
+    case ArtNet::OP_DMX:
+        // Broadcast ArtDmx means the controller has not switched this node to unicast yet.
+        if (netif_default && ip4_addr_isbroadcast_u32(stDatagram.u32Destination, netif_default))
+        {
+            m_u32BroadcastDmxCount++;
+        }
+        else
+        {
+            m_u32UnicastDmxCount++;
+        }
+        // Handler may keep a copy of the handle, the slot is then owned by the ports.
+        m_oDMXHandler(m_oRxMessage, oPacket, senderIP);
+        m_oRxMessage.Reset();
+        break;
+    case ArtNet::OP_SYNC:
+        m_oArtSyncHandler(pBuffer, msgLength, senderIP);
+        break;
+    case ArtNet::OP_CONFIG:
+        m_oDiscoveryHandler(pBuffer, msgLength, senderIP);
         break;
-    case 0x5200:
-        m_oArtSyncHandler(m_aRxBuffer.data(), msgLength, senderIP);
+    case ArtNet::OP_POLL:
+        m_oPollHandler(pBuffer, msgLength, senderIP);
         break;
-    case 0x2009:
-        m_oDiscoveryHandler(m_aRxBuffer.data(), msgLength, senderIP);
+    case ArtNet::OP_FEC:
+        m_oFecHandler(pBuffer, msgLength, senderIP);
         break;
+    case ArtNet::OP_DMX_BATCH:
+    {
+        // Each universe is routed from the receive buffer, the slot is free again afterwards.
+        m_u32BatchCount++;
+        const uint8_t *pData = (const uint8_t *)pBuffer;
+        size_t u32Offset = ArtNet::OFFSET_BATCH_ENTRIES;
+        for (uint8_t i = 0; i < oPacket.GetBatchCount(); ++i)
+        {
+            ArtNet::BatchEntry stEntry;
+            if (!ArtNet::ReadBatchEntry(pData + u32Offset, msgLength - u32Offset, stEntry))
+            {
+                m_u32BatchMalformedCount++;
+                break;
+            }
+            u32Offset += ArtNet::BATCH_ENTRY_HEADER_LENGTH;
+            m_oDMXPayloadHandler(stEntry.s32PortAddress, stEntry.u8Sequence, stEntry.u16Length, CopyFromDatagram, (void *)(pData + u32Offset));
+            u32Offset += stEntry.u16Length;
+            m_u32BatchUniverseCount++;
+        }
+    }
+    break;
     default:
-        ESP_LOGD(TAG, "Receive ArtNet Message with unsupported OPCODE '0x%04X'", op_code);
+        ESP_LOGD(TAG, "Receive ArtNet Message with unhandled OPCODE '0x%04X'", oPacket.GetOpCode());
         break;
     }
 }
@@ -38,8 +112,11 @@ void ArtNetServer::CheckHandlers()
 {
     bool init = true;
     init &= (bool)m_oDMXHandler;
+    init &= (bool)m_oDMXPayloadHandler;
     init &= (bool)m_oArtSyncHandler;
     init &= (bool)m_oDiscoveryHandler;
+    init &= (bool)m_oPollHandler;
+    init &= (bool)m_oFecHandler;
     if (!init)
     {
         ESP_LOGE(TAG, "All handlers must be registered");
@@ -47,89 +124,243 @@ void ArtNetServer::CheckHandlers()
     }
 }
 
-void ArtNetServer::FreeRTOSTask(void *pvParameters)
+void ArtNetServer::SendTo(const uint8_t * pBuffer, size_t u32BufferSize, uint32_t u32Ip)
 {
-    ESP_LOGI(TAG, "UDP Server ArtNet Task starts");
+    struct sockaddr_in stDestination = {};
+    stDestination.sin_family = AF_INET;
+    stDestination.sin_addr.s_addr = u32Ip;
+    stDestination.sin_port = htons(PROJECT_UDP_ARTNET_PORT);
+    UdpReactor::SendTo(m_s32Socket, pBuffer, u32BufferSize, stDestination);
+}
 
-    char addr_str[128];
-    struct sockaddr_in dest_addr = {}; // IPv4
-    dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(PROJECT_UDP_ARTNET_PORT); // To read later: __builtin_bswap16
+typedef struct
+{
+    const struct pbuf *pBuf;
+    u16_t u16Offset;
+} RawPayload_t;
 
-    ArtNetServer::GetInstance().CheckHandlers();
+void ArtNetRawServer::CheckHandlers()
+{
+    bool init = true;
+    init &= (bool)m_oDMXPayloadHandler;
+    init &= (bool)m_oArtSyncHandler;
+    init &= (bool)m_oDiscoveryHandler;
+    init &= (bool)m_oPollHandler;
+    init &= (bool)m_oFecHandler;
+    if (!init)
+    {
+        ESP_LOGE(TAG, "All handlers must be registered");
+        ESP_ERROR_CHECK(ESP_ERR_NOT_FOUND);
+    }
+}
 
-    while (true)
+esp_err_t ArtNetRawServer::Start()
+{
+    CheckHandlers();
+    // The raw API is not thread safe, create the pcb from the tcpip thread.
+    if (tcpip_callback(&ArtNetRawServer::Bind, this) != ERR_OK)
     {
-        m_s32Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-        if (m_s32Socket < 0)
-        {
-            ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-            break;
-        }
-        ESP_LOGI(TAG, "Socket created");
+        ESP_LOGE(TAG, "Unable to schedule raw pcb creation");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
 
-        // Set timeout
-        struct timeval timeout;
-        timeout.tv_sec = 3600;
-        timeout.tv_usec = 0;
-        setsockopt(m_s32Socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+void ArtNetRawServer::Bind(void *pvContext)
+{
+    ArtNetRawServer *pServer = (ArtNetRawServer *)pvContext;
+    pServer->m_pPcb = udp_new();
+    if (pServer->m_pPcb == nullptr)
+    {
+        ESP_LOGE(TAG, "Unable to create raw pcb");
+        return;
+    }
+    err_t err = udp_bind(pServer->m_pPcb, IP_ADDR_ANY, PROJECT_UDP_ARTNET_PORT);
+    if (err != ERR_OK)
+    {
+        ESP_LOGE(TAG, "Raw pcb unable to bind: err %d", err);
+        udp_remove(pServer->m_pPcb);
+        pServer->m_pPcb = nullptr;
+        return;
+    }
+    udp_recv(pServer->m_pPcb, &ArtNetRawServer::Receive, pServer);
+    ESP_LOGI(TAG, "Raw pcb bound, port %d", PROJECT_UDP_ARTNET_PORT);
+}
 
-        int err = bind(m_s32Socket, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-        if (err < 0)
-        {
-            ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
-        }
-        ESP_LOGI(TAG, "Socket bound, port %d", PROJECT_UDP_ARTNET_PORT);
+void ArtNetRawServer::Receive(void *pvArg, struct udp_pcb *pPcb, struct pbuf *pBuf, const ip_addr_t *pAddr, u16_t u16Port)
+{
+    ArtNetRawServer *pServer = (ArtNetRawServer *)pvArg;
+    pServer->m_stSourceAddress = *pAddr;
+    pServer->m_u16SourcePort = u16Port;
+    pServer->HandleIncommingMessage(pBuf, pAddr);
+    pbuf_free(pBuf);
+}
 
-        socklen_t socklen = sizeof(m_stSourceAddress);
+size_t ArtNetRawServer::CopyPayload(void *pDest, size_t u32Length, void *pvContext)
+{
+    RawPayload_t *pPayload = (RawPayload_t *)pvContext;
+    return pbuf_copy_partial(pPayload->pBuf, pDest, u32Length, pPayload->u16Offset);
+}
 
-        while (true)
+void ArtNetRawServer::HandleIncommingMessage(struct pbuf *pBuf, const ip_addr_t *pAddr)
+{
+    uint8_t au8Header[ArtNet::OFFSET_DMX_DATA];
+    size_t u32HeaderLength = pbuf_copy_partial(pBuf, au8Header, sizeof(au8Header), 0);
+    ArtNet::Packet oPacket;
+    ArtNet::ParseResult eResult = oPacket.Parse(au8Header, u32HeaderLength, pBuf->tot_len);
+    m_oParseStats.Add(eResult);
+    if (eResult != ArtNet::PARSE_OK)
+    {
+        ESP_LOGD(TAG, "Drop invalid ArtNet Message, reason %d", eResult);
+        return;
+    }
+    if (!m_oFilter.Accept(oPacket, ip4_addr_get_u32(ip_2_ip4(pAddr))))
+    {
+        return;
+    }
+    char senderIP[16];
+    ipaddr_ntoa_r(pAddr, senderIP, sizeof(senderIP));
+    switch (oPacket.GetOpCode())
+    {
+    case ArtNet::OP_DMX:
+    {
+        // Broadcast ArtDmx means the controller has not switched this node to unicast yet.
+        if (ip_addr_isbroadcast(ip_current_dest_addr(), ip_current_netif()))
         {
-            char * buffer = ArtNetServer::GetInstance().GetBuffer();
-            size_t bufferlen = ArtNetServer::GetInstance().GetBufferLength() - 1;
-            int len = recvfrom(m_s32Socket, buffer, bufferlen, 0, (struct sockaddr *)&m_stSourceAddress, &socklen);
-            // Error occurred during receiving
-            if (len < 0)
+            m_u32BroadcastDmxCount++;
+        }
+        else
+        {
+            m_u32UnicastDmxCount++;
+        }
+        RawPayload_t stPayload = {pBuf, ArtNet::OFFSET_DMX_DATA};
+        m_u64BytesCopied += m_oDMXPayloadHandler(oPacket.GetPortAddress(), oPacket.GetSequence(), oPacket.GetDmxLength(), &ArtNetRawServer::CopyPayload, &stPayload);
+        m_u32PacketCount++;
+    }
+    break;
+    case ArtNet::OP_DMX_BATCH:
+    {
+        // Entry headers are copied out one at a time, payloads go straight from the pbuf chain.
+        m_u32BatchCount++;
+        size_t u32Offset = ArtNet::OFFSET_BATCH_ENTRIES;
+        for (uint8_t i = 0; i < oPacket.GetBatchCount(); ++i)
+        {
+            uint8_t au8Entry[ArtNet::BATCH_ENTRY_HEADER_LENGTH];
+            size_t u32EntryLength = pbuf_copy_partial(pBuf, au8Entry, sizeof(au8Entry), u32Offset);
+            ArtNet::BatchEntry stEntry;
+            if (u32EntryLength < sizeof(au8Entry) || !ArtNet::ReadBatchEntry(au8Entry, pBuf->tot_len - u32Offset, stEntry))
             {
-                ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+                m_u32BatchMalformedCount++;
                 break;
             }
-            // Data received
-            else if (m_stSourceAddress.ss_family == PF_INET)
-            {
-                // Get the sender's ip address as string
-                inet_ntoa_r(((struct sockaddr_in *)&m_stSourceAddress)->sin_addr, addr_str, sizeof(addr_str) - 1);
-                ArtNetServer::GetInstance().HandleIncommingMessage(len, addr_str);
-            }
+            u32Offset += ArtNet::BATCH_ENTRY_HEADER_LENGTH;
+            RawPayload_t stPayload = {pBuf, (u16_t)u32Offset};
+            m_u64BytesCopied += m_oDMXPayloadHandler(stEntry.s32PortAddress, stEntry.u8Sequence, stEntry.u16Length, &ArtNetRawServer::CopyPayload, &stPayload);
+            u32Offset += stEntry.u16Length;
+            m_u32BatchUniverseCount++;
         }
-
-        if (m_s32Socket != -1)
+    }
+    break;
+    case ArtNet::OP_SYNC:
+    case ArtNet::OP_CONFIG:
+    case ArtNet::OP_POLL:
+    case ArtNet::OP_FEC:
+    {
+        // Rare control traffic and parity, hand the handlers a linear copy.
+        DMX512Message oMessage = DMX512MessagePool::GetInstance().Acquire();
+        if (!oMessage.IsValid())
+        {
+            ESP_LOGD(TAG, "Drop ArtNet Message, DMX message pool exhausted");
+            return;
+        }
+        size_t u32Length = pbuf_copy_partial(pBuf, oMessage.GetBuffer(), oMessage.GetBufferLength(), 0);
+        if (oPacket.GetOpCode() == ArtNet::OP_SYNC)
+        {
+            m_oArtSyncHandler(oMessage.GetBuffer(), u32Length, senderIP);
+        }
+        else if (oPacket.GetOpCode() == ArtNet::OP_POLL)
+        {
+            m_oPollHandler(oMessage.GetBuffer(), u32Length, senderIP);
+        }
+        else if (oPacket.GetOpCode() == ArtNet::OP_FEC)
+        {
+            m_oFecHandler(oMessage.GetBuffer(), u32Length, senderIP);
+        }
+        else
         {
-            ESP_LOGE(TAG, "Shutting down socket and restarting...");
-            shutdown(m_s32Socket, 0);
-            close(m_s32Socket);
+            m_oDiscoveryHandler(oMessage.GetBuffer(), u32Length, senderIP);
         }
     }
+    break;
+    default:
+        ESP_LOGD(TAG, "Receive ArtNet Message with unhandled OPCODE '0x%04X'", oPacket.GetOpCode());
+        break;
+    }
+}
+
+void ArtNetRawServer::Response(const char *pBuffer, size_t u32BufferSize)
+{
+    struct pbuf *pBuf = pbuf_alloc(PBUF_TRANSPORT, u32BufferSize, PBUF_RAM);
+    if (pBuf == nullptr)
+    {
+        ESP_LOGE(TAG, "Error occurred during sending: out of pbuf");
+        return;
+    }
+    pbuf_take(pBuf, pBuffer, u32BufferSize);
+    err_t err = udp_sendto(m_pPcb, pBuf, &m_stSourceAddress, m_u16SourcePort);
+    if (err != ERR_OK)
+    {
+        ESP_LOGE(TAG, "Error occurred during sending: err %d", err);
+    }
+    pbuf_free(pBuf);
 }
 
-void ArtNetServer::Response(const char * pBuffer, size_t u32BufferSize)
+void ArtNetRawServer::SendTo(const uint8_t *pBuffer, size_t u32BufferSize, uint32_t u32Ip)
 {
-    int err = sendto(m_s32Socket, pBuffer, u32BufferSize, 0, (struct sockaddr *)&m_stSourceAddress, sizeof(m_stSourceAddress));
-    if (err < 0) {
-        ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
+    if (m_pPcb == nullptr)
+    {
+        return;
+    }
+    struct pbuf *pBuf = pbuf_alloc(PBUF_TRANSPORT, u32BufferSize, PBUF_RAM);
+    if (pBuf == nullptr)
+    {
+        ESP_LOGE(TAG, "Error occurred during sending: out of pbuf");
+        return;
     }
+    pbuf_take(pBuf, pBuffer, u32BufferSize);
+    ip_addr_t stDestination = IPADDR4_INIT(u32Ip);
+    err_t err = udp_sendto(m_pPcb, pBuf, &stDestination, PROJECT_UDP_ARTNET_PORT);
+    if (err != ERR_OK)
+    {
+        ESP_LOGE(TAG, "Error occurred during sending: err %d", err);
+    }
+    pbuf_free(pBuf);
 }
 
-void CommonServer::HandleIncommingMessage(size_t msgLength, char * senderIP)
+SacnServer::SacnServer()
 {
-    m_oMessageHandler(m_aRxBuffer.data(), msgLength, senderIP);
+    m_s32BaseUniv = 0;
+    m_u16SyncUniverse = 0;
+    m_bSyncUniverseChanged = false;
+    m_u32SettingsRevision = 0;
+    m_u32LowerPriorityCount = 0;
+    m_u32OutOfOrderCount = 0;
+    m_u32SourceChangeCount = 0;
+    m_u32PreviewCount = 0;
+    m_u32SyncCount = 0;
+    m_u32JoinFailedCount = 0;
+    for (auto &stSource : m_aSources)
+    {
+        stSource.u16Universe = 0;
+        stSource.bHasSource = false;
+    }
 }
 
-void CommonServer::CheckHandlers()
+void SacnServer::CheckHandlers()
 {
     bool init = true;
-    init &= (bool)m_oMessageHandler;
+    init &= (bool)m_oDMXPayloadHandler;
+    init &= (bool)m_oSyncHandler;
     if (!init)
     {
         ESP_LOGE(TAG, "All handlers must be registered");
@@ -137,76 +368,496 @@ void CommonServer::CheckHandlers()
     }
 }
 
-void CommonServer::FreeRTOSTask(void *pvParameters)
+void SacnServer::UpdateUniverses()
 {
-    ESP_LOGI(TAG, "UDP Server Common Task starts");
+    const Settings &oSettings = Settings::GetInstance();
+    m_u32SettingsRevision = oSettings.GetRevision();
+    m_s32BaseUniv = INT32_MAX;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        if (oSettings.GetStartUniverse(i) >= E131::MINIMUM_UNIVERSE && oSettings.GetNoUniverses(i) > 0)
+        {
+            m_s32BaseUniv = std::min(m_s32BaseUniv, oSettings.GetStartUniverse(i));
+        }
+    }
 
-    char addr_str[128];
-    struct sockaddr_in dest_addr = {}; // IPv4
-    dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(PROJECT_UDP_COMMON_PORT); // To read later: __builtin_bswap16
+    for (auto &stSource : m_aSources)
+    {
+        stSource.u16Universe = 0;
+        stSource.bHasSource = false;
+    }
+    // sACN universes map one to one onto the Art-Net universes of the ports; universe 0 does not exist in E1.31.
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        for (int32_t j = 0; j < oSettings.GetNoUniverses(i); ++j)
+        {
+            int32_t s32Univ = oSettings.GetStartUniverse(i) + j;
+            uint32_t u32Slot = s32Univ - m_s32BaseUniv;
+            if (s32Univ < E131::MINIMUM_UNIVERSE || s32Univ > E131::MAXIMUM_UNIVERSE || u32Slot >= m_aSources.size())
+            {
+                continue;
+            }
+            m_aSources[u32Slot].u16Universe = s32Univ;
+        }
+    }
+}
 
-    CommonServer::GetInstance().CheckHandlers();
+bool SacnServer::SetMembership(uint16_t u16Universe, bool bJoin)
+{
+    struct ip_mreq stRequest = {};
+    stRequest.imr_multiaddr.s_addr = E131::MulticastAddress(u16Universe);
+    stRequest.imr_interface.s_addr = htonl(INADDR_ANY);
+    int err = setsockopt(m_s32Socket, IPPROTO_IP, bJoin ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP, &stRequest, sizeof(stRequest));
+    if (err < 0)
+    {
+        ESP_LOGE(TAG, "Unable to %s sACN universe %u: errno %d", bJoin ? "join" : "leave", u16Universe, errno);
+        return false;
+    }
+    return true;
+}
 
-    while (true)
+void SacnServer::UpdateMemberships()
+{
+    std::vector<uint16_t> vWanted;
+    for (const auto &stSource : m_aSources)
     {
-        m_s32Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-        if (m_s32Socket < 0)
+        if (stSource.u16Universe != 0)
         {
-            ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-            break;
+            vWanted.push_back(stSource.u16Universe);
         }
-        ESP_LOGI(TAG, "Socket created");
+    }
+    if (m_u16SyncUniverse != 0)
+    {
+        vWanted.push_back(m_u16SyncUniverse);
+    }
+    std::sort(vWanted.begin(), vWanted.end());
+    vWanted.erase(std::unique(vWanted.begin(), vWanted.end()), vWanted.end());
 
-        // Set timeout
-        struct timeval timeout;
-        timeout.tv_sec = 3600;
-        timeout.tv_usec = 0;
-        setsockopt(m_s32Socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    // Leave first, lwIP has a small pool of IGMP groups.
+    std::vector<uint16_t> vJoined;
+    for (uint16_t u16Universe : m_vJoined)
+    {
+        if (!std::binary_search(vWanted.begin(), vWanted.end(), u16Universe) && SetMembership(u16Universe, false))
+        {
+            continue;
+        }
+        vJoined.push_back(u16Universe);
+    }
+    for (uint16_t u16Universe : vWanted)
+    {
+        if (std::binary_search(m_vJoined.begin(), m_vJoined.end(), u16Universe))
+        {
+            continue;
+        }
+        if (SetMembership(u16Universe, true))
+        {
+            vJoined.push_back(u16Universe);
+        }
+        else
+        {
+            // Still reachable by unicast.
+            m_u32JoinFailedCount++;
+        }
+    }
+    std::sort(vJoined.begin(), vJoined.end());
+    m_vJoined = vJoined;
+    m_bSyncUniverseChanged = false;
+    ESP_LOGI(TAG, "Member of %d sACN multicast groups", (int)m_vJoined.size());
+}
 
-        int err = bind(m_s32Socket, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-        if (err < 0)
+bool SacnServer::AcceptSource(UniverseSource &stSource, const E131::Packet &oPacket)
+{
+    int64_t s64NowUs = esp_timer_get_time();
+    bool bTerminated = oPacket.GetOptions() & E131::OPTION_STREAM_TERMINATED;
+    if (!stSource.bHasSource || memcmp(stSource.aCid.data(), oPacket.GetCid(), E131::CID_LENGTH) != 0)
+    {
+        // Another source only takes the universe over with a higher priority or once the owner went silent.
+        bool bExpired = !stSource.bHasSource || s64NowUs - stSource.s64LastUs > PROJECT_SACN_SOURCE_TIMEOUT_MS * 1000LL;
+        if (bTerminated || (!bExpired && oPacket.GetPriority() <= stSource.u8Priority))
         {
-            ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
+            m_u32LowerPriorityCount++;
+            return false;
         }
-        ESP_LOGI(TAG, "Socket bound, port %d", PROJECT_UDP_COMMON_PORT);
+        memcpy(stSource.aCid.data(), oPacket.GetCid(), E131::CID_LENGTH);
+        stSource.bHasSource = true;
+        m_u32SourceChangeCount++;
+    }
+    else if (bTerminated)
+    {
+        stSource.bHasSource = false;
+        return false;
+    }
+    else
+    {
+        // E1.31 6.7.2: a packet up to 20 sequence numbers behind the newest one is out of order.
+        int8_t s8Distance = oPacket.GetSequence() - stSource.u8LastSequence;
+        if (s8Distance <= 0 && s8Distance > -20)
+        {
+            m_u32OutOfOrderCount++;
+            return false;
+        }
+    }
+    stSource.u8Priority = oPacket.GetPriority();
+    stSource.u8LastSequence = oPacket.GetSequence();
+    stSource.s64LastUs = s64NowUs;
+    return true;
+}
 
-        socklen_t socklen = sizeof(m_stSourceAddress);
+void SacnServer::HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram)
+{
+    E131::Packet oPacket;
+    E131::ParseResult eResult = oPacket.Parse(m_aRxBuffer.data(), msgLength);
+    m_oParseStats.Add(eResult);
+    if (eResult != E131::PARSE_OK)
+    {
+        ESP_LOGD(TAG, "Drop invalid sACN Message, reason %d", eResult);
+        return;
+    }
 
-        while (true)
+    if (oPacket.GetType() == E131::PACKET_SYNC)
+    {
+        if (m_u16SyncUniverse != 0 && oPacket.GetSyncUniverse() == m_u16SyncUniverse)
         {
-            char * buffer = CommonServer::GetInstance().GetBuffer();
-            size_t bufferlen = CommonServer::GetInstance().GetBufferLength() - 1;
-            int len = recvfrom(m_s32Socket, buffer, bufferlen, 0, (struct sockaddr *)&m_stSourceAddress, &socklen);
-            // Error occurred during receiving
-            if (len < 0)
-            {
-                ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
-                break;
-            }
-            // Data received
-            else if (m_stSourceAddress.ss_family == PF_INET)
-            {
-                // Get the sender's ip address as string
-                inet_ntoa_r(((struct sockaddr_in *)&m_stSourceAddress)->sin_addr, addr_str, sizeof(addr_str) - 1);
-                CommonServer::GetInstance().HandleIncommingMessage(len, addr_str);
-            }
+            m_u32SyncCount++;
+            char senderIP[16];
+            m_oSyncHandler(m_aRxBuffer.data(), msgLength, stDatagram.FormatSource(senderIP));
         }
+        return;
+    }
+
+    uint16_t u16Universe = oPacket.GetUniverse();
+    uint32_t u32Slot = u16Universe - m_s32BaseUniv;
+    if (u32Slot >= m_aSources.size() || m_aSources[u32Slot].u16Universe != u16Universe)
+    {
+        // Unicast to a universe this node does not own.
+        return;
+    }
+    if (oPacket.GetOptions() & E131::OPTION_PREVIEW_DATA)
+    {
+        m_u32PreviewCount++;
+        return;
+    }
+    if (!AcceptSource(m_aSources[u32Slot], oPacket))
+    {
+        return;
+    }
+    if (oPacket.GetSyncAddress() != m_u16SyncUniverse)
+    {
+        m_u16SyncUniverse = oPacket.GetSyncAddress();
+        m_bSyncUniverseChanged = true;
+    }
+    // The sequence was checked per source above, 0 keeps Ports from checking it as ArtDmx.
+    m_oDMXPayloadHandler(u16Universe, 0, oPacket.GetDmxLength(), CopyFromDatagram, (void *)oPacket.GetDmxData());
+}
+
+void SacnServer::OnOpen()
+{
+    // A new socket has no memberships yet.
+    m_vJoined.clear();
+    UpdateUniverses();
+    UpdateMemberships();
+}
 
-        if (m_s32Socket != -1)
+void SacnServer::OnWake()
+{
+    if (m_s32Socket < 0)
+    {
+        return;
+    }
+    if (m_u32SettingsRevision != Settings::GetInstance().GetRevision())
+    {
+        UpdateUniverses();
+        UpdateMemberships();
+    }
+    else if (m_bSyncUniverseChanged)
+    {
+        UpdateMemberships();
+    }
+}
+
+cJSON *SacnServer::ToJson()
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddItemToObject(json, "Parse", m_oParseStats.ToJson());
+    cJSON_AddNumberToObject(json, "Groups", m_vJoined.size());
+    cJSON_AddNumberToObject(json, "JoinFailed", m_u32JoinFailedCount);
+    cJSON_AddNumberToObject(json, "SyncUniverse", m_u16SyncUniverse);
+    cJSON_AddNumberToObject(json, "Syncs", m_u32SyncCount);
+    cJSON_AddNumberToObject(json, "LowerPriority", m_u32LowerPriorityCount);
+    cJSON_AddNumberToObject(json, "OutOfOrder", m_u32OutOfOrderCount);
+    cJSON_AddNumberToObject(json, "SourceChanges", m_u32SourceChangeCount);
+    cJSON_AddNumberToObject(json, "Preview", m_u32PreviewCount);
+    return json;
+}
+
+void DdpServer::CheckHandlers()
+{
+    bool init = true;
+    init &= (bool)m_oPayloadHandler;
+    init &= (bool)m_oPushHandler;
+    if (!init)
+    {
+        ESP_LOGE(TAG, "All handlers must be registered");
+        ESP_ERROR_CHECK(ESP_ERR_NOT_FOUND);
+    }
+}
+
+void DdpServer::HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram)
+{
+    DDP::Packet oPacket;
+    DDP::ParseResult eResult = oPacket.Parse(m_aRxBuffer.data(), msgLength);
+    m_oParseStats.Add(eResult);
+    if (eResult != DDP::PARSE_OK)
+    {
+        ESP_LOGD(TAG, "Drop invalid DDP Message, reason %d", eResult);
+        return;
+    }
+
+    // Sequences run 1..15 then wrap to 1, gaps are only counted, DDP has no ordering rule.
+    uint8_t u8Sequence = oPacket.GetSequence();
+    if (u8Sequence != 0)
+    {
+        if (m_u8LastSequence != 0 && u8Sequence != m_u8LastSequence % 15 + 1)
         {
-            ESP_LOGE(TAG, "Shutting down socket and restarting...");
-            shutdown(m_s32Socket, 0);
-            close(m_s32Socket);
+            m_u32SequenceGapCount++;
         }
+        m_u8LastSequence = u8Sequence;
     }
+
+    if (oPacket.GetDataLength() > 0)
+    {
+        m_u32PacketCount++;
+        m_u64BytesCopied += m_oPayloadHandler(oPacket.GetDataOffset(), oPacket.GetDataLength(), CopyFromDatagram, (void *)oPacket.GetData());
+    }
+    // The push applies to this packet's data as well.
+    if (oPacket.IsPush())
+    {
+        m_u32PushCount++;
+        char senderIP[16];
+        m_oPushHandler(m_aRxBuffer.data(), msgLength, stDatagram.FormatSource(senderIP));
+    }
+}
+
+cJSON *DdpServer::ToJson()
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddItemToObject(json, "Parse", m_oParseStats.ToJson());
+    cJSON_AddNumberToObject(json, "DataPackets", m_u32PacketCount);
+    cJSON_AddNumberToObject(json, "BytesCopied", m_u64BytesCopied);
+    cJSON_AddNumberToObject(json, "Pushes", m_u32PushCount);
+    // Against 6 ArtDmx per 1020 pixel port.
+    cJSON_AddNumberToObject(json, "PacketsPerPush", m_u32PushCount ? (double)m_u32PacketCount / m_u32PushCount : 0);
+    cJSON_AddNumberToObject(json, "SequenceGaps", m_u32SequenceGapCount);
+    return json;
+}
+
+DeltaStreamServer::DeltaStreamServer()
+{
+    for (auto &stStream : m_aStreams)
+    {
+        stStream = {};
+    }
+    m_u32PacketCount = 0;
+    m_u64PacketBytes = 0;
+    m_u32KeyFrameCount = 0;
+    m_u32DeltaFrameCount = 0;
+    m_u64FrameBytes = 0;
+    m_u32InvalidCount = 0;
+    m_u32StaleCount = 0;
+    m_u32DuplicateCount = 0;
+    m_u32IncompleteCount = 0;
+    m_u32BaseMismatchCount = 0;
+    m_u32KeyRequestCount = 0;
 }
 
-void CommonServer::Response(const char * pBuffer, size_t u32BufferSize)
+void DeltaStreamServer::CheckHandlers()
 {
-    int err = sendto(m_s32Socket, pBuffer, u32BufferSize, 0, (struct sockaddr *)&m_stSourceAddress, sizeof(m_stSourceAddress));
-    if (err < 0) {
-        ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
+    bool init = true;
+    init &= (bool)m_oFrameHandler;
+    if (!init)
+    {
+        ESP_LOGE(TAG, "All handlers must be registered");
+        ESP_ERROR_CHECK(ESP_ERR_NOT_FOUND);
+    }
+}
+
+bool DeltaStreamServer::PrepareStream(PortStream &stStream, int32_t s32Port)
+{
+    int32_t s32LedCount = Settings::GetInstance().GetLedCount(s32Port);
+    size_t u32Pixels = std::max<int32_t>(std::min<int32_t>(s32LedCount, PROJECT_MAXIMUM_NUMBER_OF_LEDS_PER_PORT), 0);
+    if (stStream.pReference != nullptr && stStream.u32Pixels == u32Pixels)
+    {
+        return true;
+    }
+    // First use of the port, or its led count changed: the base frame is gone either way.
+    heap_caps_free(stStream.pReference);
+    stStream = {};
+    if (u32Pixels == 0)
+    {
+        return false;
+    }
+    stStream.pReference = (uint8_t *)heap_caps_calloc(1, u32Pixels * 3, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (stStream.pReference == nullptr)
+    {
+        ESP_LOGE(TAG, "Port %" PRId32 ": No memory for %zu bytes stream base frame", s32Port, u32Pixels * 3);
+        return false;
+    }
+    stStream.u32Pixels = u32Pixels;
+    return true;
+}
+
+void DeltaStreamServer::RequestKeyFrame(PortStream &stStream, int32_t s32Port, uint16_t u16Sequence)
+{
+    int64_t s64NowUs = esp_timer_get_time();
+    if (stStream.s64LastKeyRequestUs != 0 && s64NowUs - stStream.s64LastKeyRequestUs < PROJECT_DELTA_STREAM_KEY_REQUEST_INTERVAL_MS * 1000LL)
+    {
+        return;
+    }
+    stStream.s64LastKeyRequestUs = s64NowUs;
+
+    DeltaStream::Header stHeader = {};
+    stHeader.u8Type = DeltaStream::TYPE_KEY_REQUEST;
+    stHeader.u8Port = s32Port;
+    stHeader.u16Sequence = u16Sequence;
+    stHeader.u16BaseSequence = stStream.u16Sequence;
+    stHeader.u8Count = 1;
+    std::array<uint8_t, DeltaStream::HEADER_LENGTH> aRequest;
+    DeltaStream::WriteHeader(stHeader, aRequest.data());
+    // Back to wherever the stream comes from, the sender or a relay.
+    Response((const char *)aRequest.data(), aRequest.size());
+    m_u32KeyRequestCount++;
+}
+
+void DeltaStreamServer::HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram)
+{
+    DeltaStream::Header stHeader;
+    if (!DeltaStream::ReadHeader((const uint8_t *)m_aRxBuffer.data(), msgLength, stHeader) || stHeader.u8Type == DeltaStream::TYPE_KEY_REQUEST ||
+        stHeader.u8Port >= PROJECT_NUMBER_OF_PORTS)
+    {
+        m_u32InvalidCount++;
+        return;
+    }
+    m_u32PacketCount++;
+    m_u64PacketBytes += msgLength;
+
+    int32_t s32Port = stHeader.u8Port;
+    PortStream &stStream = m_aStreams[s32Port];
+    if (!PrepareStream(stStream, s32Port))
+    {
+        return;
+    }
+    bool bKey = stHeader.u8Type == DeltaStream::TYPE_KEY;
+
+    if (stStream.bAssembling && stHeader.u16Sequence != stStream.u16AssemblySequence)
+    {
+        if (DeltaStream::IsStale(stHeader.u16Sequence, stStream.u16AssemblySequence))
+        {
+            m_u32StaleCount++;
+            return;
+        }
+        // A newer frame started before this one completed, the base frame is now partly updated.
+        stStream.bAssembling = false;
+        stStream.bValid = false;
+        m_u32IncompleteCount++;
+    }
+    if (!stStream.bAssembling)
+    {
+        if (stStream.bValid && DeltaStream::IsStale(stHeader.u16Sequence, stStream.u16Sequence))
+        {
+            m_u32StaleCount++;
+            return;
+        }
+        if (!bKey && (!stStream.bValid || stHeader.u16BaseSequence != stStream.u16Sequence))
+        {
+            m_u32BaseMismatchCount++;
+            RequestKeyFrame(stStream, s32Port, stHeader.u16Sequence);
+            return;
+        }
+        stStream.bAssembling = true;
+        stStream.bAssemblingKey = bKey;
+        stStream.bValid = false;
+        stStream.u16AssemblySequence = stHeader.u16Sequence;
+        stStream.u8Count = stHeader.u8Count;
+        stStream.u32ReceivedMask = 0;
+    }
+
+    uint32_t u32Bit = 1UL << stHeader.u8Index;
+    if (stHeader.u8Count != stStream.u8Count || bKey != stStream.bAssemblingKey)
+    {
+        m_u32InvalidCount++;
+        return;
+    }
+    if (stStream.u32ReceivedMask & u32Bit)
+    {
+        m_u32DuplicateCount++;
+        return;
+    }
+    if (!DeltaStream::ApplyOps(stStream.pReference, stStream.u32Pixels, stHeader.u16FirstPixel, (const uint8_t *)m_aRxBuffer.data() + DeltaStream::HEADER_LENGTH,
+                               stHeader.u16OpsLength, bKey))
+    {
+        m_u32InvalidCount++;
+        stStream.bAssembling = false;
+        RequestKeyFrame(stStream, s32Port, stHeader.u16Sequence);
+        return;
+    }
+    stStream.u32ReceivedMask |= u32Bit;
+
+    if (stStream.u32ReceivedMask == (uint32_t)((1ULL << stStream.u8Count) - 1))
+    {
+        stStream.bAssembling = false;
+        stStream.bValid = true;
+        stStream.u16Sequence = stStream.u16AssemblySequence;
+        if (bKey)
+        {
+            m_u32KeyFrameCount++;
+        }
+        else
+        {
+            m_u32DeltaFrameCount++;
+        }
+        m_u64FrameBytes += stStream.u32Pixels * 3;
+        m_oFrameHandler(s32Port, stStream.pReference, stStream.u32Pixels * 3);
+    }
+}
+
+cJSON *DeltaStreamServer::ToJson()
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "Packets", m_u32PacketCount);
+    cJSON_AddNumberToObject(json, "KeyFrames", m_u32KeyFrameCount);
+    cJSON_AddNumberToObject(json, "DeltaFrames", m_u32DeltaFrameCount);
+    // Decoded frame bytes per received byte.
+    cJSON_AddNumberToObject(json, "CompressionRatio", m_u64PacketBytes ? (double)m_u64FrameBytes / m_u64PacketBytes : 0);
+    cJSON_AddNumberToObject(json, "Invalid", m_u32InvalidCount);
+    cJSON_AddNumberToObject(json, "Stale", m_u32StaleCount);
+    cJSON_AddNumberToObject(json, "Duplicate", m_u32DuplicateCount);
+    cJSON_AddNumberToObject(json, "Incomplete", m_u32IncompleteCount);
+    cJSON_AddNumberToObject(json, "BaseMismatch", m_u32BaseMismatchCount);
+    cJSON_AddNumberToObject(json, "KeyRequests", m_u32KeyRequestCount);
+    return json;
+}
+
+char * CommonServer::GetBuffer(size_t &u32Length)
+{
+    // Room for the terminating null character, the messages are text.
+    u32Length = m_aRxBuffer.size() - 1;
+    return m_aRxBuffer.data();
+}
+
+void CommonServer::HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram)
+{
+    m_aRxBuffer[msgLength] = '\0';
+    char senderIP[16];
+    m_oMessageHandler(m_aRxBuffer.data(), msgLength, stDatagram.FormatSource(senderIP));
+}
+
+void CommonServer::CheckHandlers()
+{
+    bool init = true;
+    init &= (bool)m_oMessageHandler;
+    if (!init)
+    {
+        ESP_LOGE(TAG, "All handlers must be registered");
+        ESP_ERROR_CHECK(ESP_ERR_NOT_FOUND);
     }
 }
@@ -3,31 +3,52 @@
 
 #include <stdio.h>
 #include <array>
+#include <vector>
 #include <functional>
 #include "lwip/sockets.h"
+#include "lwip/udp.h"
 #include "cJSON.h"
-
-#ifndef UDP_ARTNET_BUFFER_LEN
-#define UDP_ARTNET_BUFFER_LEN 535
-#endif
+#include "dmx_message.h"
+#include "artnet_packet.h"
+#include "artnet_filter.h"
+#include "e131_packet.h"
+#include "ddp_packet.h"
+#include "delta_stream.h"
+#include "udp_reactor.h"
+#include "models/settings.h"
 
 #ifndef UDP_COMMON_BUFFER_LEN
 #define UDP_COMMON_BUFFER_LEN 2048
 #endif
 
 typedef std::function<void(const char *, size_t, const char *)> MessageHandler_t;
+typedef std::function<void(DMX512Message &, const ArtNet::Packet &, const char *)> DMXMessageHandler_t; // packet is a validated view over the message
+typedef std::function<size_t(int32_t, uint8_t, size_t, PayloadCopier_t, void *)> DMXPayloadHandler_t; // port address, sequence, payload length, copier, copier context
+typedef std::function<size_t(size_t, size_t, PayloadCopier_t, void *)> LinearPayloadHandler_t; // byte offset, payload length, copier, copier context
+typedef std::function<void(int32_t, const uint8_t *, size_t)> PortFrameHandler_t; // port, complete RGB frame, length
 
-class ArtNetServer
+// Art-Net socket of the reactor. m_aRxBuffer only receives while the pool is exhausted, those datagrams are dropped.
+class ArtNetServer : public UdpServer<ArtNetServer, PROJECT_DMX_MESSAGE_BUFFER_SIZE>
 {
-    std::array<char, UDP_ARTNET_BUFFER_LEN> m_aRxBuffer;
-    MessageHandler_t m_oDMXHandler;
+    friend class UdpServer<ArtNetServer, PROJECT_DMX_MESSAGE_BUFFER_SIZE>;
+
+    DMX512Message m_oRxMessage; // Pool slot the next datagram is received into.
+    DMXMessageHandler_t m_oDMXHandler;
+    DMXPayloadHandler_t m_oDMXPayloadHandler; // ArtDmxBatch universes, routed straight from the receive buffer
     MessageHandler_t m_oArtSyncHandler;
     MessageHandler_t m_oDiscoveryHandler;
+    MessageHandler_t m_oPollHandler;
+    MessageHandler_t m_oFecHandler;
+    ArtNet::ParseStats m_oParseStats;
+    ArtNetFilter m_oFilter;
+    uint32_t m_u32BroadcastDmxCount;
+    uint32_t m_u32UnicastDmxCount;
+    uint32_t m_u32BatchCount;
+    uint32_t m_u32BatchUniverseCount;
+    uint32_t m_u32BatchMalformedCount; // entries running past the datagram, the rest of it is dropped
 
-    static int32_t m_s32Socket;
-    static sockaddr_storage m_stSourceAddress; // Large enough for both IPv4 or IPv6
-
-    void HandleIncommingMessage(size_t msgLength, char *senderIP);
+    char *GetBuffer(size_t &u32Length);
+    void HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram);
     void CheckHandlers();
 public:
     static ArtNetServer &GetInstance()
@@ -35,25 +56,240 @@ public:
         static ArtNetServer oIns;
         return oIns;
     }
-    static void FreeRTOSTask(void *pvParamaters);
-    std::array<char, UDP_ARTNET_BUFFER_LEN> &GetBufferRef() { return m_aRxBuffer; }
-    inline char *GetBuffer() { return m_aRxBuffer.data(); }
-    inline size_t GetBufferLength() { return m_aRxBuffer.size(); }
-    void RegisterDMXMessageHandler(MessageHandler_t handler) { m_oDMXHandler = handler; }
+    ArtNetServer() : m_u32BroadcastDmxCount(0), m_u32UnicastDmxCount(0), m_u32BatchCount(0), m_u32BatchUniverseCount(0), m_u32BatchMalformedCount(0) {}
+    void RegisterDMXMessageHandler(DMXMessageHandler_t handler) { m_oDMXHandler = handler; }
+    void RegisterDMXPayloadHandler(DMXPayloadHandler_t handler) { m_oDMXPayloadHandler = handler; }
     void RegisterArtSyncMessageHandler(MessageHandler_t handler) { m_oArtSyncHandler = handler; }
     void RegisterDiscoveryMessageHandler(MessageHandler_t handler) { m_oDiscoveryHandler = handler; }
-    void Response(const char * pBuffer, size_t u32BufferSize);
+    void RegisterPollMessageHandler(MessageHandler_t handler) { m_oPollHandler = handler; }
+    void RegisterFecMessageHandler(MessageHandler_t handler) { m_oFecHandler = handler; }
+    // u32Ip in network byte order, to the Art-Net port.
+    void SendTo(const uint8_t * pBuffer, size_t u32BufferSize, uint32_t u32Ip);
+    const ArtNet::ParseStats &GetParseStats() const { return m_oParseStats; }
+    const ArtNetFilter &GetFilter() const { return m_oFilter; }
+    uint32_t GetBroadcastDmxCount() const { return m_u32BroadcastDmxCount; }
+    uint32_t GetUnicastDmxCount() const { return m_u32UnicastDmxCount; }
+    uint32_t GetBatchCount() const { return m_u32BatchCount; }
+    uint32_t GetBatchUniverseCount() const { return m_u32BatchUniverseCount; }
+    uint32_t GetBatchMalformedCount() const { return m_u32BatchMalformedCount; }
 };
 
-class CommonServer
+// Alternative to ArtNetServer: a raw lwIP pcb whose receive callback runs in the tcpip thread
+// and copies ArtDmx payload from the pbuf chain straight into the port buffers.
+class ArtNetRawServer
 {
-    std::array<char, UDP_COMMON_BUFFER_LEN> m_aRxBuffer;
-    MessageHandler_t m_oMessageHandler;
+    struct udp_pcb *m_pPcb;
+    DMXPayloadHandler_t m_oDMXPayloadHandler;
+    MessageHandler_t m_oArtSyncHandler;
+    MessageHandler_t m_oDiscoveryHandler;
+    MessageHandler_t m_oPollHandler;
+    MessageHandler_t m_oFecHandler;
+
+    ip_addr_t m_stSourceAddress;
+    u16_t m_u16SourcePort;
+
+    uint32_t m_u32PacketCount;
+    uint64_t m_u64BytesCopied;
+    ArtNet::ParseStats m_oParseStats;
+    ArtNetFilter m_oFilter; // runs in the tcpip thread, before anything is queued or copied
+    uint32_t m_u32BroadcastDmxCount;
+    uint32_t m_u32UnicastDmxCount;
+    uint32_t m_u32BatchCount;
+    uint32_t m_u32BatchUniverseCount;
+    uint32_t m_u32BatchMalformedCount;
+
+    static void Bind(void *pvContext);
+    static void Receive(void *pvArg, struct udp_pcb *pPcb, struct pbuf *pBuf, const ip_addr_t *pAddr, u16_t u16Port);
+    static size_t CopyPayload(void *pDest, size_t u32Length, void *pvContext);
+    void HandleIncommingMessage(struct pbuf *pBuf, const ip_addr_t *pAddr);
+    void CheckHandlers();
+
+public:
+    static ArtNetRawServer &GetInstance()
+    {
+        static ArtNetRawServer oIns;
+        return oIns;
+    }
+    ArtNetRawServer() : m_pPcb(nullptr), m_u16SourcePort(0), m_u32PacketCount(0), m_u64BytesCopied(0), m_u32BroadcastDmxCount(0), m_u32UnicastDmxCount(0),
+                        m_u32BatchCount(0), m_u32BatchUniverseCount(0), m_u32BatchMalformedCount(0) {}
+    esp_err_t Start();
+    void RegisterDMXPayloadHandler(DMXPayloadHandler_t handler) { m_oDMXPayloadHandler = handler; }
+    void RegisterArtSyncMessageHandler(MessageHandler_t handler) { m_oArtSyncHandler = handler; }
+    void RegisterDiscoveryMessageHandler(MessageHandler_t handler) { m_oDiscoveryHandler = handler; }
+    void RegisterPollMessageHandler(MessageHandler_t handler) { m_oPollHandler = handler; }
+    void RegisterFecMessageHandler(MessageHandler_t handler) { m_oFecHandler = handler; }
+    // Only valid from a handler, i.e. inside the tcpip thread.
+    void Response(const char *pBuffer, size_t u32BufferSize);
+    // Only valid inside the tcpip thread. u32Ip in network byte order, to the Art-Net port.
+    void SendTo(const uint8_t *pBuffer, size_t u32BufferSize, uint32_t u32Ip);
+    uint32_t GetPacketCount() const { return m_u32PacketCount; }
+    uint64_t GetBytesCopied() const { return m_u64BytesCopied; }
+    const ArtNet::ParseStats &GetParseStats() const { return m_oParseStats; }
+    const ArtNetFilter &GetFilter() const { return m_oFilter; }
+    uint32_t GetBroadcastDmxCount() const { return m_u32BroadcastDmxCount; }
+    uint32_t GetUnicastDmxCount() const { return m_u32UnicastDmxCount; }
+    uint32_t GetBatchCount() const { return m_u32BatchCount; }
+    uint32_t GetBatchUniverseCount() const { return m_u32BatchUniverseCount; }
+    uint32_t GetBatchMalformedCount() const { return m_u32BatchMalformedCount; }
+};
+
+// A source that stops sending for this long gives its universes up to lower priority sources (E1.31 network data loss).
+#ifndef PROJECT_SACN_SOURCE_TIMEOUT_MS
+#define PROJECT_SACN_SOURCE_TIMEOUT_MS 2500
+#endif
+
+// E1.31 receiver. The socket joins the multicast group of every configured universe, so WiFi and lwIP
+// drop the universes of other nodes before they reach the reactor. Settings changes are followed on
+// every reactor wake up.
+class SacnServer : public UdpServer<SacnServer, E131::OFFSET_DMX_DATA + E131::MAXIMUM_DMX_LENGTH>
+{
+    friend class UdpServer<SacnServer, E131::OFFSET_DMX_DATA + E131::MAXIMUM_DMX_LENGTH>;
+
+    typedef struct
+    {
+        uint16_t u16Universe; // 0: not configured
+        bool bHasSource;
+        uint8_t u8Priority;
+        uint8_t u8LastSequence;
+        int64_t s64LastUs; // esp_timer time of the newest packet of the owning source
+        std::array<uint8_t, E131::CID_LENGTH> aCid; // owning source
+    } UniverseSource;
+
+    DMXPayloadHandler_t m_oDMXPayloadHandler;
+    MessageHandler_t m_oSyncHandler;
+    E131::ParseStats m_oParseStats;
+    std::array<UniverseSource, PROJECT_MAXIMUM_NUMBER_OF_UNIVERSES> m_aSources; // indexed by universe - m_s32BaseUniv
+    int32_t m_s32BaseUniv;
+    std::vector<uint16_t> m_vJoined; // sorted multicast groups of the socket, by universe
+    uint16_t m_u16SyncUniverse; // sync address named by the data packets, 0: not synchronized
+    bool m_bSyncUniverseChanged;
+    uint32_t m_u32SettingsRevision;
+
+    uint32_t m_u32LowerPriorityCount;
+    uint32_t m_u32OutOfOrderCount;
+    uint32_t m_u32SourceChangeCount;
+    uint32_t m_u32PreviewCount;
+    uint32_t m_u32SyncCount;
+    uint32_t m_u32JoinFailedCount;
+
+    void OnOpen();
+    void OnWake();
+    void HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram);
+    void CheckHandlers();
+    bool AcceptSource(UniverseSource &stSource, const E131::Packet &oPacket);
+    void UpdateUniverses();
+    void UpdateMemberships();
+    bool SetMembership(uint16_t u16Universe, bool bJoin);
+
+public:
+    static SacnServer &GetInstance()
+    {
+        static SacnServer oIns;
+        return oIns;
+    }
+    SacnServer();
+    void RegisterDMXPayloadHandler(DMXPayloadHandler_t handler) { m_oDMXPayloadHandler = handler; }
+    void RegisterSyncMessageHandler(MessageHandler_t handler) { m_oSyncHandler = handler; }
+    const E131::ParseStats &GetParseStats() const { return m_oParseStats; }
+    cJSON *ToJson();
+};
+
+// DDP receiver. One datagram carries up to 480 RGB pixels at any byte offset, the push flag commits the frame.
+class DdpServer : public UdpServer<DdpServer, DDP::HEADER_LENGTH + DDP::TIMECODE_LENGTH + DDP::MAXIMUM_DATA_LENGTH>
+{
+    friend class UdpServer<DdpServer, DDP::HEADER_LENGTH + DDP::TIMECODE_LENGTH + DDP::MAXIMUM_DATA_LENGTH>;
+
+    LinearPayloadHandler_t m_oPayloadHandler;
+    MessageHandler_t m_oPushHandler;
+    DDP::ParseStats m_oParseStats;
+    uint8_t m_u8LastSequence; // 0: none yet
 
-    static int32_t m_s32Socket;
-    static sockaddr_storage m_stSourceAddress; // Large enough for both IPv4 or IPv6
+    uint32_t m_u32PacketCount; // accepted data packets
+    uint64_t m_u64BytesCopied;
+    uint32_t m_u32PushCount;
+    uint32_t m_u32SequenceGapCount;
+
+    void HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram);
+    void CheckHandlers();
+
+public:
+    static DdpServer &GetInstance()
+    {
+        static DdpServer oIns;
+        return oIns;
+    }
+    DdpServer() : m_u8LastSequence(0), m_u32PacketCount(0), m_u64BytesCopied(0), m_u32PushCount(0), m_u32SequenceGapCount(0) {}
+    void RegisterPayloadHandler(LinearPayloadHandler_t handler) { m_oPayloadHandler = handler; }
+    void RegisterPushMessageHandler(MessageHandler_t handler) { m_oPushHandler = handler; }
+    cJSON *ToJson();
+};
+
+// Sender side delta frames need the node to hold the same base frame, a loss is recovered by asking for a keyframe
+// no more often than this per port.
+#ifndef PROJECT_DELTA_STREAM_KEY_REQUEST_INTERVAL_MS
+#define PROJECT_DELTA_STREAM_KEY_REQUEST_INTERVAL_MS 100
+#endif
+
+// Receiver of the compressed stream of delta_stream.h. Each port keeps the last complete frame in RGB as the
+// base for the next delta, completed frames go to the port as a whole.
+class DeltaStreamServer : public UdpServer<DeltaStreamServer, DeltaStream::HEADER_LENGTH + DeltaStream::MAXIMUM_OPS_LENGTH>
+{
+    friend class UdpServer<DeltaStreamServer, DeltaStream::HEADER_LENGTH + DeltaStream::MAXIMUM_OPS_LENGTH>;
+
+    typedef struct
+    {
+        uint8_t *pReference; // RGB, u32Pixels * 3
+        size_t u32Pixels;
+        uint16_t u16Sequence; // frame held in pReference
+        bool bValid;          // pReference is a complete frame
+        bool bAssembling;     // packets of u16AssemblySequence are being applied to pReference
+        bool bAssemblingKey;
+        uint16_t u16AssemblySequence;
+        uint8_t u8Count;
+        uint32_t u32ReceivedMask;
+        int64_t s64LastKeyRequestUs;
+    } PortStream;
+
+    std::array<PortStream, PROJECT_NUMBER_OF_PORTS> m_aStreams;
+    PortFrameHandler_t m_oFrameHandler;
+
+    uint32_t m_u32PacketCount;
+    uint64_t m_u64PacketBytes;
+    uint32_t m_u32KeyFrameCount;
+    uint32_t m_u32DeltaFrameCount;
+    uint64_t m_u64FrameBytes; // decoded RGB bytes of the completed frames
+    uint32_t m_u32InvalidCount;
+    uint32_t m_u32StaleCount;
+    uint32_t m_u32DuplicateCount;
+    uint32_t m_u32IncompleteCount; // frames given up because a newer one started
+    uint32_t m_u32BaseMismatchCount;
+    uint32_t m_u32KeyRequestCount;
+
+    void HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram);
+    void CheckHandlers();
+    bool PrepareStream(PortStream &stStream, int32_t s32Port);
+    void RequestKeyFrame(PortStream &stStream, int32_t s32Port, uint16_t u16Sequence);
+
+public:
+    static DeltaStreamServer &GetInstance()
+    {
+        static DeltaStreamServer oIns;
+        return oIns;
+    }
+    DeltaStreamServer();
+    void RegisterPortFrameHandler(PortFrameHandler_t handler) { m_oFrameHandler = handler; }
+    cJSON *ToJson();
+};
+
+// Configuration and status requests of the host app, answered with Response() from inside the handler.
+class CommonServer : public UdpServer<CommonServer, UDP_COMMON_BUFFER_LEN>
+{
+    friend class UdpServer<CommonServer, UDP_COMMON_BUFFER_LEN>;
+
+    MessageHandler_t m_oMessageHandler;
 
-    void HandleIncommingMessage(size_t msgLength, char * senderIP);
+    char * GetBuffer(size_t &u32Length);
+    void HandleIncommingMessage(size_t msgLength, const UdpDatagram_t &stDatagram);
     void CheckHandlers();
 
 public:
@@ -63,12 +299,7 @@ public:
         return oIns;
     }
 
-    static void FreeRTOSTask(void *pvParamaters);
-    std::array<char, UDP_COMMON_BUFFER_LEN> &GetBufferRef() { return m_aRxBuffer; }
-    inline char * GetBuffer() {return m_aRxBuffer.data(); }
-    inline size_t GetBufferLength() { return m_aRxBuffer.size(); }
     void RegisterMessageHandler(MessageHandler_t handler) { m_oMessageHandler = handler; }
-    void Response(const char * pBuffer, size_t u32BufferSize);
 };
 
 #endif /* __UDP_SERVERS_H__ */
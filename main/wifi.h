@@ -63,6 +63,7 @@ public:
     static esp_err_t ApplyDHCP();
 
     static std::string GetIP() { return inet_ntoa(m_stGotIP.ip); }
+    static uint32_t GetIPAddress() { return m_stGotIP.ip.addr; } // network byte order
     static std::string GetNetmask() { return inet_ntoa(m_stGotIP.netmask); }
     static std::string GetGatewayAddress() { return inet_ntoa(m_stGotIP.gw); }
 };
@@ -0,0 +1,385 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_lwip.h"
+#include "config.h"
+#include "udp_server.h"
+#include <string.h>
+#include <sys/select.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ArtNet;
+
+static constexpr uint16_t UDP_PORT = 16454;
+
+// The syscalls of the receive path, counted on their way to libc: the test links with --wrap for both.
+static std::atomic<uint32_t> g_u32SelectCalls(0);
+static std::atomic<uint32_t> g_u32RecvmsgCalls(0);
+
+extern "C" int __real_select(int s32Count, fd_set *pRead, fd_set *pWrite, fd_set *pExcept, struct timeval *pTimeout);
+extern "C" ssize_t __real_recvmsg(int s32Socket, struct msghdr *pMsg, int s32Flags);
+
+extern "C" int __wrap_select(int s32Count, fd_set *pRead, fd_set *pWrite, fd_set *pExcept, struct timeval *pTimeout)
+{
+    g_u32SelectCalls++;
+    return __real_select(s32Count, pRead, pWrite, pExcept, pTimeout);
+}
+
+extern "C" ssize_t __wrap_recvmsg(int s32Socket, struct msghdr *pMsg, int s32Flags)
+{
+    g_u32RecvmsgCalls++;
+    return __real_recvmsg(s32Socket, pMsg, s32Flags);
+}
+
+typedef struct
+{
+    uint8_t u8Sequence;
+    int32_t s32PortAddress;
+    std::vector<uint8_t> vData;
+} Universe;
+
+static std::vector<uint8_t> MakeHeader(OpCode eOpCode)
+{
+    std::vector<uint8_t> vPacket(OFFSET_BATCH_ENTRIES, 0);
+    memcpy(vPacket.data(), ID, sizeof(ID));
+    vPacket[8] = eOpCode & 0xFF;
+    vPacket[9] = eOpCode >> 8;
+    vPacket[11] = PROTOCOL_VERSION;
+    return vPacket;
+}
+
+static std::vector<uint8_t> MakeDmx(const Universe &stUniverse)
+{
+    std::vector<uint8_t> vPacket = MakeHeader(OP_DMX);
+    vPacket.resize(OFFSET_DMX_DATA);
+    vPacket[12] = stUniverse.u8Sequence;
+    vPacket[14] = stUniverse.s32PortAddress & 0xFF;
+    vPacket[15] = stUniverse.s32PortAddress >> 8;
+    vPacket[16] = stUniverse.vData.size() >> 8;
+    vPacket[17] = stUniverse.vData.size();
+    vPacket.insert(vPacket.end(), stUniverse.vData.begin(), stUniverse.vData.end());
+    return vPacket;
+}
+
+static std::vector<uint8_t> MakeBatch(const std::vector<Universe> &vUniverses)
+{
+    std::vector<uint8_t> vPacket = MakeHeader(OP_DMX_BATCH);
+    vPacket[OFFSET_BATCH_COUNT] = vUniverses.size();
+    for (const Universe &stUniverse : vUniverses)
+    {
+        const uint8_t au8Entry[BATCH_ENTRY_HEADER_LENGTH] = {stUniverse.u8Sequence, (uint8_t)stUniverse.s32PortAddress,
+                                                             (uint8_t)(stUniverse.s32PortAddress >> 8), (uint8_t)(stUniverse.vData.size() >> 8),
+                                                             (uint8_t)stUniverse.vData.size()};
+        vPacket.insert(vPacket.end(), au8Entry, au8Entry + sizeof(au8Entry));
+        vPacket.insert(vPacket.end(), stUniverse.vData.begin(), stUniverse.vData.end());
+    }
+    return vPacket;
+}
+
+static std::vector<uint8_t> Fill(size_t u32Length, uint8_t u8First)
+{
+    std::vector<uint8_t> vData(u32Length);
+    for (size_t i = 0; i < u32Length; ++i)
+    {
+        vData[i] = u8First + i;
+    }
+    return vData;
+}
+
+// Walks the entries the way both receive paths do.
+static std::vector<BatchEntry> ReadEntries(const std::vector<uint8_t> &vPacket, bool &bMalformed)
+{
+    std::vector<BatchEntry> vEntries;
+    bMalformed = false;
+    size_t u32Offset = OFFSET_BATCH_ENTRIES;
+    for (uint8_t i = 0; i < vPacket[OFFSET_BATCH_COUNT]; ++i)
+    {
+        BatchEntry stEntry;
+        if (!ReadBatchEntry(&vPacket[u32Offset], vPacket.size() - u32Offset, stEntry))
+        {
+            bMalformed = true;
+            break;
+        }
+        vEntries.push_back(stEntry);
+        u32Offset += BATCH_ENTRY_HEADER_LENGTH + stEntry.u16Length;
+    }
+    return vEntries;
+}
+
+static void TestParse()
+{
+    std::vector<uint8_t> vPacket = MakeBatch({{1, 0x7FFF, Fill(510, 0)}, {2, 1, Fill(510, 1)}});
+    CHECK_EQ(vPacket.size(), OFFSET_BATCH_ENTRIES + 2 * (BATCH_ENTRY_HEADER_LENGTH + 510));
+    CHECK(vPacket.size() <= PROJECT_DMX_MESSAGE_BUFFER_SIZE);
+    Packet oPacket;
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()), PARSE_OK);
+    CHECK_EQ(oPacket.GetOpCode(), OP_DMX_BATCH);
+    CHECK_EQ(oPacket.GetBatchCount(), 2);
+    bool bMalformed;
+    std::vector<BatchEntry> vEntries = ReadEntries(vPacket, bMalformed);
+    CHECK(!bMalformed);
+    CHECK_EQ(vEntries.size(), 2);
+    CHECK_EQ(vEntries[0].u8Sequence, 1);
+    CHECK_EQ(vEntries[0].s32PortAddress, 0x7FFF);
+    CHECK_EQ(vEntries[1].s32PortAddress, 1);
+    CHECK_EQ(vEntries[1].u16Length, 510);
+
+    // The count decides the least the datagram must hold, entries are checked as they are walked.
+    vPacket[OFFSET_BATCH_COUNT] = 0;
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()), PARSE_BAD_LENGTH);
+    vPacket[OFFSET_BATCH_COUNT] = MAXIMUM_BATCH_UNIVERSES + 1;
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()), PARSE_BAD_LENGTH);
+    std::vector<uint8_t> vShort = MakeBatch({{1, 0, {}}});
+    vShort[OFFSET_BATCH_COUNT] = 2;
+    CHECK_EQ(oPacket.Parse(vShort.data(), vShort.size(), vShort.size()), PARSE_BAD_LENGTH);
+    CHECK_EQ(oPacket.Parse(vShort.data(), OFFSET_BATCH_ENTRIES - 1, OFFSET_BATCH_ENTRIES - 1), PARSE_TOO_SHORT);
+
+    // An entry running past the datagram ends the walk, the ones before it stand.
+    vPacket = MakeBatch({{1, 0, Fill(100, 0)}, {2, 1, Fill(100, 0)}, {3, 2, Fill(100, 0)}});
+    vPacket.resize(vPacket.size() - 1);
+    vEntries = ReadEntries(vPacket, bMalformed);
+    CHECK(bMalformed);
+    CHECK_EQ(vEntries.size(), 2);
+    // As does one longer than a universe.
+    vPacket = MakeBatch({{1, 0, Fill(MAXIMUM_DMX_LENGTH + 1, 0)}});
+    vEntries = ReadEntries(vPacket, bMalformed);
+    CHECK(bMalformed);
+    CHECK_EQ(vEntries.size(), 0);
+    BatchEntry stEntry;
+    CHECK(!ReadBatchEntry(vPacket.data(), BATCH_ENTRY_HEADER_LENGTH - 1, stEntry));
+}
+
+// What reached the handlers: universes of ArtDmx and of ArtDmxBatch alike.
+typedef struct
+{
+    int32_t s32PortAddress;
+    uint8_t u8Sequence;
+    std::vector<uint8_t> vData;
+    bool bBatch;
+} Received;
+
+static std::mutex g_oMutex;
+static std::vector<Received> g_vReceived;
+static UdpReactor g_oReactor;
+static int32_t g_s32Sender = -1;
+
+static void Record(int32_t s32PortAddress, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void *pvContext, bool bBatch)
+{
+    std::vector<uint8_t> vData(u32Length);
+    fnCopy(vData.data(), u32Length, pvContext);
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    g_vReceived.push_back({s32PortAddress, u8Sequence, vData, bBatch});
+}
+
+static size_t GetReceived()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_vReceived.size();
+}
+
+static bool WaitReceived(size_t u32Count)
+{
+    for (int32_t i = 0; i < 3000 && GetReceived() < u32Count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return GetReceived() >= u32Count;
+}
+
+static void Send(const std::vector<uint8_t> &vPacket)
+{
+    struct sockaddr_in stDestination = {};
+    stDestination.sin_family = AF_INET;
+    stDestination.sin_port = htons(UDP_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &stDestination.sin_addr);
+    sendto(g_s32Sender, vPacket.data(), vPacket.size(), 0, (struct sockaddr *)&stDestination, sizeof(stDestination));
+}
+
+static void CheckReceived(size_t u32First, const std::vector<Universe> &vUniverses, bool bBatch)
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    CHECK_EQ(g_vReceived.size(), u32First + vUniverses.size());
+    for (size_t i = 0; i < vUniverses.size() && u32First + i < g_vReceived.size(); ++i)
+    {
+        const Received &stReceived = g_vReceived[u32First + i];
+        CHECK_EQ(stReceived.s32PortAddress, vUniverses[i].s32PortAddress);
+        CHECK_EQ(stReceived.u8Sequence, vUniverses[i].u8Sequence);
+        CHECK(stReceived.vData == vUniverses[i].vData);
+        CHECK_EQ(stReceived.bBatch, bBatch);
+    }
+}
+
+// Every universe of a batch is routed from the pooled receive buffer as a single ArtDmx would be; an entry
+// running past the datagram drops the rest of it.
+static void TestSocketServer()
+{
+    ArtNetServer &oServer = ArtNetServer::GetInstance();
+    HostKernel::Advance(1000000);
+    std::vector<Universe> vUniverses = {{7, 0, Fill(510, 0x10)}, {7, 1, Fill(510, 0x20)}};
+    Send(MakeBatch(vUniverses));
+    CHECK(WaitReceived(2));
+    CheckReceived(0, vUniverses, true);
+
+    std::vector<Universe> vShort = {{8, 3, Fill(3, 0x30)}, {8, 4, Fill(6, 0x40)}, {8, 5, Fill(9, 0x50)}};
+    std::vector<uint8_t> vPacket = MakeBatch(vShort);
+    vPacket.resize(vPacket.size() - 1);
+    Send(vPacket);
+    CHECK(WaitReceived(4));
+    vShort.pop_back();
+    CheckReceived(2, vShort, true);
+    Send(MakeDmx({9, 2, Fill(12, 0x60)}));
+    CHECK(WaitReceived(5));
+    CheckReceived(4, {{9, 2, Fill(12, 0x60)}}, false);
+    CHECK_EQ(oServer.GetBatchCount(), 2);
+    CHECK_EQ(oServer.GetBatchUniverseCount(), 4);
+    CHECK_EQ(oServer.GetBatchMalformedCount(), 1);
+}
+
+// The raw pcb path copies entry headers and payloads from the pbuf chain, also when they straddle pbufs.
+static void TestRawServer()
+{
+    ArtNetRawServer &oServer = ArtNetRawServer::GetInstance();
+    HostKernel::Advance(1000000);
+    size_t u32First = GetReceived();
+    std::vector<Universe> vUniverses = {{1, 0, Fill(510, 0x11)}, {1, 1, Fill(300, 0x22)}, {1, 2, Fill(99, 0x33)}};
+    uint32_t u32Source = htonl(0x7F000001);
+    for (size_t u32Segment : {7, 64, 1472})
+    {
+        CHECK(HostLwip::Deliver(PROJECT_UDP_ARTNET_PORT, MakeBatch(vUniverses), u32Segment, u32Source, u32Source));
+        CheckReceived(u32First, vUniverses, true);
+        u32First += vUniverses.size();
+    }
+    std::vector<uint8_t> vPacket = MakeBatch(vUniverses);
+    vPacket.resize(vPacket.size() - 1);
+    CHECK(HostLwip::Deliver(PROJECT_UDP_ARTNET_PORT, vPacket, 64, u32Source, u32Source));
+    CheckReceived(u32First, {vUniverses[0], vUniverses[1]}, true);
+    CHECK_EQ(oServer.GetBatchCount(), 4);
+    CHECK_EQ(oServer.GetBatchUniverseCount(), 11);
+    CHECK_EQ(oServer.GetBatchMalformedCount(), 1);
+}
+
+typedef struct
+{
+    uint32_t u32Datagrams;
+    uint32_t u32Wakeups; // select() returning
+    uint32_t u32Syscalls; // select() and recvmsg()
+} Cost;
+
+// Sends u32Frames frames of vDatagrams, each datagram only once the previous one was handled as they arrive
+// spread out over a WiFi link, or all back to back.
+static Cost Measure(const std::vector<std::vector<uint8_t>> &vDatagrams, size_t u32Universes, uint32_t u32Frames, bool bPaced)
+{
+    HostKernel::Advance(1000000);
+    size_t u32Expected = GetReceived();
+    uint32_t u32Select = g_u32SelectCalls, u32Recvmsg = g_u32RecvmsgCalls, u32Datagrams = g_oReactor.GetDatagramCount();
+    for (uint32_t u32Frame = 0; u32Frame < u32Frames; ++u32Frame)
+    {
+        for (const std::vector<uint8_t> &vDatagram : vDatagrams)
+        {
+            Send(vDatagram);
+            if (bPaced)
+            {
+                u32Expected += u32Universes / vDatagrams.size();
+                WaitReceived(u32Expected);
+            }
+        }
+        if (!bPaced)
+        {
+            u32Expected += u32Universes;
+            WaitReceived(u32Expected);
+        }
+        // Back in select() before the next frame.
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    CHECK_EQ(GetReceived(), u32Expected);
+    // Every select() but the one the reactor now waits in returned.
+    return {g_oReactor.GetDatagramCount() - u32Datagrams, g_u32SelectCalls - u32Select,
+            (g_u32SelectCalls - u32Select) + (g_u32RecvmsgCalls - u32Recvmsg)};
+}
+
+// A 1020 LED port, six universes, as six ArtDmx or as three ArtDmxBatch of two universes.
+static void TestSyscalls()
+{
+    const uint32_t u32Frames = 20;
+    std::vector<std::vector<uint8_t>> vDmx, vBatch;
+    std::vector<Universe> vUniverses;
+    for (int32_t i = 0; i < 6; ++i)
+    {
+        vUniverses.push_back({0, i, Fill(510, i)});
+        vDmx.push_back(MakeDmx(vUniverses.back()));
+        if (i % 2 == 1)
+        {
+            vBatch.push_back(MakeBatch({vUniverses[i - 1], vUniverses[i]}));
+            CHECK(vBatch.back().size() <= PROJECT_DMX_MESSAGE_BUFFER_SIZE);
+        }
+    }
+    for (bool bPaced : {true, false})
+    {
+        Cost stDmx = Measure(vDmx, 6, u32Frames, bPaced);
+        Cost stBatch = Measure(vBatch, 6, u32Frames, bPaced);
+        printf("%s: per frame ArtDmx %.1f datagrams, %.1f wake ups, %.1f syscalls; ArtDmxBatch %.1f datagrams, %.1f wake ups, %.1f syscalls\n",
+               bPaced ? "paced" : "back to back", (double)stDmx.u32Datagrams / u32Frames, (double)stDmx.u32Wakeups / u32Frames,
+               (double)stDmx.u32Syscalls / u32Frames, (double)stBatch.u32Datagrams / u32Frames, (double)stBatch.u32Wakeups / u32Frames,
+               (double)stBatch.u32Syscalls / u32Frames);
+        CHECK_EQ(stDmx.u32Datagrams, 6 * u32Frames);
+        CHECK_EQ(stBatch.u32Datagrams, 3 * u32Frames);
+        CHECK(stBatch.u32Syscalls < stDmx.u32Syscalls);
+        if (bPaced)
+        {
+            // One wake up per datagram, its select(), its recvmsg() and the one finding the socket dry.
+            CHECK(stDmx.u32Wakeups >= 6 * u32Frames);
+            CHECK(stBatch.u32Wakeups * 3 <= stDmx.u32Wakeups * 2);
+            CHECK(stBatch.u32Syscalls * 3 <= stDmx.u32Syscalls * 2);
+        }
+    }
+}
+
+int main()
+{
+    ConfigurePorts("{\"StartUniverse\":0,\"NoUniverses\":6,\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":6,\"LedCount\":1020,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":6,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":6,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":6,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+
+    DMXPayloadHandler_t fnBatch = [](int32_t s32PortAddress, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void *pvContext)
+    {
+        Record(s32PortAddress, u8Sequence, u32Length, fnCopy, pvContext, true);
+        return u32Length;
+    };
+    MessageHandler_t fnIgnore = [](const char *, size_t, const char *) {};
+    ArtNetServer &oServer = ArtNetServer::GetInstance();
+    oServer.RegisterDMXMessageHandler([](DMX512Message &oMessage, const Packet &oPacket, const char *)
+    {
+        std::vector<uint8_t> vData(oPacket.GetDmxData(), oPacket.GetDmxData() + oPacket.GetDmxLength());
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        g_vReceived.push_back({oPacket.GetPortAddress(), oPacket.GetSequence(), vData, false});
+    });
+    oServer.RegisterDMXPayloadHandler(fnBatch);
+    oServer.RegisterArtSyncMessageHandler(fnIgnore);
+    oServer.RegisterDiscoveryMessageHandler(fnIgnore);
+    oServer.RegisterPollMessageHandler(fnIgnore);
+    oServer.RegisterFecMessageHandler(fnIgnore);
+    oServer.Attach(g_oReactor, UDP_PORT);
+    std::thread([]() { g_oReactor.Run(); }).detach();
+    g_s32Sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    // The reactor binds its socket once it runs.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ArtNetRawServer &oRawServer = ArtNetRawServer::GetInstance();
+    oRawServer.RegisterDMXPayloadHandler(fnBatch);
+    oRawServer.RegisterArtSyncMessageHandler(fnIgnore);
+    oRawServer.RegisterDiscoveryMessageHandler(fnIgnore);
+    oRawServer.RegisterPollMessageHandler(fnIgnore);
+    oRawServer.RegisterFecMessageHandler(fnIgnore);
+    CHECK_EQ(oRawServer.Start(), ESP_OK);
+
+    RUN_TEST(TestParse);
+    RUN_TEST(TestSocketServer);
+    RUN_TEST(TestRawServer);
+    RUN_TEST(TestSyscalls);
+    return TestResult();
+}
@@ -0,0 +1,80 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "artnet_filter.h"
+#include "port.h"
+#include "lwip/inet.h"
+#include <string.h>
+#include <vector>
+
+using namespace ArtNet;
+
+static std::vector<uint8_t> MakeHeader(uint16_t u16OpCode, size_t u32Length)
+{
+    std::vector<uint8_t> vPacket(u32Length, 0);
+    memcpy(vPacket.data(), ID, sizeof(ID));
+    vPacket[OFFSET_OPCODE] = u16OpCode & 0xFF;
+    vPacket[OFFSET_OPCODE + 1] = u16OpCode >> 8;
+    vPacket[OFFSET_PROT_VER_LO] = PROTOCOL_VERSION;
+    return vPacket;
+}
+
+static bool Accept(ArtNetFilter &oFilter, const std::vector<uint8_t> &vPacket)
+{
+    Packet oPacket;
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()), PARSE_OK);
+    return oFilter.Accept(oPacket, htonl(0x0A000002));
+}
+
+static bool AcceptDmx(ArtNetFilter &oFilter, int32_t s32PortAddress)
+{
+    std::vector<uint8_t> vPacket = MakeHeader(OP_DMX, OFFSET_DMX_DATA + 30);
+    vPacket[OFFSET_DMX_SUBUNI] = s32PortAddress & 0xFF;
+    vPacket[OFFSET_DMX_NET] = s32PortAddress >> 8;
+    vPacket[OFFSET_DMX_LENGTH_LO] = 30;
+    return Accept(oFilter, vPacket);
+}
+
+// Ownership follows the universes of the ports, not the node's StartUniverse / NoUniverses: ArtDmx for a
+// port outside that range passes and reaches the port, ArtDmx inside it that no port owns is dropped.
+static void TestPortUniverses()
+{
+    ArtNetFilter oFilter;
+    CHECK(AcceptDmx(oFilter, 40));
+    CHECK(AcceptDmx(oFilter, 41));
+    CHECK(AcceptDmx(oFilter, 3));
+    CHECK(!AcceptDmx(oFilter, 0));
+    CHECK(!AcceptDmx(oFilter, 42));
+    CHECK(!AcceptDmx(oFilter, 2));
+    CHECK_EQ(oFilter.GetDropCount(ArtNetFilter::DROP_NOT_OWNED), 3);
+    // Not ArtDmx, always let through.
+    CHECK(Accept(oFilter, MakeHeader(OP_POLL, POLL_LENGTH)));
+
+    std::vector<uint8_t> vPayload(30, 0x55);
+    CHECK_EQ(Ports::GetInstance().WriteUniverse(40, 0, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    CHECK_EQ(Ports::GetInstance().WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data()), 0);
+}
+
+// A settings change moves the owned universes with it.
+static void TestReconfigure()
+{
+    ArtNetFilter oFilter;
+    CHECK(AcceptDmx(oFilter, 40));
+    ConfigurePorts("{\"Ports\":[{\"StartUniverse\":60,\"NoUniverses\":1}]}");
+    CHECK(!AcceptDmx(oFilter, 40));
+    CHECK(AcceptDmx(oFilter, 60));
+    CHECK(AcceptDmx(oFilter, 3));
+}
+
+int main()
+{
+    ConfigurePorts("{\"StartUniverse\":0,\"NoUniverses\":1,\"Ports\":["
+                   "{\"StartUniverse\":40,\"NoUniverses\":2,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":3,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    StartOutputTask();
+
+    RUN_TEST(TestPortUniverses);
+    RUN_TEST(TestReconfigure);
+    return TestResult();
+}
@@ -0,0 +1,225 @@
+#include "host_test.h"
+#include "artnet_packet.h"
+#include "cJSON.h"
+#include <chrono>
+#include <vector>
+
+using namespace ArtNet;
+
+static std::vector<uint8_t> MakeHeader(uint16_t u16OpCode, size_t u32Length)
+{
+    std::vector<uint8_t> vPacket(u32Length, 0);
+    memcpy(vPacket.data(), ID, sizeof(ID));
+    vPacket[OFFSET_OPCODE] = u16OpCode & 0xFF;
+    vPacket[OFFSET_OPCODE + 1] = u16OpCode >> 8;
+    vPacket[OFFSET_PROT_VER_LO] = PROTOCOL_VERSION;
+    return vPacket;
+}
+
+static std::vector<uint8_t> MakeDmx(uint8_t u8Sequence, uint8_t u8Net, uint8_t u8SubUni, uint16_t u16Length, size_t u32PayloadBytes)
+{
+    std::vector<uint8_t> vPacket = MakeHeader(OP_DMX, OFFSET_DMX_DATA + u32PayloadBytes);
+    vPacket[OFFSET_DMX_SEQUENCE] = u8Sequence;
+    vPacket[OFFSET_DMX_PHYSICAL] = 3;
+    vPacket[OFFSET_DMX_SUBUNI] = u8SubUni;
+    vPacket[OFFSET_DMX_NET] = u8Net;
+    vPacket[OFFSET_DMX_LENGTH_HI] = u16Length >> 8;
+    vPacket[OFFSET_DMX_LENGTH_LO] = u16Length & 0xFF;
+    for (size_t i = 0; i < u32PayloadBytes; ++i)
+    {
+        vPacket[OFFSET_DMX_DATA + i] = (uint8_t)i;
+    }
+    return vPacket;
+}
+
+static ParseResult Parse(Packet &oPacket, const std::vector<uint8_t> &vPacket)
+{
+    return oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size());
+}
+
+// The fields of a valid ArtDmx, the 15-bit Port-Address above the 8-bit range and the unsigned bytes that used
+// to be read as char.
+static void TestDmxFields()
+{
+    Packet oPacket;
+    std::vector<uint8_t> vPacket = MakeDmx(0xC8, 0x7F, 0xFF, 512, 512);
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK_EQ(oPacket.GetOpCode(), OP_DMX);
+    CHECK_EQ(oPacket.GetProtocolVersion(), PROTOCOL_VERSION);
+    CHECK_EQ(oPacket.GetSequence(), 0xC8);
+    CHECK_EQ(oPacket.GetPhysical(), 3);
+    CHECK_EQ(oPacket.GetPortAddress(), 0x7FFF);
+    CHECK_EQ(oPacket.GetDmxLength(), 512);
+    CHECK(oPacket.GetDmxData() == vPacket.data() + OFFSET_DMX_DATA);
+
+    // Bit 7 of Net is not part of the Port-Address.
+    vPacket = MakeDmx(1, 0x81, 0x23, 2, 2);
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK_EQ(oPacket.GetPortAddress(), 0x0123);
+
+    // Only the header copied out of a pbuf chain: valid, without a contiguous payload.
+    vPacket = MakeDmx(1, 0, 0, 100, 100);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), OFFSET_DMX_DATA, vPacket.size()), PARSE_OK);
+    CHECK(oPacket.GetDmxData() == nullptr);
+}
+
+// The length field has to be 1..512 and covered by the datagram, extra trailing bytes are fine.
+static void TestDmxLength()
+{
+    Packet oPacket;
+    CHECK_EQ(Parse(oPacket, MakeDmx(1, 0, 0, 0, 0)), PARSE_BAD_LENGTH);
+    CHECK_EQ(Parse(oPacket, MakeDmx(1, 0, 0, 513, 513)), PARSE_BAD_LENGTH);
+    CHECK_EQ(Parse(oPacket, MakeDmx(1, 0, 0, 512, 511)), PARSE_BAD_LENGTH);
+    CHECK_EQ(Parse(oPacket, MakeDmx(1, 0, 0, 2, 10)), PARSE_OK);
+    CHECK_EQ(Parse(oPacket, MakeDmx(1, 0, 0, 1, 1)), PARSE_OK);
+    std::vector<uint8_t> vPacket = MakeDmx(1, 0, 0, 2, 2);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), OFFSET_DMX_DATA - 1, OFFSET_DMX_DATA - 1), PARSE_TOO_SHORT);
+}
+
+// ID and version are checked before anything opcode specific.
+static void TestHeader()
+{
+    Packet oPacket;
+    std::vector<uint8_t> vPacket = MakeDmx(1, 0, 0, 2, 2);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), OFFSET_OPCODE + 1, vPacket.size()), PARSE_TOO_SHORT);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), HEADER_LENGTH - 1, vPacket.size()), PARSE_TOO_SHORT);
+
+    vPacket[OFFSET_ID + 7] = 'x';
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_BAD_ID);
+    vPacket = MakeDmx(1, 0, 0, 2, 2);
+    vPacket[OFFSET_PROT_VER_LO] = PROTOCOL_VERSION - 1;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_BAD_VERSION);
+    vPacket[OFFSET_PROT_VER_HI] = 1;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+
+    vPacket = MakeHeader(OP_POLL_REPLY, 239);
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_UNSUPPORTED_OPCODE);
+}
+
+static void TestSyncAndPoll()
+{
+    Packet oPacket;
+    CHECK_EQ(Parse(oPacket, MakeHeader(OP_SYNC, SYNC_LENGTH)), PARSE_OK);
+    CHECK_EQ(oPacket.GetOpCode(), OP_SYNC);
+    CHECK_EQ(Parse(oPacket, MakeHeader(OP_SYNC, SYNC_LENGTH - 1)), PARSE_TOO_SHORT);
+
+    std::vector<uint8_t> vPacket = MakeHeader(OP_POLL, POLL_LENGTH);
+    vPacket[OFFSET_POLL_FLAGS] = 0x06;
+    vPacket[OFFSET_POLL_DIAG_PRIORITY] = 0x40;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK_EQ(oPacket.GetPollFlags(), 0x06);
+    CHECK_EQ(oPacket.GetPollDiagPriority(), 0x40);
+    CHECK_EQ(Parse(oPacket, MakeHeader(OP_POLL, POLL_LENGTH - 1)), PARSE_TOO_SHORT);
+}
+
+// The vendor ArtConfig is matched on its opcode alone, whatever precedes it.
+static void TestConfig()
+{
+    Packet oPacket;
+    std::vector<uint8_t> vPacket(64, 0);
+    vPacket[OFFSET_OPCODE] = OP_CONFIG & 0xFF;
+    vPacket[OFFSET_OPCODE + 1] = OP_CONFIG >> 8;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK_EQ(oPacket.GetOpCode(), OP_CONFIG);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), OFFSET_OPCODE + 2, OFFSET_OPCODE + 2), PARSE_OK);
+}
+
+static void TestParseStats()
+{
+    ParseStats oStats;
+    oStats.Add(PARSE_OK);
+    oStats.Add(PARSE_OK);
+    oStats.Add(PARSE_BAD_ID);
+    CHECK_EQ(oStats.Get(PARSE_OK), 2);
+    CHECK_EQ(oStats.Get(PARSE_BAD_ID), 1);
+    CHECK_EQ(oStats.Get(PARSE_TOO_SHORT), 0);
+    cJSON *pJson = oStats.ToJson();
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "Ok")->valueint, 2);
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "BadId")->valueint, 1);
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "UnsupportedOpCode")->valueint, 0);
+    cJSON_Delete(pJson);
+}
+
+static uint32_t g_u32Random = 0x12345678;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+// Mutated and truncated datagrams in buffers of their exact size: the sanitizers catch any read past the header,
+// and whatever is accepted has to be safe to use as the firmware uses it.
+static void TestFuzz()
+{
+    static const uint16_t au16OpCodes[] = {OP_DMX, OP_SYNC, OP_POLL, OP_CONFIG, OP_DMX_BATCH, OP_FEC, OP_POLL_REPLY};
+    Packet oPacket;
+    uint32_t u32Unsafe = 0, u32Accepted = 0;
+    for (int32_t i = 0; i < 200000; ++i)
+    {
+        std::vector<uint8_t> vSeed = MakeDmx(Random(), Random(), Random(), Random() % 530, Random() % 530);
+        uint16_t u16OpCode = au16OpCodes[Random() % (sizeof(au16OpCodes) / sizeof(au16OpCodes[0]))];
+        vSeed[OFFSET_OPCODE] = u16OpCode & 0xFF;
+        vSeed[OFFSET_OPCODE + 1] = u16OpCode >> 8;
+        for (uint32_t u32Flips = Random() % 4; u32Flips > 0; --u32Flips)
+        {
+            vSeed[Random() % OFFSET_DMX_DATA] ^= 1 << (Random() % 8);
+        }
+        std::vector<uint8_t> vPacket(vSeed.begin(), vSeed.begin() + Random() % (vSeed.size() + 1));
+        if (Parse(oPacket, vPacket) != PARSE_OK)
+        {
+            continue;
+        }
+        u32Accepted++;
+        switch (oPacket.GetOpCode())
+        {
+        case OP_DMX:
+            u32Unsafe += OFFSET_DMX_DATA + oPacket.GetDmxLength() > vPacket.size() || oPacket.GetDmxLength() > MAXIMUM_DMX_LENGTH;
+            u32Unsafe += oPacket.GetPortAddress() > 0x7FFF;
+            break;
+        case OP_SYNC:
+            u32Unsafe += vPacket.size() < SYNC_LENGTH;
+            break;
+        case OP_POLL:
+            u32Unsafe += vPacket.size() < POLL_LENGTH;
+            break;
+        default:
+            break;
+        }
+    }
+    CHECK_EQ(u32Unsafe, 0);
+    CHECK(u32Accepted > 0);
+}
+
+// Parse cost per packet, for comparison only: it is not checked, the sanitizers slow it down.
+static void TestBenchmark()
+{
+    std::vector<uint8_t> vPacket = MakeDmx(1, 0, 1, 510, 510);
+    const int32_t s32Packets = 2000000;
+    Packet oPacket;
+    uint32_t u32Ok = 0;
+    auto stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Packets; ++i)
+    {
+        vPacket[OFFSET_DMX_SEQUENCE] = (uint8_t)i;
+        u32Ok += Parse(oPacket, vPacket) == PARSE_OK && oPacket.GetPortAddress() == 1;
+    }
+    double dNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count();
+    CHECK_EQ(u32Ok, s32Packets);
+    printf("ArtDmx parse: %.1f ns per packet\n", dNs / s32Packets);
+}
+
+int main()
+{
+    RUN_TEST(TestDmxFields);
+    RUN_TEST(TestDmxLength);
+    RUN_TEST(TestHeader);
+    RUN_TEST(TestSyncAndPoll);
+    RUN_TEST(TestConfig);
+    RUN_TEST(TestParseStats);
+    RUN_TEST(TestFuzz);
+    RUN_TEST(TestBenchmark);
+    return TestResult();
+}
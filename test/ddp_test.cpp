@@ -0,0 +1,428 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_rmt.h"
+#include "port.h"
+#include "udp_server.h"
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace DDP;
+
+static std::vector<uint8_t> MakeDdp(uint8_t u8Flags, uint8_t u8Sequence, uint32_t u32Offset, const std::vector<uint8_t> &vData)
+{
+    size_t u32Header = HEADER_LENGTH + ((u8Flags & FLAG_TIMECODE) ? TIMECODE_LENGTH : 0);
+    std::vector<uint8_t> vPacket(u32Header, 0);
+    vPacket[OFFSET_FLAGS] = FLAG_VERSION_1 | u8Flags;
+    vPacket[OFFSET_SEQUENCE] = u8Sequence;
+    vPacket[OFFSET_TYPE] = TYPE_RGB_8BIT;
+    vPacket[OFFSET_ID] = ID_DISPLAY;
+    for (int32_t i = 0; i < 4; ++i)
+    {
+        vPacket[OFFSET_DATA_OFFSET + i] = u32Offset >> (24 - 8 * i);
+    }
+    vPacket[OFFSET_DATA_LENGTH] = vData.size() >> 8;
+    vPacket[OFFSET_DATA_LENGTH + 1] = vData.size();
+    vPacket.insert(vPacket.end(), vData.begin(), vData.end());
+    return vPacket;
+}
+
+static ParseResult Parse(Packet &oPacket, const std::vector<uint8_t> &vPacket)
+{
+    return oPacket.Parse(vPacket.data(), vPacket.size());
+}
+
+static void TestParse()
+{
+    Packet oPacket;
+    std::vector<uint8_t> vData(MAXIMUM_DATA_LENGTH, 0x5A);
+    std::vector<uint8_t> vPacket = MakeDdp(FLAG_PUSH, 0x37, 0x01020300, vData);
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK(oPacket.IsPush());
+    CHECK_EQ(oPacket.GetSequence(), 7);
+    CHECK_EQ(oPacket.GetDataOffset(), 0x01020300);
+    CHECK_EQ(oPacket.GetDataLength(), MAXIMUM_DATA_LENGTH);
+    CHECK_EQ(oPacket.GetHeaderLength(), HEADER_LENGTH);
+    CHECK(oPacket.GetData() == vPacket.data() + HEADER_LENGTH);
+
+    // The timecode moves the data back, it is not interpreted.
+    vPacket = MakeDdp(FLAG_TIMECODE, 1, 3, {1, 2, 3});
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK(!oPacket.IsPush());
+    CHECK_EQ(oPacket.GetHeaderLength(), HEADER_LENGTH + TIMECODE_LENGTH);
+    CHECK_EQ(oPacket.GetData()[0], 1);
+    CHECK_EQ(Parse(oPacket, std::vector<uint8_t>(vPacket.begin(), vPacket.end() - 1)), PARSE_BAD_LENGTH);
+
+    // A push alone carries no data, extra trailing bytes are fine.
+    vPacket = MakeDdp(FLAG_PUSH, 0, 0, {});
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK_EQ(oPacket.GetDataLength(), 0);
+    vPacket.push_back(0);
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), HEADER_LENGTH - 1), PARSE_TOO_SHORT);
+
+    vData.push_back(0);
+    CHECK_EQ(Parse(oPacket, MakeDdp(0, 1, 0, vData)), PARSE_BAD_LENGTH);
+    vPacket = MakeDdp(0, 1, 0, {1, 2, 3});
+    vPacket[OFFSET_FLAGS] = 0x80;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_BAD_VERSION);
+    for (uint8_t u8Flag : {FLAG_QUERY, FLAG_REPLY, FLAG_STORAGE})
+    {
+        CHECK_EQ(Parse(oPacket, MakeDdp(u8Flag, 1, 0, {1, 2, 3})), PARSE_UNSUPPORTED);
+    }
+    vPacket = MakeDdp(0, 1, 0, {1, 2, 3});
+    vPacket[OFFSET_ID] = 2;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_UNSUPPORTED);
+    vPacket[OFFSET_ID] = ID_ALL;
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    for (uint8_t u8Type : {TYPE_UNDEFINED, TYPE_RGB})
+    {
+        vPacket[OFFSET_TYPE] = u8Type;
+        CHECK_EQ(Parse(oPacket, vPacket), PARSE_OK);
+    }
+    vPacket[OFFSET_TYPE] = 0x1B; // RGBW
+    CHECK_EQ(Parse(oPacket, vPacket), PARSE_UNSUPPORTED);
+}
+
+// The ports behind WriteLinear() and Push(), shown per port by the output task on the host kernel's virtual clock:
+// 10 LEDs on port 0 then 10 on port 1, both LED2811 with the identity transform so the wire data is the RGB sent.
+static uint32_t Shown(int32_t s32Pin)
+{
+    return HostRmt::FindChannel(s32Pin)->u32TransmitCount;
+}
+
+static std::vector<uint8_t> Data(int32_t s32Pin)
+{
+    return HostRmt::FindChannel(s32Pin)->vData;
+}
+
+static size_t WriteLinear(std::vector<uint8_t> &vExpected, size_t u32Offset, size_t u32Length, uint8_t u8Value)
+{
+    std::vector<uint8_t> vData(u32Length, u8Value);
+    size_t u32Copied = Ports::GetInstance().WriteLinear(u32Offset, u32Length, CopyFromBuffer, vData.data());
+    memcpy(&vExpected[u32Offset], vData.data(), u32Copied);
+    return u32Copied;
+}
+
+static void Push()
+{
+    Ports::GetInstance().Push();
+    HostKernel::WaitIdle();
+}
+
+static std::vector<uint8_t> g_vExpected(60);
+
+// A push that covers part of a port shows the rest as it was last pushed, through every frame of the triple buffer.
+static void TestPartialPush()
+{
+    uint32_t u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN), u32Shown1 = Shown(PROJECT_PORT_1_DATA_PIN);
+    std::vector<uint8_t> vFull(g_vExpected.size());
+    for (size_t i = 0; i < vFull.size(); ++i)
+    {
+        vFull[i] = i;
+    }
+    CHECK_EQ(Ports::GetInstance().WriteLinear(0, vFull.size(), CopyFromBuffer, vFull.data()), vFull.size());
+    g_vExpected = vFull;
+    Push();
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+    CHECK(Data(PROJECT_PORT_0_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin(), g_vExpected.begin() + 30));
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin() + 30, g_vExpected.end()));
+
+    for (uint8_t u8Round = 1; u8Round <= 6; ++u8Round)
+    {
+        CHECK_EQ(WriteLinear(g_vExpected, u8Round * 3, 3, 0x80 + u8Round), 3);
+        // Only written ports are committed.
+        Push();
+        CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1 + u8Round);
+        CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+        CHECK(Data(PROJECT_PORT_0_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin(), g_vExpected.begin() + 30));
+    }
+}
+
+// A write across the end of port 0 is split over both ports, several writes make up one push and nothing is
+// shown before it.
+static void TestSplitWrites()
+{
+    uint32_t u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN), u32Shown1 = Shown(PROJECT_PORT_1_DATA_PIN);
+    CHECK_EQ(WriteLinear(g_vExpected, 27, 6, 0xC0), 6);
+    CHECK_EQ(WriteLinear(g_vExpected, 45, 9, 0xC1), 9);
+    HostKernel::WaitIdle();
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0);
+    Push();
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+    CHECK(Data(PROJECT_PORT_0_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin(), g_vExpected.begin() + 30));
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin() + 30, g_vExpected.end()));
+
+    // Past the last pixel is cut off, partial pixels are refused and counted.
+    CHECK_EQ(WriteLinear(g_vExpected, 57, 6, 0xC2), 3);
+    std::vector<uint8_t> vData(6, 0xC3);
+    CHECK_EQ(Ports::GetInstance().WriteLinear(60, 3, CopyFromBuffer, vData.data()), 0);
+    CHECK_EQ(Ports::GetInstance().WriteLinear(1, 3, CopyFromBuffer, vData.data()), 0);
+    CHECK_EQ(Ports::GetInstance().WriteLinear(0, 4, CopyFromBuffer, vData.data()), 0);
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "MisalignedLinearWrites")->valueint, 2);
+    cJSON_Delete(pJson);
+    Push();
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin() + 30, g_vExpected.end()));
+}
+
+static int32_t GetLockTimeouts()
+{
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    int32_t s32Count = cJSON_GetObjectItemCaseSensitive(pJson, "ReceiveLockTimeouts")->valueint;
+    cJSON_Delete(pJson);
+    return s32Count;
+}
+
+// Copies the payload, then keeps the receive mutex for 10 ms like assembly stuck behind a slow copy.
+static size_t SlowCopy(void *pDest, size_t u32Length, void *pvContext)
+{
+    size_t u32Copied = CopyFromBuffer(pDest, u32Length, pvContext);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    return u32Copied;
+}
+
+static size_t g_u32LinearCopied = 0;
+static size_t g_u32FrameCopied = 0;
+
+static void HolderTask(void *pvData)
+{
+    Ports::GetInstance().WriteUniverse(0, 0, 30, SlowCopy, pvData);
+}
+
+static void LinearTask(void *pvData)
+{
+    g_u32LinearCopied = Ports::GetInstance().WriteLinear(30, 3, CopyFromBuffer, pvData);
+}
+
+static void FrameTask(void *pvData)
+{
+    g_u32FrameCopied = Ports::GetInstance().WritePortFrame(1, (const uint8_t *)pvData, 30);
+}
+
+static void PushTask(void *pvData)
+{
+    Ports::GetInstance().Push();
+}
+
+// Writes, whole port frames and pushes wait no longer than PROJECT_RECEIVE_LOCK_TIMEOUT_MS for a busy receive mutex, they are
+// dropped and counted instead. A dropped push leaves the written ports for the next one.
+static void TestBusyMutex()
+{
+    std::vector<uint8_t> vData(30, 0xD0);
+    uint32_t u32Shown1 = Shown(PROJECT_PORT_1_DATA_PIN);
+    int32_t s32Timeouts = GetLockTimeouts();
+    CHECK_EQ(WriteLinear(g_vExpected, 33, 3, 0xD1), 3);
+
+    xTaskCreate(HolderTask, "holder", 4096, vData.data(), 5, nullptr);
+    HostKernel::WaitIdle();
+    g_u32LinearCopied = 1;
+    g_u32FrameCopied = 1;
+    xTaskCreate(LinearTask, "linear", 4096, vData.data(), 5, nullptr);
+    xTaskCreate(FrameTask, "frame", 4096, vData.data(), 5, nullptr);
+    xTaskCreate(PushTask, "push", 4096, nullptr, 5, nullptr);
+    HostKernel::Advance(PROJECT_RECEIVE_LOCK_TIMEOUT_MS * 1000);
+    HostKernel::WaitIdle();
+    CHECK_EQ(g_u32LinearCopied, 0);
+    CHECK_EQ(g_u32FrameCopied, 0);
+    CHECK_EQ(GetLockTimeouts(), s32Timeouts + 3);
+    HostKernel::Advance(10000);
+    HostKernel::WaitIdle();
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1);
+
+    // Free again, the push shows what was written before the busy spell.
+    Push();
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == std::vector<uint8_t>(g_vExpected.begin() + 30, g_vExpected.end()));
+    CHECK_EQ(GetLockTimeouts(), s32Timeouts + 3);
+}
+
+// The receiver on its real socket, served by the reactor on its own thread. The handlers record what reaches
+// them, push is recorded as an entry of its own.
+typedef struct
+{
+    uint32_t u32Offset;
+    uint32_t u32Length;
+    uint8_t u8First;
+    bool bPush;
+} Received;
+
+static std::mutex g_oMutex;
+static std::vector<Received> g_vReceived;
+static UdpReactor g_oReactor;
+static int32_t g_s32Sender = -1;
+
+static void Send(const std::vector<uint8_t> &vPacket)
+{
+    struct sockaddr_in stDestination = {};
+    stDestination.sin_family = AF_INET;
+    stDestination.sin_port = htons(UDP_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &stDestination.sin_addr);
+    sendto(g_s32Sender, vPacket.data(), vPacket.size(), 0, (struct sockaddr *)&stDestination, sizeof(stDestination));
+}
+
+static size_t GetReceived()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_vReceived.size();
+}
+
+static bool WaitReceived(size_t u32Count)
+{
+    for (int32_t i = 0; i < 3000 && GetReceived() < u32Count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return GetReceived() >= u32Count;
+}
+
+static int32_t GetStatus(const char *pName, const char *pParse = nullptr)
+{
+    cJSON *pJson = DdpServer::GetInstance().ToJson();
+    cJSON *pItem = cJSON_GetObjectItemCaseSensitive(pJson, pName);
+    int32_t s32Value = (pParse ? cJSON_GetObjectItemCaseSensitive(pItem, pParse) : pItem)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+// Data of a push packet is handled before the push. Invalid datagrams reach no handler, sequence gaps are counted.
+static void TestServer()
+{
+    Send(MakeDdp(0, 1, 0, std::vector<uint8_t>(MAXIMUM_DATA_LENGTH, 0x11)));
+    Send(MakeDdp(FLAG_TIMECODE, 2, MAXIMUM_DATA_LENGTH, std::vector<uint8_t>(MAXIMUM_DATA_LENGTH, 0x12)));
+    Send(MakeDdp(FLAG_PUSH, 3, 2 * MAXIMUM_DATA_LENGTH, std::vector<uint8_t>(180, 0x13)));
+    std::vector<uint8_t> vBad = MakeDdp(0, 4, 0, {1, 2, 3});
+    vBad[OFFSET_FLAGS] = 0;
+    Send(vBad);
+    Send(MakeDdp(FLAG_QUERY, 4, 0, {}));
+    Send(MakeDdp(FLAG_PUSH, 5, 0, {}));
+    CHECK(WaitReceived(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    {
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        CHECK_EQ(g_vReceived.size(), 5);
+        const Received astExpected[] = {{0, MAXIMUM_DATA_LENGTH, 0x11, false},
+                                        {MAXIMUM_DATA_LENGTH, MAXIMUM_DATA_LENGTH, 0x12, false},
+                                        {2 * MAXIMUM_DATA_LENGTH, 180, 0x13, false},
+                                        {0, 0, 0, true},
+                                        {0, 0, 0, true}};
+        for (size_t i = 0; i < std::min(g_vReceived.size(), sizeof(astExpected) / sizeof(astExpected[0])); ++i)
+        {
+            CHECK_EQ(g_vReceived[i].u32Offset, astExpected[i].u32Offset);
+            CHECK_EQ(g_vReceived[i].u32Length, astExpected[i].u32Length);
+            CHECK_EQ(g_vReceived[i].u8First, astExpected[i].u8First);
+            CHECK_EQ(g_vReceived[i].bPush, astExpected[i].bPush);
+        }
+    }
+    CHECK_EQ(GetStatus("DataPackets"), 3);
+    CHECK_EQ(GetStatus("BytesCopied"), 2 * MAXIMUM_DATA_LENGTH + 180);
+    CHECK_EQ(GetStatus("Pushes"), 2);
+    CHECK_EQ(GetStatus("SequenceGaps"), 1);
+    CHECK_EQ(GetStatus("Parse", "Ok"), 4);
+    CHECK_EQ(GetStatus("Parse", "BadVersion"), 1);
+    CHECK_EQ(GetStatus("Parse", "Unsupported"), 1);
+}
+
+// Receive cost of one 1020 pixel frame, parse and copy into the frame, against the six ArtDmx it takes. For
+// comparison only: it is not checked, the sanitizers slow it down.
+static void TestBenchmark()
+{
+    const size_t u32FrameBytes = 1020 * 3;
+    std::vector<std::vector<uint8_t>> vDdp, vArtDmx;
+    for (size_t u32Offset = 0; u32Offset < u32FrameBytes; u32Offset += MAXIMUM_DATA_LENGTH)
+    {
+        size_t u32Length = std::min(MAXIMUM_DATA_LENGTH, u32FrameBytes - u32Offset);
+        vDdp.push_back(MakeDdp(u32Offset + u32Length == u32FrameBytes ? FLAG_PUSH : 0, 1, u32Offset, std::vector<uint8_t>(u32Length, 1)));
+    }
+    for (size_t u32Offset = 0; u32Offset < u32FrameBytes; u32Offset += 510)
+    {
+        std::vector<uint8_t> vPacket(ArtNet::OFFSET_DMX_DATA, 0);
+        memcpy(vPacket.data(), ArtNet::ID, sizeof(ArtNet::ID));
+        vPacket[ArtNet::OFFSET_OPCODE] = ArtNet::OP_DMX & 0xFF;
+        vPacket[ArtNet::OFFSET_OPCODE + 1] = ArtNet::OP_DMX >> 8;
+        vPacket[ArtNet::OFFSET_PROT_VER_LO] = ArtNet::PROTOCOL_VERSION;
+        vPacket[ArtNet::OFFSET_DMX_SUBUNI] = u32Offset / 510;
+        vPacket[ArtNet::OFFSET_DMX_LENGTH_HI] = 510 >> 8;
+        vPacket[ArtNet::OFFSET_DMX_LENGTH_LO] = 510 & 0xFF;
+        vPacket.resize(ArtNet::OFFSET_DMX_DATA + 510, 1);
+        vArtDmx.push_back(vPacket);
+    }
+    CHECK_EQ(vDdp.size(), 3);
+    CHECK_EQ(vArtDmx.size(), 6);
+
+    const int32_t s32Frames = 200000;
+    std::vector<uint8_t> vFrame(u32FrameBytes);
+    uint64_t u64Copied = 0;
+    auto stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Frames; ++i)
+    {
+        for (const std::vector<uint8_t> &vPacket : vDdp)
+        {
+            Packet oPacket;
+            if (Parse(oPacket, vPacket) == PARSE_OK)
+            {
+                memcpy(&vFrame[oPacket.GetDataOffset()], oPacket.GetData(), oPacket.GetDataLength());
+                u64Copied += oPacket.GetDataLength();
+            }
+        }
+    }
+    double dDdpNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count();
+    stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Frames; ++i)
+    {
+        for (const std::vector<uint8_t> &vPacket : vArtDmx)
+        {
+            ArtNet::Packet oPacket;
+            if (oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()) == ArtNet::PARSE_OK)
+            {
+                memcpy(&vFrame[oPacket.GetPortAddress() * 510], oPacket.GetDmxData(), oPacket.GetDmxLength());
+                u64Copied += oPacket.GetDmxLength();
+            }
+        }
+    }
+    double dArtDmxNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count();
+    CHECK_EQ(u64Copied, 2ULL * s32Frames * u32FrameBytes);
+    printf("1020 pixel frame: DDP %zu packets %.1f ns, ArtDmx %zu packets %.1f ns\n", vDdp.size(), dDdpNs / s32Frames,
+           vArtDmx.size(), dArtDmxNs / s32Frames);
+}
+
+int main()
+{
+    ConfigurePorts("{\"ArtNetSync\":false,\"FrameOutputMode\":\"PerPort\",\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    StartOutputTask();
+
+    DdpServer &oServer = DdpServer::GetInstance();
+    oServer.RegisterPayloadHandler([](size_t u32Offset, size_t u32Length, PayloadCopier_t fnCopy, void *pvContext)
+    {
+        uint8_t au8Payload[MAXIMUM_DATA_LENGTH];
+        size_t u32Copied = fnCopy(au8Payload, std::min(u32Length, sizeof(au8Payload)), pvContext);
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        g_vReceived.push_back({(uint32_t)u32Offset, (uint32_t)u32Length, au8Payload[0], false});
+        return u32Copied;
+    });
+    oServer.RegisterPushMessageHandler([](const char *pBuffer, size_t u32Length, const char *pSender)
+    {
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        g_vReceived.push_back({0, 0, 0, true});
+    });
+    oServer.Attach(g_oReactor, UDP_PORT);
+    std::thread([]() { g_oReactor.Run(); }).detach();
+    g_s32Sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+
+    RUN_TEST(TestParse);
+    RUN_TEST(TestPartialPush);
+    RUN_TEST(TestSplitWrites);
+    RUN_TEST(TestBusyMutex);
+    RUN_TEST(TestServer);
+    RUN_TEST(TestBenchmark);
+    return TestResult();
+}
@@ -0,0 +1,348 @@
+#include "host_test.h"
+#include "config.h"
+#include "host_kernel.h"
+#include "udp_server.h"
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace DeltaStream;
+
+static uint32_t g_u32Random = 0x2545F491;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+// Test patterns of an LED show, frame by frame: a few pixels changing, a chase, a fade of the whole strip and noise.
+enum Pattern
+{
+    PATTERN_SPARKLE,
+    PATTERN_CHASE,
+    PATTERN_FADE,
+    PATTERN_NOISE,
+    PATTERN_COUNT,
+};
+
+static const char *g_apPatternNames[PATTERN_COUNT] = {"sparkle", "chase", "fade", "noise"};
+
+static void NextFrame(Pattern ePattern, uint32_t u32Frame, std::vector<uint8_t> &vFrame)
+{
+    size_t u32Pixels = vFrame.size() / 3;
+    switch (ePattern)
+    {
+    case PATTERN_SPARKLE:
+        for (int32_t i = 0; i < 8; ++i)
+        {
+            memset(&vFrame[Random() % u32Pixels * 3], Random(), 3);
+        }
+        break;
+    case PATTERN_CHASE:
+        for (size_t p = 0; p < u32Pixels; ++p)
+        {
+            bool bLit = (p + u32Frame) % 30 < 5;
+            vFrame[p * 3] = bLit ? 0xFF : 0;
+            vFrame[p * 3 + 1] = bLit ? 0x80 : 0;
+            vFrame[p * 3 + 2] = 0;
+        }
+        break;
+    case PATTERN_FADE:
+        for (size_t p = 0; p < u32Pixels; ++p)
+        {
+            vFrame[p * 3] = u32Frame;
+            vFrame[p * 3 + 1] = p / 10 + u32Frame;
+            vFrame[p * 3 + 2] = 0x40;
+        }
+        break;
+    default:
+        for (uint8_t &u8Byte : vFrame)
+        {
+            u8Byte = Random();
+        }
+        break;
+    }
+}
+
+// Applies one datagram the way the node does, without the loss handling. False if it is not valid.
+static bool Decode(const uint8_t *pData, size_t u32Length, std::vector<uint8_t> &vFrame, Header &stHeader)
+{
+    return ReadHeader(pData, u32Length, stHeader) &&
+           ApplyOps(vFrame.data(), vFrame.size() / 3, stHeader.u16FirstPixel, pData + HEADER_LENGTH, stHeader.u16OpsLength, stHeader.u8Type == TYPE_KEY);
+}
+
+// Every pattern, encoded and decoded frame by frame, comes out as it went in, keyframes every 10 frames included.
+static void TestRoundTrip()
+{
+    for (size_t u32Pixels : {1, 170, 1020, 10000})
+    {
+        for (int32_t i = 0; i < PATTERN_COUNT; ++i)
+        {
+            Encoder oEncoder(2, u32Pixels, 10);
+            std::vector<uint8_t> vFrame(u32Pixels * 3, 0), vDecoded(u32Pixels * 3, 0);
+            uint32_t u32Bad = 0, u32Keys = 0;
+            for (uint32_t u32Frame = 0; u32Frame < 30; ++u32Frame)
+            {
+                NextFrame((Pattern)i, u32Frame, vFrame);
+                uint32_t u32Packets = 0;
+                CHECK(oEncoder.EncodeFrame(vFrame.data(), [&](const uint8_t *pData, size_t u32Length)
+                {
+                    Header stHeader;
+                    u32Bad += !Decode(pData, u32Length, vDecoded, stHeader);
+                    u32Bad += stHeader.u8Port != 2 || stHeader.u16Sequence != u32Frame + 1 || stHeader.u16BaseSequence != u32Frame;
+                    u32Bad += stHeader.u8Index != u32Packets++;
+                    u32Keys += stHeader.u8Type == TYPE_KEY && stHeader.u8Index == 0;
+                }));
+                u32Bad += vDecoded != vFrame;
+                CHECK(u32Packets >= 1);
+            }
+            CHECK_EQ(u32Bad, 0);
+            CHECK_EQ(u32Keys, 3);
+            CHECK_EQ(oEncoder.GetSequence(), 30);
+        }
+    }
+    // Random noise beyond what MAXIMUM_PACKETS_PER_FRAME datagrams hold is refused as a whole.
+    Encoder oEncoder(0, 20000);
+    std::vector<uint8_t> vFrame(20000 * 3);
+    NextFrame(PATTERN_NOISE, 0, vFrame);
+    uint32_t u32Sent = 0;
+    CHECK(!oEncoder.EncodeFrame(vFrame.data(), [&](const uint8_t *pData, size_t u32Length) { u32Sent++; }));
+    CHECK_EQ(u32Sent, 0);
+}
+
+// Malformed ops stop at the frame's end, skips are refused in a keyframe, headers have to add up.
+static void TestMalformed()
+{
+    std::vector<uint8_t> vFrame(10 * 3, 0);
+    const uint8_t au8Literal[] = {OP_LITERAL | 1, 1, 2, 3, 4, 5, 6};
+    CHECK(ApplyOps(vFrame.data(), 10, 8, au8Literal, sizeof(au8Literal), true));
+    CHECK(!ApplyOps(vFrame.data(), 10, 9, au8Literal, sizeof(au8Literal), true));
+    CHECK(!ApplyOps(vFrame.data(), 10, 0, au8Literal, sizeof(au8Literal) - 1, true));
+    const uint8_t au8Run[] = {OP_RUN | 9, 7, 8, 9};
+    CHECK(ApplyOps(vFrame.data(), 10, 0, au8Run, sizeof(au8Run), true));
+    CHECK_EQ(vFrame[27], 7);
+    CHECK(!ApplyOps(vFrame.data(), 10, 1, au8Run, sizeof(au8Run), true));
+    CHECK(!ApplyOps(vFrame.data(), 10, 0, au8Run, 3, true));
+    const uint8_t au8Skip[] = {OP_SKIP | 9};
+    CHECK(ApplyOps(vFrame.data(), 10, 0, au8Skip, sizeof(au8Skip), false));
+    CHECK(!ApplyOps(vFrame.data(), 10, 0, au8Skip, sizeof(au8Skip), true));
+    CHECK(!ApplyOps(vFrame.data(), 10, 1, au8Skip, sizeof(au8Skip), false));
+
+    Header stHeader = {TYPE_DELTA, 1, 5, 4, 0, 1, 0, 3};
+    std::vector<uint8_t> vPacket(HEADER_LENGTH + 3);
+    WriteHeader(stHeader, vPacket.data());
+    Header stRead;
+    CHECK(ReadHeader(vPacket.data(), vPacket.size(), stRead));
+    CHECK_EQ(stRead.u16Sequence, 5);
+    CHECK_EQ(stRead.u16BaseSequence, 4);
+    CHECK(!ReadHeader(vPacket.data(), vPacket.size() - 1, stRead));
+    for (Header stBad : {Header{3, 1, 5, 4, 0, 1, 0, 3}, Header{TYPE_DELTA, 1, 5, 4, 1, 1, 0, 3},
+                         Header{TYPE_DELTA, 1, 5, 4, 0, MAXIMUM_PACKETS_PER_FRAME + 1, 0, 3}, Header{TYPE_DELTA, 1, 5, 4, 0, 0, 0, 3}})
+    {
+        WriteHeader(stBad, vPacket.data());
+        CHECK(!ReadHeader(vPacket.data(), vPacket.size(), stRead));
+    }
+    WriteHeader(stHeader, vPacket.data());
+    vPacket[3] = VERSION + 1;
+    CHECK(!ReadHeader(vPacket.data(), vPacket.size(), stRead));
+
+    // Key requests reach the encoder of their port only.
+    Encoder oEncoder(1, 10);
+    stHeader = {TYPE_KEY_REQUEST, 1, 5, 4, 0, 1, 0, 0};
+    WriteHeader(stHeader, vPacket.data());
+    CHECK(oEncoder.HandleKeyRequest(vPacket.data(), HEADER_LENGTH));
+    stHeader.u8Port = 0;
+    WriteHeader(stHeader, vPacket.data());
+    CHECK(!oEncoder.HandleKeyRequest(vPacket.data(), HEADER_LENGTH));
+}
+
+// The node's receiver on its real socket, served by the reactor on its own thread. The encoder sends from a local
+// socket and reads the key requests the node answers with on it.
+static std::mutex g_oMutex;
+static std::vector<std::pair<int32_t, std::vector<uint8_t>>> g_vFrames; // port, RGB
+static UdpReactor g_oReactor;
+static int32_t g_s32Sender = -1;
+static const size_t g_u32Pixels = 600;
+
+static void Send(const uint8_t *pData, size_t u32Length)
+{
+    struct sockaddr_in stDestination = {};
+    stDestination.sin_family = AF_INET;
+    stDestination.sin_port = htons(PROJECT_UDP_DELTA_STREAM_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &stDestination.sin_addr);
+    sendto(g_s32Sender, pData, u32Length, 0, (struct sockaddr *)&stDestination, sizeof(stDestination));
+}
+
+// Sends the frame's datagrams except the ones whose index is in u32DropMask.
+static void SendFrame(Encoder &oEncoder, const std::vector<uint8_t> &vFrame, uint32_t u32DropMask = 0)
+{
+    CHECK(oEncoder.EncodeFrame(vFrame.data(), [&](const uint8_t *pData, size_t u32Length)
+    {
+        if (!(u32DropMask & (1UL << pData[10])))
+        {
+            Send(pData, u32Length);
+        }
+    }));
+}
+
+static size_t GetFrames()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_vFrames.size();
+}
+
+static bool WaitFrames(size_t u32Count)
+{
+    for (int32_t i = 0; i < 3000 && GetFrames() < u32Count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return GetFrames() >= u32Count;
+}
+
+static bool GetLast(std::vector<uint8_t> &vFrame)
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    vFrame = g_vFrames.back().second;
+    return g_vFrames.back().first == 0;
+}
+
+// Waits for the node's key request and hands it to the encoder.
+static bool ReceiveKeyRequest(Encoder &oEncoder)
+{
+    std::vector<uint8_t> vRequest(64);
+    ssize_t s32Length = recv(g_s32Sender, vRequest.data(), vRequest.size(), 0);
+    return s32Length > 0 && oEncoder.HandleKeyRequest(vRequest.data(), s32Length);
+}
+
+static int32_t GetStatus(const char *pName)
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    cJSON *pJson = DeltaStreamServer::GetInstance().ToJson();
+    int32_t s32Value = cJSON_GetObjectItemCaseSensitive(pJson, pName)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+// A lost packet or frame costs the frames up to the keyframe the node asks for, nothing from a lost base is shown.
+static void TestLossRecovery()
+{
+    Encoder oEncoder(0, g_u32Pixels);
+    std::vector<uint8_t> vFrame(g_u32Pixels * 3, 0), vShown;
+    NextFrame(PATTERN_NOISE, 0, vFrame);
+    SendFrame(oEncoder, vFrame);
+    CHECK(WaitFrames(1));
+    for (uint32_t u32Frame = 1; u32Frame < 5; ++u32Frame)
+    {
+        NextFrame(PATTERN_SPARKLE, u32Frame, vFrame);
+        SendFrame(oEncoder, vFrame);
+        CHECK(WaitFrames(1 + u32Frame));
+        CHECK(GetLast(vShown));
+        CHECK(vShown == vFrame);
+    }
+    CHECK_EQ(GetStatus("KeyFrames"), 1);
+    CHECK_EQ(GetStatus("DeltaFrames"), 4);
+
+    // The second of a multi packet frame lost: the next frame gives it up and asks for a keyframe.
+    NextFrame(PATTERN_NOISE, 5, vFrame);
+    SendFrame(oEncoder, vFrame, 1 << 1);
+    NextFrame(PATTERN_SPARKLE, 6, vFrame);
+    SendFrame(oEncoder, vFrame);
+    CHECK(ReceiveKeyRequest(oEncoder));
+    NextFrame(PATTERN_SPARKLE, 7, vFrame);
+    SendFrame(oEncoder, vFrame);
+    CHECK(WaitFrames(6));
+    CHECK(GetLast(vShown));
+    CHECK(vShown == vFrame);
+    CHECK_EQ(GetFrames(), 6);
+    CHECK_EQ(GetStatus("Incomplete"), 1);
+    CHECK_EQ(GetStatus("BaseMismatch"), 1);
+    CHECK_EQ(GetStatus("KeyFrames"), 2);
+
+    // A whole frame lost, after the key request interval.
+    HostKernel::Advance(PROJECT_DELTA_STREAM_KEY_REQUEST_INTERVAL_MS * 1000LL);
+    NextFrame(PATTERN_SPARKLE, 8, vFrame);
+    SendFrame(oEncoder, vFrame, UINT32_MAX);
+    NextFrame(PATTERN_SPARKLE, 9, vFrame);
+    SendFrame(oEncoder, vFrame);
+    CHECK(ReceiveKeyRequest(oEncoder));
+    NextFrame(PATTERN_SPARKLE, 10, vFrame);
+    SendFrame(oEncoder, vFrame);
+    CHECK(WaitFrames(7));
+    CHECK(GetLast(vShown));
+    CHECK(vShown == vFrame);
+    CHECK_EQ(GetStatus("BaseMismatch"), 2);
+    CHECK_EQ(GetStatus("KeyRequests"), 2);
+}
+
+// Compression ratio against the RGB data and against the ArtDmx it replaces, and encode and decode cost per frame
+// of 1020 pixels. For comparison only: it is not checked, the sanitizers slow it down.
+static void TestBenchmark()
+{
+    const size_t u32Pixels = 1020;
+    const size_t u32ArtDmxBytes = (u32Pixels + 169) / 170 * (18 + 510);
+    const uint32_t u32Frames = 2000;
+    for (int32_t i = 0; i < PATTERN_COUNT; ++i)
+    {
+        Encoder oEncoder(0, u32Pixels);
+        std::vector<uint8_t> vFrame(u32Pixels * 3, 0), vDecoded(u32Pixels * 3, 0);
+        std::vector<std::vector<uint8_t>> vPackets;
+        uint64_t u64Bytes = 0, u64Packets = 0;
+        double dEncodeNs = 0, dDecodeNs = 0;
+        uint32_t u32Bad = 0;
+        for (uint32_t u32Frame = 0; u32Frame < u32Frames; ++u32Frame)
+        {
+            NextFrame((Pattern)i, u32Frame, vFrame);
+            vPackets.clear();
+            auto stStart = std::chrono::steady_clock::now();
+            oEncoder.EncodeFrame(vFrame.data(), [&](const uint8_t *pData, size_t u32Length) { vPackets.emplace_back(pData, pData + u32Length); });
+            dEncodeNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count();
+            stStart = std::chrono::steady_clock::now();
+            for (const std::vector<uint8_t> &vPacket : vPackets)
+            {
+                Header stHeader;
+                u32Bad += !Decode(vPacket.data(), vPacket.size(), vDecoded, stHeader);
+                u64Bytes += vPacket.size();
+            }
+            dDecodeNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count();
+            u64Packets += vPackets.size();
+            u32Bad += vDecoded != vFrame;
+        }
+        CHECK_EQ(u32Bad, 0);
+        printf("%-8s %.2f packets %6.0f bytes per frame, %5.1fx RGB %5.1fx ArtDmx, encode %6.0f ns decode %6.0f ns\n", g_apPatternNames[i],
+               (double)u64Packets / u32Frames, (double)u64Bytes / u32Frames, (double)u32Pixels * 3 * u32Frames / u64Bytes,
+               (double)u32ArtDmxBytes * u32Frames / u64Bytes, dEncodeNs / u32Frames, dDecodeNs / u32Frames);
+    }
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":4,\"LedCount\":600,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":4,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+
+    DeltaStreamServer &oServer = DeltaStreamServer::GetInstance();
+    oServer.RegisterPortFrameHandler([](int32_t s32Port, const uint8_t *pRgb, size_t u32Length)
+    {
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        g_vFrames.push_back({s32Port, std::vector<uint8_t>(pRgb, pRgb + u32Length)});
+    });
+    oServer.Attach(g_oReactor, PROJECT_UDP_DELTA_STREAM_PORT);
+    std::thread([]() { g_oReactor.Run(); }).detach();
+    g_s32Sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    struct timeval stTimeout = {3, 0};
+    setsockopt(g_s32Sender, SOL_SOCKET, SO_RCVTIMEO, &stTimeout, sizeof(stTimeout));
+
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestMalformed);
+    RUN_TEST(TestLossRecovery);
+    RUN_TEST(TestBenchmark);
+    return TestResult();
+}
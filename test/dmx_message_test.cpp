@@ -0,0 +1,172 @@
+#include "host_test.h"
+#include "dmx_message.h"
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Every operator new of the test binary is counted, the pool must not cause any once it exists.
+static std::atomic<uint32_t> g_u32Allocations(0);
+
+void *operator new(size_t u32Size)
+{
+    g_u32Allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(u32Size ? u32Size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// GCC cannot see that these pair with the operator new above.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// What the receive path does per ArtDmx: take a slot, receive into it, hand a copy to the port, which keeps
+// it until the universe after next replaces it.
+static void ReceivePacket(DMX512MessagePool &oPool, DMX512Message &oHeld, uint8_t u8Fill)
+{
+    DMX512Message oRx = oPool.Acquire();
+    CHECK(oRx.IsValid());
+    if (!oRx.IsValid())
+    {
+        return;
+    }
+    memset(oRx.GetBuffer(), u8Fill, DMX512Message::GetBufferLength());
+    oHeld = oRx;
+    oRx.Reset();
+}
+
+static void TestNoAllocationPerPacket()
+{
+    DMX512MessagePool *pPool = new DMX512MessagePool();
+    DMX512Message aHeld[4];
+    // Warm up, then no packet may allocate.
+    ReceivePacket(*pPool, aHeld[0], 0);
+    uint32_t u32Before = g_u32Allocations.load();
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        ReceivePacket(*pPool, aHeld[i % 4], i);
+    }
+    CHECK_EQ(g_u32Allocations.load() - u32Before, 0);
+    CHECK_EQ(pPool->GetFreeCount(), DMX512MessagePool::GetCapacity() - 4);
+    for (DMX512Message &oHeld : aHeld)
+    {
+        oHeld.Reset();
+    }
+    CHECK_EQ(pPool->GetFreeCount(), DMX512MessagePool::GetCapacity());
+    delete pPool;
+}
+
+static void TestExhaustionAndReferenceCounts()
+{
+    DMX512MessagePool oPool;
+    std::vector<DMX512Message> vHeld;
+    for (int32_t i = 0; i < DMX512MessagePool::GetCapacity(); ++i)
+    {
+        vHeld.push_back(oPool.Acquire());
+        CHECK(vHeld.back().IsValid());
+    }
+    CHECK_EQ(oPool.GetFreeCount(), 0);
+    DMX512Message oNone = oPool.Acquire();
+    CHECK(!oNone.IsValid());
+    CHECK(oNone.GetBuffer() == nullptr);
+    CHECK_EQ(oPool.GetExhaustedCount(), 1);
+
+    // Slots are distinct buffers.
+    for (size_t i = 0; i < vHeld.size(); ++i)
+    {
+        for (size_t j = i + 1; j < vHeld.size(); ++j)
+        {
+            CHECK(vHeld[i].GetBuffer() != vHeld[j].GetBuffer());
+        }
+    }
+
+    // Copies share the slot, the last one returns it.
+    DMX512Message oCopy = vHeld[0];
+    DMX512Message oSecond(oCopy);
+    CHECK(oCopy.GetBuffer() == vHeld[0].GetBuffer());
+    vHeld[0].Reset();
+    oCopy.Reset();
+    CHECK_EQ(oPool.GetFreeCount(), 0);
+    char *pBuffer = oSecond.GetBuffer();
+    oSecond.Reset();
+    CHECK_EQ(oPool.GetFreeCount(), 1);
+    DMX512Message oAgain = oPool.Acquire();
+    CHECK(oAgain.GetBuffer() == pBuffer);
+
+    // Moves do not touch the count.
+    DMX512Message oMoved(std::move(oAgain));
+    CHECK(!oAgain.IsValid());
+    oAgain = std::move(oMoved);
+    CHECK_EQ(oPool.GetFreeCount(), 0);
+    oAgain = oAgain;
+    CHECK_EQ(oPool.GetFreeCount(), 0);
+}
+
+static void TestUniverse()
+{
+    DMX512MessagePool oPool;
+    DMX512Message oMsg = oPool.Acquire();
+    uint8_t *pData = (uint8_t *)oMsg.GetBuffer();
+    pData[14] = 0x34; // SubUni
+    pData[15] = 0x92; // Net, the top bit is not part of the 15-bit Port-Address
+    CHECK_EQ(oMsg.GetUniverse(), 0x1234);
+}
+
+// Producers on several threads take, share and drop slots concurrently; a slot handed out twice would
+// show up as a foreign stamp in its buffer.
+static void TestConcurrentAcquireRelease()
+{
+    DMX512MessagePool oPool;
+    std::atomic<uint32_t> u32Torn(0);
+    std::atomic<uint32_t> u32Acquired(0);
+    std::vector<std::thread> vThreads;
+    for (uint32_t t = 0; t < 4; ++t)
+    {
+        vThreads.emplace_back([&oPool, &u32Torn, &u32Acquired, t]()
+        {
+            for (uint32_t i = 0; i < 50000; ++i)
+            {
+                DMX512Message oMsg = oPool.Acquire();
+                if (!oMsg.IsValid())
+                {
+                    continue;
+                }
+                u32Acquired++;
+                uint32_t u32Stamp = (t << 24) | i;
+                memcpy(oMsg.GetBuffer(), &u32Stamp, sizeof(u32Stamp));
+                DMX512Message oShared = oMsg;
+                oMsg.Reset();
+                std::this_thread::yield();
+                uint32_t u32Read;
+                memcpy(&u32Read, oShared.GetBuffer(), sizeof(u32Read));
+                if (u32Read != u32Stamp)
+                {
+                    u32Torn++;
+                }
+            }
+        });
+    }
+    for (std::thread &oThread : vThreads)
+    {
+        oThread.join();
+    }
+    CHECK_EQ(u32Torn.load(), 0);
+    CHECK(u32Acquired.load() > 0);
+    CHECK_EQ(oPool.GetFreeCount(), DMX512MessagePool::GetCapacity());
+    printf("%u acquired, %u exhausted\n", (unsigned)u32Acquired.load(), (unsigned)oPool.GetExhaustedCount());
+}
+
+int main()
+{
+    RUN_TEST(TestNoAllocationPerPacket);
+    RUN_TEST(TestExhaustionAndReferenceCounts);
+    RUN_TEST(TestUniverse);
+    RUN_TEST(TestConcurrentAcquireRelease);
+    return TestResult();
+}
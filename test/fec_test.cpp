@@ -0,0 +1,271 @@
+#include "host_test.h"
+#include "port.h"
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace ArtNet;
+
+static uint32_t g_u32Random = 0x6C8E9CF5;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+static std::vector<uint8_t> MakeFec(int32_t s32PortAddress, const std::vector<FecMember> &vMembers)
+{
+    std::vector<uint8_t> vPacket(MAXIMUM_FEC_LENGTH);
+    vPacket.resize(WriteFec(s32PortAddress, vMembers.data(), vMembers.size(), vPacket.data()));
+    return vPacket;
+}
+
+// The encoder's datagram parses as the node parses it, the parity is the XOR of the members' whole payloads.
+static void TestEncoder()
+{
+    std::vector<uint8_t> vA(512), vB(512), vC(100);
+    for (size_t i = 0; i < vA.size(); ++i)
+    {
+        vA[i] = Random();
+        vB[i] = Random();
+    }
+    for (uint8_t &u8Byte : vC)
+    {
+        u8Byte = Random();
+    }
+    std::vector<uint8_t> vPacket = MakeFec(0x1234, {{1, 512, vA.data()}, {2, 510, vB.data()}, {3, 100, vC.data()}});
+    Packet oPacket;
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()), PARSE_OK);
+    CHECK_EQ(oPacket.GetOpCode(), OP_FEC);
+    CHECK_EQ(oPacket.GetFecCount(), 3);
+    CHECK_EQ(oPacket.GetFecPortAddress(), 0x1234);
+    CHECK_EQ(oPacket.GetFecLength(), 512);
+    CHECK_EQ(vPacket.size(), OFFSET_FEC_ENTRIES + 3 * FEC_ENTRY_LENGTH + 512);
+    CHECK_EQ(oPacket.GetFecSequence(1), 2);
+    CHECK_EQ(oPacket.GetFecUniverseLength(0), 512);
+    CHECK_EQ(oPacket.GetFecUniverseLength(2), 100);
+    uint32_t u32Bad = 0;
+    for (size_t i = 0; i < 512; ++i)
+    {
+        uint8_t u8Expected = vA[i] ^ (i < 510 ? vB[i] : 0) ^ (i < 100 ? vC[i] : 0);
+        u32Bad += oPacket.GetFecData()[i] != u8Expected;
+    }
+    CHECK_EQ(u32Bad, 0);
+    // Short universes make a short parity.
+    vPacket = MakeFec(7, {{1, 30, vA.data()}, {1, 31, vB.data()}});
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size(), vPacket.size()), PARSE_OK);
+    CHECK_EQ(oPacket.GetFecLength(), 31);
+}
+
+// Loss injection: the same stream of frames and the same losses reach a port without FEC and one with it. A frame
+// counts as complete when the port committed exactly the frame that was sent; with FEC a single lost universe of a
+// group costs nothing as long as its parity arrived.
+typedef struct
+{
+    uint32_t u32Complete;
+    uint32_t u32Torn; // committed with universes of another frame
+} Completion;
+
+static void CheckFrame(Port &oPort, const std::vector<uint8_t> &vFrame, Completion &stCompletion)
+{
+    if (!oPort.TakeReadyFrame())
+    {
+        return;
+    }
+    if (memcmp(oPort.m_aFrames[oPort.m_u8DisplayIndex], vFrame.data(), vFrame.size()) == 0)
+    {
+        stCompletion.u32Complete++;
+    }
+    else
+    {
+        stCompletion.u32Torn++;
+    }
+}
+
+static void RunLoss(uint32_t u32LossPermille, uint32_t u32Frames, Port &oPlain, Port &oFec, Completion &stPlain, Completion &stFec)
+{
+    const int32_t s32Universes = oFec.GetNoUniverses();
+    const size_t u32FrameBytes = oFec.GetLedCount() * 3;
+    std::vector<uint8_t> vFrame(u32FrameBytes);
+    for (uint32_t u32Frame = 0; u32Frame < u32Frames; ++u32Frame)
+    {
+        for (uint8_t &u8Byte : vFrame)
+        {
+            u8Byte = Random();
+        }
+        uint8_t u8Sequence = u32Frame % 255 + 1;
+        std::vector<FecMember> vMembers;
+        for (int32_t i = 0; i < s32Universes; ++i)
+        {
+            size_t u32Offset = i * 510;
+            vMembers.push_back({u8Sequence, (uint16_t)std::min<size_t>(510, u32FrameBytes - u32Offset), &vFrame[u32Offset]});
+        }
+        // Datagram s32Universes is the parity of the group, sent anywhere in the frame.
+        std::vector<uint8_t> vParity = MakeFec(0, vMembers);
+        std::vector<int32_t> vOrder;
+        for (int32_t i = 0; i <= s32Universes; ++i)
+        {
+            vOrder.push_back(i);
+        }
+        std::swap(vOrder[s32Universes], vOrder[Random() % (s32Universes + 1)]);
+        for (int32_t s32Datagram : vOrder)
+        {
+            if (Random() % 1000 < u32LossPermille)
+            {
+                continue;
+            }
+            if (s32Datagram == s32Universes)
+            {
+                Packet oPacket;
+                oPacket.Parse(vParity.data(), vParity.size(), vParity.size());
+                CHECK(!oPlain.AddParity(0, oPacket));
+                CHECK(oFec.AddParity(0, oPacket));
+                continue;
+            }
+            const FecMember &stMember = vMembers[s32Datagram];
+            oPlain.WriteUniverse(s32Datagram, u8Sequence, stMember.u16Length, CopyFromBuffer, (void *)stMember.pData);
+            oFec.WriteUniverse(s32Datagram, u8Sequence, stMember.u16Length, CopyFromBuffer, (void *)stMember.pData);
+        }
+        CheckFrame(oPlain, vFrame, stPlain);
+        CheckFrame(oFec, vFrame, stFec);
+    }
+}
+
+static void TestLossInjection()
+{
+    CHECK_EQ(Settings::GetInstance().SetFecEnabled(false), ESP_OK);
+    Port oPlain(0);
+    CHECK_EQ(Settings::GetInstance().SetFecEnabled(true), ESP_OK);
+    Port oFec(0);
+    CHECK_EQ(oFec.GetNoUniverses(), PROJECT_FEC_GROUP_SIZE);
+
+    const uint32_t u32Frames = 4000;
+    for (uint32_t u32LossPermille : {0, 20, 50, 100})
+    {
+        Completion stPlain = {}, stFec = {};
+        RunLoss(u32LossPermille, u32Frames, oPlain, oFec, stPlain, stFec);
+        // A frame survives without FEC when none of its universes is lost, with FEC when at most one is and the
+        // parity made it in that case. Without a deadline the next frame's universes fill an incomplete frame's
+        // holes and then find their own slots taken, so a lost frame usually costs its successor as well.
+        double p = u32LossPermille / 1000.0, q = 1 - p;
+        double dPlain = 1, dFec;
+        for (int32_t i = 0; i < PROJECT_FEC_GROUP_SIZE; ++i)
+        {
+            dPlain *= q;
+        }
+        dFec = dPlain + PROJECT_FEC_GROUP_SIZE * p * dPlain;
+        printf("%4.1f%% loss: complete frames %5.1f%% without FEC (%5.1f%% expected, %u torn), %5.1f%% with FEC (%5.1f%% expected, %u torn)\n",
+               p * 100, 100.0 * stPlain.u32Complete / u32Frames, dPlain * 100, stPlain.u32Torn, 100.0 * stFec.u32Complete / u32Frames,
+               dFec * 100, stFec.u32Torn);
+        CHECK(stPlain.u32Complete >= (dPlain * dPlain - 0.03) * u32Frames);
+        CHECK(stPlain.u32Complete <= (dPlain + 0.03) * u32Frames);
+        CHECK(stFec.u32Complete >= (dFec * dFec - 0.03) * u32Frames);
+        CHECK(stFec.u32Complete <= (dFec + 0.03) * u32Frames);
+        CHECK(stFec.u32Complete >= stPlain.u32Complete);
+        if (u32LossPermille == 0)
+        {
+            CHECK_EQ(stPlain.u32Complete, u32Frames);
+            CHECK_EQ(stFec.u32Complete, u32Frames);
+        }
+    }
+    cJSON *pJson = oFec.ToJson();
+    CHECK(cJSON_GetObjectItemCaseSensitive(pJson, "FecRecovered")->valueint > 0);
+    cJSON_Delete(pJson);
+}
+
+// Unsequenced ArtDmx and a parity of another frame are never used to rebuild a universe.
+static void TestMismatch()
+{
+    Port oFec(0);
+    std::vector<uint8_t> vFrame(oFec.GetLedCount() * 3, 0x5A);
+    for (uint8_t u8Sequence : {0, 9})
+    {
+        std::vector<FecMember> vMembers;
+        for (int32_t i = 0; i < oFec.GetNoUniverses(); ++i)
+        {
+            vMembers.push_back({u8Sequence, 510, &vFrame[i * 510]});
+        }
+        if (u8Sequence != 0)
+        {
+            vMembers[2].u8Sequence = 10;
+        }
+        std::vector<uint8_t> vParity = MakeFec(0, vMembers);
+        Packet oPacket;
+        oPacket.Parse(vParity.data(), vParity.size(), vParity.size());
+        for (int32_t i = 1; i < oFec.GetNoUniverses(); ++i)
+        {
+            oFec.WriteUniverse(i, u8Sequence, 510, CopyFromBuffer, &vFrame[i * 510]);
+        }
+        CHECK(oFec.AddParity(0, oPacket));
+        CHECK(!oFec.HasReadyFrame());
+        oFec.ResetAssembly();
+    }
+    cJSON *pJson = oFec.ToJson();
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "FecMismatch")->valueint, 2);
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "FecRecovered")->valueint, 0);
+    cJSON_Delete(pJson);
+    // Only a group's first universe takes parity, of as many universes as the group has.
+    std::vector<uint8_t> vParity = MakeFec(1, {{1, 510, vFrame.data()}});
+    Packet oPacket;
+    oPacket.Parse(vParity.data(), vParity.size(), vParity.size());
+    CHECK(!oFec.AddParity(1, oPacket));
+    CHECK(!oFec.AddParity(0, oPacket));
+}
+
+// RGBW in 512 channel universes: 128 pixels fill every byte. Losing any one universe of the group, the parity
+// rebuilds all 512 bytes of it and the port shows what a port that got every universe shows.
+static void TestRgbw512()
+{
+    ConfigurePorts("{\"Ports\":[{\"StartUniverse\":0,\"NoUniverses\":6,\"LedCount\":768,\"LedType\":\"LED1904\","
+                   "\"PixelFormat\":\"RGBW\",\"BitDepth\":8,\"ChannelsPerUniverse\":512}]}");
+    Port oReference(0), oFec(0);
+    CHECK_EQ(oFec.GetNoUniverses(), PROJECT_FEC_GROUP_SIZE);
+    std::vector<uint8_t> vFrame(768 * 4);
+    for (int32_t s32Lost = 0; s32Lost < PROJECT_FEC_GROUP_SIZE; ++s32Lost)
+    {
+        for (uint8_t &u8Byte : vFrame)
+        {
+            u8Byte = Random();
+        }
+        uint8_t u8Sequence = s32Lost + 1;
+        std::vector<FecMember> vMembers;
+        for (int32_t i = 0; i < PROJECT_FEC_GROUP_SIZE; ++i)
+        {
+            vMembers.push_back({u8Sequence, 512, &vFrame[i * 512]});
+            oReference.WriteUniverse(i, u8Sequence, 512, CopyFromBuffer, &vFrame[i * 512]);
+            if (i != s32Lost)
+            {
+                oFec.WriteUniverse(i, u8Sequence, 512, CopyFromBuffer, &vFrame[i * 512]);
+            }
+        }
+        std::vector<uint8_t> vParity = MakeFec(0, vMembers);
+        Packet oPacket;
+        CHECK_EQ(oPacket.Parse(vParity.data(), vParity.size(), vParity.size()), PARSE_OK);
+        CHECK_EQ(oPacket.GetFecLength(), 512);
+        CHECK(oFec.AddParity(0, oPacket));
+        CHECK(oReference.TakeReadyFrame());
+        CHECK(oFec.TakeReadyFrame());
+        CHECK(memcmp(oFec.m_aFrames[oFec.m_u8DisplayIndex], oReference.m_aFrames[oReference.m_u8DisplayIndex], oFec.m_u32FrameBytes) == 0);
+    }
+    cJSON *pJson = oFec.ToJson();
+    CHECK_EQ(cJSON_GetObjectItemCaseSensitive(pJson, "FecRecovered")->valueint, PROJECT_FEC_GROUP_SIZE);
+    cJSON_Delete(pJson);
+}
+
+int main()
+{
+    ConfigurePorts("{\"PartialFrameDeadlineMs\":0,\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":6,\"LedCount\":1020,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":6,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+
+    RUN_TEST(TestEncoder);
+    RUN_TEST(TestLossInjection);
+    RUN_TEST(TestMismatch);
+    RUN_TEST(TestRgbw512);
+    return TestResult();
+}
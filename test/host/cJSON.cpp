@@ -0,0 +1,507 @@
+#include "cJSON.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+#include <string>
+#include <algorithm>
+
+static char *Duplicate(const char *pString)
+{
+    size_t u32Length = strlen(pString) + 1;
+    char *pCopy = (char *)malloc(u32Length);
+    memcpy(pCopy, pString, u32Length);
+    return pCopy;
+}
+
+static cJSON *NewItem(int s32Type)
+{
+    cJSON *pItem = (cJSON *)calloc(1, sizeof(cJSON));
+    pItem->type = s32Type;
+    return pItem;
+}
+
+static void SetNumber(cJSON *pItem, double dNumber)
+{
+    pItem->valuedouble = dNumber;
+    // Saturated like cJSON does.
+    if (dNumber >= INT_MAX)
+    {
+        pItem->valueint = INT_MAX;
+    }
+    else if (dNumber <= (double)INT_MIN)
+    {
+        pItem->valueint = INT_MIN;
+    }
+    else
+    {
+        pItem->valueint = (int)dNumber;
+    }
+}
+
+cJSON *cJSON_CreateObject(void)
+{
+    return NewItem(cJSON_Object);
+}
+
+cJSON *cJSON_CreateArray(void)
+{
+    return NewItem(cJSON_Array);
+}
+
+cJSON *cJSON_CreateNumber(double dNumber)
+{
+    cJSON *pItem = NewItem(cJSON_Number);
+    SetNumber(pItem, dNumber);
+    return pItem;
+}
+
+cJSON *cJSON_CreateString(const char *pString)
+{
+    cJSON *pItem = NewItem(cJSON_String);
+    pItem->valuestring = Duplicate(pString);
+    return pItem;
+}
+
+cJSON *cJSON_CreateBool(cJSON_bool bValue)
+{
+    return NewItem(bValue ? cJSON_True : cJSON_False);
+}
+
+void cJSON_Delete(cJSON *pItem)
+{
+    while (pItem != nullptr)
+    {
+        cJSON *pNext = pItem->next;
+        cJSON_Delete(pItem->child);
+        free(pItem->valuestring);
+        free(pItem->string);
+        free(pItem);
+        pItem = pNext;
+    }
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON *pArray, cJSON *pItem)
+{
+    if (pArray == nullptr || pItem == nullptr)
+    {
+        return 0;
+    }
+    if (pArray->child == nullptr)
+    {
+        pArray->child = pItem;
+        pItem->prev = pItem; // the head's prev is the tail, as in cJSON
+        return 1;
+    }
+    cJSON *pTail = pArray->child->prev;
+    pTail->next = pItem;
+    pItem->prev = pTail;
+    pArray->child->prev = pItem;
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON *pObject, const char *pName, cJSON *pItem)
+{
+    if (pObject == nullptr || pName == nullptr || pItem == nullptr)
+    {
+        return 0;
+    }
+    free(pItem->string);
+    pItem->string = Duplicate(pName);
+    return cJSON_AddItemToArray(pObject, pItem);
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *pObject, const char *pName, double dNumber)
+{
+    cJSON *pItem = cJSON_CreateNumber(dNumber);
+    cJSON_AddItemToObject(pObject, pName, pItem);
+    return pItem;
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *pObject, const char *pName, const char *pString)
+{
+    cJSON *pItem = cJSON_CreateString(pString);
+    cJSON_AddItemToObject(pObject, pName, pItem);
+    return pItem;
+}
+
+cJSON *cJSON_AddBoolToObject(cJSON *pObject, const char *pName, cJSON_bool bValue)
+{
+    cJSON *pItem = cJSON_CreateBool(bValue);
+    cJSON_AddItemToObject(pObject, pName, pItem);
+    return pItem;
+}
+
+int cJSON_GetArraySize(const cJSON *pArray)
+{
+    int s32Size = 0;
+    for (const cJSON *pItem = pArray ? pArray->child : nullptr; pItem != nullptr; pItem = pItem->next)
+    {
+        s32Size++;
+    }
+    return s32Size;
+}
+
+cJSON *cJSON_GetArrayItem(const cJSON *pArray, int s32Index)
+{
+    cJSON *pItem = (pArray != nullptr && s32Index >= 0) ? pArray->child : nullptr;
+    for (; pItem != nullptr && s32Index > 0; --s32Index)
+    {
+        pItem = pItem->next;
+    }
+    return pItem;
+}
+
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *pObject, const char *pName)
+{
+    for (cJSON *pItem = pObject ? pObject->child : nullptr; pItem != nullptr; pItem = pItem->next)
+    {
+        if (pItem->string != nullptr && strcmp(pItem->string, pName) == 0)
+        {
+            return pItem;
+        }
+    }
+    return nullptr;
+}
+
+double cJSON_GetNumberValue(const cJSON *pItem)
+{
+    return cJSON_IsNumber(pItem) ? pItem->valuedouble : NAN;
+}
+
+char *cJSON_GetStringValue(const cJSON *pItem)
+{
+    return cJSON_IsString(pItem) ? pItem->valuestring : nullptr;
+}
+
+cJSON_bool cJSON_IsBool(const cJSON *pItem)
+{
+    return pItem != nullptr && (pItem->type & (cJSON_True | cJSON_False)) != 0;
+}
+
+cJSON_bool cJSON_IsTrue(const cJSON *pItem)
+{
+    return pItem != nullptr && (pItem->type & 0xFF) == cJSON_True;
+}
+
+cJSON_bool cJSON_IsNumber(const cJSON *pItem)
+{
+    return pItem != nullptr && (pItem->type & 0xFF) == cJSON_Number;
+}
+
+cJSON_bool cJSON_IsString(const cJSON *pItem)
+{
+    return pItem != nullptr && (pItem->type & 0xFF) == cJSON_String;
+}
+
+cJSON_bool cJSON_IsArray(const cJSON *pItem)
+{
+    return pItem != nullptr && (pItem->type & 0xFF) == cJSON_Array;
+}
+
+cJSON_bool cJSON_IsObject(const cJSON *pItem)
+{
+    return pItem != nullptr && (pItem->type & 0xFF) == cJSON_Object;
+}
+
+// Recursive descent over [p, pEnd), p is advanced past what was parsed.
+typedef struct
+{
+    const char *p;
+    const char *pEnd;
+} Cursor;
+
+static void SkipSpace(Cursor &stCursor)
+{
+    while (stCursor.p < stCursor.pEnd && (*stCursor.p == ' ' || *stCursor.p == '\t' || *stCursor.p == '\n' || *stCursor.p == '\r'))
+    {
+        stCursor.p++;
+    }
+}
+
+static bool Consume(Cursor &stCursor, const char *pLiteral)
+{
+    size_t u32Length = strlen(pLiteral);
+    if ((size_t)(stCursor.pEnd - stCursor.p) < u32Length || strncmp(stCursor.p, pLiteral, u32Length) != 0)
+    {
+        return false;
+    }
+    stCursor.p += u32Length;
+    return true;
+}
+
+static bool ParseString(Cursor &stCursor, std::string &sOut)
+{
+    if (!Consume(stCursor, "\""))
+    {
+        return false;
+    }
+    while (stCursor.p < stCursor.pEnd && *stCursor.p != '"')
+    {
+        char c = *stCursor.p++;
+        if (c != '\\')
+        {
+            sOut += c;
+            continue;
+        }
+        if (stCursor.p >= stCursor.pEnd)
+        {
+            return false;
+        }
+        c = *stCursor.p++;
+        switch (c)
+        {
+        case 'b': sOut += '\b'; break;
+        case 'f': sOut += '\f'; break;
+        case 'n': sOut += '\n'; break;
+        case 'r': sOut += '\r'; break;
+        case 't': sOut += '\t'; break;
+        case 'u':
+        {
+            // Basic multilingual plane only, encoded as UTF-8.
+            if (stCursor.pEnd - stCursor.p < 4)
+            {
+                return false;
+            }
+            unsigned u32Code = (unsigned)strtoul(std::string(stCursor.p, 4).c_str(), nullptr, 16);
+            stCursor.p += 4;
+            if (u32Code < 0x80)
+            {
+                sOut += (char)u32Code;
+            }
+            else if (u32Code < 0x800)
+            {
+                sOut += (char)(0xC0 | (u32Code >> 6));
+                sOut += (char)(0x80 | (u32Code & 0x3F));
+            }
+            else
+            {
+                sOut += (char)(0xE0 | (u32Code >> 12));
+                sOut += (char)(0x80 | ((u32Code >> 6) & 0x3F));
+                sOut += (char)(0x80 | (u32Code & 0x3F));
+            }
+        }
+        break;
+        default: sOut += c; break;
+        }
+    }
+    return Consume(stCursor, "\"");
+}
+
+static cJSON *ParseValue(Cursor &stCursor, int s32Depth);
+
+static cJSON *ParseContainer(Cursor &stCursor, int s32Depth, bool bObject)
+{
+    cJSON *pContainer = bObject ? cJSON_CreateObject() : cJSON_CreateArray();
+    stCursor.p++;
+    SkipSpace(stCursor);
+    if (Consume(stCursor, bObject ? "}" : "]"))
+    {
+        return pContainer;
+    }
+    while (true)
+    {
+        std::string sName;
+        SkipSpace(stCursor);
+        if (bObject && !(ParseString(stCursor, sName) && (SkipSpace(stCursor), Consume(stCursor, ":"))))
+        {
+            break;
+        }
+        cJSON *pItem = ParseValue(stCursor, s32Depth + 1);
+        if (pItem == nullptr)
+        {
+            break;
+        }
+        if (bObject)
+        {
+            cJSON_AddItemToObject(pContainer, sName.c_str(), pItem);
+        }
+        else
+        {
+            cJSON_AddItemToArray(pContainer, pItem);
+        }
+        SkipSpace(stCursor);
+        if (Consume(stCursor, ","))
+        {
+            continue;
+        }
+        if (Consume(stCursor, bObject ? "}" : "]"))
+        {
+            return pContainer;
+        }
+        break;
+    }
+    cJSON_Delete(pContainer);
+    return nullptr;
+}
+
+static cJSON *ParseValue(Cursor &stCursor, int s32Depth)
+{
+    SkipSpace(stCursor);
+    if (stCursor.p >= stCursor.pEnd || s32Depth > 64)
+    {
+        return nullptr;
+    }
+    switch (*stCursor.p)
+    {
+    case '{':
+        return ParseContainer(stCursor, s32Depth, true);
+    case '[':
+        return ParseContainer(stCursor, s32Depth, false);
+    case '"':
+    {
+        std::string sValue;
+        return ParseString(stCursor, sValue) ? cJSON_CreateString(sValue.c_str()) : nullptr;
+    }
+    default:
+        break;
+    }
+    if (Consume(stCursor, "true"))
+    {
+        return cJSON_CreateBool(1);
+    }
+    if (Consume(stCursor, "false"))
+    {
+        return cJSON_CreateBool(0);
+    }
+    if (Consume(stCursor, "null"))
+    {
+        return NewItem(cJSON_NULL);
+    }
+    std::string sNumber(stCursor.p, std::min<size_t>(stCursor.pEnd - stCursor.p, 64));
+    char *pNumberEnd = nullptr;
+    double dNumber = strtod(sNumber.c_str(), &pNumberEnd);
+    if (pNumberEnd == sNumber.c_str())
+    {
+        return nullptr;
+    }
+    stCursor.p += pNumberEnd - sNumber.c_str();
+    return cJSON_CreateNumber(dNumber);
+}
+
+cJSON *cJSON_ParseWithLength(const char *pValue, size_t u32Length)
+{
+    if (pValue == nullptr)
+    {
+        return nullptr;
+    }
+    Cursor stCursor = {pValue, pValue + u32Length};
+    cJSON *pItem = ParseValue(stCursor, 0);
+    SkipSpace(stCursor);
+    // Trailing NULs are fine, like a length that includes the terminator.
+    while (stCursor.p < stCursor.pEnd && *stCursor.p == '\0')
+    {
+        stCursor.p++;
+    }
+    if (pItem != nullptr && stCursor.p != stCursor.pEnd)
+    {
+        cJSON_Delete(pItem);
+        return nullptr;
+    }
+    return pItem;
+}
+
+cJSON *cJSON_Parse(const char *pValue)
+{
+    return pValue ? cJSON_ParseWithLength(pValue, strlen(pValue)) : nullptr;
+}
+
+static void PrintString(const char *pString, std::string &sOut)
+{
+    sOut += '"';
+    for (const char *p = pString; *p != '\0'; ++p)
+    {
+        switch (*p)
+        {
+        case '"': sOut += "\\\""; break;
+        case '\\': sOut += "\\\\"; break;
+        case '\n': sOut += "\\n"; break;
+        case '\r': sOut += "\\r"; break;
+        case '\t': sOut += "\\t"; break;
+        default:
+            if ((unsigned char)*p < 0x20)
+            {
+                char aEscape[8];
+                snprintf(aEscape, sizeof(aEscape), "\\u%04x", (unsigned char)*p);
+                sOut += aEscape;
+            }
+            else
+            {
+                sOut += *p;
+            }
+            break;
+        }
+    }
+    sOut += '"';
+}
+
+static void PrintValue(const cJSON *pItem, std::string &sOut)
+{
+    switch (pItem->type & 0xFF)
+    {
+    case cJSON_False:
+        sOut += "false";
+        break;
+    case cJSON_True:
+        sOut += "true";
+        break;
+    case cJSON_Number:
+    {
+        char aNumber[32];
+        if (pItem->valuedouble == (double)pItem->valueint)
+        {
+            snprintf(aNumber, sizeof(aNumber), "%d", pItem->valueint);
+        }
+        else
+        {
+            snprintf(aNumber, sizeof(aNumber), "%.17g", pItem->valuedouble);
+        }
+        sOut += aNumber;
+    }
+    break;
+    case cJSON_String:
+        PrintString(pItem->valuestring, sOut);
+        break;
+    case cJSON_Array:
+    case cJSON_Object:
+    {
+        bool bObject = (pItem->type & 0xFF) == cJSON_Object;
+        sOut += bObject ? '{' : '[';
+        for (const cJSON *pChild = pItem->child; pChild != nullptr; pChild = pChild->next)
+        {
+            if (pChild != pItem->child)
+            {
+                sOut += ',';
+            }
+            if (bObject)
+            {
+                PrintString(pChild->string, sOut);
+                sOut += ':';
+            }
+            PrintValue(pChild, sOut);
+        }
+        sOut += bObject ? '}' : ']';
+    }
+    break;
+    default:
+        sOut += "null";
+        break;
+    }
+}
+
+char *cJSON_PrintUnformatted(const cJSON *pItem)
+{
+    if (pItem == nullptr)
+    {
+        return nullptr;
+    }
+    std::string sOut;
+    PrintValue(pItem, sOut);
+    return Duplicate(sOut.c_str());
+}
+
+char *cJSON_Print(const cJSON *pItem)
+{
+    return cJSON_PrintUnformatted(pItem);
+}
@@ -0,0 +1,64 @@
+#ifndef __ARTNET_NODE_HOST_CJSON_H__
+#define __ARTNET_NODE_HOST_CJSON_H__
+
+#include <stddef.h>
+
+// Host stand-in for the subset of cJSON the firmware uses. Same node layout and type flags as cJSON, so
+// main/ reads valueint, valuedouble and valuestring as it does on the target.
+#define cJSON_Invalid (0)
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef int cJSON_bool;
+
+typedef struct cJSON
+{
+    struct cJSON *next;
+    struct cJSON *prev;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+cJSON *cJSON_CreateObject(void);
+cJSON *cJSON_CreateArray(void);
+cJSON *cJSON_CreateNumber(double dNumber);
+cJSON *cJSON_CreateString(const char *pString);
+cJSON *cJSON_CreateBool(cJSON_bool bValue);
+void cJSON_Delete(cJSON *pItem);
+
+cJSON_bool cJSON_AddItemToArray(cJSON *pArray, cJSON *pItem);
+cJSON_bool cJSON_AddItemToObject(cJSON *pObject, const char *pName, cJSON *pItem);
+cJSON *cJSON_AddNumberToObject(cJSON *pObject, const char *pName, double dNumber);
+cJSON *cJSON_AddStringToObject(cJSON *pObject, const char *pName, const char *pString);
+cJSON *cJSON_AddBoolToObject(cJSON *pObject, const char *pName, cJSON_bool bValue);
+
+int cJSON_GetArraySize(const cJSON *pArray);
+cJSON *cJSON_GetArrayItem(const cJSON *pArray, int s32Index);
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *pObject, const char *pName);
+double cJSON_GetNumberValue(const cJSON *pItem);
+char *cJSON_GetStringValue(const cJSON *pItem);
+
+cJSON_bool cJSON_IsBool(const cJSON *pItem);
+cJSON_bool cJSON_IsTrue(const cJSON *pItem);
+cJSON_bool cJSON_IsNumber(const cJSON *pItem);
+cJSON_bool cJSON_IsString(const cJSON *pItem);
+cJSON_bool cJSON_IsArray(const cJSON *pItem);
+cJSON_bool cJSON_IsObject(const cJSON *pItem);
+
+// Plain JSON without comments, nullptr on a syntax error. Print() and PrintUnformatted() both print compact,
+// the result is freed with free().
+cJSON *cJSON_Parse(const char *pValue);
+cJSON *cJSON_ParseWithLength(const char *pValue, size_t u32Length);
+char *cJSON_Print(const cJSON *pItem);
+char *cJSON_PrintUnformatted(const cJSON *pItem);
+
+#endif /* __ARTNET_NODE_HOST_CJSON_H__ */
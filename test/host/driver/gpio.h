@@ -0,0 +1,7 @@
+#ifndef __ARTNET_NODE_HOST_DRIVER_GPIO_H__
+#define __ARTNET_NODE_HOST_DRIVER_GPIO_H__
+
+// Host stand-in: only the pin number type.
+typedef int gpio_num_t;
+
+#endif /* __ARTNET_NODE_HOST_DRIVER_GPIO_H__ */
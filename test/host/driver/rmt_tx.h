@@ -0,0 +1,97 @@
+#ifndef __ARTNET_NODE_HOST_DRIVER_RMT_TX_H__
+#define __ARTNET_NODE_HOST_DRIVER_RMT_TX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+// Host stand-in for the RMT TX driver: rmt_transmit() runs the encoder right away, in channel memory sized
+// chunks like the driver's ping-pong refill, and keeps what it produced for host_rmt.h.
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
+
+typedef union
+{
+    struct
+    {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+typedef enum
+{
+    RMT_ENCODING_RESET = 0,
+    RMT_ENCODING_COMPLETE = (1 << 0),
+    RMT_ENCODING_MEM_FULL = (1 << 1),
+} rmt_encode_state_t;
+
+typedef enum
+{
+    RMT_CLK_SRC_DEFAULT,
+} rmt_clock_source_t;
+
+typedef struct rmt_channel_t *rmt_channel_handle_t;
+typedef struct rmt_encoder_t rmt_encoder_t;
+typedef rmt_encoder_t *rmt_encoder_handle_t;
+
+struct rmt_encoder_t
+{
+    size_t (*encode)(rmt_encoder_t *encoder, rmt_channel_handle_t tx_channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state);
+    esp_err_t (*reset)(rmt_encoder_t *encoder);
+    esp_err_t (*del)(rmt_encoder_t *encoder);
+};
+
+typedef struct
+{
+    gpio_num_t gpio_num;
+    rmt_clock_source_t clk_src;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    size_t trans_queue_depth;
+    int intr_priority;
+    struct
+    {
+        uint32_t invert_out : 1;
+        uint32_t with_dma : 1;
+    } flags;
+} rmt_tx_channel_config_t;
+
+typedef struct
+{
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    struct
+    {
+        uint32_t msb_first : 1;
+    } flags;
+} rmt_bytes_encoder_config_t;
+
+typedef struct
+{
+} rmt_copy_encoder_config_t;
+
+typedef struct
+{
+    int loop_count;
+    struct
+    {
+        uint32_t eot_level : 1;
+    } flags;
+} rmt_transmit_config_t;
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *pConfig, rmt_channel_handle_t *pChannel);
+esp_err_t rmt_enable(rmt_channel_handle_t hChannel);
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *pConfig, rmt_encoder_handle_t *pEncoder);
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *pConfig, rmt_encoder_handle_t *pEncoder);
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t hEncoder);
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t hEncoder);
+esp_err_t rmt_transmit(rmt_channel_handle_t hChannel, rmt_encoder_handle_t hEncoder, const void *pPayload, size_t u32Bytes, const rmt_transmit_config_t *pConfig);
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t hChannel, int s32TimeoutMs);
+
+#endif /* __ARTNET_NODE_HOST_DRIVER_RMT_TX_H__ */
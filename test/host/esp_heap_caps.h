@@ -0,0 +1,13 @@
+#ifndef __ARTNET_NODE_HOST_ESP_HEAP_CAPS_H__
+#define __ARTNET_NODE_HOST_ESP_HEAP_CAPS_H__
+
+#include <stdlib.h>
+
+// Host stand-in: one heap, the capabilities are ignored.
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+static inline void *heap_caps_calloc(size_t u32Count, size_t u32Size, unsigned u32Caps) { (void)u32Caps; return calloc(u32Count, u32Size); }
+static inline void heap_caps_free(void *p) { free(p); }
+
+#endif /* __ARTNET_NODE_HOST_ESP_HEAP_CAPS_H__ */
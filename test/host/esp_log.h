@@ -0,0 +1,15 @@
+#ifndef __ARTNET_NODE_HOST_ESP_LOG_H__
+#define __ARTNET_NODE_HOST_ESP_LOG_H__
+
+#include <stdio.h>
+
+// Host stand-in: errors and warnings go to stderr, the rest is dropped to keep test output readable. The
+// dropped ones still have their format checked against the arguments.
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOG_DROPPED(tag, format, ...) do { (void)(tag); if (0) fprintf(stderr, format, ##__VA_ARGS__); } while (0)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_DROPPED(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_DROPPED(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_DROPPED(tag, format, ##__VA_ARGS__)
+
+#endif /* __ARTNET_NODE_HOST_ESP_LOG_H__ */
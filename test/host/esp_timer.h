@@ -0,0 +1,32 @@
+#ifndef __ARTNET_NODE_HOST_ESP_TIMER_H__
+#define __ARTNET_NODE_HOST_ESP_TIMER_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Host stand-in: esp_timer on the virtual clock of host_kernel.h. Callbacks run in the thread that advances
+// the clock.
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+esp_err_t esp_timer_create(const esp_timer_create_args_t *pArgs, esp_timer_handle_t *pHandle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t hTimer, uint64_t u64TimeoutUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t hTimer);
+
+#endif /* __ARTNET_NODE_HOST_ESP_TIMER_H__ */
@@ -0,0 +1,34 @@
+#ifndef __ARTNET_NODE_HOST_FREERTOS_H__
+#define __ARTNET_NODE_HOST_FREERTOS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Host stand-in for the FreeRTOS API main/ uses, on std::thread and a virtual clock, see host_kernel.h.
+// Ticks are milliseconds like the target's CONFIG_FREERTOS_HZ=1000.
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+#ifndef BIT0
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+#define BIT4 0x00000010
+#define BIT5 0x00000020
+#define BIT6 0x00000040
+#define BIT7 0x00000080
+#define BIT8 0x00000100
+#endif
+
+#endif /* __ARTNET_NODE_HOST_FREERTOS_H__ */
@@ -0,0 +1,17 @@
+#ifndef __ARTNET_NODE_HOST_FREERTOS_EVENT_GROUPS_H__
+#define __ARTNET_NODE_HOST_FREERTOS_EVENT_GROUPS_H__
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef uint32_t EventBits_t;
+typedef struct HostEventGroup *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t hGroup, EventBits_t u32Bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t hGroup, EventBits_t u32Bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t hGroup);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t hGroup, EventBits_t u32BitsToWaitFor, BaseType_t bClearOnExit, BaseType_t bWaitForAllBits,
+                                TickType_t u32Ticks);
+
+#endif /* __ARTNET_NODE_HOST_FREERTOS_EVENT_GROUPS_H__ */
@@ -0,0 +1,12 @@
+#ifndef __ARTNET_NODE_HOST_FREERTOS_SEMPHR_H__
+#define __ARTNET_NODE_HOST_FREERTOS_SEMPHR_H__
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct HostSemaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t hSemaphore, TickType_t u32Ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t hSemaphore);
+
+#endif /* __ARTNET_NODE_HOST_FREERTOS_SEMPHR_H__ */
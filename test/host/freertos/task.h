@@ -0,0 +1,23 @@
+#ifndef __ARTNET_NODE_HOST_FREERTOS_TASK_H__
+#define __ARTNET_NODE_HOST_FREERTOS_TASK_H__
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct HostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+// Each task is a detached thread, priorities and cores are ignored.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fnTask, const char *pName, uint32_t u32StackDepth, void *pvParameters,
+                                   UBaseType_t u32Priority, TaskHandle_t *pHandle, BaseType_t s32CoreId);
+static inline BaseType_t xTaskCreate(TaskFunction_t fnTask, const char *pName, uint32_t u32StackDepth, void *pvParameters,
+                                     UBaseType_t u32Priority, TaskHandle_t *pHandle)
+{
+    return xTaskCreatePinnedToCore(fnTask, pName, u32StackDepth, pvParameters, u32Priority, pHandle, -1);
+}
+void vTaskDelay(TickType_t u32Ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t hTask);
+uint32_t ulTaskNotifyTake(BaseType_t bClearCountOnExit, TickType_t u32Ticks);
+
+#endif /* __ARTNET_NODE_HOST_FREERTOS_TASK_H__ */
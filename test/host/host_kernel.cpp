@@ -0,0 +1,338 @@
+#include "host_kernel.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+struct HostTask
+{
+    uint32_t u32NotifyCount;
+};
+
+struct HostSemaphore
+{
+    bool bTaken;
+};
+
+struct HostEventGroup
+{
+    EventBits_t u32Bits;
+};
+
+struct esp_timer
+{
+    esp_timer_cb_t fnCallback;
+    void *pvArg;
+    int64_t s64DueUs; // -1: stopped
+};
+
+// Every wait is on one condition, any state change wakes every waiter to check its own. A task woken that
+// way counts as running until it blocks again, which is what WaitIdle() waits for.
+typedef struct
+{
+    std::mutex oLock;
+    std::condition_variable oWake;
+    std::condition_variable oIdle;
+    std::atomic<int64_t> s64NowUs{0};
+    uint64_t u64Generation = 0;
+    int32_t s32Running = 0;
+    int32_t s32Waiting = 0;
+    std::multiset<int64_t> setDeadlines; // timeouts of the blocked tasks
+    std::vector<esp_timer *> vTimers;
+    HostTask stOutsideTask = {0}; // handle of the threads that are not tasks
+} Kernel;
+
+// Never destroyed, tasks are still blocked in it when the test exits.
+static Kernel &GetKernel()
+{
+    static Kernel *pKernel = new Kernel();
+    return *pKernel;
+}
+
+static thread_local HostTask *t_pTask = nullptr;
+
+static void Notify(Kernel &stKernel)
+{
+    stKernel.u64Generation++;
+    stKernel.s32Running += stKernel.s32Waiting;
+    stKernel.s32Waiting = 0;
+    stKernel.oWake.notify_all();
+}
+
+static int64_t Deadline(TickType_t u32Ticks)
+{
+    return u32Ticks == portMAX_DELAY ? INT64_MAX : GetKernel().s64NowUs.load() + u32Ticks * 1000LL;
+}
+
+// Kernel lock held. True once fnReady() holds, false when the clock reaches s64DeadlineUs first.
+static bool Block(std::unique_lock<std::mutex> &oLock, const std::function<bool()> &fnReady, int64_t s64DeadlineUs)
+{
+    Kernel &stKernel = GetKernel();
+    while (!fnReady())
+    {
+        if (s64DeadlineUs <= stKernel.s64NowUs.load() || (t_pTask == nullptr && s64DeadlineUs != INT64_MAX))
+        {
+            return false;
+        }
+        uint64_t u64Generation = stKernel.u64Generation;
+        if (t_pTask == nullptr)
+        {
+            stKernel.oWake.wait(oLock, [&]() { return stKernel.u64Generation != u64Generation; });
+            continue;
+        }
+        auto itDeadline = stKernel.setDeadlines.insert(s64DeadlineUs);
+        stKernel.s32Running--;
+        stKernel.s32Waiting++;
+        stKernel.oIdle.notify_all();
+        stKernel.oWake.wait(oLock, [&]() { return stKernel.u64Generation != u64Generation; });
+        stKernel.setDeadlines.erase(itDeadline);
+    }
+    return true;
+}
+
+static void WaitIdleLocked(std::unique_lock<std::mutex> &oLock)
+{
+    Kernel &stKernel = GetKernel();
+    stKernel.oIdle.wait(oLock, [&]() { return stKernel.s32Running == 0; });
+}
+
+static void FireDueTimers(std::unique_lock<std::mutex> &oLock)
+{
+    Kernel &stKernel = GetKernel();
+    bool bFired = true;
+    while (bFired)
+    {
+        bFired = false;
+        for (esp_timer *pTimer : stKernel.vTimers)
+        {
+            if (pTimer->s64DueUs < 0 || pTimer->s64DueUs > stKernel.s64NowUs.load())
+            {
+                continue;
+            }
+            pTimer->s64DueUs = -1;
+            oLock.unlock();
+            pTimer->fnCallback(pTimer->pvArg);
+            oLock.lock();
+            WaitIdleLocked(oLock);
+            bFired = true;
+            break;
+        }
+    }
+}
+
+void HostKernel::WaitIdle()
+{
+    std::unique_lock<std::mutex> oLock(GetKernel().oLock);
+    WaitIdleLocked(oLock);
+}
+
+void HostKernel::Advance(int64_t s64Us)
+{
+    Kernel &stKernel = GetKernel();
+    std::unique_lock<std::mutex> oLock(stKernel.oLock);
+    int64_t s64TargetUs = stKernel.s64NowUs.load() + s64Us;
+    WaitIdleLocked(oLock);
+    while (true)
+    {
+        FireDueTimers(oLock);
+        if (stKernel.s64NowUs.load() >= s64TargetUs)
+        {
+            break;
+        }
+        int64_t s64NextUs = s64TargetUs;
+        if (!stKernel.setDeadlines.empty())
+        {
+            s64NextUs = std::min(s64NextUs, *stKernel.setDeadlines.begin());
+        }
+        for (esp_timer *pTimer : stKernel.vTimers)
+        {
+            if (pTimer->s64DueUs >= 0)
+            {
+                s64NextUs = std::min(s64NextUs, pTimer->s64DueUs);
+            }
+        }
+        stKernel.s64NowUs = std::max(s64NextUs, stKernel.s64NowUs.load());
+        Notify(stKernel);
+        WaitIdleLocked(oLock);
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fnTask, const char *pName, uint32_t u32StackDepth, void *pvParameters,
+                                   UBaseType_t u32Priority, TaskHandle_t *pHandle, BaseType_t s32CoreId)
+{
+    Kernel &stKernel = GetKernel();
+    HostTask *pTask = new HostTask();
+    {
+        std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+        stKernel.s32Running++;
+    }
+    std::thread([pTask, fnTask, pvParameters]()
+    {
+        t_pTask = pTask;
+        fnTask(pvParameters);
+        // A FreeRTOS task never returns, a host one that does no longer counts.
+        Kernel &stKernel = GetKernel();
+        std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+        stKernel.s32Running--;
+        stKernel.oIdle.notify_all();
+    }).detach();
+    if (pHandle != nullptr)
+    {
+        *pHandle = pTask;
+    }
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t u32Ticks)
+{
+    std::unique_lock<std::mutex> oLock(GetKernel().oLock);
+    Block(oLock, []() { return false; }, Deadline(u32Ticks));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(GetKernel().s64NowUs.load() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return t_pTask != nullptr ? t_pTask : &GetKernel().stOutsideTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t hTask)
+{
+    Kernel &stKernel = GetKernel();
+    std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+    hTask->u32NotifyCount++;
+    Notify(stKernel);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t bClearCountOnExit, TickType_t u32Ticks)
+{
+    HostTask *pTask = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> oLock(GetKernel().oLock);
+    Block(oLock, [pTask]() { return pTask->u32NotifyCount > 0; }, Deadline(u32Ticks));
+    uint32_t u32Count = pTask->u32NotifyCount;
+    if (u32Count > 0)
+    {
+        pTask->u32NotifyCount = bClearCountOnExit ? 0 : u32Count - 1;
+    }
+    return u32Count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return new HostSemaphore{false};
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t hSemaphore, TickType_t u32Ticks)
+{
+    std::unique_lock<std::mutex> oLock(GetKernel().oLock);
+    if (!Block(oLock, [hSemaphore]() { return !hSemaphore->bTaken; }, Deadline(u32Ticks)))
+    {
+        return pdFALSE;
+    }
+    hSemaphore->bTaken = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t hSemaphore)
+{
+    Kernel &stKernel = GetKernel();
+    std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+    hSemaphore->bTaken = false;
+    Notify(stKernel);
+    return pdTRUE;
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return new HostEventGroup{0};
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t hGroup, EventBits_t u32Bits)
+{
+    Kernel &stKernel = GetKernel();
+    std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+    hGroup->u32Bits |= u32Bits;
+    Notify(stKernel);
+    return hGroup->u32Bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t hGroup, EventBits_t u32Bits)
+{
+    std::lock_guard<std::mutex> oGuard(GetKernel().oLock);
+    EventBits_t u32Previous = hGroup->u32Bits;
+    hGroup->u32Bits &= ~u32Bits;
+    return u32Previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t hGroup)
+{
+    std::lock_guard<std::mutex> oGuard(GetKernel().oLock);
+    return hGroup->u32Bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t hGroup, EventBits_t u32BitsToWaitFor, BaseType_t bClearOnExit, BaseType_t bWaitForAllBits,
+                                TickType_t u32Ticks)
+{
+    std::unique_lock<std::mutex> oLock(GetKernel().oLock);
+    bool bSet = Block(oLock, [&]()
+    {
+        EventBits_t u32Set = hGroup->u32Bits & u32BitsToWaitFor;
+        return bWaitForAllBits ? u32Set == u32BitsToWaitFor : u32Set != 0;
+    }, Deadline(u32Ticks));
+    EventBits_t u32Bits = hGroup->u32Bits;
+    if (bSet && bClearOnExit)
+    {
+        hGroup->u32Bits &= ~u32BitsToWaitFor;
+    }
+    return u32Bits;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return GetKernel().s64NowUs.load();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *pArgs, esp_timer_handle_t *pHandle)
+{
+    Kernel &stKernel = GetKernel();
+    std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+    *pHandle = new esp_timer{pArgs->callback, pArgs->arg, -1};
+    stKernel.vTimers.push_back(*pHandle);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t hTimer, uint64_t u64TimeoutUs)
+{
+    Kernel &stKernel = GetKernel();
+    std::lock_guard<std::mutex> oGuard(stKernel.oLock);
+    if (hTimer->s64DueUs >= 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    hTimer->s64DueUs = stKernel.s64NowUs.load() + (int64_t)u64TimeoutUs;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t hTimer)
+{
+    std::lock_guard<std::mutex> oGuard(GetKernel().oLock);
+    if (hTimer->s64DueUs < 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    hTimer->s64DueUs = -1;
+    return ESP_OK;
+}
@@ -0,0 +1,18 @@
+#ifndef __ARTNET_NODE_HOST_KERNEL_H__
+#define __ARTNET_NODE_HOST_KERNEL_H__
+
+#include <stdint.h>
+
+// The FreeRTOS and esp_timer stand-ins share one virtual clock that only the test moves. Tasks run as real
+// threads until they block; a timeout ends when the clock reaches it. Threads that are not tasks, the test
+// itself, never wait for the clock: a finite timeout that is not met right away fails at once.
+namespace HostKernel
+{
+    // Returns once every task is blocked.
+    void WaitIdle();
+    // Moves the clock s64Us forward, stopping at each task timeout and esp_timer on the way, which run
+    // before the clock moves on.
+    void Advance(int64_t s64Us);
+}
+
+#endif /* __ARTNET_NODE_HOST_KERNEL_H__ */
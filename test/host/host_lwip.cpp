@@ -0,0 +1,159 @@
+#include "host_lwip.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+const ip_addr_t g_stHostIpAddrAny = {0};
+struct netif *netif_default = nullptr;
+
+struct udp_pcb
+{
+    uint16_t u16Port;
+    udp_recv_fn fnRecv;
+    void *pvArg;
+};
+
+static std::vector<struct udp_pcb *> g_vPcbs;
+static std::vector<HostLwip::Sent> g_vSent;
+static ip_addr_t g_stCurrentDestination;
+
+struct pbuf *pbuf_alloc(pbuf_layer eLayer, u16_t u16Length, pbuf_type eType)
+{
+    (void)eLayer;
+    (void)eType;
+    struct pbuf *pBuf = (struct pbuf *)calloc(1, sizeof(struct pbuf) + u16Length);
+    pBuf->payload = pBuf + 1;
+    pBuf->len = u16Length;
+    pBuf->tot_len = u16Length;
+    return pBuf;
+}
+
+uint8_t pbuf_free(struct pbuf *pBuf)
+{
+    uint8_t u8Count = 0;
+    while (pBuf != nullptr)
+    {
+        struct pbuf *pNext = pBuf->next;
+        free(pBuf);
+        pBuf = pNext;
+        u8Count++;
+    }
+    return u8Count;
+}
+
+err_t pbuf_take(struct pbuf *pBuf, const void *pData, u16_t u16Length)
+{
+    if (pBuf->tot_len < u16Length)
+    {
+        return ERR_MEM;
+    }
+    for (u16_t u16Copied = 0; u16Copied < u16Length; pBuf = pBuf->next)
+    {
+        u16_t u16Chunk = std::min<u16_t>(pBuf->len, u16Length - u16Copied);
+        memcpy(pBuf->payload, (const uint8_t *)pData + u16Copied, u16Chunk);
+        u16Copied += u16Chunk;
+    }
+    return ERR_OK;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *pBuf, void *pData, u16_t u16Length, u16_t u16Offset)
+{
+    u16_t u16Copied = 0;
+    for (; pBuf != nullptr && u16Copied < u16Length; pBuf = pBuf->next)
+    {
+        if (u16Offset >= pBuf->len)
+        {
+            u16Offset -= pBuf->len;
+            continue;
+        }
+        u16_t u16Chunk = std::min<u16_t>(pBuf->len - u16Offset, u16Length - u16Copied);
+        memcpy((uint8_t *)pData + u16Copied, (const uint8_t *)pBuf->payload + u16Offset, u16Chunk);
+        u16Copied += u16Chunk;
+        u16Offset = 0;
+    }
+    return u16Copied;
+}
+
+struct udp_pcb *udp_new(void)
+{
+    struct udp_pcb *pPcb = new udp_pcb{0, nullptr, nullptr};
+    g_vPcbs.push_back(pPcb);
+    return pPcb;
+}
+
+void udp_remove(struct udp_pcb *pPcb)
+{
+    g_vPcbs.erase(std::remove(g_vPcbs.begin(), g_vPcbs.end(), pPcb), g_vPcbs.end());
+    delete pPcb;
+}
+
+err_t udp_bind(struct udp_pcb *pPcb, const ip_addr_t *pAddr, u16_t u16Port)
+{
+    (void)pAddr;
+    for (struct udp_pcb *pOther : g_vPcbs)
+    {
+        if (pOther != pPcb && pOther->u16Port == u16Port)
+        {
+            return ERR_USE;
+        }
+    }
+    pPcb->u16Port = u16Port;
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pPcb, udp_recv_fn fnRecv, void *pvArg)
+{
+    pPcb->fnRecv = fnRecv;
+    pPcb->pvArg = pvArg;
+}
+
+err_t udp_sendto(struct udp_pcb *pPcb, struct pbuf *pBuf, const ip_addr_t *pAddr, u16_t u16Port)
+{
+    (void)pPcb;
+    HostLwip::Sent stSent = {pAddr->addr, u16Port, std::vector<uint8_t>(pBuf->tot_len)};
+    pbuf_copy_partial(pBuf, stSent.vData.data(), pBuf->tot_len, 0);
+    g_vSent.push_back(stSent);
+    return ERR_OK;
+}
+
+const ip_addr_t *ip_current_dest_addr(void)
+{
+    return &g_stCurrentDestination;
+}
+
+struct netif *ip_current_netif(void)
+{
+    return netif_default;
+}
+
+namespace HostLwip
+{
+    bool Deliver(uint16_t u16Port, const std::vector<uint8_t> &vData, size_t u32Segment, uint32_t u32Source, uint32_t u32Destination)
+    {
+        auto it = std::find_if(g_vPcbs.begin(), g_vPcbs.end(), [u16Port](const struct udp_pcb *pPcb) { return pPcb->u16Port == u16Port && pPcb->fnRecv; });
+        if (it == g_vPcbs.end())
+        {
+            return false;
+        }
+        // Segments are allocated on their own like the WiFi driver's, so a read past one is caught.
+        struct pbuf *pHead = nullptr, **ppTail = &pHead;
+        for (size_t u32Offset = 0; u32Offset < vData.size() || pHead == nullptr; u32Offset += u32Segment)
+        {
+            u16_t u16Length = std::min(u32Segment, vData.size() - u32Offset);
+            struct pbuf *pBuf = pbuf_alloc(PBUF_TRANSPORT, u16Length, PBUF_RAM);
+            memcpy(pBuf->payload, vData.data() + u32Offset, u16Length);
+            pBuf->tot_len = vData.size() - u32Offset;
+            *ppTail = pBuf;
+            ppTail = &pBuf->next;
+        }
+        ip_addr_t stSource = {u32Source};
+        g_stCurrentDestination.addr = u32Destination;
+        (*it)->fnRecv((*it)->pvArg, *it, pHead, &stSource, 6454);
+        return true;
+    }
+
+    const std::vector<Sent> &GetSent()
+    {
+        return g_vSent;
+    }
+}
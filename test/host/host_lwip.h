@@ -0,0 +1,25 @@
+#ifndef __ARTNET_NODE_HOST_LWIP_H__
+#define __ARTNET_NODE_HOST_LWIP_H__
+
+#include <stdint.h>
+#include <vector>
+#include "lwip/udp.h"
+
+// Drives the raw UDP stand-in of lwip/udp.h.
+namespace HostLwip
+{
+    typedef struct
+    {
+        uint32_t u32Destination; // network byte order
+        uint16_t u16Port;
+        std::vector<uint8_t> vData;
+    } Sent;
+
+    // Hands vData, from Art-Net's port 6454, to the receive callback of the pcb bound to u16Port, split into a pbuf chain of u32Segment
+    // bytes per pbuf. Addresses in network byte order. False when no pcb is bound to the port.
+    bool Deliver(uint16_t u16Port, const std::vector<uint8_t> &vData, size_t u32Segment, uint32_t u32Source, uint32_t u32Destination);
+    // Everything udp_sendto() was given, oldest first.
+    const std::vector<Sent> &GetSent();
+}
+
+#endif /* __ARTNET_NODE_HOST_LWIP_H__ */
@@ -0,0 +1,211 @@
+#include "host_rmt.h"
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+struct rmt_channel_t
+{
+    HostRmt::Channel stCapture;
+    size_t u32MemorySymbols;
+    size_t u32Free; // symbols left in channel memory before the next refill
+};
+
+// Bits of the data handed over, in the order the encoder shifts them out.
+typedef struct
+{
+    rmt_encoder_t base;
+    rmt_symbol_word_t stBit0;
+    rmt_symbol_word_t stBit1;
+    bool bMsbFirst;
+    size_t u32Bit; // next bit to encode
+} BytesEncoder;
+
+typedef struct
+{
+    rmt_encoder_t base;
+    size_t u32Symbol; // next symbol to copy
+} CopyEncoder;
+
+static std::mutex g_oLock;
+static std::map<int32_t, rmt_channel_t *> g_mapChannels; // by pin, the newest
+static std::atomic<uint32_t> g_u32Stamp(0);
+
+static bool Emit(rmt_channel_handle_t hChannel, rmt_symbol_word_t stSymbol)
+{
+    if (hChannel->u32Free == 0)
+    {
+        return false;
+    }
+    hChannel->stCapture.vSymbols.push_back(stSymbol);
+    hChannel->u32Free--;
+    return true;
+}
+
+static size_t BytesEncode(rmt_encoder_t *pEncoder, rmt_channel_handle_t hChannel, const void *pData, size_t u32Size, rmt_encode_state_t *pState)
+{
+    BytesEncoder *pBytes = __containerof(pEncoder, BytesEncoder, base);
+    const uint8_t *pBytesIn = (const uint8_t *)pData;
+    size_t u32Encoded = 0;
+    int32_t s32State = RMT_ENCODING_RESET;
+    while (pBytes->u32Bit < u32Size * 8)
+    {
+        uint8_t u8Byte = pBytesIn[pBytes->u32Bit / 8];
+        uint32_t u32Shift = pBytes->bMsbFirst ? 7 - pBytes->u32Bit % 8 : pBytes->u32Bit % 8;
+        if (!Emit(hChannel, (u8Byte >> u32Shift) & 1 ? pBytes->stBit1 : pBytes->stBit0))
+        {
+            break;
+        }
+        pBytes->u32Bit++;
+        u32Encoded++;
+    }
+    if (pBytes->u32Bit == u32Size * 8)
+    {
+        pBytes->u32Bit = 0;
+        s32State |= RMT_ENCODING_COMPLETE;
+    }
+    if (hChannel->u32Free == 0)
+    {
+        s32State |= RMT_ENCODING_MEM_FULL;
+    }
+    *pState = (rmt_encode_state_t)s32State;
+    return u32Encoded;
+}
+
+static esp_err_t BytesReset(rmt_encoder_t *pEncoder)
+{
+    __containerof(pEncoder, BytesEncoder, base)->u32Bit = 0;
+    return ESP_OK;
+}
+
+static esp_err_t BytesDelete(rmt_encoder_t *pEncoder)
+{
+    delete __containerof(pEncoder, BytesEncoder, base);
+    return ESP_OK;
+}
+
+static size_t CopyEncode(rmt_encoder_t *pEncoder, rmt_channel_handle_t hChannel, const void *pData, size_t u32Size, rmt_encode_state_t *pState)
+{
+    CopyEncoder *pCopy = __containerof(pEncoder, CopyEncoder, base);
+    const rmt_symbol_word_t *pSymbols = (const rmt_symbol_word_t *)pData;
+    size_t u32Symbols = u32Size / sizeof(rmt_symbol_word_t);
+    size_t u32Encoded = 0;
+    int32_t s32State = RMT_ENCODING_RESET;
+    while (pCopy->u32Symbol < u32Symbols && Emit(hChannel, pSymbols[pCopy->u32Symbol]))
+    {
+        pCopy->u32Symbol++;
+        u32Encoded++;
+    }
+    if (pCopy->u32Symbol == u32Symbols)
+    {
+        pCopy->u32Symbol = 0;
+        s32State |= RMT_ENCODING_COMPLETE;
+    }
+    if (hChannel->u32Free == 0)
+    {
+        s32State |= RMT_ENCODING_MEM_FULL;
+    }
+    *pState = (rmt_encode_state_t)s32State;
+    return u32Encoded;
+}
+
+static esp_err_t CopyReset(rmt_encoder_t *pEncoder)
+{
+    __containerof(pEncoder, CopyEncoder, base)->u32Symbol = 0;
+    return ESP_OK;
+}
+
+static esp_err_t CopyDelete(rmt_encoder_t *pEncoder)
+{
+    delete __containerof(pEncoder, CopyEncoder, base);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *pConfig, rmt_channel_handle_t *pChannel)
+{
+    if (pConfig->mem_block_symbols == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_channel_t *pNew = new rmt_channel_t();
+    pNew->stCapture.s32Gpio = pConfig->gpio_num;
+    pNew->stCapture.u32ResolutionHz = pConfig->resolution_hz;
+    pNew->u32MemorySymbols = pConfig->mem_block_symbols;
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    g_mapChannels[pConfig->gpio_num] = pNew;
+    *pChannel = pNew;
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t hChannel)
+{
+    return hChannel ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *pConfig, rmt_encoder_handle_t *pEncoder)
+{
+    BytesEncoder *pBytes = new BytesEncoder();
+    pBytes->base.encode = BytesEncode;
+    pBytes->base.reset = BytesReset;
+    pBytes->base.del = BytesDelete;
+    pBytes->stBit0 = pConfig->bit0;
+    pBytes->stBit1 = pConfig->bit1;
+    pBytes->bMsbFirst = pConfig->flags.msb_first;
+    *pEncoder = &pBytes->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *pConfig, rmt_encoder_handle_t *pEncoder)
+{
+    CopyEncoder *pCopy = new CopyEncoder();
+    pCopy->base.encode = CopyEncode;
+    pCopy->base.reset = CopyReset;
+    pCopy->base.del = CopyDelete;
+    *pEncoder = &pCopy->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t hEncoder)
+{
+    return hEncoder->del(hEncoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t hEncoder)
+{
+    return hEncoder->reset(hEncoder);
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t hChannel, rmt_encoder_handle_t hEncoder, const void *pPayload, size_t u32Bytes, const rmt_transmit_config_t *pConfig)
+{
+    HostRmt::Channel &stCapture = hChannel->stCapture;
+    stCapture.vData.assign((const uint8_t *)pPayload, (const uint8_t *)pPayload + u32Bytes);
+    stCapture.vSymbols.clear();
+    // The driver calls the encoder again with the same arguments whenever channel memory was refilled.
+    rmt_encode_state_t eState = RMT_ENCODING_RESET;
+    do
+    {
+        hChannel->u32Free = hChannel->u32MemorySymbols;
+        hEncoder->encode(hEncoder, hChannel, pPayload, u32Bytes, &eState);
+        stCapture.u32RefillCount += (eState & RMT_ENCODING_MEM_FULL) ? 1 : 0;
+    } while (!(eState & RMT_ENCODING_COMPLETE));
+    stCapture.u32TransmitCount++;
+    stCapture.u32TransmitStamp = ++g_u32Stamp;
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t hChannel, int s32TimeoutMs)
+{
+    if (hChannel == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    hChannel->stCapture.u32WaitStamp = ++g_u32Stamp;
+    return ESP_OK;
+}
+
+const HostRmt::Channel *HostRmt::FindChannel(int32_t s32Gpio)
+{
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    auto it = g_mapChannels.find(s32Gpio);
+    return it == g_mapChannels.end() ? nullptr : &it->second->stCapture;
+}
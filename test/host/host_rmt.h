@@ -0,0 +1,27 @@
+#ifndef __ARTNET_NODE_HOST_RMT_H__
+#define __ARTNET_NODE_HOST_RMT_H__
+
+#include <stdint.h>
+#include <vector>
+#include "driver/rmt_tx.h"
+
+// What the RMT stand-in saw on a channel.
+namespace HostRmt
+{
+    typedef struct
+    {
+        int32_t s32Gpio;
+        uint32_t u32ResolutionHz;
+        uint32_t u32TransmitCount;
+        uint32_t u32RefillCount; // encoder calls that ended on a full channel memory
+        uint32_t u32TransmitStamp; // order of the last rmt_transmit() among the calls on every channel
+        uint32_t u32WaitStamp;     // same for rmt_tx_wait_all_done()
+        std::vector<uint8_t> vData; // payload of the last transmission
+        std::vector<rmt_symbol_word_t> vSymbols; // its waveform
+    } Channel;
+
+    // The newest channel created on s32Gpio, nullptr if there is none.
+    const Channel *FindChannel(int32_t s32Gpio);
+}
+
+#endif /* __ARTNET_NODE_HOST_RMT_H__ */
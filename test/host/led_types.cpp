@@ -0,0 +1,8 @@
+#include "miscellaneous.h"
+#include "led_output.h"
+
+// miscellaneous.cpp needs the board, this stand-in only knows the clockless types led_output.cpp drives.
+bool Existing::LedTypeOnline::IsValidLedTypeString(const std::string &sLedType)
+{
+    return RmtLedStrip::FindChipset(sLedType) != nullptr;
+}
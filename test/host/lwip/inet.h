@@ -0,0 +1,26 @@
+#ifndef __ARTNET_NODE_HOST_LWIP_INET_H__
+#define __ARTNET_NODE_HOST_LWIP_INET_H__
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+// Host stand-in for lwIP's IPv4 address helpers, on top of the POSIX ones.
+typedef struct
+{
+    uint32_t addr; // network byte order
+} ip4_addr_t;
+
+static inline int ip4addr_aton(const char *pAddress, ip4_addr_t *pAddr)
+{
+    struct in_addr stAddr;
+    if (inet_aton(pAddress, &stAddr) == 0)
+    {
+        return 0;
+    }
+    pAddr->addr = stAddr.s_addr;
+    return 1;
+}
+
+#define ip4_addr_get_u32(pAddr) ((pAddr)->addr)
+
+#endif /* __ARTNET_NODE_HOST_LWIP_INET_H__ */
@@ -0,0 +1,30 @@
+#ifndef __ARTNET_NODE_HOST_LWIP_NETIF_H__
+#define __ARTNET_NODE_HOST_LWIP_NETIF_H__
+
+#include "lwip/inet.h"
+
+// Host stand-in: the one interface, none until a test sets netif_default.
+struct netif
+{
+    ip4_addr_t ip_addr;
+    ip4_addr_t netmask;
+};
+
+extern struct netif *netif_default;
+
+// Limited broadcast or the directed broadcast of the interface's subnet, u32Address in network byte order.
+static inline bool ip4_addr_isbroadcast_u32(uint32_t u32Address, const struct netif *pNetif)
+{
+    if (u32Address == 0xFFFFFFFFUL)
+    {
+        return true;
+    }
+    if (pNetif == nullptr)
+    {
+        return false;
+    }
+    uint32_t u32Mask = pNetif->netmask.addr;
+    return u32Mask != 0xFFFFFFFFUL && (u32Address & u32Mask) == (pNetif->ip_addr.addr & u32Mask) && (u32Address & ~u32Mask) == ~u32Mask;
+}
+
+#endif /* __ARTNET_NODE_HOST_LWIP_NETIF_H__ */
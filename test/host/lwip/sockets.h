@@ -0,0 +1,13 @@
+#ifndef __ARTNET_NODE_HOST_LWIP_SOCKETS_H__
+#define __ARTNET_NODE_HOST_LWIP_SOCKETS_H__
+
+// Host stand-in: lwIP's BSD socket API is the POSIX one.
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#endif /* __ARTNET_NODE_HOST_LWIP_SOCKETS_H__ */
@@ -0,0 +1,15 @@
+#ifndef __ARTNET_NODE_HOST_LWIP_TCPIP_H__
+#define __ARTNET_NODE_HOST_LWIP_TCPIP_H__
+
+#include "lwip/udp.h"
+
+// Host stand-in: there is no tcpip thread, the callback runs in the caller.
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+static inline err_t tcpip_callback(tcpip_callback_fn fnFunction, void *pvContext)
+{
+    fnFunction(pvContext);
+    return ERR_OK;
+}
+
+#endif /* __ARTNET_NODE_HOST_LWIP_TCPIP_H__ */
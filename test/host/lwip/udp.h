@@ -0,0 +1,68 @@
+#ifndef __ARTNET_NODE_HOST_LWIP_UDP_H__
+#define __ARTNET_NODE_HOST_LWIP_UDP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lwip/inet.h"
+#include "lwip/netif.h"
+
+// Host stand-in for the parts of lwIP's raw UDP API main/ uses, IPv4 only. Datagrams are handed to a pcb with
+// HostLwip::Deliver() as a pbuf chain, sent ones are recorded instead of going out.
+typedef uint16_t u16_t;
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_USE -8
+
+typedef ip4_addr_t ip_addr_t;
+#define IPADDR4_INIT(u32Address) {u32Address}
+#define ip_2_ip4(pAddr) (pAddr)
+#define ip_addr_isbroadcast(pAddr, pNetif) ip4_addr_isbroadcast_u32((pAddr)->addr, pNetif)
+
+extern const ip_addr_t g_stHostIpAddrAny;
+#define IP_ADDR_ANY (&g_stHostIpAddrAny)
+
+static inline char *ipaddr_ntoa_r(const ip_addr_t *pAddr, char *pBuffer, int s32Length)
+{
+    struct in_addr stAddr = {pAddr->addr};
+    return inet_ntop(AF_INET, &stAddr, pBuffer, s32Length) ? pBuffer : nullptr;
+}
+
+struct pbuf
+{
+    struct pbuf *next;
+    void *payload;
+    u16_t len;
+    u16_t tot_len;
+};
+
+typedef enum
+{
+    PBUF_TRANSPORT,
+} pbuf_layer;
+
+typedef enum
+{
+    PBUF_RAM,
+} pbuf_type;
+
+struct pbuf *pbuf_alloc(pbuf_layer eLayer, u16_t u16Length, pbuf_type eType);
+// Frees the whole chain.
+uint8_t pbuf_free(struct pbuf *pBuf);
+err_t pbuf_take(struct pbuf *pBuf, const void *pData, u16_t u16Length);
+u16_t pbuf_copy_partial(const struct pbuf *pBuf, void *pData, u16_t u16Length, u16_t u16Offset);
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb *udp_new(void);
+void udp_remove(struct udp_pcb *pPcb);
+err_t udp_bind(struct udp_pcb *pPcb, const ip_addr_t *pAddr, u16_t u16Port);
+void udp_recv(struct udp_pcb *pPcb, udp_recv_fn fnRecv, void *pvArg);
+err_t udp_sendto(struct udp_pcb *pPcb, struct pbuf *pBuf, const ip_addr_t *pAddr, u16_t u16Port);
+
+// Source and destination of the datagram being delivered.
+const ip_addr_t *ip_current_dest_addr(void);
+struct netif *ip_current_netif(void);
+
+#endif /* __ARTNET_NODE_HOST_LWIP_UDP_H__ */
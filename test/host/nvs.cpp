@@ -0,0 +1,104 @@
+#include "nvs.h"
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Keyed by namespace, then key. Numbers are kept as their decimal text, types are not checked.
+static std::mutex g_oLock;
+static std::vector<std::string> g_vNamespaces;
+static std::map<std::string, std::map<std::string, std::string>> g_mapValues;
+
+static std::string *Find(nvs_handle_t hHandle, const char *pKey)
+{
+    if (hHandle == 0 || hHandle > g_vNamespaces.size())
+    {
+        return nullptr;
+    }
+    std::map<std::string, std::string> &mapKeys = g_mapValues[g_vNamespaces[hHandle - 1]];
+    auto it = mapKeys.find(pKey);
+    return it == mapKeys.end() ? nullptr : &it->second;
+}
+
+static esp_err_t Store(nvs_handle_t hHandle, const char *pKey, const std::string &sValue)
+{
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    if (hHandle == 0 || hHandle > g_vNamespaces.size())
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_mapValues[g_vNamespaces[hHandle - 1]][pKey] = sValue;
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *pNamespace, nvs_open_mode_t eMode, nvs_handle_t *pHandle)
+{
+    (void)eMode;
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    g_vNamespaces.push_back(pNamespace);
+    *pHandle = g_vNamespaces.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t hHandle, const char *pKey, char *pValue, size_t *pLength)
+{
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    std::string *pStored = Find(hHandle, pKey);
+    if (pStored == nullptr)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    // Without a buffer only the length, terminator included, is returned.
+    if (pValue == nullptr)
+    {
+        *pLength = pStored->size() + 1;
+        return ESP_OK;
+    }
+    if (*pLength < pStored->size() + 1)
+    {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(pValue, pStored->c_str(), pStored->size() + 1);
+    *pLength = pStored->size() + 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t hHandle, const char *pKey, int32_t *pValue)
+{
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    std::string *pStored = Find(hHandle, pKey);
+    if (pStored == nullptr)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *pValue = (int32_t)std::stol(*pStored);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t hHandle, const char *pKey, uint8_t *pValue)
+{
+    std::lock_guard<std::mutex> oGuard(g_oLock);
+    std::string *pStored = Find(hHandle, pKey);
+    if (pStored == nullptr)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *pValue = (uint8_t)std::stoul(*pStored);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t hHandle, const char *pKey, const char *pValue)
+{
+    return Store(hHandle, pKey, pValue);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t hHandle, const char *pKey, int32_t s32Value)
+{
+    return Store(hHandle, pKey, std::to_string(s32Value));
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t hHandle, const char *pKey, uint8_t u8Value)
+{
+    return Store(hHandle, pKey, std::to_string(u8Value));
+}
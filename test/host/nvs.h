@@ -0,0 +1,26 @@
+#ifndef __ARTNET_NODE_HOST_NVS_H__
+#define __ARTNET_NODE_HOST_NVS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Host stand-in: one in-memory namespace per handle, empty at start, so every setting starts at its default.
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *pNamespace, nvs_open_mode_t eMode, nvs_handle_t *pHandle);
+esp_err_t nvs_get_str(nvs_handle_t hHandle, const char *pKey, char *pValue, size_t *pLength);
+esp_err_t nvs_get_i32(nvs_handle_t hHandle, const char *pKey, int32_t *pValue);
+esp_err_t nvs_get_u8(nvs_handle_t hHandle, const char *pKey, uint8_t *pValue);
+esp_err_t nvs_set_str(nvs_handle_t hHandle, const char *pKey, const char *pValue);
+esp_err_t nvs_set_i32(nvs_handle_t hHandle, const char *pKey, int32_t s32Value);
+esp_err_t nvs_set_u8(nvs_handle_t hHandle, const char *pKey, uint8_t u8Value);
+static inline esp_err_t nvs_commit(nvs_handle_t hHandle) { (void)hHandle; return ESP_OK; }
+
+#endif /* __ARTNET_NODE_HOST_NVS_H__ */
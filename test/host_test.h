@@ -0,0 +1,78 @@
+#ifndef __ARTNET_NODE_HOST_TEST_H__
+#define __ARTNET_NODE_HOST_TEST_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "cJSON.h"
+#include "host_kernel.h"
+#include "port.h"
+
+// Just enough of a test framework for the host tests: a failed check reports where it failed and makes
+// the test executable exit non-zero, the remaining checks still run.
+static int32_t g_s32CheckFailures = 0;
+
+#define CHECK(expr)                                                                       \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(expr))                                                                      \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr);      \
+            g_s32CheckFailures++;                                                         \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                      \
+    do                                                                                                  \
+    {                                                                                                   \
+        long long s64Actual = (long long)(actual), s64Expected = (long long)(expected);                  \
+        if (s64Actual != s64Expected)                                                                   \
+        {                                                                                               \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__,       \
+                    #actual, #expected, s64Actual, s64Expected);                                        \
+            g_s32CheckFailures++;                                                                       \
+        }                                                                                               \
+    } while (0)
+
+#define RUN_TEST(fnTest)                         \
+    do                                           \
+    {                                            \
+        int32_t s32Before = g_s32CheckFailures;  \
+        fnTest();                                \
+        printf("%s %s\n", g_s32CheckFailures == s32Before ? "PASS" : "FAIL", #fnTest); \
+    } while (0)
+
+static inline int TestResult()
+{
+    if (g_s32CheckFailures != 0)
+    {
+        fprintf(stderr, "%d check(s) failed\n", (int)g_s32CheckFailures);
+    }
+    return g_s32CheckFailures == 0 ? 0 : 1;
+}
+
+// PayloadCopier_t of a plain buffer, pvContext points at the payload.
+static inline size_t CopyFromBuffer(void *pDest, size_t u32Length, void *pvContext)
+{
+    memcpy(pDest, pvContext, u32Length);
+    return u32Length;
+}
+
+// Applies settings as the web UI posts them, ports missing from "Ports" keep theirs.
+static inline void ConfigurePorts(const char *pJson)
+{
+    cJSON *pSettings = cJSON_Parse(pJson);
+    CHECK(pSettings != nullptr);
+    Settings::GetInstance().FromJson(pSettings);
+    cJSON_Delete(pSettings);
+}
+
+// Starts the output task as app_main does and waits until Ports::Init() is through.
+static inline void StartOutputTask()
+{
+    xTaskCreatePinnedToCore(Ports::FreeRTOSTask, "ports", 4096, xTaskGetCurrentTaskHandle(), 5, nullptr, PROJECT_OUTPUT_CORE);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    HostKernel::WaitIdle();
+}
+
+#endif /* __ARTNET_NODE_HOST_TEST_H__ */
@@ -0,0 +1,118 @@
+#include "host_test.h"
+#include "host_rmt.h"
+#include "port.h"
+#include <string.h>
+#include <vector>
+
+static std::vector<uint8_t> MakeRgb(size_t u32Pixels, uint8_t u8Seed)
+{
+    std::vector<uint8_t> vRgb(u32Pixels * 3);
+    for (size_t i = 0; i < vRgb.size(); ++i)
+    {
+        vRgb[i] = (uint8_t)(u8Seed + i * 13);
+    }
+    return vRgb;
+}
+
+static bool IsZero(const uint8_t *pBytes, size_t u32Length)
+{
+    for (size_t i = 0; i < u32Length; ++i)
+    {
+        if (pBytes[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// GRB wire order, written by each universe as it lands: the frame in assembly is wire format already and a
+// universe never touches the pixels of another.
+static void TestUniverseLandsInWireOrder()
+{
+    Port oPort(0);
+    std::vector<uint8_t> vUniverse0 = MakeRgb(170, 1), vUniverse1 = MakeRgb(30, 2);
+    const uint8_t *pFrame = oPort.m_aFrames[oPort.m_u8WriteIndex];
+    oPort.WriteUniverse(1, 0, vUniverse1.size(), CopyFromBuffer, vUniverse1.data());
+    CHECK(IsZero(pFrame, 510));
+    for (size_t i = 0; i < 30; ++i)
+    {
+        CHECK_EQ(pFrame[510 + i * 3], vUniverse1[i * 3 + 1]);
+        CHECK_EQ(pFrame[510 + i * 3 + 1], vUniverse1[i * 3]);
+        CHECK_EQ(pFrame[510 + i * 3 + 2], vUniverse1[i * 3 + 2]);
+    }
+    oPort.WriteUniverse(0, 0, vUniverse0.size(), CopyFromBuffer, vUniverse0.data());
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 1);
+    for (size_t i = 0; i < 170; ++i)
+    {
+        CHECK_EQ(pFrame[i * 3], vUniverse0[i * 3 + 1]);
+        CHECK_EQ(pFrame[i * 3 + 1], vUniverse0[i * 3]);
+        CHECK_EQ(pFrame[i * 3 + 2], vUniverse0[i * 3 + 2]);
+    }
+}
+
+// A wire pixel twice the size of its RGB: the payload is copied to the tail of its wire range and expanded front
+// to back, in place, in either universe order.
+static void TestInPlaceExpansion()
+{
+    std::vector<uint8_t> vUniverse0 = MakeRgb(170, 3), vUniverse1 = MakeRgb(30, 4);
+    for (int32_t s32Order = 0; s32Order < 2; ++s32Order)
+    {
+        Port oPort(1);
+        CHECK_EQ(oPort.m_u32FrameBytes, 200 * 6);
+        const uint8_t *pFrame = oPort.m_aFrames[oPort.m_u8WriteIndex];
+        for (int32_t i = 0; i < 2; ++i)
+        {
+            std::vector<uint8_t> &vPayload = (i == s32Order) ? vUniverse0 : vUniverse1;
+            oPort.WriteUniverse(i == s32Order ? 0 : 1, 0, vPayload.size(), CopyFromBuffer, vPayload.data());
+        }
+        CHECK_EQ(oPort.m_u32CommittedFrames.load(), 1);
+        for (size_t i = 0; i < 200 * 3; ++i)
+        {
+            uint8_t u8Rgb = i < 510 ? vUniverse0[i] : vUniverse1[i - 510];
+            // c * 257, high byte first.
+            CHECK_EQ(pFrame[i * 2], u8Rgb);
+            CHECK_EQ(pFrame[i * 2 + 1], u8Rgb);
+        }
+    }
+}
+
+// Showing only starts the RMT on the encoded frame: the bytes shifted out are the frame's, their waveform one
+// symbol per bit, most significant first, then the latch, across as many channel memory refills as it takes.
+static void TestShowSendsEncodedFrame()
+{
+    Port oPort(0);
+    std::vector<uint8_t> vUniverse0 = MakeRgb(170, 5), vUniverse1 = MakeRgb(30, 6);
+    oPort.WriteUniverse(0, 0, vUniverse0.size(), CopyFromBuffer, vUniverse0.data());
+    oPort.WriteUniverse(1, 0, vUniverse1.size(), CopyFromBuffer, vUniverse1.data());
+    CHECK(oPort.TakeReadyFrame());
+    CHECK_EQ(oPort.Show(), ESP_OK);
+    CHECK_EQ(oPort.WaitShown(), ESP_OK);
+    const HostRmt::Channel *pChannel = HostRmt::FindChannel(PROJECT_PORT_0_DATA_PIN);
+    const uint8_t *pFrame = oPort.m_aFrames[oPort.m_u8DisplayIndex];
+    CHECK_EQ(pChannel->vData.size(), oPort.m_u32FrameBytes);
+    CHECK(memcmp(pChannel->vData.data(), pFrame, oPort.m_u32FrameBytes) == 0);
+    CHECK_EQ(pChannel->vSymbols.size(), oPort.m_u32FrameBytes * 8 + 1);
+    CHECK(pChannel->u32RefillCount >= oPort.m_u32FrameBytes * 8 / PROJECT_LED_RMT_MEM_BLOCK_SYMBOLS);
+    // LED2812 at 0.1us per tick: 1.25us bits, high for 0.8us on a one and 0.4us on a zero.
+    size_t u32BadSymbols = 0;
+    for (size_t i = 0; i < oPort.m_u32FrameBytes * 8; ++i)
+    {
+        bool bBit = (pFrame[i / 8] >> (7 - i % 8)) & 1;
+        const rmt_symbol_word_t &stSymbol = pChannel->vSymbols[i];
+        u32BadSymbols += !(stSymbol.level0 == 1 && stSymbol.duration0 == (bBit ? 8 : 4) && stSymbol.level1 == 0 && stSymbol.duration1 == (bBit ? 4 : 8));
+    }
+    CHECK_EQ(u32BadSymbols, 0);
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":2,\"LedCount\":200,\"LedType\":\"LED2812\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":2,\"LedCount\":200,\"LedType\":\"LED8903\"}]}");
+
+    RUN_TEST(TestUniverseLandsInWireOrder);
+    RUN_TEST(TestInPlaceExpansion);
+    RUN_TEST(TestShowSendsEncodedFrame);
+    return TestResult();
+}
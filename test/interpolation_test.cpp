@@ -0,0 +1,199 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_rmt.h"
+#include "port.h"
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+// BlendFrames() against the per-byte formula, and the interpolated output task on the virtual clock: port 0
+// gets frames of one value each, the RMT channel shows every crossfade step in between.
+static uint32_t g_u32Random = 0x85EBCA6B;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+static constexpr int32_t RATE_HZ = 100;
+static constexpr int64_t TICK_US = 1000000 / RATE_HZ;
+static constexpr size_t PORT_BYTES = 1020 * 3;
+
+static uint8_t Blend(uint8_t u8From, uint8_t u8To, uint32_t u32Weight)
+{
+    return (u8From * (256 - u32Weight) + u8To * u32Weight) >> 8;
+}
+
+// Every weight, lengths with and without a tail after the last whole word, unaligned buffers.
+static void TestBlendFrames()
+{
+    for (size_t u32Length : {0, 1, 3, 4, 7, 64, 3061})
+    {
+        std::vector<uint8_t> vFrom(u32Length + 1), vTo(u32Length + 1), vOut(u32Length + 1);
+        for (size_t i = 0; i <= u32Length; ++i)
+        {
+            vFrom[i] = Random();
+            vTo[i] = Random();
+        }
+        // The extreme values, where a lane would overflow into its neighbour.
+        if (u32Length >= 4)
+        {
+            memset(&vFrom[1], 0xFF, 2);
+            memset(&vTo[3], 0xFF, 2);
+        }
+        for (uint32_t u32Weight = 0; u32Weight <= 256; ++u32Weight)
+        {
+            BlendFrames(&vOut[1], &vFrom[1], &vTo[1], u32Length, u32Weight);
+            uint32_t u32Wrong = 0;
+            for (size_t i = 1; i <= u32Length; ++i)
+            {
+                u32Wrong += vOut[i] != Blend(vFrom[i], vTo[i], u32Weight);
+            }
+            CHECK_EQ(u32Wrong, 0);
+        }
+    }
+}
+
+// Blend cost per 1020-pixel port against a byte at a time, for comparison only: it is not checked, the
+// sanitizers slow it down.
+static void TestBenchmark()
+{
+    std::vector<uint8_t> vFrom(PORT_BYTES), vTo(PORT_BYTES), vOut(PORT_BYTES);
+    for (size_t i = 0; i < PORT_BYTES; ++i)
+    {
+        vFrom[i] = Random();
+        vTo[i] = Random();
+    }
+    const int32_t s32Rounds = 20000;
+    uint32_t u32Sum = 0;
+    auto stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Rounds; ++i)
+    {
+        BlendFrames(vOut.data(), vFrom.data(), vTo.data(), PORT_BYTES, i & 0xFF);
+        u32Sum += vOut[i % PORT_BYTES];
+    }
+    double dWordNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count() / s32Rounds;
+    stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Rounds; ++i)
+    {
+        uint32_t u32Weight = i & 0xFF;
+        for (size_t j = 0; j < PORT_BYTES; ++j)
+        {
+            vOut[j] = Blend(vFrom[j], vTo[j], u32Weight);
+        }
+        u32Sum += vOut[i % PORT_BYTES];
+    }
+    double dByteNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count() / s32Rounds;
+    printf("Blend of a 1020 pixel port: %.0f ns a word at a time, %.0f ns a byte at a time (%u)\n", dWordNs, dByteNs, u32Sum & 1);
+}
+
+typedef struct
+{
+    const HostRmt::Channel *pChannel;
+    uint32_t u32Shown;
+    uint32_t u32Wrong; // shows with a value other than the expected one, or not the same on every byte
+    int64_t s64IntervalUs; // the port's input interval estimate, followed as Port::TakeBlendFrame() does
+    int64_t s64LastCommitUs;
+    uint8_t u8Shown; // what the strip shows
+} Output;
+
+static void Step(int64_t s64Us)
+{
+    HostKernel::WaitIdle();
+    HostKernel::Advance(s64Us);
+    HostKernel::WaitIdle();
+}
+
+// Sends a frame of u8Value and runs the clock for s64HoldUs. The first show after it repeats what the strip
+// showed, the crossfade then moves one tick's share of the input interval per show and stops on the frame.
+static void SendFrame(Output &stOutput, uint8_t u8Value, int64_t s64HoldUs)
+{
+    std::vector<uint8_t> vPayload(30, u8Value);
+    CHECK_EQ(Ports::GetInstance().WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    int64_t s64CommitUs = esp_timer_get_time();
+    int64_t s64IntervalUs = s64CommitUs - stOutput.s64LastCommitUs;
+    if (stOutput.s64LastCommitUs != 0 && s64IntervalUs <= PROJECT_INTERPOLATION_MAXIMUM_INTERVAL_US)
+    {
+        stOutput.s64IntervalUs += (s64IntervalUs - stOutput.s64IntervalUs) / 4;
+    }
+    stOutput.s64LastCommitUs = s64CommitUs;
+
+    uint8_t u8From = stOutput.u8Shown;
+    uint32_t u32Steps = 0;
+    bool bDone = false;
+    for (int64_t s64Us = 0; s64Us < s64HoldUs; s64Us += 1000)
+    {
+        Step(1000);
+        if (stOutput.pChannel->u32TransmitCount == stOutput.u32Shown)
+        {
+            continue;
+        }
+        CHECK_EQ(stOutput.pChannel->u32TransmitCount, stOutput.u32Shown + 1);
+        stOutput.u32Shown = stOutput.pChannel->u32TransmitCount;
+        int64_t s64ElapsedUs = u32Steps * TICK_US;
+        uint32_t u32Weight = s64ElapsedUs >= stOutput.s64IntervalUs ? 256 : s64ElapsedUs * 256 / stOutput.s64IntervalUs;
+        uint8_t u8Expected = Blend(u8From, u8Value, u32Weight);
+        bool bWrong = bDone;
+        for (uint8_t u8Byte : stOutput.pChannel->vData)
+        {
+            bWrong |= u8Byte != u8Expected;
+        }
+        stOutput.u32Wrong += bWrong;
+        stOutput.u8Shown = stOutput.pChannel->vData[0];
+        bDone = u32Weight == 256;
+        u32Steps++;
+    }
+    // A show on every tick until the frame is reached.
+    CHECK(bDone || (int64_t)u32Steps >= s64HoldUs / TICK_US);
+}
+
+// The first frame is shown as it is, not faded in from black. Each later one is reached in the input
+// interval at the output rate, whatever the input rate, and held once the input stops.
+static void TestCrossfade()
+{
+    Output stOutput = {HostRmt::FindChannel(PROJECT_PORT_0_DATA_PIN), 0, 0, 1000000 / 25, 0, 0};
+    stOutput.u32Shown = stOutput.pChannel->u32TransmitCount;
+    // Far enough from the port's initial commit time that the first interval is a pause.
+    Step(1000000);
+    uint32_t u32First = stOutput.u32Shown;
+    stOutput.u8Shown = 200;
+    SendFrame(stOutput, 200, 55000);
+    const uint8_t au8Values[] = {100, 0, 255, 17, 240, 128, 129, 3};
+    for (int32_t i = 0; i < 20; ++i)
+    {
+        SendFrame(stOutput, au8Values[i % sizeof(au8Values)], 55000);
+    }
+    for (int32_t i = 0; i < 10; ++i)
+    {
+        SendFrame(stOutput, au8Values[i % sizeof(au8Values)], 100000);
+    }
+    uint32_t u32Shows = stOutput.u32Shown - u32First;
+    printf("%u shows for 31 input frames, last input interval estimate %lld us\n", u32Shows, (long long)stOutput.s64IntervalUs);
+    CHECK_EQ(stOutput.u32Wrong, 0);
+
+    // Stopped input: the last frame stays, nothing more is sent.
+    Step(1000000);
+    uint32_t u32Shown = stOutput.pChannel->u32TransmitCount;
+    CHECK_EQ(stOutput.pChannel->vData[0], au8Values[9 % sizeof(au8Values)]);
+    Step(1000000);
+    CHECK_EQ(stOutput.pChannel->u32TransmitCount, u32Shown);
+}
+
+int main()
+{
+    ConfigurePorts("{\"ArtNetSync\":false,\"FrameOutputMode\":\"Interpolated\",\"InterpolationRateHz\":100,\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    CHECK_EQ(Settings::GetInstance().GetInterpolationRateHz(), RATE_HZ);
+    StartOutputTask();
+
+    RUN_TEST(TestBlendFrames);
+    RUN_TEST(TestBenchmark);
+    RUN_TEST(TestCrossfade);
+    return TestResult();
+}
@@ -0,0 +1,125 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_rmt.h"
+#include "port.h"
+#include <string.h>
+#include <vector>
+
+// The output task runs as it does on the target, on the host kernel's virtual clock. What it showed is read
+// back from the RMT channels of port 0 (pin PROJECT_PORT_0_DATA_PIN) and port 1.
+static std::vector<uint8_t> Write(int32_t s32Universe, uint8_t u8Value)
+{
+    std::vector<uint8_t> vPayload(30, u8Value);
+    CHECK_EQ(Ports::GetInstance().WriteUniverse(s32Universe, 0, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    HostKernel::WaitIdle();
+    return vPayload;
+}
+
+static uint32_t Shown(int32_t s32Pin)
+{
+    return HostRmt::FindChannel(s32Pin)->u32TransmitCount;
+}
+
+static const std::vector<uint8_t> &Data(int32_t s32Pin)
+{
+    return HostRmt::FindChannel(s32Pin)->vData;
+}
+
+static int32_t GetStatus(const char *pName)
+{
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    int32_t s32Value = cJSON_GetObjectItemCaseSensitive(pJson, pName)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+// Mode changes are picked up once the current wait of the output task ends.
+static void SwitchMode(bool bArtSync, const char *pMode)
+{
+    CHECK_EQ(Settings::GetInstance().SetArtNetSyncEnabled(bArtSync), ESP_OK);
+    CHECK_EQ(Settings::GetInstance().SetFrameOutputMode(pMode), ESP_OK);
+    HostKernel::Advance(PROJECT_OUTPUT_MODE_POLL_MS * 1000);
+}
+
+// Without ArtSync all ports are shown together once every active port has a new frame.
+static void TestAllPortsShowOnComplete()
+{
+    uint32_t u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN), u32Shown1 = Shown(PROJECT_PORT_1_DATA_PIN);
+    std::vector<uint8_t> vPort0 = Write(0, 0x11);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0);
+    std::vector<uint8_t> vPort1 = Write(1, 0x22);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+    CHECK(Data(PROJECT_PORT_0_DATA_PIN) == vPort0);
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == vPort1);
+}
+
+// A port that stays behind holds the others back for the output deadline only.
+static void TestAllPortsDeadline()
+{
+    uint32_t u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN);
+    int32_t s32DeadlineShows = GetStatus("DeadlineShowCount");
+    std::vector<uint8_t> vPort0 = Write(0, 0x33);
+    HostKernel::Advance((Settings::GetInstance().GetOutputDeadlineMs() - 1) * 1000);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0);
+    HostKernel::Advance(1000);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK(Data(PROJECT_PORT_0_DATA_PIN) == vPort0);
+    CHECK_EQ(GetStatus("DeadlineShowCount"), s32DeadlineShows + 1);
+}
+
+// PerPort shows each port the moment its frame completes, the other ports are left alone.
+static void TestPerPort()
+{
+    SwitchMode(false, "PerPort");
+    uint32_t u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN), u32Shown1 = Shown(PROJECT_PORT_1_DATA_PIN);
+    std::vector<uint8_t> vPort1 = Write(1, 0x44);
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0);
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == vPort1);
+    std::vector<uint8_t> vPort0 = Write(0, 0x55);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK(Data(PROJECT_PORT_0_DATA_PIN) == vPort0);
+}
+
+// With ArtSync enabled complete frames wait for the sync, whatever the frame output mode says.
+static void TestArtSync()
+{
+    SwitchMode(true, "PerPort");
+    uint32_t u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN), u32Shown1 = Shown(PROJECT_PORT_1_DATA_PIN);
+    std::vector<uint8_t> vPort0 = Write(0, 0x66);
+    std::vector<uint8_t> vPort1 = Write(1, 0x77);
+    HostKernel::Advance(100000);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0);
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1);
+    Ports::GetInstance().Sync();
+    HostKernel::WaitIdle();
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+    CHECK_EQ(Shown(PROJECT_PORT_1_DATA_PIN), u32Shown1 + 1);
+    CHECK(Data(PROJECT_PORT_0_DATA_PIN) == vPort0);
+    CHECK(Data(PROJECT_PORT_1_DATA_PIN) == vPort1);
+
+    // Frame completions seen while waiting for the sync must not show anything once sync is off again.
+    SwitchMode(false, "AllPorts");
+    u32Shown0 = Shown(PROJECT_PORT_0_DATA_PIN);
+    Write(0, 0x88);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0);
+    Write(1, 0x99);
+    CHECK_EQ(Shown(PROJECT_PORT_0_DATA_PIN), u32Shown0 + 1);
+}
+
+int main()
+{
+    ConfigurePorts("{\"ArtNetSync\":false,\"FrameOutputMode\":\"AllPorts\",\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    StartOutputTask();
+
+    RUN_TEST(TestAllPortsShowOnComplete);
+    RUN_TEST(TestAllPortsDeadline);
+    RUN_TEST(TestPerPort);
+    RUN_TEST(TestArtSync);
+    return TestResult();
+}
@@ -0,0 +1,65 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_rmt.h"
+#include "port.h"
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static const int32_t g_aPins[PROJECT_NUMBER_OF_PORTS] = {PROJECT_PORT_0_DATA_PIN, PROJECT_PORT_1_DATA_PIN, PROJECT_PORT_2_DATA_PIN, PROJECT_PORT_3_DATA_PIN};
+
+// One RMT channel per port on the port's data pin, all at the encoder's resolution.
+static void TestChannelPerPort()
+{
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        const HostRmt::Channel *pChannel = HostRmt::FindChannel(g_aPins[i]);
+        CHECK(pChannel != nullptr);
+        if (pChannel == nullptr)
+        {
+            return;
+        }
+        CHECK_EQ(pChannel->u32ResolutionHz, PROJECT_LED_RMT_RESOLUTION_HZ);
+        for (int32_t j = 0; j < i; ++j)
+        {
+            CHECK(HostRmt::FindChannel(g_aPins[j]) != pChannel);
+        }
+    }
+}
+
+// A frame of every port is shifted out by its own channel, all channels are started before the output task
+// waits for any of them, so a frame takes one strip time instead of one per port.
+static void TestAllChannelsStartBeforeWaiting()
+{
+    std::vector<uint8_t> aPayloads[PROJECT_NUMBER_OF_PORTS];
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        aPayloads[i].assign(30 * (i + 1), 0x10 * (i + 1));
+        CHECK_EQ(Ports::GetInstance().WriteUniverse(i, 0, aPayloads[i].size(), CopyFromBuffer, aPayloads[i].data()), aPayloads[i].size());
+    }
+    HostKernel::WaitIdle();
+    uint32_t u32LastStart = 0, u32FirstWait = UINT32_MAX;
+    for (int32_t i = 0; i < PROJECT_NUMBER_OF_PORTS; ++i)
+    {
+        const HostRmt::Channel *pChannel = HostRmt::FindChannel(g_aPins[i]);
+        CHECK_EQ(pChannel->u32TransmitCount, 1);
+        CHECK(pChannel->vData == aPayloads[i]);
+        u32LastStart = std::max(u32LastStart, pChannel->u32TransmitStamp);
+        u32FirstWait = std::min(u32FirstWait, pChannel->u32WaitStamp);
+    }
+    CHECK(u32LastStart < u32FirstWait);
+}
+
+int main()
+{
+    ConfigurePorts("{\"ArtNetSync\":false,\"FrameOutputMode\":\"AllPorts\",\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":1,\"LedCount\":20,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":2,\"NoUniverses\":1,\"LedCount\":30,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":3,\"NoUniverses\":1,\"LedCount\":40,\"LedType\":\"LED2811\"}]}");
+    StartOutputTask();
+
+    RUN_TEST(TestChannelPerPort);
+    RUN_TEST(TestAllChannelsStartBeforeWaiting);
+    return TestResult();
+}
@@ -0,0 +1,174 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "port.h"
+#include <string.h>
+#include <vector>
+
+static uint32_t g_u32Random = 0x2545F491;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+static constexpr int32_t LED_COUNT = 1020;
+static constexpr int64_t FRAME_US = 25000; // 40 fps
+static constexpr int64_t UNIVERSE_US = 1000;
+
+static int32_t GetStatus(Port &oPort, const char *pName)
+{
+    cJSON *pJson = oPort.ToJson();
+    int32_t s32Value = cJSON_GetObjectItemCaseSensitive(pJson, pName)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+// One port configuration: a port that gets every universe, and one that gets them with losses. Both
+// are fed the same frames; the reference shows what a received pixel must look like on the other.
+typedef struct
+{
+    Port *pReference;
+    Port *pLossy;
+    size_t u32UniverseBytes;
+    std::vector<uint8_t> vShown; // what the lossy port must show, in wire bytes
+    uint32_t u32Frames;
+    uint32_t u32Shown; // frames the lossy port committed
+    uint32_t u32Partial; // of those, frames with universes missing
+    uint32_t u32Concealed; // missing universes of partial frames
+    uint32_t u32Wrong; // frames that did not show what they should
+} Stream;
+
+static void SendFrame(Stream &stStream, uint32_t u32LossPermille, uint8_t u8Sequence)
+{
+    std::vector<uint8_t> vFrame(LED_COUNT * 3);
+    for (uint8_t &u8Byte : vFrame)
+    {
+        u8Byte = Random();
+    }
+    int32_t s32Universes = stStream.pLossy->GetNoUniverses();
+    uint64_t u64Received = 0;
+    for (int32_t i = 0; i < s32Universes; ++i)
+    {
+        size_t u32Offset = i * stStream.u32UniverseBytes;
+        size_t u32Length = std::min(stStream.u32UniverseBytes, vFrame.size() - u32Offset);
+        stStream.pReference->WriteUniverse(i, u8Sequence, u32Length, CopyFromBuffer, &vFrame[u32Offset]);
+        if (Random() % 1000 >= u32LossPermille)
+        {
+            stStream.pLossy->WriteUniverse(i, u8Sequence, u32Length, CopyFromBuffer, &vFrame[u32Offset]);
+            u64Received |= 1ULL << i;
+        }
+        HostKernel::Advance(UNIVERSE_US);
+    }
+    // Past the deadline before the next frame starts.
+    HostKernel::Advance(FRAME_US - s32Universes * UNIVERSE_US);
+
+    stStream.u32Frames++;
+    CHECK(stStream.pReference->TakeReadyFrame());
+    const uint8_t *pReference = stStream.pReference->m_aFrames[stStream.pReference->m_u8DisplayIndex];
+    if (!stStream.pLossy->TakeReadyFrame())
+    {
+        stStream.u32Wrong += u64Received != 0;
+        return;
+    }
+    stStream.u32Shown++;
+    if (u64Received != (1ULL << s32Universes) - 1)
+    {
+        stStream.u32Partial++;
+        stStream.u32Concealed += s32Universes - __builtin_popcountll(u64Received);
+    }
+    // A pixel is new when every universe carrying one of its bytes arrived, else it keeps what was shown.
+    for (int32_t s32Pixel = 0; s32Pixel < LED_COUNT; ++s32Pixel)
+    {
+        int32_t s32First = s32Pixel * 3 / stStream.u32UniverseBytes, s32Last = (s32Pixel * 3 + 2) / stStream.u32UniverseBytes;
+        bool bFresh = true;
+        for (int32_t i = s32First; i <= s32Last; ++i)
+        {
+            bFresh &= (u64Received >> i) & 1;
+        }
+        if (bFresh)
+        {
+            memcpy(&stStream.vShown[s32Pixel * 3], pReference + s32Pixel * 3, 3);
+        }
+    }
+    const uint8_t *pLossy = stStream.pLossy->m_aFrames[stStream.pLossy->m_u8DisplayIndex];
+    stStream.u32Wrong += memcmp(pLossy, stStream.vShown.data(), stStream.vShown.size()) != 0;
+}
+
+static Stream MakeStream(Port &oReference, Port &oLossy, size_t u32UniverseBytes)
+{
+    return {&oReference, &oLossy, u32UniverseBytes, std::vector<uint8_t>(LED_COUNT * 3, 0), 0, 0, 0, 0, 0};
+}
+
+// Missing universes are filled from the frame shown before, at the deadline; a pixel split across a lost and
+// a received universe keeps its old value as a whole. The counters match what was concealed.
+static void TestConcealment()
+{
+    CHECK_EQ(Settings::GetInstance().SetPartialFrameDeadlineMs(10), ESP_OK);
+    Port oReference0(0), oLossy0(0), oReference1(1), oLossy1(1);
+    Stream astStreams[] = {MakeStream(oReference0, oLossy0, 510), MakeStream(oReference1, oLossy1, 512)};
+    for (Stream &stStream : astStreams)
+    {
+        for (uint32_t u32Frame = 0; u32Frame < 500; ++u32Frame)
+        {
+            SendFrame(stStream, 100, u32Frame % 255 + 1);
+        }
+        CHECK_EQ(stStream.u32Wrong, 0);
+        CHECK(stStream.u32Partial > 100);
+        CHECK_EQ(GetStatus(*stStream.pLossy, "PartialCommits"), stStream.u32Partial);
+        CHECK_EQ(GetStatus(*stStream.pLossy, "ConcealedUniverses"), stStream.u32Concealed);
+        CHECK_EQ(GetStatus(*stStream.pReference, "PartialCommits"), 0);
+    }
+}
+
+// Without the deadline a frame that lost a universe is dropped, or shown torn once the next frame's universes
+// fill its holes; with the deadline every frame that got any universe is shown on time.
+static void TestVisibleFrameRate()
+{
+    const uint32_t u32Frames = 2000;
+    for (uint32_t u32LossPermille : {0, 20, 50, 100})
+    {
+        double adRate[2];
+        for (int32_t s32DeadlineMs : {0, 10})
+        {
+            CHECK_EQ(Settings::GetInstance().SetPartialFrameDeadlineMs(s32DeadlineMs), ESP_OK);
+            Port oReference(0), oLossy(0);
+            Stream stStream = MakeStream(oReference, oLossy, 510);
+            for (uint32_t u32Frame = 0; u32Frame < u32Frames; ++u32Frame)
+            {
+                SendFrame(stStream, u32LossPermille, u32Frame % 255 + 1);
+            }
+            adRate[s32DeadlineMs != 0] = 1e6 / FRAME_US * stStream.u32Shown / u32Frames;
+            if (s32DeadlineMs != 0)
+            {
+                CHECK_EQ(stStream.u32Wrong, 0);
+            }
+        }
+        double q = 1 - u32LossPermille / 1000.0, dComplete = q * q * q * q * q * q;
+        printf("%4.1f%% loss: %4.1f fps shown without deadline (%4.1f fps complete frames), %4.1f fps with a 10 ms deadline\n",
+               u32LossPermille / 10.0, adRate[0], 1e6 / FRAME_US * dComplete, adRate[1]);
+        CHECK(adRate[1] >= 0.99 * 1e6 / FRAME_US);
+        if (u32LossPermille != 0)
+        {
+            CHECK(adRate[0] < 0.95 * adRate[1]);
+        }
+    }
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":6,\"LedCount\":1020,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":6,\"NoUniverses\":6,\"LedCount\":1020,\"LedType\":\"LED2811\","
+                   "\"ChannelsPerUniverse\":512,\"SplitPixels\":true},"
+                   "{\"StartUniverse\":12,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":12,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    // The deadline timers take the receive mutex of the ports.
+    Ports::GetInstance();
+
+    RUN_TEST(TestConcealment);
+    RUN_TEST(TestVisibleFrameRate);
+    return TestResult();
+}
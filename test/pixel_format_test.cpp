@@ -0,0 +1,268 @@
+#include "host_test.h"
+#include "port.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// Every pixel format and universe packing of a port, run through the copy plans and the assembler with the
+// universes arriving in random order, against the pixels that were sent.
+static uint32_t g_u32Random = 0x27D4EB2F;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+typedef struct
+{
+    uint8_t u8Channels;
+    uint8_t u8BytesPerChannel;
+    uint16_t u16UniverseBytes;
+    bool bSplitPixels;
+    bool bWhite; // an RGBW strip
+    uint32_t u32LedCount;
+
+    PixelFormat GetFormat() const { return {u8Channels, u8BytesPerChannel, u16UniverseBytes, bSplitPixels}; }
+    size_t GetUniverses() const
+    {
+        size_t u32BytesPerPixel = u8Channels * u8BytesPerChannel;
+        if (bSplitPixels && u16UniverseBytes % u32BytesPerPixel != 0)
+        {
+            return (u32LedCount * u32BytesPerPixel + u16UniverseBytes - 1) / u16UniverseBytes;
+        }
+        size_t u32PerUniverse = u16UniverseBytes / u32BytesPerPixel;
+        return (u32LedCount + u32PerUniverse - 1) / u32PerUniverse;
+    }
+} Case;
+
+static std::vector<Case> GetCases()
+{
+    std::vector<Case> vCases;
+    for (uint8_t u8Channels : {1, 3, 4})
+        for (uint8_t u8BytesPerChannel : {1, 2})
+            for (uint16_t u16UniverseBytes : {510, 512})
+                for (bool bSplitPixels : {false, true})
+                    for (bool bWhite : {false, true})
+                        for (uint32_t u32LedCount : {1020, 777})
+                        {
+                            vCases.push_back({u8Channels, u8BytesPerChannel, u16UniverseBytes, bSplitPixels, bWhite, u32LedCount});
+                        }
+    return vCases;
+}
+
+static const char *GetName(uint8_t u8Channels)
+{
+    return u8Channels == 1 ? "Mono" : u8Channels == 4 ? "RGBW" : "RGB";
+}
+
+// Each pixel lands in the universes exactly once: the whole pixels of the plans and the tails split across two
+// universes cover the port without gaps or overlaps, and nothing beyond it.
+static void TestCopyPlans()
+{
+    for (const Case &stCase : GetCases())
+    {
+        CopyPlan oPlan;
+        size_t u32Universes = stCase.GetUniverses();
+        oPlan.Build(stCase.GetFormat(), u32Universes, stCase.u32LedCount, stCase.bWhite);
+        CHECK_EQ(oPlan.IsDirect(), stCase.u8Channels == 3 && stCase.u8BytesPerChannel == 1 && (!stCase.bSplitPixels || stCase.u16UniverseBytes == 510));
+        CHECK_EQ(oPlan.GetOutputChannels(), stCase.u8Channels == 4 && stCase.bWhite ? 4 : 3);
+        std::vector<uint32_t> vCovered(stCase.u32LedCount, 0);
+        size_t u32BytesPerPixel = stCase.GetFormat().GetBytesPerPixel();
+        for (size_t i = 0; i < u32Universes; ++i)
+        {
+            const UniverseCopy &stCopy = oPlan.GetUniverse(i);
+            CHECK(stCopy.u16Offset + stCopy.u16Pixels * u32BytesPerPixel <= stCase.u16UniverseBytes);
+            for (size_t p = stCopy.u32FirstPixel; p < stCopy.u32FirstPixel + stCopy.u16Pixels; ++p)
+            {
+                CHECK(p < stCase.u32LedCount);
+                vCovered[std::min<size_t>(p, stCase.u32LedCount - 1)]++;
+            }
+            if (stCopy.u8TailBytes != 0)
+            {
+                CHECK(stCopy.u32TailPixel < stCase.u32LedCount);
+                CHECK(i + 1 < u32Universes);
+                CHECK_EQ(stCopy.u16TailOffset + stCopy.u8TailBytes, stCase.u16UniverseBytes);
+                vCovered[std::min<size_t>(stCopy.u32TailPixel, stCase.u32LedCount - 1)]++;
+                // The rest of the pixel opens the next universe.
+                if (i + 1 < u32Universes)
+                {
+                    CHECK_EQ(oPlan.GetUniverse(i + 1).u16Offset + stCopy.u8TailBytes, u32BytesPerPixel);
+                }
+            }
+        }
+        CHECK(std::all_of(vCovered.begin(), vCovered.end(), [](uint32_t u32Count) { return u32Count == 1; }));
+    }
+}
+
+// The universes of a frame of random pixels, packed as the sender does.
+static std::vector<std::vector<uint8_t>> Pack(const Case &stCase, const std::vector<uint16_t> &vPixels)
+{
+    size_t u32BytesPerPixel = stCase.GetFormat().GetBytesPerPixel();
+    bool bSplit = stCase.bSplitPixels && stCase.u16UniverseBytes % u32BytesPerPixel != 0;
+    size_t u32PerUniverse = stCase.u16UniverseBytes / u32BytesPerPixel;
+    std::vector<std::vector<uint8_t>> vUniverses(stCase.GetUniverses(), std::vector<uint8_t>(stCase.u16UniverseBytes, 0));
+    for (size_t p = 0; p < stCase.u32LedCount; ++p)
+    {
+        for (size_t c = 0; c < stCase.u8Channels; ++c)
+        {
+            uint16_t u16Value = vPixels[p * stCase.u8Channels + c];
+            for (size_t b = 0; b < stCase.u8BytesPerChannel; ++b)
+            {
+                size_t u32Byte = c * stCase.u8BytesPerChannel + b;
+                uint8_t u8Byte = stCase.u8BytesPerChannel == 2 ? (b == 0 ? u16Value >> 8 : u16Value & 0xFF) : u16Value;
+                size_t u32Position = bSplit ? p * u32BytesPerPixel + u32Byte : (p / u32PerUniverse) * stCase.u16UniverseBytes + (p % u32PerUniverse) * u32BytesPerPixel + u32Byte;
+                vUniverses[u32Position / stCase.u16UniverseBytes][u32Position % stCase.u16UniverseBytes] = u8Byte;
+            }
+        }
+    }
+    return vUniverses;
+}
+
+// A port built from the settings for the case, fed one frame.
+static const uint8_t *Assemble(const Case &stCase, const std::vector<std::vector<uint8_t>> &vUniverses, bool bShuffle)
+{
+    char acSettings[512];
+    snprintf(acSettings, sizeof(acSettings),
+             "{\"Ports\":[{\"StartUniverse\":0,\"NoUniverses\":%zu,\"LedCount\":%u,\"LedType\":\"%s\",\"PixelFormat\":\"%s\","
+             "\"BitDepth\":%u,\"ChannelsPerUniverse\":%u,\"SplitPixels\":%s}]}",
+             vUniverses.size(), stCase.u32LedCount, stCase.bWhite ? "LED1904" : "LED2811", GetName(stCase.u8Channels),
+             stCase.u8BytesPerChannel * 8, stCase.u16UniverseBytes, stCase.bSplitPixels ? "true" : "false");
+    ConfigurePorts(acSettings);
+    Port *pPort = new Port(0);
+    CHECK_EQ(pPort->GetNoUniverses(), vUniverses.size());
+    std::vector<size_t> vOrder(vUniverses.size());
+    for (size_t i = 0; i < vOrder.size(); ++i)
+    {
+        vOrder[i] = i;
+    }
+    for (size_t i = vOrder.size(); bShuffle && i > 1; --i)
+    {
+        std::swap(vOrder[i - 1], vOrder[Random() % i]);
+    }
+    for (size_t i : vOrder)
+    {
+        pPort->WriteUniverse(i, 0, vUniverses[i].size(), CopyFromBuffer, (void *)vUniverses[i].data());
+    }
+    CHECK(pPort->TakeReadyFrame());
+    return pPort->m_aFrames[pPort->m_u8DisplayIndex];
+}
+
+// 8-bit input exactly, 16-bit input within a step of n / 257, whose rounding the error diffusion spreads.
+// RGBW input on an RGB strip mixes white into R, G and B.
+static void TestFormats()
+{
+    uint32_t u32Cases = 0;
+    for (const Case &stCase : GetCases())
+    {
+        std::vector<uint16_t> vPixels(stCase.u32LedCount * stCase.u8Channels);
+        for (uint16_t &u16Value : vPixels)
+        {
+            u16Value = stCase.u8BytesPerChannel == 2 ? Random() & 0xFFFF : Random() & 0xFF;
+        }
+        std::vector<std::vector<uint8_t>> vUniverses = Pack(stCase, vPixels);
+        const uint8_t *pFrame = Assemble(stCase, vUniverses, true);
+        // The strips have no colour correction by default, the wire bytes are R, G, B and W for LED1904.
+        size_t u32WireBytes = stCase.bWhite ? 4 : 3;
+        double dTolerance = stCase.u8BytesPerChannel == 1 ? 0 : stCase.u8Channels == 4 && !stCase.bWhite ? 2 : 1;
+        uint32_t u32Wrong = 0;
+        for (size_t p = 0; p < stCase.u32LedCount; ++p)
+        {
+            double adIn[4] = {};
+            for (size_t c = 0; c < stCase.u8Channels; ++c)
+            {
+                uint16_t u16Value = vPixels[p * stCase.u8Channels + c];
+                adIn[c] = stCase.u8BytesPerChannel == 2 ? u16Value / 257.0 : u16Value;
+            }
+            double adExpected[4] = {adIn[0], adIn[1], adIn[2], adIn[3]};
+            if (stCase.u8Channels == 1)
+            {
+                adExpected[1] = adExpected[2] = adIn[0];
+            }
+            else if (stCase.u8Channels == 4 && !stCase.bWhite)
+            {
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    adExpected[c] = std::min(adIn[c] + adIn[3], 255.0);
+                }
+            }
+            for (size_t c = 0; c < u32WireBytes; ++c)
+            {
+                u32Wrong += fabs(pFrame[p * u32WireBytes + c] - adExpected[c]) > dTolerance;
+            }
+        }
+        if (u32Wrong != 0)
+        {
+            printf("%s %u bit, %u channels per universe, split %d, white %d, %u leds: %u wrong\n", GetName(stCase.u8Channels),
+                   stCase.u8BytesPerChannel * 8, stCase.u16UniverseBytes, stCase.bSplitPixels, stCase.bWhite, stCase.u32LedCount, u32Wrong);
+        }
+        CHECK_EQ(u32Wrong, 0);
+        u32Cases++;
+    }
+    printf("%u format and packing cases\n", u32Cases);
+    CHECK_EQ(u32Cases, 96);
+}
+
+// The error diffusion starts over in every universe, so the frame does not depend on the arrival order.
+static void TestOrderIndependence()
+{
+    for (const Case &stCase : GetCases())
+    {
+        if (stCase.u8BytesPerChannel != 2 || stCase.u32LedCount != 777)
+        {
+            continue;
+        }
+        std::vector<uint16_t> vPixels(stCase.u32LedCount * stCase.u8Channels);
+        for (uint16_t &u16Value : vPixels)
+        {
+            u16Value = Random() & 0xFFFF;
+        }
+        std::vector<std::vector<uint8_t>> vUniverses = Pack(stCase, vPixels);
+        size_t u32Bytes = stCase.u32LedCount * (stCase.bWhite ? 4 : 3);
+        std::vector<uint8_t> vInOrder(u32Bytes);
+        memcpy(vInOrder.data(), Assemble(stCase, vUniverses, false), u32Bytes);
+        CHECK(memcmp(vInOrder.data(), Assemble(stCase, vUniverses, true), u32Bytes) == 0);
+    }
+}
+
+// A flat 16-bit level between two 8-bit steps comes out as a mix of both with the right mean, where rounding
+// every pixel would be off by up to half a step.
+static void TestDither()
+{
+    CopyPlan oPlan;
+    oPlan.Build({1, 2, 510, false}, 1, 255, false);
+    for (uint16_t u16Level : {0x80C0, 0x0140, 0xFE80, 0x1234})
+    {
+        uint8_t au8In[510], au8Out[255 * 3];
+        for (size_t i = 0; i < 255; ++i)
+        {
+            au8In[2 * i] = u16Level >> 8;
+            au8In[2 * i + 1] = u16Level & 0xFF;
+        }
+        oPlan.GetConverter()(au8Out, au8In, 255);
+        double dSum = 0;
+        uint8_t u8Min = 255, u8Max = 0;
+        for (size_t i = 0; i < 255; ++i)
+        {
+            dSum += au8Out[3 * i];
+            u8Min = std::min(u8Min, au8Out[3 * i]);
+            u8Max = std::max(u8Max, au8Out[3 * i]);
+        }
+        double dExpected = u16Level / 257.0;
+        CHECK(fabs(dSum / 255 - dExpected) < 0.01);
+        CHECK(u8Max - u8Min <= 1);
+        CHECK(u8Min <= dExpected && dExpected <= u8Max);
+    }
+}
+
+int main()
+{
+    RUN_TEST(TestCopyPlans);
+    RUN_TEST(TestFormats);
+    RUN_TEST(TestOrderIndependence);
+    RUN_TEST(TestDither);
+    return TestResult();
+}
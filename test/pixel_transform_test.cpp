@@ -0,0 +1,225 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_rmt.h"
+#include "port.h"
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+// PixelTransform against a naive per-pixel implementation for every wire layout of the chipset table, and
+// the ports rebuilding their tables on settings changes only.
+static uint32_t g_u32Random = 0xC2B2AE35;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+typedef struct
+{
+    float fGamma;
+    float fBrightness;
+    std::array<uint8_t, 3> aWhiteBalance;
+} Correction;
+
+static const Correction g_aCorrections[] =
+{
+    {1.0f, 1.0f, {255, 255, 255}},
+    {2.2f, 1.0f, {255, 255, 255}},
+    {1.0f, 0.5f, {255, 255, 255}},
+    {1.0f, 1.0f, {255, 200, 100}},
+    {2.8f, 0.25f, {180, 255, 40}},
+    {1.0f, 0.0f, {255, 255, 255}},
+};
+
+// Wire byte j of the pixel, worked out on its own with the same float steps the tables are built with.
+static uint8_t GetWireByte(const LedChipset &stChipset, const Correction &stCorrection, const uint8_t *pPixel, uint8_t j)
+{
+    uint8_t u8Channel = stChipset.aWire[j];
+    float fGain = u8Channel == LED_WIRE_WHITE ? stCorrection.fBrightness : stCorrection.fBrightness * stCorrection.aWhiteBalance[u8Channel] / 255.0f;
+    float fLevel = powf(pPixel[u8Channel] / 255.0f, stCorrection.fGamma) * fGain;
+    bool bHigh = j + 1 < stChipset.u8BytesPerPixel && stChipset.aWire[j + 1] == u8Channel && u8Channel != LED_WIRE_WHITE;
+    bool bLow = j > 0 && stChipset.aWire[j - 1] == u8Channel && u8Channel != LED_WIRE_WHITE;
+    uint32_t u32Level16 = (uint32_t)(fLevel * 65535.0f + 0.5f);
+    return bHigh ? u32Level16 >> 8 : bLow ? u32Level16 & 0xFF : (uint8_t)(fLevel * 255.0f + 0.5f);
+}
+
+// The naive implementation: every wire byte of every pixel computed from scratch.
+static void EncodeNaive(uint8_t *pWire, const uint8_t *pPixels, size_t u32Pixels, uint8_t u8Channels, const LedChipset &stChipset,
+                        const Correction &stCorrection)
+{
+    for (size_t i = 0; i < u32Pixels; ++i)
+    {
+        uint8_t aPixel[4] = {pPixels[i * u8Channels], pPixels[i * u8Channels + 1], pPixels[i * u8Channels + 2],
+                             u8Channels == 4 ? pPixels[i * u8Channels + 3] : (uint8_t)0};
+        for (uint8_t j = 0; j < stChipset.u8BytesPerPixel; ++j)
+        {
+            pWire[i * stChipset.u8BytesPerPixel + j] = GetWireByte(stChipset, stCorrection, aPixel, j);
+        }
+    }
+}
+
+static const char *g_apChipsets[] = {"LED1903", "LED1904", "LED1905", "LED2811", "LED2812", "LED8206", "LED1916",
+                                     "LED16703", "LED9883", "LED1914", "LED8903", "UCS1903"};
+
+// Every chipset and correction, RGB and RGBW input, pixel counts on and off the four pixel step, into a separate
+// buffer, in place, and from the tail of the wire region as the assembler expands universes.
+static void TestAgainstNaive()
+{
+    for (const char *pName : g_apChipsets)
+    {
+        const LedChipset *pChipset = RmtLedStrip::FindChipset(pName);
+        CHECK(pChipset != nullptr);
+        for (const Correction &stCorrection : g_aCorrections)
+        {
+            PixelTransform oTransform;
+            oTransform.Build(*pChipset, stCorrection.fGamma, stCorrection.fBrightness, stCorrection.aWhiteBalance);
+            bool bOrdered = pChipset->u8BytesPerPixel == 3 && pChipset->aWire[0] == 0 && pChipset->aWire[1] == 1 && pChipset->aWire[2] == 2;
+            CHECK_EQ(oTransform.IsIdentity(), bOrdered && &stCorrection == &g_aCorrections[0]);
+            for (uint8_t u8Channels : {3, 4})
+            {
+                for (size_t u32Pixels : {1, 4, 5, 170, 171})
+                {
+                    size_t u32In = u32Pixels * u8Channels, u32Out = u32Pixels * pChipset->u8BytesPerPixel;
+                    std::vector<uint8_t> vPixels(u32In), vExpected(u32Out), vWire(u32Out);
+                    for (uint8_t &u8Byte : vPixels)
+                    {
+                        u8Byte = Random();
+                    }
+                    EncodeNaive(vExpected.data(), vPixels.data(), u32Pixels, u8Channels, *pChipset, stCorrection);
+                    oTransform.Apply(vWire.data(), vPixels.data(), u32In, u8Channels);
+                    CHECK(vWire == vExpected);
+
+                    std::vector<uint8_t> vRegion(std::max(u32In, u32Out));
+                    memcpy(&vRegion[vRegion.size() - u32In], vPixels.data(), u32In);
+                    oTransform.Apply(vRegion.data(), &vRegion[vRegion.size() - u32In], u32In, u8Channels);
+                    CHECK(memcmp(vRegion.data(), vExpected.data(), u32Out) == 0);
+                }
+            }
+        }
+    }
+}
+
+// Gamma keeps black and full scale, is monotonic, and the 16-bit tables use the extra resolution: a dark
+// 8-bit input step is more than one 16-bit step.
+static void TestGammaCurve()
+{
+    const LedChipset *pChipset = RmtLedStrip::FindChipset("LED8903");
+    PixelTransform oTransform;
+    oTransform.Build(*pChipset, 2.2f, 1.0f, {255, 255, 255});
+    uint32_t u32Previous = 0, u32Distinct = 0;
+    for (int32_t x = 0; x < 256; ++x)
+    {
+        uint8_t aPixel[3] = {(uint8_t)x, 0, 0}, aWire[6];
+        oTransform.Apply(aWire, aPixel, 3, 3);
+        uint32_t u32Level = aWire[0] << 8 | aWire[1];
+        CHECK(x == 0 || u32Level >= u32Previous);
+        u32Distinct += x == 0 || u32Level != u32Previous;
+        u32Previous = u32Level;
+    }
+    CHECK_EQ(u32Previous, 0xFFFF);
+    // An 8-bit output with gamma 2.2 merges the darkest inputs, 16 bits keep nearly all of them apart.
+    CHECK(u32Distinct >= 250);
+}
+
+// The ports build their tables when the settings revision changes, not per packet, and the next frame shows
+// the new correction.
+static void TestRebuildOnSettings()
+{
+    Ports &oPorts = Ports::GetInstance();
+    const HostRmt::Channel *pChannel = HostRmt::FindChannel(PROJECT_PORT_0_DATA_PIN);
+    const LedChipset *pChipset = RmtLedStrip::FindChipset("LED2812");
+    std::vector<uint8_t> vPayload(30);
+    auto GetBuilds = [&oPorts]()
+    {
+        cJSON *pJson = oPorts.ToJson();
+        int32_t s32Builds = cJSON_GetObjectItemCaseSensitive(pJson, "TransformBuilds")->valueint;
+        cJSON_Delete(pJson);
+        return s32Builds;
+    };
+    auto CheckFrame = [&]()
+    {
+        for (uint8_t &u8Byte : vPayload)
+        {
+            u8Byte = Random();
+        }
+        CHECK_EQ(oPorts.WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+        HostKernel::WaitIdle();
+        const Settings &oSettings = Settings::GetInstance();
+        Correction stCorrection = {oSettings.GetGamma(), oSettings.GetBrightness() / 255.0f, oSettings.GetWhiteBalance()};
+        std::vector<uint8_t> vExpected(30);
+        EncodeNaive(vExpected.data(), vPayload.data(), 10, 3, *pChipset, stCorrection);
+        CHECK(pChannel->vData == vExpected);
+    };
+
+    int32_t s32Builds = GetBuilds();
+    for (int32_t i = 0; i < 10; ++i)
+    {
+        CheckFrame();
+    }
+    CHECK_EQ(GetBuilds(), s32Builds);
+
+    CHECK_EQ(Settings::GetInstance().SetGamma(2.2), ESP_OK);
+    CheckFrame();
+    CHECK_EQ(GetBuilds(), s32Builds + 1);
+    CHECK_EQ(Settings::GetInstance().SetBrightness(128), ESP_OK);
+    CHECK_EQ(Settings::GetInstance().SetWhiteBalance({255, 180, 90}), ESP_OK);
+    for (int32_t i = 0; i < 10; ++i)
+    {
+        CheckFrame();
+    }
+    CHECK_EQ(GetBuilds(), s32Builds + 2);
+}
+
+// Encoding cost per pixel of a 1020-pixel port, tables against the naive implementation, for comparison only:
+// it is not checked, the sanitizers slow it down.
+static void TestBenchmark()
+{
+    const size_t u32Pixels = 1020;
+    const Correction stCorrection = {2.2f, 0.5f, {255, 200, 100}};
+    std::vector<uint8_t> vPixels(u32Pixels * 3), vWire(u32Pixels * 3);
+    for (uint8_t &u8Byte : vPixels)
+    {
+        u8Byte = Random();
+    }
+    const LedChipset *pChipset = RmtLedStrip::FindChipset("LED2812");
+    PixelTransform oTransform;
+    oTransform.Build(*pChipset, stCorrection.fGamma, stCorrection.fBrightness, stCorrection.aWhiteBalance);
+    const int32_t s32Rounds = 2000;
+    uint32_t u32Sum = 0;
+    auto stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Rounds; ++i)
+    {
+        oTransform.Apply(vWire.data(), vPixels.data(), vPixels.size(), 3);
+        u32Sum += vWire[i % vWire.size()];
+    }
+    double dLutNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count() / s32Rounds / u32Pixels;
+    stStart = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < s32Rounds / 20; ++i)
+    {
+        EncodeNaive(vWire.data(), vPixels.data(), u32Pixels, 3, *pChipset, stCorrection);
+        u32Sum += vWire[i % vWire.size()];
+    }
+    double dNaiveNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count() / (s32Rounds / 20) / u32Pixels;
+    printf("Pixel transform: %.2f ns per pixel with tables, %.1f ns per pixel naive (%u)\n", dLutNs, dNaiveNs, u32Sum & 1);
+}
+
+int main()
+{
+    ConfigurePorts("{\"ArtNetSync\":false,\"FrameOutputMode\":\"PerPort\",\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2812\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    StartOutputTask();
+
+    RUN_TEST(TestAgainstNaive);
+    RUN_TEST(TestGammaCurve);
+    RUN_TEST(TestRebuildOnSettings);
+    RUN_TEST(TestBenchmark);
+    return TestResult();
+}
@@ -0,0 +1,180 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "host_rmt.h"
+#include "port.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// The paced output task on the virtual clock, fed from synthetic arrival traces. Each frame fills port 0 with its
+// own number, the RMT channel tells which frame was shown and, stepping the clock by a millisecond, when.
+static uint32_t g_u32Random = 0x1B873593;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+static constexpr int64_t PERIOD_US = 25000; // 40 fps sent
+static constexpr int64_t STEP_US = 1000;
+
+static int64_t g_s64NowUs = 0;
+
+static int32_t GetPlayout(const char *pName)
+{
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    int32_t s32Value = cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(pJson, "Playout"), pName)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+typedef struct
+{
+    int64_t s64TimeUs;
+    uint8_t u8Frame;
+} Event;
+
+// Mean deviation of the intervals between events from the sender's period, the first u32Skip events are
+// the playout settling in.
+static double GetJitterUs(const std::vector<Event> &vEvents, size_t u32Skip)
+{
+    double dSum = 0;
+    size_t u32Count = 0;
+    for (size_t i = u32Skip + 1; i < vEvents.size(); ++i)
+    {
+        dSum += fabs((double)(vEvents[i].s64TimeUs - vEvents[i - 1].s64TimeUs) - PERIOD_US);
+        u32Count++;
+    }
+    return u32Count ? dSum / u32Count : 0;
+}
+
+// Delivers each frame at its arrival time and records every show until the queue ran dry.
+static std::vector<Event> Play(const std::vector<int64_t> &vArrivalsUs, std::vector<Event> &vArrivals)
+{
+    std::vector<Event> vShows;
+    const HostRmt::Channel *pChannel = HostRmt::FindChannel(PROJECT_PORT_0_DATA_PIN);
+    uint32_t u32Shown = pChannel->u32TransmitCount;
+    int64_t s64StartUs = g_s64NowUs;
+    size_t u32Next = 0;
+    while (u32Next < vArrivalsUs.size() || g_s64NowUs < s64StartUs + vArrivalsUs.back() + 10 * PERIOD_US)
+    {
+        while (u32Next < vArrivalsUs.size() && s64StartUs + vArrivalsUs[u32Next] <= g_s64NowUs)
+        {
+            uint8_t u8Frame = u32Next + 1;
+            std::vector<uint8_t> vPayload(30, u8Frame);
+            Ports::GetInstance().WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data());
+            vArrivals.push_back({g_s64NowUs, u8Frame});
+            u32Next++;
+        }
+        HostKernel::WaitIdle();
+        HostKernel::Advance(STEP_US);
+        g_s64NowUs += STEP_US;
+        if (pChannel->u32TransmitCount != u32Shown)
+        {
+            CHECK_EQ(pChannel->u32TransmitCount, u32Shown + 1);
+            u32Shown = pChannel->u32TransmitCount;
+            vShows.push_back({g_s64NowUs, pChannel->vData[0]});
+        }
+    }
+    return vShows;
+}
+
+// Frames are shown in the order sent, none twice.
+static void CheckOrder(const std::vector<Event> &vShows)
+{
+    for (size_t i = 1; i < vShows.size(); ++i)
+    {
+        CHECK(vShows[i].u8Frame > vShows[i - 1].u8Frame);
+    }
+}
+
+static void Report(const char *pName, const std::vector<Event> &vArrivals, const std::vector<Event> &vShows, double &dIn, double &dOut)
+{
+    dIn = GetJitterUs(vArrivals, 40);
+    dOut = GetJitterUs(vShows, 40);
+    printf("%s: %zu frames in, %zu shown, jitter in %.0f us, out %.0f us; status: period %d us, delay %d us, jitter in %d us, out %d us, late %d\n",
+           pName, vArrivals.size(), vShows.size(), dIn, dOut, GetPlayout("PeriodUs"), GetPlayout("DelayUs"), GetPlayout("JitterInUs"),
+           GetPlayout("JitterOutUs"), GetPlayout("Late"));
+}
+
+// Arrivals spread up to 8 ms around their slot come out on a steady clock, every frame shown.
+static void TestUniformJitter()
+{
+    std::vector<int64_t> vArrivalsUs;
+    for (int32_t i = 0; i < 240; ++i)
+    {
+        int64_t s64Us = i * PERIOD_US + (int64_t)(Random() % 16000) - 8000;
+        vArrivalsUs.push_back(std::max<int64_t>(s64Us, vArrivalsUs.empty() ? 0 : vArrivalsUs.back()));
+    }
+    std::vector<Event> vArrivals;
+    std::vector<Event> vShows = Play(vArrivalsUs, vArrivals);
+    double dIn, dOut;
+    Report("uniform +-8 ms", vArrivals, vShows, dIn, dOut);
+    CheckOrder(vShows);
+    CHECK(vShows.size() >= vArrivals.size() - 3);
+    CHECK(dOut < dIn / 3);
+    CHECK(GetPlayout("JitterOutUs") < GetPlayout("JitterInUs"));
+    CHECK(abs(GetPlayout("PeriodUs") - PERIOD_US) < 1000);
+}
+
+// WiFi bursts: two frames back to back every other period. The playout delay absorbs them.
+static void TestBursts()
+{
+    std::vector<int64_t> vArrivalsUs;
+    for (int32_t i = 0; i < 240; ++i)
+    {
+        vArrivalsUs.push_back((i / 2) * 2 * PERIOD_US + PERIOD_US + (i % 2) * 1000);
+    }
+    std::vector<Event> vArrivals;
+    std::vector<Event> vShows = Play(vArrivalsUs, vArrivals);
+    double dIn, dOut;
+    Report("bursts of 2", vArrivals, vShows, dIn, dOut);
+    CheckOrder(vShows);
+    CHECK(vShows.size() >= vArrivals.size() - 3);
+    CHECK(dOut < dIn / 3);
+}
+
+// A stall followed by a burst of the frames held up: the ones that missed their tick are dropped while newer
+// ones wait, the rest stay in order, and the clock settles again.
+static void TestStall()
+{
+    int32_t s32Late = GetPlayout("Late");
+    std::vector<int64_t> vArrivalsUs;
+    for (int32_t i = 0; i < 200; ++i)
+    {
+        int64_t s64Us = i * PERIOD_US;
+        if (i >= 100 && i < 106)
+        {
+            s64Us = 106 * PERIOD_US - (106 - i) * 500;
+        }
+        vArrivalsUs.push_back(s64Us);
+    }
+    std::vector<Event> vArrivals;
+    std::vector<Event> vShows = Play(vArrivalsUs, vArrivals);
+    double dIn, dOut;
+    Report("150 ms stall", vArrivals, vShows, dIn, dOut);
+    CheckOrder(vShows);
+    CHECK(GetPlayout("Late") > s32Late);
+    CHECK(vShows.size() < vArrivals.size());
+    // Steady again once the burst is through.
+    std::vector<Event> vTail(vShows.end() - 60, vShows.end() - 10);
+    CHECK(GetJitterUs(vTail, 0) < 2000);
+}
+
+int main()
+{
+    ConfigurePorts("{\"ArtNetSync\":false,\"FramePacing\":true,\"PartialFrameDeadlineMs\":0,\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    StartOutputTask();
+
+    RUN_TEST(TestUniformJitter);
+    RUN_TEST(TestBursts);
+    RUN_TEST(TestStall);
+    return TestResult();
+}
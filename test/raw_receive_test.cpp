@@ -0,0 +1,234 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "port.h"
+#include <string.h>
+#include <vector>
+
+// The raw lwIP receive path without lwIP: a datagram split over a pbuf chain the way the WiFi driver hands it
+// over, its ArtDmx header parsed from a copy and the payload copied by offset straight into the port frame,
+// as ArtNetRawServer does with pbuf_copy_partial().
+typedef struct HostPbuf
+{
+    struct HostPbuf *next;
+    const uint8_t *payload;
+    uint16_t len;
+    uint16_t tot_len;
+} HostPbuf;
+
+typedef struct
+{
+    const HostPbuf *pBuf;
+    uint16_t u16Offset;
+} RawPayload_t;
+
+// lwIP's pbuf_copy_partial(): up to u32Length bytes from u32Offset on, across the chain.
+static size_t PbufCopyPartial(const HostPbuf *pBuf, void *pDest, size_t u32Length, size_t u32Offset)
+{
+    size_t u32Copied = 0;
+    for (const HostPbuf *p = pBuf; p != nullptr && u32Copied < u32Length; p = p->next)
+    {
+        if (u32Offset >= p->len)
+        {
+            u32Offset -= p->len;
+            continue;
+        }
+        size_t u32Chunk = std::min<size_t>(p->len - u32Offset, u32Length - u32Copied);
+        memcpy((uint8_t *)pDest + u32Copied, p->payload + u32Offset, u32Chunk);
+        u32Copied += u32Chunk;
+        u32Offset = 0;
+    }
+    return u32Copied;
+}
+
+static size_t CopyPayload(void *pDest, size_t u32Length, void *pvContext)
+{
+    RawPayload_t *pPayload = (RawPayload_t *)pvContext;
+    return PbufCopyPartial(pPayload->pBuf, pDest, u32Length, pPayload->u16Offset);
+}
+
+// A datagram and its pbuf chain, one pbuf per entry of vSizes, the last one takes the rest.
+typedef struct Chain
+{
+    std::vector<uint8_t> vDatagram;
+    std::vector<HostPbuf> vPbufs;
+
+    Chain(const std::vector<uint8_t> &vData, const std::vector<size_t> &vSizes) : vDatagram(vData)
+    {
+        size_t u32Offset = 0;
+        for (size_t i = 0; i <= vSizes.size() && u32Offset < vDatagram.size(); ++i)
+        {
+            size_t u32Length = i < vSizes.size() ? std::min(vSizes[i], vDatagram.size() - u32Offset) : vDatagram.size() - u32Offset;
+            vPbufs.push_back({nullptr, vDatagram.data() + u32Offset, (uint16_t)u32Length, (uint16_t)(vDatagram.size() - u32Offset)});
+            u32Offset += u32Length;
+        }
+        for (size_t i = 0; i + 1 < vPbufs.size(); ++i)
+        {
+            vPbufs[i].next = &vPbufs[i + 1];
+        }
+    }
+    const HostPbuf *Head() const { return &vPbufs[0]; }
+} Chain;
+
+static std::vector<uint8_t> MakeArtDmx(int32_t s32Universe, uint8_t u8Sequence, size_t u32Length, uint8_t u8Seed)
+{
+    std::vector<uint8_t> vPacket(ArtNet::OFFSET_DMX_DATA + u32Length);
+    memcpy(vPacket.data(), ArtNet::ID, sizeof(ArtNet::ID));
+    vPacket[ArtNet::OFFSET_OPCODE] = ArtNet::OP_DMX & 0xFF;
+    vPacket[ArtNet::OFFSET_OPCODE + 1] = ArtNet::OP_DMX >> 8;
+    vPacket[ArtNet::OFFSET_PROT_VER_LO] = ArtNet::PROTOCOL_VERSION;
+    vPacket[ArtNet::OFFSET_DMX_SEQUENCE] = u8Sequence;
+    vPacket[ArtNet::OFFSET_DMX_SUBUNI] = s32Universe & 0xFF;
+    vPacket[ArtNet::OFFSET_DMX_NET] = s32Universe >> 8;
+    vPacket[ArtNet::OFFSET_DMX_LENGTH_HI] = u32Length >> 8;
+    vPacket[ArtNet::OFFSET_DMX_LENGTH_LO] = u32Length & 0xFF;
+    for (size_t i = 0; i < u32Length; ++i)
+    {
+        vPacket[ArtNet::OFFSET_DMX_DATA + i] = (uint8_t)(u8Seed + i * 7);
+    }
+    return vPacket;
+}
+
+// ArtNetRawServer::HandleIncommingMessage() for ArtDmx, into a port. Returns the payload bytes copied, 0 when dropped.
+static size_t ReceiveRaw(Port &oPort, const Chain &oChain)
+{
+    uint8_t au8Header[ArtNet::OFFSET_DMX_DATA];
+    size_t u32HeaderLength = PbufCopyPartial(oChain.Head(), au8Header, sizeof(au8Header), 0);
+    ArtNet::Packet oPacket;
+    if (oPacket.Parse(au8Header, u32HeaderLength, oChain.Head()->tot_len) != ArtNet::PARSE_OK || oPacket.GetOpCode() != ArtNet::OP_DMX)
+    {
+        return 0;
+    }
+    RawPayload_t stPayload = {oChain.Head(), ArtNet::OFFSET_DMX_DATA};
+    return oPort.WriteUniverse(oPacket.GetPortAddress() - oPort.GetStartUniverse(), oPacket.GetSequence(), oPacket.GetDmxLength(), CopyPayload, &stPayload);
+}
+
+static void TestPbufCopyPartial()
+{
+    std::vector<uint8_t> vData(100);
+    for (size_t i = 0; i < vData.size(); ++i)
+    {
+        vData[i] = i;
+    }
+    Chain oChain(vData, {7, 1, 40});
+    CHECK_EQ(oChain.vPbufs.size(), 4);
+    uint8_t au8Out[100] = {};
+    CHECK_EQ(PbufCopyPartial(oChain.Head(), au8Out, 10, 5), 10);
+    CHECK_EQ(au8Out[0], 5);
+    CHECK_EQ(au8Out[9], 14);
+    CHECK_EQ(PbufCopyPartial(oChain.Head(), au8Out, 100, 90), 10);
+    CHECK_EQ(au8Out[9], 99);
+    CHECK_EQ(PbufCopyPartial(oChain.Head(), au8Out, 10, 100), 0);
+}
+
+// Both universes of port 0 arrive split at every awkward place: inside the ArtDmx header, at the payload
+// start and in the middle of a pixel. The committed frame must be the payload, byte for byte.
+static void TestChainedUniversesFillFrame()
+{
+    Port oPort(0);
+    CHECK_EQ(oPort.GetNoUniverses(), 2);
+    CHECK_EQ(oPort.m_u32FrameBytes, 340 * 3);
+    std::vector<uint8_t> vUniverse0 = MakeArtDmx(0, 0, 510, 1);
+    std::vector<uint8_t> vUniverse1 = MakeArtDmx(1, 0, 510, 2);
+    Chain oChain0(vUniverse0, {5, 10, 4, 100});
+    Chain oChain1(vUniverse1, {ArtNet::OFFSET_DMX_DATA, 1, 255, 1});
+
+    CHECK_EQ(ReceiveRaw(oPort, oChain0), 510);
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 0);
+    CHECK_EQ(ReceiveRaw(oPort, oChain1), 510);
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 1);
+    const uint8_t *pFrame = oPort.m_aFrames[oPort.m_u8PreviousIndex];
+    CHECK(memcmp(pFrame, vUniverse0.data() + ArtNet::OFFSET_DMX_DATA, 510) == 0);
+    CHECK(memcmp(pFrame + 510, vUniverse1.data() + ArtNet::OFFSET_DMX_DATA, 510) == 0);
+}
+
+// ArtDmx longer than the port: only the pixels it has are copied, the copy never runs past the frame.
+static void TestPayloadClippedToPort()
+{
+    Port oPort(1);
+    CHECK_EQ(oPort.m_u32FrameBytes, 100 * 3);
+    std::vector<uint8_t> vPacket = MakeArtDmx(10, 0, 512, 3);
+    Chain oChain(vPacket, {20, 200});
+    CHECK_EQ(ReceiveRaw(oPort, oChain), 300);
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 1);
+    CHECK(memcmp(oPort.m_aFrames[oPort.m_u8PreviousIndex], vPacket.data() + ArtNet::OFFSET_DMX_DATA, 300) == 0);
+}
+
+// A datagram shorter than its ArtDmx length field is dropped before anything is copied.
+static void TestTruncatedDatagramDropped()
+{
+    Port oPort(1);
+    std::vector<uint8_t> vPacket = MakeArtDmx(10, 0, 300, 4);
+    vPacket.resize(vPacket.size() - 1);
+    Chain oChain(vPacket, {30});
+    CHECK_EQ(ReceiveRaw(oPort, oChain), 0);
+    CHECK_EQ(oPort.m_u64ReceivedMask, 0);
+}
+
+static size_t g_u32HolderCopied = 0;
+static size_t g_u32WaiterCopied = 0;
+
+// Copies the payload, then keeps the receive mutex for 10 ms like assembly stuck behind a slow copy.
+static size_t SlowCopy(void *pDest, size_t u32Length, void *pvContext)
+{
+    size_t u32Copied = CopyPayload(pDest, u32Length, pvContext);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    return u32Copied;
+}
+
+static void HolderTask(void *pvChain)
+{
+    RawPayload_t stPayload = {((Chain *)pvChain)->Head(), ArtNet::OFFSET_DMX_DATA};
+    g_u32HolderCopied = Ports::GetInstance().WriteUniverse(0, 0, 510, SlowCopy, &stPayload);
+}
+
+static void WaiterTask(void *pvChain)
+{
+    RawPayload_t stPayload = {((Chain *)pvChain)->Head(), ArtNet::OFFSET_DMX_DATA};
+    g_u32WaiterCopied = Ports::GetInstance().WriteUniverse(1, 0, 510, CopyPayload, &stPayload);
+}
+
+static int32_t GetLockTimeouts()
+{
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    int32_t s32Count = cJSON_GetObjectItemCaseSensitive(pJson, "ReceiveLockTimeouts")->valueint;
+    cJSON_Delete(pJson);
+    return s32Count;
+}
+
+// The tcpip thread never waits for the receive mutex longer than PROJECT_RECEIVE_LOCK_TIMEOUT_MS, the packet is
+// dropped and counted instead.
+static void TestBusyMutexDropsPacket()
+{
+    Chain oChain0(MakeArtDmx(0, 0, 510, 5), {64});
+    Chain oChain1(MakeArtDmx(1, 0, 510, 6), {64});
+    xTaskCreate(HolderTask, "holder", 4096, &oChain0, 5, nullptr);
+    HostKernel::WaitIdle();
+    xTaskCreate(WaiterTask, "waiter", 4096, &oChain1, 5, nullptr);
+    HostKernel::Advance(PROJECT_RECEIVE_LOCK_TIMEOUT_MS * 1000);
+    CHECK_EQ(g_u32WaiterCopied, 0);
+    CHECK_EQ(GetLockTimeouts(), 1);
+    HostKernel::Advance(10000);
+    CHECK_EQ(g_u32HolderCopied, 510);
+
+    // Free again, the next packet goes through.
+    RawPayload_t stPayload = {oChain1.Head(), ArtNet::OFFSET_DMX_DATA};
+    CHECK_EQ(Ports::GetInstance().WriteUniverse(1, 0, 510, CopyPayload, &stPayload), 510);
+    CHECK_EQ(GetLockTimeouts(), 1);
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":2,\"LedCount\":340,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":10,\"NoUniverses\":1,\"LedCount\":100,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":20,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":30,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+
+    RUN_TEST(TestPbufCopyPartial);
+    RUN_TEST(TestChainedUniversesFillFrame);
+    RUN_TEST(TestPayloadClippedToPort);
+    RUN_TEST(TestTruncatedDatagramDropped);
+    Ports::GetInstance().Init();
+    RUN_TEST(TestBusyMutexDropsPacket);
+    return TestResult();
+}
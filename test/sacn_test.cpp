@@ -0,0 +1,330 @@
+#include "host_test.h"
+#include "udp_server.h"
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace E131;
+
+static std::vector<uint8_t> MakeRoot(uint32_t u32RootVector, uint8_t u8Cid, size_t u32Length)
+{
+    std::vector<uint8_t> vPacket(u32Length, 0);
+    vPacket[OFFSET_PREAMBLE_SIZE + 1] = 0x10;
+    memcpy(&vPacket[OFFSET_ACN_ID], ACN_ID, sizeof(ACN_ID));
+    vPacket[OFFSET_ROOT_VECTOR + 3] = u32RootVector;
+    memset(&vPacket[OFFSET_CID], u8Cid, CID_LENGTH);
+    for (size_t u32Pdu : {OFFSET_ROOT_VECTOR - 2, OFFSET_FRAMING_VECTOR - 2})
+    {
+        vPacket[u32Pdu] = 0x70 | (u32Length - u32Pdu) >> 8;
+        vPacket[u32Pdu + 1] = u32Length - u32Pdu;
+    }
+    return vPacket;
+}
+
+typedef struct
+{
+    uint8_t u8Cid;
+    uint16_t u16Universe;
+    uint8_t u8Priority;
+    uint8_t u8Sequence;
+    uint8_t u8Options;
+    uint16_t u16SyncUniverse;
+    uint8_t u8Value;
+} DataPacket;
+
+static std::vector<uint8_t> MakeData(const DataPacket &stData, uint16_t u16Slots = 3)
+{
+    size_t u32Length = OFFSET_DMX_DATA + u16Slots;
+    std::vector<uint8_t> vPacket = MakeRoot(VECTOR_ROOT_DATA, stData.u8Cid, u32Length);
+    vPacket[OFFSET_FRAMING_VECTOR + 3] = VECTOR_DATA_PACKET;
+    vPacket[OFFSET_DATA_PRIORITY] = stData.u8Priority;
+    vPacket[OFFSET_DATA_SYNC_ADDRESS] = stData.u16SyncUniverse >> 8;
+    vPacket[OFFSET_DATA_SYNC_ADDRESS + 1] = stData.u16SyncUniverse;
+    vPacket[OFFSET_DATA_SEQUENCE] = stData.u8Sequence;
+    vPacket[OFFSET_DATA_OPTIONS] = stData.u8Options;
+    vPacket[OFFSET_DATA_UNIVERSE] = stData.u16Universe >> 8;
+    vPacket[OFFSET_DATA_UNIVERSE + 1] = stData.u16Universe;
+    vPacket[OFFSET_DMP_VECTOR - 2] = 0x70 | (u32Length - OFFSET_DMP_VECTOR + 2) >> 8;
+    vPacket[OFFSET_DMP_VECTOR - 1] = u32Length - OFFSET_DMP_VECTOR + 2;
+    vPacket[OFFSET_DMP_VECTOR] = 0x02;
+    vPacket[OFFSET_DMP_ADDRESS_TYPE] = 0xA1;
+    vPacket[OFFSET_DMP_ADDRESS_TYPE + 4] = 1; // address increment
+    vPacket[OFFSET_DMP_PROPERTY_COUNT] = (u16Slots + 1) >> 8;
+    vPacket[OFFSET_DMP_PROPERTY_COUNT + 1] = u16Slots + 1;
+    memset(&vPacket[OFFSET_DMX_DATA], stData.u8Value, u16Slots);
+    return vPacket;
+}
+
+static std::vector<uint8_t> MakeSync(uint16_t u16SyncUniverse, uint8_t u8Sequence)
+{
+    std::vector<uint8_t> vPacket = MakeRoot(VECTOR_ROOT_EXTENDED, 1, SYNC_LENGTH);
+    vPacket[OFFSET_FRAMING_VECTOR + 3] = VECTOR_EXTENDED_SYNCHRONIZATION;
+    vPacket[OFFSET_SYNC_SEQUENCE] = u8Sequence;
+    vPacket[OFFSET_SYNC_ADDRESS] = u16SyncUniverse >> 8;
+    vPacket[OFFSET_SYNC_ADDRESS + 1] = u16SyncUniverse;
+    return vPacket;
+}
+
+static void TestParseData()
+{
+    Packet oPacket;
+    std::vector<uint8_t> vPacket = MakeData({7, 63999, 150, 42, 0, 9, 0xAB}, 512);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size()), PARSE_OK);
+    CHECK_EQ(oPacket.GetType(), PACKET_DATA);
+    CHECK_EQ(oPacket.GetCid()[0], 7);
+    CHECK_EQ(oPacket.GetUniverse(), 63999);
+    CHECK_EQ(oPacket.GetPriority(), 150);
+    CHECK_EQ(oPacket.GetSequence(), 42);
+    CHECK_EQ(oPacket.GetSyncAddress(), 9);
+    CHECK_EQ(oPacket.GetDmxLength(), 512);
+    CHECK(oPacket.GetDmxData() == vPacket.data() + OFFSET_DMX_DATA);
+    CHECK_EQ(oPacket.GetDmxData()[511], 0xAB);
+
+    // One slot less than the property count says.
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size() - 1), PARSE_BAD_LENGTH);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), ROOT_LENGTH + 5), PARSE_TOO_SHORT);
+    std::vector<uint8_t> vBad = MakeData({1, 513, 100, 1, 0, 0, 0}, 513);
+    CHECK_EQ(oPacket.Parse(vBad.data(), vBad.size()), PARSE_BAD_LENGTH);
+    for (uint16_t u16Universe : {0, 64000})
+    {
+        vBad = MakeData({1, u16Universe, 100, 1, 0, 0, 0});
+        CHECK_EQ(oPacket.Parse(vBad.data(), vBad.size()), PARSE_BAD_LENGTH);
+    }
+    vBad = MakeData({1, 1, 100, 1, 0, 0, 0});
+    vBad[OFFSET_ACN_ID + 3] = '+';
+    CHECK_EQ(oPacket.Parse(vBad.data(), vBad.size()), PARSE_BAD_ID);
+    vBad = MakeData({1, 1, 100, 1, 0, 0, 0});
+    vBad[OFFSET_FRAMING_VECTOR - 1]++;
+    CHECK_EQ(oPacket.Parse(vBad.data(), vBad.size()), PARSE_BAD_LENGTH);
+    vBad = MakeData({1, 1, 100, 1, 0, 0, 0});
+    vBad[OFFSET_DMP_ADDRESS_TYPE] = 0xA0;
+    CHECK_EQ(oPacket.Parse(vBad.data(), vBad.size()), PARSE_BAD_VECTOR);
+    // Alternate START codes, e.g. 0xDD per-address priority, are not DMX levels.
+    vBad = MakeData({1, 1, 100, 1, 0, 0, 0});
+    vBad[OFFSET_DMP_START_CODE] = 0xDD;
+    CHECK_EQ(oPacket.Parse(vBad.data(), vBad.size()), PARSE_UNSUPPORTED);
+}
+
+static void TestParseSync()
+{
+    Packet oPacket;
+    std::vector<uint8_t> vPacket = MakeSync(7, 3);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size()), PARSE_OK);
+    CHECK_EQ(oPacket.GetType(), PACKET_SYNC);
+    CHECK_EQ(oPacket.GetSyncUniverse(), 7);
+    CHECK_EQ(oPacket.GetSyncSequence(), 3);
+    CHECK_EQ(oPacket.Parse(vPacket.data(), SYNC_LENGTH - 1), PARSE_BAD_LENGTH);
+    vPacket[OFFSET_FRAMING_VECTOR + 3] = VECTOR_EXTENDED_DISCOVERY;
+    CHECK_EQ(oPacket.Parse(vPacket.data(), vPacket.size()), PARSE_UNSUPPORTED);
+}
+
+static void TestMulticastAddress()
+{
+    uint32_t u32Address = MulticastAddress(0x1234);
+    const uint8_t *pAddress = (const uint8_t *)&u32Address;
+    CHECK_EQ(pAddress[0], 239);
+    CHECK_EQ(pAddress[1], 255);
+    CHECK_EQ(pAddress[2], 0x12);
+    CHECK_EQ(pAddress[3], 0x34);
+}
+
+// The receiver on its real socket, served by the reactor on its own thread the way the reactor task does.
+// Universes 1-2 on port 0 and 10 on port 1, the test sends from a local socket.
+static std::mutex g_oMutex;
+static std::vector<std::pair<int32_t, uint8_t>> g_vReceived; // universe, first slot
+static std::vector<uint16_t> g_vSyncs;
+static UdpReactor g_oReactor;
+static int32_t g_s32Sender = -1;
+static uint8_t g_u8MarkerSequence = 0;
+static uint16_t g_u16SyncUniverse = 0; // named by every data packet, the markers included
+
+static void Send(const char *pAddress, const std::vector<uint8_t> &vPacket)
+{
+    struct sockaddr_in stDestination = {};
+    stDestination.sin_family = AF_INET;
+    stDestination.sin_port = htons(UDP_PORT);
+    inet_pton(AF_INET, pAddress, &stDestination.sin_addr);
+    sendto(g_s32Sender, vPacket.data(), vPacket.size(), 0, (struct sockaddr *)&stDestination, sizeof(stDestination));
+}
+
+static size_t GetReceived()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_vReceived.size();
+}
+
+static bool WaitReceived(size_t u32Count)
+{
+    for (int32_t i = 0; i < 3000 && GetReceived() < u32Count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return GetReceived() >= u32Count;
+}
+
+// Datagrams that get no answer can only be told apart from late ones by waiting. A unicast marker to universe 2
+// is then handled, also the reactor wake up that follows Settings changes before it.
+static bool SendMarker()
+{
+    size_t u32Count = GetReceived();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Send("127.0.0.1", MakeData({1, 2, 100, ++g_u8MarkerSequence, 0, g_u16SyncUniverse, 0xEE}));
+    return WaitReceived(u32Count + 1);
+}
+
+static int32_t GetStatus(const char *pName)
+{
+    cJSON *pJson = SacnServer::GetInstance().ToJson();
+    int32_t s32Value = cJSON_GetObjectItemCaseSensitive(pJson, pName)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+static std::pair<int32_t, uint8_t> GetLast()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_vReceived.back();
+}
+
+// Unicast reaches the configured universes only, to the handler ArtDmx goes through as well.
+static void TestUnicast()
+{
+    CHECK(SendMarker());
+    size_t u32Count = GetReceived();
+    Send("127.0.0.1", MakeData({2, 1, 100, 1, 0, 0, 0x11}));
+    CHECK(WaitReceived(u32Count + 1));
+    CHECK(GetLast() == std::make_pair(1, (uint8_t)0x11));
+    Send("127.0.0.1", MakeData({2, 3, 100, 1, 0, 0, 0x12}));
+    CHECK(SendMarker());
+    CHECK_EQ(GetReceived(), u32Count + 2);
+}
+
+// The universe belongs to its source until one of higher priority shows up or it goes silent; packets the
+// source sent before its newest one and preview data are dropped.
+static void TestPriorityAndOrder()
+{
+    int32_t s32LowerPriority = GetStatus("LowerPriority"), s32SourceChanges = GetStatus("SourceChanges");
+    size_t u32Count = GetReceived();
+    Send("127.0.0.1", MakeData({3, 1, 50, 1, 0, 0, 0x21}));
+    CHECK(SendMarker());
+    CHECK_EQ(GetStatus("LowerPriority"), s32LowerPriority + 1);
+    Send("127.0.0.1", MakeData({3, 1, 150, 2, 0, 0, 0x22}));
+    CHECK(WaitReceived(u32Count + 2));
+    CHECK(GetLast() == std::make_pair(1, (uint8_t)0x22));
+    CHECK_EQ(GetStatus("SourceChanges"), s32SourceChanges + 1);
+    Send("127.0.0.1", MakeData({2, 1, 100, 2, 0, 0, 0x23}));
+    Send("127.0.0.1", MakeData({3, 1, 150, 1, 0, 0, 0x24}));
+    Send("127.0.0.1", MakeData({3, 1, 150, 3, OPTION_PREVIEW_DATA, 0, 0x25}));
+    CHECK(SendMarker());
+    CHECK_EQ(GetReceived(), u32Count + 3);
+    CHECK_EQ(GetStatus("LowerPriority"), s32LowerPriority + 2);
+    CHECK_EQ(GetStatus("OutOfOrder"), 1);
+    CHECK_EQ(GetStatus("Preview"), 1);
+}
+
+// Data naming a sync universe holds back for the sync packet of that universe, which the socket joins as well.
+static void TestSync()
+{
+    size_t u32Count = GetReceived();
+    g_u16SyncUniverse = 7;
+    Send("127.0.0.1", MakeData({4, 10, 100, 1, 0, g_u16SyncUniverse, 0x31}));
+    CHECK(WaitReceived(u32Count + 1));
+    CHECK_EQ(GetStatus("SyncUniverse"), 7);
+    Send("127.0.0.1", MakeSync(8, 1));
+    Send("127.0.0.1", MakeSync(7, 2));
+    CHECK(SendMarker());
+    CHECK_EQ(GetStatus("Groups"), 4);
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    CHECK(g_vSyncs == std::vector<uint16_t>{7});
+}
+
+static uint32_t GetDatagrams()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_oReactor.GetDatagramCount();
+}
+
+static char *GroupOf(uint16_t u16Universe, char *acBuffer)
+{
+    uint32_t u32Address = MulticastAddress(u16Universe);
+    return (char *)inet_ntop(AF_INET, &u32Address, acBuffer, 16);
+}
+
+// The socket is a member of exactly the groups of the configured universes and the sync universe: the stack
+// drops every other group before the reactor wakes up. Reconfiguring leaves and joins groups.
+static void TestMulticastMembership()
+{
+    if (GetStatus("JoinFailed") != 0)
+    {
+        printf("SKIP TestMulticastMembership: no multicast route on this host\n");
+        return;
+    }
+    char acGroup[16];
+    CHECK_EQ(GetStatus("Groups"), 4);
+    size_t u32Count = GetReceived();
+    uint32_t u32Datagrams = GetDatagrams();
+    Send(GroupOf(10, acGroup), MakeData({5, 10, 200, 1, 0, g_u16SyncUniverse, 0x41}));
+    CHECK(WaitReceived(u32Count + 1));
+    CHECK(GetLast() == std::make_pair(10, (uint8_t)0x41));
+    Send(GroupOf(4, acGroup), MakeData({5, 4, 200, 1, 0, g_u16SyncUniverse, 0x42}));
+    CHECK(SendMarker());
+    CHECK_EQ(GetDatagrams(), u32Datagrams + 2);
+
+    // Port 1 moves from universe 10 to 4.
+    ConfigurePorts("{\"Ports\":[{},{\"StartUniverse\":4,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"}]}");
+    CHECK(SendMarker());
+    CHECK_EQ(GetStatus("Groups"), 4);
+    u32Count = GetReceived();
+    u32Datagrams = GetDatagrams();
+    Send(GroupOf(4, acGroup), MakeData({5, 4, 200, 2, 0, g_u16SyncUniverse, 0x43}));
+    CHECK(WaitReceived(u32Count + 1));
+    CHECK(GetLast() == std::make_pair(4, (uint8_t)0x43));
+    Send(GroupOf(10, acGroup), MakeData({5, 10, 200, 3, 0, g_u16SyncUniverse, 0x44}));
+    CHECK(SendMarker());
+    CHECK_EQ(GetDatagrams(), u32Datagrams + 2);
+
+    // Once the sender stops synchronizing, the sync universe's group is left as well: the first marker names no
+    // sync universe, the wake up for the second one leaves the group.
+    g_u16SyncUniverse = 0;
+    CHECK(SendMarker());
+    CHECK(SendMarker());
+    CHECK_EQ(GetStatus("Groups"), 3);
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":1,\"NoUniverses\":2,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":10,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+
+    SacnServer &oServer = SacnServer::GetInstance();
+    oServer.RegisterDMXPayloadHandler([](int32_t s32Universe, uint8_t u8Sequence, size_t u32Length, PayloadCopier_t fnCopy, void *pvContext)
+    {
+        uint8_t au8Payload[MAXIMUM_DMX_LENGTH];
+        size_t u32Copied = fnCopy(au8Payload, std::min<size_t>(u32Length, sizeof(au8Payload)), pvContext);
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        g_vReceived.push_back({s32Universe, au8Payload[0]});
+        return u32Copied;
+    });
+    oServer.RegisterSyncMessageHandler([](const char *pBuffer, size_t u32Length, const char *pSender)
+    {
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        g_vSyncs.push_back(((uint8_t)pBuffer[OFFSET_SYNC_ADDRESS] << 8) | (uint8_t)pBuffer[OFFSET_SYNC_ADDRESS + 1]);
+    });
+    oServer.Attach(g_oReactor, UDP_PORT);
+    std::thread([]() { g_oReactor.Run(); }).detach();
+    g_s32Sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+
+    RUN_TEST(TestParseData);
+    RUN_TEST(TestParseSync);
+    RUN_TEST(TestMulticastAddress);
+    RUN_TEST(TestUnicast);
+    RUN_TEST(TestPriorityAndOrder);
+    RUN_TEST(TestSync);
+    RUN_TEST(TestMulticastMembership);
+    return TestResult();
+}
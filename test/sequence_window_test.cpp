@@ -0,0 +1,187 @@
+#include "host_test.h"
+#include "host_kernel.h"
+#include "port.h"
+#include "sequence_window.h"
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static uint32_t g_u32Random = 0x9E3779B9;
+
+static uint32_t Random()
+{
+    g_u32Random ^= g_u32Random << 13;
+    g_u32Random ^= g_u32Random >> 17;
+    g_u32Random ^= g_u32Random << 5;
+    return g_u32Random;
+}
+
+static uint8_t SequenceOf(uint32_t u32Index)
+{
+    return u32Index % 255 + 1;
+}
+
+// A stream of 1..255 wrapping to 1, shuffled in blocks no wider than the reorder window, with drops and
+// duplicates: every dropped packet is a loss, every late one takes back its own, duplicates take back nothing
+// and the newest accepted sequence never goes back.
+static void TestShuffledReplay()
+{
+    for (int32_t s32Run = 0; s32Run < 50; ++s32Run)
+    {
+        const uint32_t u32Packets = 2000;
+        const uint32_t u32Block = 1 + Random() % (PROJECT_SEQUENCE_REORDER_WINDOW / 2);
+        std::vector<uint32_t> vSent;
+        for (uint32_t i = 0; i < u32Packets; i += u32Block)
+        {
+            std::vector<uint32_t> vBlock;
+            for (uint32_t j = i; j < std::min(i + u32Block, u32Packets); ++j)
+            {
+                vBlock.push_back(j);
+            }
+            for (size_t j = vBlock.size(); j > 1; --j)
+            {
+                std::swap(vBlock[j - 1], vBlock[Random() % j]);
+            }
+            vSent.insert(vSent.end(), vBlock.begin(), vBlock.end());
+        }
+        // The window starts from the first packet that arrives: make that the oldest one.
+        std::vector<uint32_t> vReceived(1, 0);
+        std::vector<uint32_t> vDropped;
+        for (size_t i = 0; i < vSent.size(); ++i)
+        {
+            if (vSent[i] == 0)
+            {
+                continue;
+            }
+            if (Random() % 20 == 0)
+            {
+                vDropped.push_back(vSent[i]);
+                continue;
+            }
+            vReceived.push_back(vSent[i]);
+            if (Random() % 10 == 0)
+            {
+                vReceived.push_back(vReceived[vReceived.size() - 1 - Random() % std::min<size_t>(vReceived.size(), u32Block)]);
+            }
+        }
+
+        SequenceWindow oWindow;
+        int64_t s64NowUs = 0;
+        int32_t s32LostTotal = 0;
+        uint32_t u32Newest = 0, u32Backwards = 0, u32Unexpected = 0;
+        std::vector<uint8_t> vSeen(u32Packets, 0);
+        for (uint32_t u32Index : vReceived)
+        {
+            int32_t s32Lost;
+            SequenceWindow::Verdict eVerdict = oWindow.Check(SequenceOf(u32Index), s64NowUs += 1000, s32Lost);
+            s32LostTotal += s32Lost;
+            bool bFirst = vSeen[u32Index]++ == 0;
+            switch (eVerdict)
+            {
+            case SequenceWindow::ACCEPT:
+                u32Backwards += u32Index <= u32Newest && u32Index != 0;
+                u32Unexpected += !bFirst;
+                u32Newest = u32Index;
+                break;
+            case SequenceWindow::DUPLICATE:
+                u32Unexpected += u32Index != u32Newest;
+                break;
+            case SequenceWindow::LATE:
+                u32Unexpected += u32Index >= u32Newest || (!bFirst && s32Lost != 0);
+                break;
+            default:
+                u32Unexpected++;
+                break;
+            }
+        }
+        // A drop is only noticed once a newer packet arrives.
+        CHECK_EQ(s32LostTotal, std::count_if(vDropped.begin(), vDropped.end(), [&](uint32_t u32Index) { return u32Index < u32Newest; }));
+        CHECK_EQ(u32Backwards, 0);
+        CHECK_EQ(u32Unexpected, 0);
+    }
+}
+
+// 255 wraps to 1, not to 0, and 0 switches the check off.
+static void TestWrap()
+{
+    SequenceWindow oWindow;
+    int32_t s32Lost;
+    CHECK_EQ(oWindow.Check(254, 0, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(oWindow.Check(255, 0, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(s32Lost, 0);
+    CHECK_EQ(oWindow.Check(1, 0, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(s32Lost, 0);
+    CHECK_EQ(oWindow.Check(3, 0, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(s32Lost, 1);
+    CHECK_EQ(oWindow.Check(255, 0, s32Lost), SequenceWindow::LATE);
+    CHECK_EQ(s32Lost, 0);
+    CHECK_EQ(oWindow.Check(2, 0, s32Lost), SequenceWindow::LATE);
+    CHECK_EQ(s32Lost, -1);
+    CHECK_EQ(oWindow.Check(0, 0, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(oWindow.Check(0, 0, s32Lost), SequenceWindow::ACCEPT);
+}
+
+// Behind the reorder window is stale while the sender keeps sending, a sender restart after a pause.
+static void TestStaleAndResync()
+{
+    SequenceWindow oWindow;
+    int32_t s32Lost;
+    const int64_t s64RestartUs = PROJECT_SEQUENCE_RESTART_MS * 1000LL;
+    CHECK_EQ(oWindow.Check(100, 0, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(oWindow.Check(100 - PROJECT_SEQUENCE_REORDER_WINDOW, 1000, s32Lost), SequenceWindow::LATE);
+    CHECK_EQ(oWindow.Check(100 - PROJECT_SEQUENCE_REORDER_WINDOW - 1, 2000, s32Lost), SequenceWindow::STALE);
+    CHECK_EQ(oWindow.Check(1, s64RestartUs - 1, s32Lost), SequenceWindow::STALE);
+    CHECK_EQ(oWindow.Check(1, s64RestartUs, s32Lost), SequenceWindow::RESYNC);
+    CHECK_EQ(s32Lost, 0);
+    CHECK_EQ(oWindow.Check(2, s64RestartUs + 1000, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(s32Lost, 0);
+    // Counting starts over from the sequence the sender restarted with.
+    CHECK_EQ(oWindow.Check(4, s64RestartUs + 2000, s32Lost), SequenceWindow::ACCEPT);
+    CHECK_EQ(s32Lost, 1);
+}
+
+static int32_t GetSequenceStatus(const char *pName)
+{
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    int32_t s32Value = cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(pJson, "Sequence"), pName)->valueint;
+    cJSON_Delete(pJson);
+    return s32Value;
+}
+
+// Through the ports: only accepted packets reach the frame, the others are counted.
+static void TestPortsDropOlderFrames()
+{
+    Ports &oPorts = Ports::GetInstance();
+    std::vector<uint8_t> vPayload(30, 0x5A);
+    CHECK_EQ(oPorts.WriteUniverse(0, 10, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    CHECK_EQ(oPorts.WriteUniverse(0, 12, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    CHECK_EQ(GetSequenceStatus("Lost"), 1);
+    CHECK_EQ(oPorts.WriteUniverse(0, 11, vPayload.size(), CopyFromBuffer, vPayload.data()), 0);
+    CHECK_EQ(GetSequenceStatus("Late"), 1);
+    CHECK_EQ(GetSequenceStatus("Lost"), 0);
+    CHECK_EQ(oPorts.WriteUniverse(0, 12, vPayload.size(), CopyFromBuffer, vPayload.data()), 0);
+    CHECK_EQ(GetSequenceStatus("Duplicate"), 1);
+    CHECK_EQ(oPorts.WriteUniverse(0, 1, vPayload.size(), CopyFromBuffer, vPayload.data()), 0);
+    CHECK_EQ(GetSequenceStatus("Stale"), 1);
+    // Universes are tracked apart.
+    CHECK_EQ(oPorts.WriteUniverse(1, 1, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    HostKernel::Advance(PROJECT_SEQUENCE_RESTART_MS * 1000LL);
+    CHECK_EQ(oPorts.WriteUniverse(0, 1, vPayload.size(), CopyFromBuffer, vPayload.data()), 30);
+    CHECK_EQ(GetSequenceStatus("Resync"), 1);
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":1,\"NoUniverses\":1,\"LedCount\":10,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    Ports::GetInstance().Init();
+
+    RUN_TEST(TestShuffledReplay);
+    RUN_TEST(TestWrap);
+    RUN_TEST(TestStaleAndResync);
+    RUN_TEST(TestPortsDropOlderFrames);
+    return TestResult();
+}
@@ -0,0 +1,114 @@
+#include "host_test.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <thread>
+
+// Items come out in the order they went in, also across the wrap of the indices.
+static void TestOrder()
+{
+    SpscRing<uint32_t, 4> oRing;
+    uint32_t u32Item = 0;
+    CHECK(!oRing.Pop(u32Item));
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        CHECK(oRing.Push(i * 2));
+        CHECK(oRing.Push(i * 2 + 1));
+        CHECK_EQ(oRing.GetDepth(), 2);
+        CHECK(oRing.Pop(u32Item));
+        CHECK_EQ(u32Item, i * 2);
+        CHECK(oRing.Pop(u32Item));
+        CHECK_EQ(u32Item, i * 2 + 1);
+    }
+    CHECK_EQ(oRing.GetDepth(), 0);
+    CHECK(!oRing.Pop(u32Item));
+    CHECK_EQ(oRing.GetDroppedCount(), 0);
+}
+
+// A full ring refuses the item and counts it, what is already queued is kept.
+static void TestFull()
+{
+    SpscRing<uint32_t, 4> oRing;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        CHECK(oRing.Push(i));
+    }
+    CHECK(!oRing.Push(4));
+    CHECK(!oRing.Push(5));
+    CHECK_EQ(oRing.GetDroppedCount(), 2);
+    CHECK_EQ(oRing.GetDepth(), 4);
+    CHECK_EQ(oRing.GetMaxDepth(), 4);
+    uint32_t u32Item = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        CHECK(oRing.Pop(u32Item));
+        CHECK_EQ(u32Item, i);
+    }
+    // Room again once the consumer took one.
+    CHECK(oRing.Push(6));
+    CHECK_EQ(oRing.GetMaxDepth(), 4);
+}
+
+// Peek shows the oldest item and leaves it queued.
+static void TestPeek()
+{
+    SpscRing<uint32_t, 2> oRing;
+    uint32_t u32Item = 0;
+    CHECK(!oRing.Peek(u32Item));
+    oRing.Push(7);
+    oRing.Push(8);
+    CHECK(oRing.Peek(u32Item));
+    CHECK_EQ(u32Item, 7);
+    CHECK_EQ(oRing.GetDepth(), 2);
+    CHECK(oRing.Pop(u32Item));
+    CHECK_EQ(u32Item, 7);
+    CHECK(oRing.Peek(u32Item));
+    CHECK_EQ(u32Item, 8);
+}
+
+// Producer and consumer on two threads, as on the two cores: every item pushed is popped once, in order, or
+// counted as dropped.
+static void TestConcurrent()
+{
+    SpscRing<uint32_t, 8> oRing;
+    const uint32_t u32Items = 200000;
+    std::atomic<bool> bDone(false);
+    uint32_t u32Popped = 0, u32OutOfOrder = 0;
+    std::thread oConsumer([&]()
+    {
+        uint32_t u32Last = 0, u32Item = 0;
+        while (true)
+        {
+            bool bFinished = bDone.load();
+            if (oRing.Pop(u32Item))
+            {
+                u32OutOfOrder += u32Item <= u32Last;
+                u32Last = u32Item;
+                u32Popped++;
+            }
+            else if (bFinished)
+            {
+                break;
+            }
+        }
+    });
+    uint32_t u32Pushed = 0;
+    for (uint32_t i = 1; i <= u32Items; ++i)
+    {
+        u32Pushed += oRing.Push(i);
+    }
+    bDone = true;
+    oConsumer.join();
+    CHECK_EQ(u32OutOfOrder, 0);
+    CHECK_EQ(u32Popped, u32Pushed);
+    CHECK_EQ(u32Pushed + oRing.GetDroppedCount(), u32Items);
+    CHECK(oRing.GetMaxDepth() <= oRing.GetCapacity());
+}
+
+int main()
+{
+    RUN_TEST(TestOrder);
+    RUN_TEST(TestFull);
+    RUN_TEST(TestPeek);
+    RUN_TEST(TestConcurrent);
+    return TestResult();
+}
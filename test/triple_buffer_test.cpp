@@ -0,0 +1,89 @@
+#include "host_test.h"
+#include "port.h"
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Commit without a take in between replaces the ready frame, a take without a commit finds nothing.
+static void TestExchange()
+{
+    Port oPort(0);
+    std::vector<uint8_t> vPayload(510, 1);
+    CHECK(!oPort.HasReadyFrame());
+    CHECK(!oPort.TakeReadyFrame());
+    oPort.WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data());
+    CHECK(oPort.HasReadyFrame());
+    vPayload.assign(510, 2);
+    oPort.WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data());
+    CHECK_EQ(oPort.m_u32OverwrittenFrames.load(), 1);
+    CHECK(oPort.TakeReadyFrame());
+    CHECK_EQ(oPort.m_aFrames[oPort.m_u8DisplayIndex][0], 2);
+    CHECK(!oPort.HasReadyFrame());
+    CHECK(!oPort.TakeReadyFrame());
+    // The three indices stay a permutation of the three frames.
+    uint8_t u8Ready = oPort.m_u8ReadyIndex.load() & ~Port::m_u8FreshFlag;
+    CHECK(oPort.m_u8WriteIndex != oPort.m_u8DisplayIndex);
+    CHECK(oPort.m_u8WriteIndex != u8Ready);
+    CHECK(oPort.m_u8DisplayIndex != u8Ready);
+}
+
+// Assembler and output task on two threads, as on the two cores. Every frame is one value in all its bytes: a
+// displayed frame mixing two values was written while on display. Frames are shown in commit order, and every
+// commit is either shown or counted as overwritten.
+static void TestConcurrentSwap()
+{
+    Port oPort(0);
+    const uint32_t u32Frames = 20000;
+    std::atomic<bool> bDone(false);
+    std::atomic<uint32_t> u32Torn(0), u32OutOfOrder(0);
+    std::thread oOutput([&]()
+    {
+        uint32_t u32Last = 0;
+        while (true)
+        {
+            bool bFinished = bDone.load();
+            if (oPort.TakeReadyFrame())
+            {
+                const uint8_t *pFrame = oPort.m_aFrames[oPort.m_u8DisplayIndex];
+                uint32_t u32Value;
+                memcpy(&u32Value, pFrame, sizeof(u32Value));
+                for (size_t i = 0; i + sizeof(u32Value) <= oPort.m_u32FrameBytes; i += sizeof(u32Value))
+                {
+                    u32Torn += memcmp(pFrame + i, &u32Value, sizeof(u32Value)) != 0;
+                }
+                u32OutOfOrder += u32Value <= u32Last;
+                u32Last = u32Value;
+            }
+            else if (bFinished)
+            {
+                break;
+            }
+        }
+    });
+    std::vector<uint8_t> vPayload(510);
+    for (uint32_t u32Frame = 1; u32Frame <= u32Frames; ++u32Frame)
+    {
+        for (size_t i = 0; i < vPayload.size(); i += sizeof(u32Frame))
+        {
+            memcpy(&vPayload[i], &u32Frame, std::min(sizeof(u32Frame), vPayload.size() - i));
+        }
+        oPort.WriteUniverse(0, 0, vPayload.size(), CopyFromBuffer, vPayload.data());
+    }
+    bDone = true;
+    oOutput.join();
+    CHECK_EQ(u32Torn.load(), 0);
+    CHECK_EQ(u32OutOfOrder.load(), 0);
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), u32Frames);
+    CHECK_EQ(oPort.m_u32DisplayedFrames.load() + oPort.m_u32OverwrittenFrames.load(), u32Frames);
+    CHECK(oPort.m_u32DisplayedFrames.load() > 0);
+}
+
+int main()
+{
+    ConfigurePorts("{\"Ports\":[{\"StartUniverse\":0,\"NoUniverses\":1,\"LedCount\":170,\"LedType\":\"LED2811\"}]}");
+
+    RUN_TEST(TestExchange);
+    RUN_TEST(TestConcurrentSwap);
+    return TestResult();
+}
@@ -0,0 +1,285 @@
+#include "host_test.h"
+#include "udp_reactor.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Built with a short PROJECT_UDP_REACTOR_WAKE_MS and PROJECT_UDP_REACTOR_RETRY_MAX_MS, see CMakeLists.txt.
+static constexpr uint16_t ECHO_PORT = 16470;
+static constexpr uint16_t COUNT_PORT = 16471;
+static constexpr uint16_t BLOCKED_PORT = 16472;
+
+// bind() calls for BLOCKED_PORT, the test links with --wrap=bind.
+static std::atomic<uint32_t> g_u32BlockedBinds(0);
+
+extern "C" int __real_bind(int s32Socket, const struct sockaddr *pAddress, socklen_t u32Length);
+
+extern "C" int __wrap_bind(int s32Socket, const struct sockaddr *pAddress, socklen_t u32Length)
+{
+    if (pAddress->sa_family == AF_INET && ntohs(((const struct sockaddr_in *)pAddress)->sin_port) == BLOCKED_PORT)
+    {
+        g_u32BlockedBinds++;
+    }
+    return __real_bind(s32Socket, pAddress, u32Length);
+}
+
+// While set, select() fails as lwIP's does on a socket closed under it; the test links with --wrap=select.
+static std::atomic<bool> g_bFailSelect(false);
+static std::atomic<uint32_t> g_u32Selects(0);
+
+extern "C" int __real_select(int s32Count, fd_set *pRead, fd_set *pWrite, fd_set *pExcept, struct timeval *pTimeout);
+
+extern "C" int __wrap_select(int s32Count, fd_set *pRead, fd_set *pWrite, fd_set *pExcept, struct timeval *pTimeout)
+{
+    g_u32Selects++;
+    if (g_bFailSelect)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    return __real_select(s32Count, pRead, pWrite, pExcept, pTimeout);
+}
+
+typedef struct
+{
+    uint16_t u16Port; // the server's
+    uint16_t u16SourcePort;
+    uint32_t u32Destination;
+    std::string sData;
+} Received;
+
+static std::mutex g_oMutex;
+static std::vector<Received> g_vReceived;
+static std::mutex g_oGate; // held by the test, stops the reactor on its next wake up
+
+// Records every datagram and answers it to its source with Response().
+template <uint16_t PORT>
+class RecordingServer : public UdpServer<RecordingServer<PORT>, 64>
+{
+    friend class UdpServer<RecordingServer<PORT>, 64>;
+
+    void HandleIncommingMessage(size_t u32Length, const UdpDatagram_t &stDatagram)
+    {
+        std::string sData(this->m_aRxBuffer.data(), u32Length);
+        {
+            std::lock_guard<std::mutex> oLock(g_oMutex);
+            g_vReceived.push_back({PORT, ntohs(stDatagram.stSource.sin_port), stDatagram.u32Destination, sData});
+        }
+        this->Response(sData.data(), sData.size());
+    }
+    void OnWake()
+    {
+        if (PORT == ECHO_PORT)
+        {
+            std::lock_guard<std::mutex> oGate(g_oGate);
+        }
+    }
+    void CheckHandlers() {}
+public:
+    int32_t GetSocket() const { return this->m_s32Socket; }
+};
+
+static UdpReactor g_oReactor;
+static std::chrono::steady_clock::time_point g_oStarted;
+static int32_t g_s32Squatter = -1; // holds BLOCKED_PORT
+static RecordingServer<ECHO_PORT> g_oEcho;
+static RecordingServer<COUNT_PORT> g_oCount;
+static RecordingServer<BLOCKED_PORT> g_oBlocked;
+
+static size_t GetReceived()
+{
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    return g_vReceived.size();
+}
+
+static bool WaitReceived(size_t u32Count)
+{
+    for (int32_t i = 0; i < 3000 && GetReceived() < u32Count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return GetReceived() >= u32Count;
+}
+
+static int32_t OpenClient()
+{
+    int32_t s32Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    struct sockaddr_in stAddress = {};
+    stAddress.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &stAddress.sin_addr);
+    bind(s32Socket, (struct sockaddr *)&stAddress, sizeof(stAddress));
+    struct timeval stTimeout = {1, 0};
+    setsockopt(s32Socket, SOL_SOCKET, SO_RCVTIMEO, &stTimeout, sizeof(stTimeout));
+    return s32Socket;
+}
+
+static uint16_t GetLocalPort(int32_t s32Socket)
+{
+    struct sockaddr_in stAddress = {};
+    socklen_t u32Length = sizeof(stAddress);
+    getsockname(s32Socket, (struct sockaddr *)&stAddress, &u32Length);
+    return ntohs(stAddress.sin_port);
+}
+
+static void Send(int32_t s32Socket, uint16_t u16Port, const std::string &sData)
+{
+    struct sockaddr_in stDestination = {};
+    stDestination.sin_family = AF_INET;
+    stDestination.sin_port = htons(u16Port);
+    inet_pton(AF_INET, "127.0.0.1", &stDestination.sin_addr);
+    sendto(s32Socket, sData.data(), sData.size(), 0, (struct sockaddr *)&stDestination, sizeof(stDestination));
+}
+
+static std::string Receive(int32_t s32Socket)
+{
+    char acBuffer[64];
+    ssize_t s32Length = recv(s32Socket, acBuffer, sizeof(acBuffer), 0);
+    return s32Length > 0 ? std::string(acBuffer, s32Length) : std::string();
+}
+
+// Each datagram is handled with its own source and destination, interleaved senders get their own answers.
+static void TestSourcePerDatagram()
+{
+    int32_t s32ClientA = OpenClient(), s32ClientB = OpenClient();
+    size_t u32First = GetReceived();
+    Send(s32ClientA, ECHO_PORT, "a1");
+    Send(s32ClientB, ECHO_PORT, "b1");
+    Send(s32ClientA, COUNT_PORT, "a2");
+    CHECK(WaitReceived(u32First + 3));
+    std::string sEchoes = Receive(s32ClientA) + Receive(s32ClientA);
+    CHECK(sEchoes == "a1a2" || sEchoes == "a2a1");
+    {
+        std::lock_guard<std::mutex> oLock(g_oMutex);
+        uint32_t u32Loopback = htonl(INADDR_LOOPBACK);
+        for (size_t i = u32First; i < g_vReceived.size(); ++i)
+        {
+            const Received &stReceived = g_vReceived[i];
+            CHECK_EQ(stReceived.u32Destination, u32Loopback);
+            CHECK_EQ(stReceived.u16SourcePort, GetLocalPort(stReceived.sData[0] == 'a' ? s32ClientA : s32ClientB));
+            CHECK_EQ(stReceived.u16Port, stReceived.sData == "a2" ? COUNT_PORT : ECHO_PORT);
+        }
+    }
+    CHECK(Receive(s32ClientB) == "b1");
+    close(s32ClientA);
+    close(s32ClientB);
+}
+
+// A socket with a backlog is read PROJECT_UDP_REACTOR_BURST datagrams at a time, the other sockets are
+// served in between.
+static void TestBurst()
+{
+    int32_t s32Client = OpenClient();
+    size_t u32First = GetReceived();
+    uint32_t u32Datagrams = g_oReactor.GetDatagramCount();
+    {
+        std::lock_guard<std::mutex> oGate(g_oGate);
+        // The reactor wakes up at least every PROJECT_UDP_REACTOR_WAKE_MS and now waits in the echo server's
+        // OnWake(), having seen nothing to read.
+        std::this_thread::sleep_for(std::chrono::milliseconds(4 * PROJECT_UDP_REACTOR_WAKE_MS));
+        for (int32_t i = 0; i < 20; ++i)
+        {
+            Send(s32Client, ECHO_PORT, "e" + std::to_string(i));
+        }
+        Send(s32Client, COUNT_PORT, "c");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(WaitReceived(u32First + 21));
+    CHECK_EQ(g_oReactor.GetDatagramCount() - u32Datagrams, 21);
+    std::lock_guard<std::mutex> oLock(g_oMutex);
+    size_t u32Count = u32First;
+    while (u32Count < g_vReceived.size() && g_vReceived[u32Count].u16Port != COUNT_PORT)
+    {
+        u32Count++;
+    }
+    CHECK_EQ(u32Count - u32First, PROJECT_UDP_REACTOR_BURST);
+    for (int32_t i = 0; i < 20; ++i)
+    {
+        size_t u32Index = u32First + i + (i >= PROJECT_UDP_REACTOR_BURST);
+        CHECK(u32Index < g_vReceived.size() && g_vReceived[u32Index].sData == "e" + std::to_string(i));
+    }
+    close(s32Client);
+}
+
+// A port that cannot be bound is retried after PROJECT_UDP_REACTOR_WAKE_MS, doubling up to
+// PROJECT_UDP_REACTOR_RETRY_MAX_MS, not on every wake up; it opens once the port is free.
+static void TestOpenBackoff()
+{
+    const int64_t s64BlockedMs = 2000;
+    std::this_thread::sleep_until(g_oStarted + std::chrono::milliseconds(s64BlockedMs));
+    uint32_t u32Binds = g_u32BlockedBinds;
+    uint32_t u32Wakes = g_oReactor.GetWakeCount();
+    // Tries at 0, 50, 150, 350, 750, 1150, 1550 and 1950 ms.
+    printf("%u binds in %lld ms, %u wake ups\n", u32Binds, (long long)s64BlockedMs, u32Wakes);
+    CHECK(u32Binds >= 6 && u32Binds <= 9);
+    CHECK(u32Wakes >= 2 * u32Binds);
+    CHECK(g_oBlocked.GetSocket() < 0);
+
+    close(g_s32Squatter);
+    for (int32_t i = 0; i < 1000 && g_oBlocked.GetSocket() < 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(g_oBlocked.GetSocket() >= 0);
+    CHECK(g_u32BlockedBinds - u32Binds == 1);
+    int32_t s32Client = OpenClient();
+    size_t u32First = GetReceived();
+    Send(s32Client, BLOCKED_PORT, "x");
+    CHECK(WaitReceived(u32First + 1));
+    CHECK(Receive(s32Client) == "x");
+    close(s32Client);
+}
+
+// A failing select() costs one call per PROJECT_UDP_REACTOR_WAKE_MS instead of a busy loop, is counted, and the
+// reactor serves again once it works.
+static void TestSelectFailure()
+{
+    const int64_t s64FailingMs = 500;
+    uint32_t u32Errors = g_oReactor.GetSelectErrorCount();
+    g_bFailSelect = true;
+    uint32_t u32Selects = g_u32Selects;
+    std::this_thread::sleep_for(std::chrono::milliseconds(s64FailingMs));
+    u32Selects = g_u32Selects - u32Selects;
+    g_bFailSelect = false;
+    printf("%u select() calls in %lld ms of failures\n", u32Selects, (long long)s64FailingMs);
+    CHECK(u32Selects >= 2 && u32Selects <= s64FailingMs / PROJECT_UDP_REACTOR_WAKE_MS + 2);
+    CHECK(g_oReactor.GetSelectErrorCount() - u32Errors >= u32Selects - 1);
+
+    int32_t s32Client = OpenClient();
+    size_t u32First = GetReceived();
+    Send(s32Client, ECHO_PORT, "after");
+    CHECK(WaitReceived(u32First + 1));
+    CHECK(Receive(s32Client) == "after");
+    close(s32Client);
+}
+
+int main()
+{
+    // Taken before the reactor starts, so every one of its attempts to open the port fails.
+    g_s32Squatter = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    struct sockaddr_in stAddress = {};
+    stAddress.sin_family = AF_INET;
+    stAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    stAddress.sin_port = htons(BLOCKED_PORT);
+    CHECK_EQ(bind(g_s32Squatter, (struct sockaddr *)&stAddress, sizeof(stAddress)), 0);
+    g_u32BlockedBinds = 0;
+
+    g_oEcho.Attach(g_oReactor, ECHO_PORT);
+    g_oCount.Attach(g_oReactor, COUNT_PORT);
+    g_oBlocked.Attach(g_oReactor, BLOCKED_PORT);
+    g_oStarted = std::chrono::steady_clock::now();
+    std::thread([]() { g_oReactor.Run(); }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    RUN_TEST(TestSourcePerDatagram);
+    RUN_TEST(TestBurst);
+    RUN_TEST(TestOpenBackoff);
+    RUN_TEST(TestSelectFailure);
+    return TestResult();
+}
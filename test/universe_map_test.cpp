@@ -0,0 +1,106 @@
+#include "host_test.h"
+#include "port.h"
+#include <string.h>
+#include <vector>
+
+static std::vector<uint8_t> MakePayload(size_t u32Length, uint8_t u8Seed)
+{
+    std::vector<uint8_t> vPayload(u32Length);
+    for (size_t i = 0; i < u32Length; ++i)
+    {
+        vPayload[i] = (uint8_t)(u8Seed + i * 3);
+    }
+    return vPayload;
+}
+
+static size_t Write(Port &oPort, int32_t s32Index, std::vector<uint8_t> &vPayload)
+{
+    return oPort.WriteUniverse(s32Index, 0, vPayload.size(), CopyFromBuffer, vPayload.data());
+}
+
+static int32_t GetCommittedFrames(int32_t s32Port)
+{
+    cJSON *pJson = Ports::GetInstance().ToJson();
+    cJSON *pPort = cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(pJson, "Ports"), s32Port);
+    int32_t s32Count = cJSON_GetObjectItemCaseSensitive(pPort, "CommittedFrames")->valueint;
+    cJSON_Delete(pJson);
+    return s32Count;
+}
+
+// Universes land at their own offset in whatever order they come, the frame commits on the last missing one.
+static void TestCompletionBitmap()
+{
+    ConfigurePorts("{\"Ports\":[{\"StartUniverse\":5,\"NoUniverses\":3,\"LedCount\":510,\"LedType\":\"LED2811\"}]}");
+    Port oPort(0);
+    CHECK_EQ(oPort.m_u64CompleteMask, 0x7);
+    std::vector<uint8_t> aPayloads[3] = {MakePayload(510, 1), MakePayload(510, 2), MakePayload(510, 3)};
+    CHECK_EQ(Write(oPort, 2, aPayloads[2]), 510);
+    CHECK_EQ(Write(oPort, 0, aPayloads[0]), 510);
+    CHECK_EQ(oPort.m_u64ReceivedMask, 0x5);
+    CHECK(!oPort.IsFull());
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 0);
+    CHECK_EQ(Write(oPort, 1, aPayloads[1]), 510);
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 1);
+    CHECK_EQ(oPort.m_u64ReceivedMask, 0);
+    const uint8_t *pFrame = oPort.m_aFrames[oPort.m_u8PreviousIndex];
+    for (int32_t i = 0; i < 3; ++i)
+    {
+        CHECK(memcmp(pFrame + i * 510, aPayloads[i].data(), 510) == 0);
+    }
+}
+
+// The bitmap is one word: 64 universes, the most a port can have, complete with the top bit.
+static void TestSixtyFourUniverses()
+{
+    ConfigurePorts("{\"Ports\":[{\"StartUniverse\":0,\"NoUniverses\":64,\"LedCount\":1020,\"LedType\":\"LED2811\"}]}");
+    Port oPort(0);
+    CHECK_EQ(oPort.GetNoUniverses(), 64);
+    CHECK(oPort.m_u64CompleteMask == ~0ULL);
+    std::vector<uint8_t> vPayload = MakePayload(510, 4);
+    size_t u32Copied = 0;
+    for (int32_t i = 63; i >= 0; --i)
+    {
+        CHECK_EQ(oPort.m_u32CommittedFrames.load(), 0);
+        u32Copied += Write(oPort, i, vPayload);
+    }
+    // 1020 pixels fill the first six universes, the others have nothing to copy but still complete the frame.
+    CHECK_EQ(u32Copied, 1020 * 3);
+    CHECK_EQ(oPort.m_u32CommittedFrames.load(), 1);
+}
+
+// One table lookup per universe: owned universes reach their port, everything else is dropped, a universe two
+// ports claim stays with the first.
+static void TestUniverseRouting()
+{
+    ConfigurePorts("{\"Ports\":["
+                   "{\"StartUniverse\":5,\"NoUniverses\":3,\"LedCount\":510,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":8,\"NoUniverses\":2,\"LedCount\":200,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":9,\"NoUniverses\":1,\"LedCount\":170,\"LedType\":\"LED2811\"},"
+                   "{\"StartUniverse\":0,\"NoUniverses\":0,\"LedCount\":0,\"LedType\":\"LED2811\"}]}");
+    Ports &oPorts = Ports::GetInstance();
+    oPorts.Init();
+    std::vector<uint8_t> vPayload = MakePayload(510, 5);
+    CHECK_EQ(oPorts.WriteUniverse(4, 0, 510, CopyFromBuffer, vPayload.data()), 0);
+    CHECK_EQ(oPorts.WriteUniverse(10, 0, 510, CopyFromBuffer, vPayload.data()), 0);
+    CHECK_EQ(oPorts.WriteUniverse(0x105, 0, 510, CopyFromBuffer, vPayload.data()), 0);
+    CHECK_EQ(oPorts.WriteUniverse(-1, 0, 510, CopyFromBuffer, vPayload.data()), 0);
+
+    CHECK_EQ(oPorts.WriteUniverse(7, 0, 510, CopyFromBuffer, vPayload.data()), 510);
+    CHECK_EQ(oPorts.WriteUniverse(5, 0, 510, CopyFromBuffer, vPayload.data()), 510);
+    CHECK_EQ(oPorts.WriteUniverse(6, 0, 510, CopyFromBuffer, vPayload.data()), 510);
+    CHECK_EQ(GetCommittedFrames(0), 1);
+
+    // Universe 9 is port 1's, its 30 remaining pixels.
+    CHECK_EQ(oPorts.WriteUniverse(9, 0, 510, CopyFromBuffer, vPayload.data()), 90);
+    CHECK_EQ(oPorts.WriteUniverse(8, 0, 510, CopyFromBuffer, vPayload.data()), 510);
+    CHECK_EQ(GetCommittedFrames(1), 1);
+    CHECK_EQ(GetCommittedFrames(2), 0);
+}
+
+int main()
+{
+    RUN_TEST(TestCompletionBitmap);
+    RUN_TEST(TestSixtyFourUniverses);
+    RUN_TEST(TestUniverseRouting);
+    return TestResult();
+}
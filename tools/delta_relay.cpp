@@ -0,0 +1,197 @@
+// Host side relay for the compressed pixel stream of main/delta_stream.h: takes ArtDmx and ArtSync from a
+// controller on PROJECT_UDP_ARTNET_PORT and sends each port's frames to the node as keyframes and deltas, on its
+// PROJECT_UDP_DELTA_STREAM_PORT. The node's key requests come back to the stream socket.
+//
+//   delta_relay [-k <key interval>] <node address> <port>:<start universe>:<led count> [...]
+//
+// A port's frame is sent once all its universes arrived, or on ArtSync once the controller sends those.
+// Linux only, built with the host tests: cmake -S test -B build-host && cmake --build build-host --target delta_relay
+#include "config.h"
+#include "artnet_packet.h"
+#include "delta_stream.h"
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+
+static constexpr size_t PIXELS_PER_UNIVERSE = 170;
+static constexpr int64_t STATS_INTERVAL_US = 10000000;
+
+typedef struct
+{
+    int32_t s32StartUniverse;
+    int32_t s32NoUniverses;
+    std::vector<uint8_t> vFrame; // RGB as assembled from ArtDmx
+    uint64_t u64ReceivedMask;    // universes since the last frame sent
+    std::unique_ptr<DeltaStream::Encoder> pEncoder;
+} RelayPort;
+
+static std::vector<RelayPort> g_vPorts;
+static int32_t g_s32StreamSocket = -1;
+static struct sockaddr_in g_stNode = {};
+static bool g_bSyncSeen = false;
+static uint64_t g_u64FrameBytes = 0;
+static uint64_t g_u64StreamBytes = 0;
+static uint32_t g_u32Frames = 0;
+static uint32_t g_u32KeyRequests = 0;
+
+static int64_t GetTimeUs()
+{
+    struct timespec stNow;
+    clock_gettime(CLOCK_MONOTONIC, &stNow);
+    return stNow.tv_sec * 1000000LL + stNow.tv_nsec / 1000;
+}
+
+static int32_t OpenSocket(uint16_t u16Port)
+{
+    int32_t s32Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int32_t s32One = 1;
+    setsockopt(s32Socket, SOL_SOCKET, SO_REUSEADDR, &s32One, sizeof(s32One));
+    setsockopt(s32Socket, SOL_SOCKET, SO_BROADCAST, &s32One, sizeof(s32One));
+    struct sockaddr_in stAddress = {};
+    stAddress.sin_family = AF_INET;
+    stAddress.sin_port = htons(u16Port);
+    stAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(s32Socket, (struct sockaddr *)&stAddress, sizeof(stAddress)) < 0)
+    {
+        perror("bind");
+        exit(1);
+    }
+    return s32Socket;
+}
+
+static void SendFrame(RelayPort &stPort)
+{
+    stPort.pEncoder->EncodeFrame(stPort.vFrame.data(), [](const uint8_t *pData, size_t u32Length)
+    {
+        sendto(g_s32StreamSocket, pData, u32Length, 0, (struct sockaddr *)&g_stNode, sizeof(g_stNode));
+        g_u64StreamBytes += u32Length;
+    });
+    g_u64FrameBytes += stPort.vFrame.size();
+    g_u32Frames++;
+    stPort.u64ReceivedMask = 0;
+}
+
+static void HandleArtNet(const uint8_t *pData, size_t u32Length)
+{
+    ArtNet::Packet oPacket;
+    if (oPacket.Parse(pData, u32Length, u32Length) != ArtNet::PARSE_OK)
+    {
+        return;
+    }
+    if (oPacket.GetOpCode() == ArtNet::OP_SYNC)
+    {
+        g_bSyncSeen = true;
+        for (RelayPort &stPort : g_vPorts)
+        {
+            if (stPort.u64ReceivedMask != 0)
+            {
+                SendFrame(stPort);
+            }
+        }
+        return;
+    }
+    if (oPacket.GetOpCode() != ArtNet::OP_DMX)
+    {
+        return;
+    }
+    for (RelayPort &stPort : g_vPorts)
+    {
+        int32_t s32Index = oPacket.GetPortAddress() - stPort.s32StartUniverse;
+        if (s32Index < 0 || s32Index >= stPort.s32NoUniverses)
+        {
+            continue;
+        }
+        size_t u32Offset = s32Index * PIXELS_PER_UNIVERSE * 3;
+        size_t u32Bytes = std::min<size_t>(oPacket.GetDmxLength() / 3 * 3, stPort.vFrame.size() - u32Offset);
+        memcpy(&stPort.vFrame[u32Offset], oPacket.GetDmxData(), u32Bytes);
+        stPort.u64ReceivedMask |= 1ULL << s32Index;
+        if (!g_bSyncSeen && stPort.u64ReceivedMask == (1ULL << stPort.s32NoUniverses) - 1)
+        {
+            SendFrame(stPort);
+        }
+    }
+}
+
+static void HandleKeyRequest(const uint8_t *pData, size_t u32Length)
+{
+    for (RelayPort &stPort : g_vPorts)
+    {
+        if (stPort.pEncoder->HandleKeyRequest(pData, u32Length))
+        {
+            g_u32KeyRequests++;
+        }
+    }
+}
+
+static void Usage(const char *pName)
+{
+    fprintf(stderr, "usage: %s [-k <key interval>] <node address> <port>:<start universe>:<led count> [...]\n", pName);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t u32KeyInterval = 0;
+    int32_t i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "-k") == 0)
+    {
+        u32KeyInterval = atoi(argv[i + 1]);
+        i += 2;
+    }
+    if (i + 1 >= argc)
+    {
+        Usage(argv[0]);
+    }
+    g_stNode.sin_family = AF_INET;
+    g_stNode.sin_port = htons(PROJECT_UDP_DELTA_STREAM_PORT);
+    if (inet_pton(AF_INET, argv[i++], &g_stNode.sin_addr) != 1)
+    {
+        Usage(argv[0]);
+    }
+    for (; i < argc; ++i)
+    {
+        int32_t s32Port, s32StartUniverse, s32LedCount;
+        if (sscanf(argv[i], "%d:%d:%d", &s32Port, &s32StartUniverse, &s32LedCount) != 3 || s32Port < 0 || s32Port > 255 ||
+            s32LedCount <= 0 || (size_t)s32LedCount > 64 * PIXELS_PER_UNIVERSE)
+        {
+            Usage(argv[0]);
+        }
+        RelayPort stPort;
+        stPort.s32StartUniverse = s32StartUniverse;
+        stPort.s32NoUniverses = (s32LedCount + PIXELS_PER_UNIVERSE - 1) / PIXELS_PER_UNIVERSE;
+        stPort.vFrame.assign(s32LedCount * 3, 0);
+        stPort.u64ReceivedMask = 0;
+        stPort.pEncoder.reset(new DeltaStream::Encoder(s32Port, s32LedCount, u32KeyInterval));
+        g_vPorts.push_back(std::move(stPort));
+    }
+
+    int32_t s32ArtNetSocket = OpenSocket(PROJECT_UDP_ARTNET_PORT);
+    g_s32StreamSocket = OpenSocket(0);
+    struct pollfd astPoll[2] = {{s32ArtNetSocket, POLLIN, 0}, {g_s32StreamSocket, POLLIN, 0}};
+    std::vector<uint8_t> vBuffer(2048);
+    int64_t s64StatsUs = GetTimeUs() + STATS_INTERVAL_US;
+    while (true)
+    {
+        poll(astPoll, 2, 1000);
+        ssize_t s32Length;
+        while ((s32Length = recv(s32ArtNetSocket, vBuffer.data(), vBuffer.size(), MSG_DONTWAIT)) > 0)
+        {
+            HandleArtNet(vBuffer.data(), s32Length);
+        }
+        while ((s32Length = recv(g_s32StreamSocket, vBuffer.data(), vBuffer.size(), MSG_DONTWAIT)) > 0)
+        {
+            HandleKeyRequest(vBuffer.data(), s32Length);
+        }
+        if (GetTimeUs() >= s64StatsUs)
+        {
+            printf("%u frames, %.2f frame bytes per stream byte, %u key requests\n", g_u32Frames,
+                   g_u64StreamBytes ? (double)g_u64FrameBytes / g_u64StreamBytes : 0.0, g_u32KeyRequests);
+            s64StatsUs += STATS_INTERVAL_US;
+        }
+    }
+}